@@ -0,0 +1,437 @@
+// End-to-end renderer benchmark: runs fixed procedural scenes through the real
+// renderer and frame graph in a headless context (offscreen framebuffer, no
+// vsync) and reports CPU frame times and GPU pass times from timestamp queries.
+// Scenes are deterministic: placement comes from the entity index and animation
+// from the frame number, so a hash of the final image identifies the output.
+// Works on Mesa llvmpipe (GL 4.5) for CI machines without a GPU.
+//
+// Usage: Henky3DBench [--scene grid|lights|atlas] [--frames 600] [--warmup 60]
+//                     [--width 1280] [--height 720] [--output bench.json] [--windowed]
+
+#include "core/Window.h"
+#include "core/Profiler.h"
+#include "core/FrameStats.h"
+#include "graphics/GraphicsDevice.h"
+#include "graphics/Renderer.h"
+#include "graphics/ConstantBuffers.h"
+#include "graphics/ShadowMap.h"
+#include "graphics/FrameGraph.h"
+#include "ecs/ECSWorld.h"
+#include "ecs/Components.h"
+#include "ecs/TransformSystem.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Henky3D;
+
+struct BenchOptions {
+    std::string Scene;          // Empty runs every scene
+    uint32_t Frames = 600;
+    uint32_t Warmup = 60;
+    uint32_t Width = 1280;
+    uint32_t Height = 720;
+    std::string OutputPath;
+    bool Windowed = false;
+};
+
+struct BenchScene {
+    const char* Name;
+    const char* Description;
+    std::function<void(ECSWorld&)> Build;
+};
+
+struct BenchTimes {
+    FrameTimeHistogram Histogram;
+    uint32_t MaxUs = 0;
+};
+
+struct BenchResult {
+    std::string Name;
+    uint32_t Entities = 0;
+    uint32_t Lights = 0;
+    BenchTimes Cpu;
+    BenchTimes Gpu;
+    std::map<std::string, std::pair<double, uint32_t>> GpuPasses;  // Total ms, samples
+    RenderStats LastStats;
+    uint64_t ImageHash = 0;
+};
+
+static void PrintUsage() {
+    std::cerr << "Usage: Henky3DBench [--scene grid|lights|atlas] [--frames 600] [--warmup 60]" << std::endl;
+    std::cerr << "                    [--width 1280] [--height 720] [--output bench.json] [--windowed]" << std::endl;
+}
+
+// Deterministic value in [0, 1) from an index
+static float Hash01(uint32_t index) {
+    index ^= index >> 16;
+    index *= 0x7feb352dU;
+    index ^= index >> 15;
+    index *= 0x846ca68bU;
+    index ^= index >> 16;
+    return static_cast<float>(index & 0xFFFFFF) / 16777216.0f;
+}
+
+static void AddCube(ECSWorld& world, const glm::vec3& position, const glm::vec3& scale, const glm::vec4& color, bool isStatic) {
+    entt::entity entity = world.CreateEntity();
+    Transform& transform = world.AddComponent<Transform>(entity);
+    transform.Position = position;
+    transform.Scale = scale;
+    Renderable& renderable = world.AddComponent<Renderable>(entity);
+    renderable.Color = color;
+    renderable.Static = isStatic;
+    world.AddComponent<BoundingBox>(entity);
+}
+
+static void AddSun(ECSWorld& world) {
+    Light& sun = world.AddComponent<Light>(world.CreateEntity());
+    sun.LightType = Light::Type::Directional;
+    sun.Direction = { 0.4f, -1.0f, 0.3f };
+}
+
+static void AddCubeField(ECSWorld& world, int halfSize, float spacing) {
+    // Ground plane plus a field of static cubes with every fourth one animated
+    AddCube(world, { 0.0f, -1.0f, 0.0f }, { halfSize * spacing * 2.0f, 0.2f, halfSize * spacing * 2.0f }, { 0.6f, 0.6f, 0.6f, 1.0f }, true);
+    uint32_t index = 0;
+    for (int z = -halfSize; z < halfSize; z++) {
+        for (int x = -halfSize; x < halfSize; x++, index++) {
+            float height = 0.5f + 2.0f * Hash01(index);
+            glm::vec4 color(Hash01(index * 3 + 1), Hash01(index * 3 + 2), Hash01(index * 3 + 3), 1.0f);
+            AddCube(world, { x * spacing, height * 0.5f - 0.9f, z * spacing }, { 0.8f, height, 0.8f }, color, index % 4 != 0);
+        }
+    }
+}
+
+static std::vector<BenchScene> CreateScenes() {
+    return {
+        { "grid", "4096 cubes, cascaded sun shadows",
+          [](ECSWorld& world) {
+              AddSun(world);
+              AddCubeField(world, 32, 2.0f);
+          } },
+        { "lights", "1024 cubes, 2048 unshadowed clustered point lights",
+          [](ECSWorld& world) {
+              AddSun(world);
+              AddCubeField(world, 16, 2.0f);
+              for (uint32_t i = 0; i < 2048; i++) {
+                  Light& light = world.AddComponent<Light>(world.CreateEntity());
+                  light.LightType = Light::Type::Point;
+                  light.Position = { (Hash01(i * 5) - 0.5f) * 64.0f, 0.2f + 2.0f * Hash01(i * 5 + 1), (Hash01(i * 5 + 2) - 0.5f) * 64.0f };
+                  light.Color = { Hash01(i * 5 + 3), Hash01(i * 5 + 4), 1.0f - Hash01(i * 5 + 3), 1.0f };
+                  light.Intensity = 0.8f;
+                  light.Range = 2.5f;
+                  light.CastShadows = false;
+              }
+          } },
+        { "atlas", "1024 cubes, 48 shadowed point and spot lights in the shadow atlas",
+          [](ECSWorld& world) {
+              AddSun(world);
+              AddCubeField(world, 16, 2.0f);
+              for (uint32_t i = 0; i < 48; i++) {
+                  Light& light = world.AddComponent<Light>(world.CreateEntity());
+                  light.LightType = i % 3 == 0 ? Light::Type::Spot : Light::Type::Point;
+                  light.Position = { (Hash01(i * 7) - 0.5f) * 28.0f, 3.0f + 2.0f * Hash01(i * 7 + 1), (Hash01(i * 7 + 2) - 0.5f) * 28.0f };
+                  light.Direction = { 0.3f, -1.0f, 0.2f };
+                  light.Color = { Hash01(i * 7 + 3), Hash01(i * 7 + 4), Hash01(i * 7 + 5), 1.0f };
+                  light.Intensity = 3.0f;
+                  light.Range = 8.0f;
+              }
+          } },
+    };
+}
+
+static void AddSample(BenchTimes& times, double ms) {
+    uint32_t microseconds = static_cast<uint32_t>(std::min(ms * 1000.0, static_cast<double>(FrameTimeHistogram::MaxValue)));
+    times.Histogram.Add(microseconds);
+    times.MaxUs = std::max(times.MaxUs, microseconds);
+}
+
+static void WriteTimes(std::ostream& out, const BenchTimes& times) {
+    auto ms = [&times](double percentile) {
+        return std::min(times.Histogram.GetPercentile(percentile), times.MaxUs) / 1000.0;
+    };
+    out << "{\"samples\": " << times.Histogram.GetCount() << ", \"mean_ms\": " << times.Histogram.GetMean() / 1000.0
+        << ", \"p50_ms\": " << ms(50.0) << ", \"p95_ms\": " << ms(95.0) << ", \"p99_ms\": " << ms(99.0)
+        << ", \"max_ms\": " << times.MaxUs / 1000.0 << "}";
+}
+
+static uint64_t HashPixels(const std::vector<uint8_t>& pixels) {
+    uint64_t hash = 14695981039346656037ull;
+    for (uint8_t byte : pixels) {
+        hash = (hash ^ byte) * 1099511628211ull;
+    }
+    return hash;
+}
+
+static void SetupFrameConstants(Renderer& renderer, ECSWorld& world, entt::entity cameraEntity, const BenchOptions& options,
+                                float time) {
+    Camera& camera = world.GetComponent<Camera>(cameraEntity);
+
+    glm::vec3 lightDirection(0.4f, -1.0f, 0.3f);
+    glm::vec4 lightColor(1.0f, 1.0f, 0.9f, 1.0f);
+    auto lightView = world.GetRegistry().view<Light>();
+    for (auto entity : lightView) {
+        const Light& light = lightView.get<Light>(entity);
+        if (light.LightType == Light::Type::Directional) {
+            lightDirection = light.Direction;
+            lightColor = light.Color;
+            break;
+        }
+    }
+
+    ShadowMap* shadowMap = renderer.GetShadowMap();
+    shadowMap->UpdateCascades(camera, lightDirection, ShadowMap::FindReceiverDistance(&world, camera));
+
+    PerFrameConstants constants;
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = camera.GetProjectionMatrix();
+    constants.ViewMatrix = view;
+    constants.ProjectionMatrix = projection;
+    constants.ViewProjectionMatrix = projection * view;
+    constants.CameraPosition = glm::vec4(camera.Position, 1.0f);
+    constants.LightDirection = glm::vec4(lightDirection, 0.0f);
+    constants.LightColor = lightColor;
+    constants.AmbientColor = glm::vec4(0.2f, 0.2f, 0.25f, 1.0f);
+    constants.Time = time;
+    constants.DeltaTime = 1.0f / 60.0f;
+    constants.ShadowBias = 0.005f;
+    constants.ShadowsEnabled = 1.0f;
+    shadowMap->WriteConstants(constants);
+    renderer.SetPerFrameConstants(constants);
+
+    renderer.GetAssetRegistry()->GetTextureResidency()->Update(&world, camera, options.Height);
+}
+
+static BenchResult RunScene(Window& window, GraphicsDevice& device, const BenchScene& scene, const BenchOptions& options) {
+    BenchResult result;
+    result.Name = scene.Name;
+
+    // A fresh renderer per scene so caches and atlas allocations start cold and equal
+    auto renderer = std::make_unique<Renderer>(&device);
+    ECSWorld world;
+    scene.Build(world);
+
+    entt::entity cameraEntity = world.CreateEntity();
+    Camera& camera = world.AddComponent<Camera>(cameraEntity);
+    camera.AspectRatio = static_cast<float>(options.Width) / static_cast<float>(options.Height);
+    camera.Position = { 0.0f, 14.0f, -34.0f };
+    camera.Target = { 0.0f, 0.0f, 0.0f };
+
+    auto& registry = world.GetRegistry();
+    result.Entities = static_cast<uint32_t>(registry.view<Renderable>().size());
+    result.Lights = static_cast<uint32_t>(registry.view<Light>().size());
+
+    FrameGraph frameGraph(&device);
+    frameGraph.SetGpuProfiler(renderer->GetGpuProfiler());
+    FrameGraphResource backBuffer = frameGraph.ImportTexture("BackBuffer", device.GetBackBuffer());
+    FrameGraphResource shadowMap = frameGraph.ImportTexture("ShadowMap", renderer->GetShadowMap()->GetDepthTexture());
+    FrameGraphResource shadowAtlas = frameGraph.ImportTexture("ShadowAtlas", renderer->GetShadowAtlas()->GetDepthTexture());
+    frameGraph.AddPass("Shadows",
+        [&](FrameGraphBuilder& builder) {
+            shadowMap = builder.Write(shadowMap);
+            shadowAtlas = builder.Write(shadowAtlas);
+        },
+        [&](const FrameGraph&) {
+            renderer->RenderShadowPass(&world);
+            glViewport(0, 0, options.Width, options.Height);
+        });
+    frameGraph.AddPass("Scene",
+        [&](FrameGraphBuilder& builder) {
+            builder.Read(shadowMap);
+            builder.Read(shadowAtlas);
+            builder.Write(backBuffer);
+            builder.SideEffect();
+        },
+        [&](const FrameGraph&) {
+            renderer->RenderScene(&world, true, true);
+        });
+
+    GpuProfiler* gpuProfiler = renderer->GetGpuProfiler();
+    uint64_t lastGpuFrame = 0;
+    auto collectGpu = [&]() {
+        for (const GpuFrameTimings& frame : gpuProfiler->GetHistory()) {
+            if (frame.FrameIndex <= lastGpuFrame) {
+                continue;
+            }
+            lastGpuFrame = frame.FrameIndex;
+            if (frame.FrameIndex <= options.Warmup) {
+                continue;
+            }
+            AddSample(result.Gpu, frame.TotalMs);
+            for (const GpuPassTiming& pass : frame.Passes) {
+                auto& total = result.GpuPasses[std::string(pass.Depth, ' ') + pass.Name];
+                total.first += pass.GpuMs;
+                total.second++;
+            }
+        }
+    };
+
+    const uint32_t totalFrames = options.Warmup + options.Frames;
+    for (uint32_t frame = 0; frame < totalFrames; frame++) {
+        Profiler::BeginFrame();
+        HENKY_PROFILE_ZONE("BenchFrame");
+        auto frameStart = std::chrono::steady_clock::now();
+        window.ProcessMessages();
+
+        // Fixed-step animation keeps every run identical
+        const float time = frame / 60.0f;
+        uint32_t index = 0;
+        auto view = registry.view<Transform, Renderable>();
+        for (auto entity : view) {
+            if (!view.get<Renderable>(entity).Static) {
+                Transform& transform = view.get<Transform>(entity);
+                transform.Rotation.y = time + Hash01(index);
+                transform.MarkDirty();
+            }
+            index++;
+        }
+        TransformSystem::UpdateTransforms(&world);
+
+        device.BeginFrame();
+        renderer->BeginFrame();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glViewport(0, 0, options.Width, options.Height);
+        SetupFrameConstants(*renderer, world, cameraEntity, options, time);
+        frameGraph.Execute();
+        result.LastStats = renderer->GetStats();
+        device.EndFrame();
+
+        double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        if (frame >= options.Warmup) {
+            AddSample(result.Cpu, cpuMs);
+        }
+        collectGpu();
+    }
+
+    std::vector<uint8_t> pixels;
+    device.ReadBackBuffer(pixels);
+    result.ImageHash = HashPixels(pixels);
+
+    // Let the last frames' queries resolve
+    device.WaitForGPU();
+    for (uint32_t i = 0; i <= GpuProfiler::Latency; i++) {
+        gpuProfiler->BeginFrame();
+    }
+    collectGpu();
+    return result;
+}
+
+static void PrintResult(const BenchResult& result) {
+    auto ms = [](const BenchTimes& times, double percentile) {
+        return std::min(times.Histogram.GetPercentile(percentile), times.MaxUs) / 1000.0;
+    };
+    std::printf("%-8s %6u ent %5u lights | CPU mean %7.3f p50 %7.3f p99 %7.3f ms | GPU mean %7.3f p50 %7.3f p99 %7.3f ms | %016llx\n",
+                result.Name.c_str(), result.Entities, result.Lights,
+                result.Cpu.Histogram.GetMean() / 1000.0, ms(result.Cpu, 50.0), ms(result.Cpu, 99.0),
+                result.Gpu.Histogram.GetMean() / 1000.0, ms(result.Gpu, 50.0), ms(result.Gpu, 99.0),
+                static_cast<unsigned long long>(result.ImageHash));
+    for (const auto& pass : result.GpuPasses) {
+        std::printf("           GPU %-24s %7.3f ms\n", pass.first.c_str(), pass.second.first / std::max(1u, pass.second.second));
+    }
+}
+
+static bool WriteResults(const std::string& path, const BenchOptions& options, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: cannot write " << path << std::endl;
+        return false;
+    }
+    out << "{\n  \"gl_renderer\": \"" << reinterpret_cast<const char*>(glGetString(GL_RENDERER))
+        << "\",\n  \"gl_version\": \"" << reinterpret_cast<const char*>(glGetString(GL_VERSION))
+        << "\",\n  \"width\": " << options.Width << ", \"height\": " << options.Height
+        << ", \"frames\": " << options.Frames << ", \"warmup\": " << options.Warmup << ",\n  \"scenes\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult& result = results[i];
+        char hash[32];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(result.ImageHash));
+        out << (i ? ",\n" : "\n") << "    {\"name\": \"" << result.Name << "\", \"entities\": " << result.Entities
+            << ", \"lights\": " << result.Lights << ", \"draws\": " << result.LastStats.DrawCount
+            << ", \"instances\": " << result.LastStats.InstanceCount
+            << ", \"shadow_instances\": " << result.LastStats.ShadowInstanceCount
+            << ", \"image_hash\": \"" << hash << "\",\n     \"cpu\": ";
+        WriteTimes(out, result.Cpu);
+        out << ",\n     \"gpu\": ";
+        WriteTimes(out, result.Gpu);
+        out << ",\n     \"gpu_passes_ms\": {";
+        bool first = true;
+        for (const auto& pass : result.GpuPasses) {
+            std::string name = pass.first;
+            name.erase(0, name.find_first_not_of(' '));
+            out << (first ? "" : ", ") << "\"" << name << "\": " << pass.second.first / std::max(1u, pass.second.second);
+            first = false;
+        }
+        out << "}}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        auto next = [&](const char* flag) -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << flag << " needs a value" << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        if (std::strcmp(argv[i], "--scene") == 0) options.Scene = next("--scene");
+        else if (std::strcmp(argv[i], "--frames") == 0) options.Frames = static_cast<uint32_t>(std::stoul(next("--frames")));
+        else if (std::strcmp(argv[i], "--warmup") == 0) options.Warmup = static_cast<uint32_t>(std::stoul(next("--warmup")));
+        else if (std::strcmp(argv[i], "--width") == 0) options.Width = static_cast<uint32_t>(std::stoul(next("--width")));
+        else if (std::strcmp(argv[i], "--height") == 0) options.Height = static_cast<uint32_t>(std::stoul(next("--height")));
+        else if (std::strcmp(argv[i], "--output") == 0) options.OutputPath = next("--output");
+        else if (std::strcmp(argv[i], "--windowed") == 0) options.Windowed = true;
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::vector<BenchScene> scenes = CreateScenes();
+    if (!options.Scene.empty()) {
+        scenes.erase(std::remove_if(scenes.begin(), scenes.end(),
+                                    [&](const BenchScene& scene) { return options.Scene != scene.Name; }),
+                     scenes.end());
+        if (scenes.empty()) {
+            std::cerr << "Error: unknown scene " << options.Scene << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    try {
+        WindowOptions windowOptions;
+        windowOptions.Headless = !options.Windowed;
+        windowOptions.VSync = false;
+        Window window("Henky3D Bench", options.Width, options.Height, windowOptions);
+        GraphicsDevice device(&window);
+        Profiler::SetThreadName("Main");
+
+        std::vector<BenchResult> results;
+        for (const BenchScene& scene : scenes) {
+            std::cout << "Running " << scene.Name << ": " << scene.Description << std::endl;
+            results.push_back(RunScene(window, device, scene, options));
+            PrintResult(results.back());
+        }
+        if (!options.OutputPath.empty() && !WriteResults(options.OutputPath, options, results)) {
+            return 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
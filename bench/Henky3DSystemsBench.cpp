@@ -0,0 +1,397 @@
+// GPU-free ECS and systems microbenchmark. Builds procedural scenes of 1k to 1M
+// entities and times TransformSystem::UpdateTransforms, CullingSystem::CullEntities
+// and render extraction (Renderer::ExtractDraws) separately, with warmup runs,
+// repeated measurements and JSON output for tracking regressions across versions.
+// Placement comes from hashed entity indices, so every run builds the same scenes.
+// Every transform is marked dirty before each repetition (outside the timing), so
+// UpdateTransforms is measured as a full hierarchy rebuild.
+//
+// Usage: Henky3DSystemsBench [--scene grid|city|deep|wide] [--sizes 1000,10000,100000,1000000]
+//                            [--warmup 3] [--repetitions 10] [--threads 0] [--budget-ms 2000]
+//                            [--output systems.json]
+
+#include "core/FrameAllocator.h"
+#include "core/JobSystem.h"
+#include "ecs/ECSWorld.h"
+#include "ecs/Components.h"
+#include "ecs/TransformSystem.h"
+#include "ecs/CullingSystem.h"
+#include "graphics/Renderer.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef HENKY_BENCH_VERSION
+#define HENKY_BENCH_VERSION "unknown"
+#endif
+
+using namespace Henky3D;
+
+struct SystemsBenchOptions {
+    std::string Scene;          // Empty runs every scene
+    std::vector<uint32_t> Sizes = { 1000, 10000, 100000, 1000000 };
+    uint32_t Warmup = 3;
+    uint32_t Repetitions = 10;
+    uint32_t Threads = 0;       // Job system workers for extraction, 0 picks the default
+    double BudgetMs = 2000.0;   // Larger sizes of a scene are skipped once a median exceeds this
+    std::string OutputPath;
+};
+
+struct SystemsScene {
+    const char* Name;
+    const char* Description;
+    // Creates count renderables and returns the half-size of the area they cover
+    std::function<float(ECSWorld&, uint32_t)> Build;
+};
+
+struct TimingStats {
+    double MinMs = 0.0;
+    double MedianMs = 0.0;
+    double MeanMs = 0.0;
+    double P95Ms = 0.0;
+    double MaxMs = 0.0;
+    double StdDevMs = 0.0;
+};
+
+struct SystemsCase {
+    std::string Scene;
+    uint32_t Entities = 0;
+    uint32_t Roots = 0;
+    uint32_t MaxDepth = 0;
+    uint32_t Visible = 0;
+    uint32_t Extracted = 0;
+    double BuildMs = 0.0;
+    TimingStats Transforms;
+    TimingStats Culling;
+    TimingStats Extraction;
+};
+
+static void PrintUsage() {
+    std::cerr << "Usage: Henky3DSystemsBench [--scene grid|city|deep|wide] [--sizes 1000,10000,100000,1000000]" << std::endl;
+    std::cerr << "                           [--warmup 3] [--repetitions 10] [--threads 0] [--budget-ms 2000]" << std::endl;
+    std::cerr << "                           [--output systems.json]" << std::endl;
+}
+
+// Deterministic value in [0, 1) from an index
+static float Hash01(uint32_t index) {
+    index ^= index >> 16;
+    index *= 0x7feb352dU;
+    index ^= index >> 15;
+    index *= 0x846ca68bU;
+    index ^= index >> 16;
+    return static_cast<float>(index & 0xFFFFFF) / 16777216.0f;
+}
+
+static entt::entity AddRenderable(ECSWorld& world, const glm::vec3& position, const glm::vec3& scale, entt::entity parent) {
+    entt::entity entity = world.CreateEntity();
+    Transform& transform = world.AddComponent<Transform>(entity);
+    transform.Position = position;
+    transform.Scale = scale;
+    transform.Parent = parent;
+    world.AddComponent<Renderable>(entity);
+    world.AddComponent<BoundingBox>(entity);
+    return entity;
+}
+
+static std::vector<SystemsScene> CreateScenes() {
+    return {
+        { "grid", "Uniform grid of flat entities, spacing 2",
+          [](ECSWorld& world, uint32_t count) {
+              const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+              const float half = side * 1.0f;
+              for (uint32_t i = 0; i < count; i++) {
+                  AddRenderable(world, { (i % side) * 2.0f - half, 0.0f, (i / side) * 2.0f - half }, glm::vec3(1.0f), entt::null);
+              }
+              return half;
+          } },
+        { "city", "Flat entities clustered into city blocks of about 256 buildings",
+          [](ECSWorld& world, uint32_t count) {
+              const uint32_t blocks = std::max(1u, count / 256);
+              const float half = 2.0f * std::sqrt(static_cast<float>(count));
+              for (uint32_t i = 0; i < count; i++) {
+                  const uint32_t block = i % blocks;
+                  const glm::vec3 center((Hash01(block * 2) - 0.5f) * 2.0f * half, 0.0f, (Hash01(block * 2 + 1) - 0.5f) * 2.0f * half);
+                  // Sum of two hashes pulls buildings toward the block center
+                  const glm::vec3 offset((Hash01(i * 4) + Hash01(i * 4 + 1) - 1.0f) * 16.0f, 0.0f,
+                                         (Hash01(i * 4 + 2) + Hash01(i * 4 + 3) - 1.0f) * 16.0f);
+                  const float height = 1.0f + 15.0f * Hash01(i * 4 + 3) * Hash01(i * 4 + 1);
+                  AddRenderable(world, center + offset + glm::vec3(0.0f, height * 0.5f, 0.0f), { 1.5f, height, 1.5f }, entt::null);
+              }
+              return half + 16.0f;
+          } },
+        { "deep", "Chains 64 levels deep, each child offset and rotated from its parent",
+          [](ECSWorld& world, uint32_t count) {
+              constexpr uint32_t Depth = 64;
+              const uint32_t chains = (count + Depth - 1) / Depth;
+              const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(chains))));
+              const float half = side * 4.0f;
+              entt::entity parent = entt::null;
+              for (uint32_t i = 0; i < count; i++) {
+                  const uint32_t chain = i / Depth;
+                  if (i % Depth == 0) {
+                      parent = AddRenderable(world, { (chain % side) * 8.0f - half, 0.0f, (chain / side) * 8.0f - half }, glm::vec3(1.0f), entt::null);
+                      continue;
+                  }
+                  parent = AddRenderable(world, { 0.0f, 1.0f, 0.0f }, glm::vec3(0.98f), parent);
+                  world.GetComponent<Transform>(parent).Rotation = { 0.02f, 0.1f, 0.0f };
+              }
+              return half;
+          } },
+        { "wide", "One level of 1023 children under each root",
+          [](ECSWorld& world, uint32_t count) {
+              constexpr uint32_t Width = 1024;
+              const uint32_t roots = (count + Width - 1) / Width;
+              const uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(roots))));
+              const float half = side * 40.0f;
+              entt::entity root = entt::null;
+              for (uint32_t i = 0; i < count; i++) {
+                  const uint32_t group = i / Width;
+                  if (i % Width == 0) {
+                      root = AddRenderable(world, { (group % side) * 80.0f - half, 0.0f, (group / side) * 80.0f - half }, glm::vec3(1.0f), entt::null);
+                      continue;
+                  }
+                  const uint32_t child = i % Width;
+                  AddRenderable(world, { (child % 32) * 2.0f - 32.0f, 0.0f, (child / 32) * 2.0f - 32.0f }, glm::vec3(0.8f), root);
+              }
+              return half + 32.0f;
+          } },
+    };
+}
+
+static TimingStats ComputeStats(std::vector<double> samples) {
+    TimingStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    const size_t count = samples.size();
+    stats.MinMs = samples.front();
+    stats.MaxMs = samples.back();
+    stats.MedianMs = count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+    stats.P95Ms = samples[std::min(count - 1, static_cast<size_t>(std::ceil(0.95 * count)) - 1)];
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    stats.MeanMs = sum / count;
+    double variance = 0.0;
+    for (double sample : samples) {
+        variance += (sample - stats.MeanMs) * (sample - stats.MeanMs);
+    }
+    stats.StdDevMs = count > 1 ? std::sqrt(variance / (count - 1)) : 0.0;
+    return stats;
+}
+
+template<typename Function>
+static double TimeMs(Function&& function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void ComputeHierarchy(ECSWorld& world, SystemsCase& result) {
+    auto& registry = world.GetRegistry();
+    auto view = registry.view<Transform>();
+    for (auto entity : view) {
+        uint32_t depth = 0;
+        for (entt::entity parent = view.get<Transform>(entity).Parent; parent != entt::null; parent = registry.get<Transform>(parent).Parent) {
+            depth++;
+        }
+        result.Roots += depth == 0 ? 1 : 0;
+        result.MaxDepth = std::max(result.MaxDepth, depth);
+    }
+}
+
+static SystemsCase RunCase(const SystemsScene& scene, uint32_t count, JobSystem& jobSystem, const SystemsBenchOptions& options) {
+    SystemsCase result;
+    result.Scene = scene.Name;
+    result.Entities = count;
+
+    ECSWorld world;
+    float half = 0.0f;
+    result.BuildMs = TimeMs([&]() { half = scene.Build(world, count); });
+    ComputeHierarchy(world, result);
+
+    // From one corner of the scene toward the middle, so culling keeps part of it
+    Camera camera;
+    camera.Position = { -half, 0.25f * half + 10.0f, -half };
+    camera.Target = { 0.0f, 0.0f, 0.0f };
+    camera.FarPlane = 2.0f * half + 50.0f;
+    const Frustum frustum = camera.GetFrustum();
+
+    auto& registry = world.GetRegistry();
+    auto transforms = registry.view<Transform>();
+    std::vector<entt::entity> entities;
+    std::vector<PerDrawConstants> draws;
+    std::vector<DrawBounds> bounds;
+    std::vector<double> transformSamples, cullingSamples, extractionSamples;
+    FrameArena arena;
+
+    for (uint32_t repetition = 0; repetition < options.Warmup + options.Repetitions; repetition++) {
+        for (auto entity : transforms) {
+            transforms.get<Transform>(entity).MarkDirty();
+        }
+
+        arena.BeginFrame();
+        const double transformMs = TimeMs([&]() { TransformSystem::UpdateTransforms(&world); });
+        FrameVector<entt::entity> visible(arena);
+        const double cullingMs = TimeMs([&]() { visible = CullingSystem::CullEntities(&world, frustum, arena); });
+        const double extractionMs = TimeMs([&]() { Renderer::ExtractDraws(&world, jobSystem, 1, entities, draws, bounds); });
+        result.Visible = static_cast<uint32_t>(visible.size());
+        result.Extracted = static_cast<uint32_t>(draws.size());
+
+        // A run over budget (even a warmup run) is kept as the only sample; repeating it would only cost time
+        const bool overBudget = std::max({ transformMs, cullingMs, extractionMs }) > options.BudgetMs;
+        if (repetition >= options.Warmup || overBudget) {
+            transformSamples.push_back(transformMs);
+            cullingSamples.push_back(cullingMs);
+            extractionSamples.push_back(extractionMs);
+        }
+        if (overBudget) {
+            break;
+        }
+    }
+
+    result.Transforms = ComputeStats(std::move(transformSamples));
+    result.Culling = ComputeStats(std::move(cullingSamples));
+    result.Extraction = ComputeStats(std::move(extractionSamples));
+    return result;
+}
+
+static void PrintCase(const SystemsCase& result) {
+    auto nsPerEntity = [&result](const TimingStats& stats) { return stats.MedianMs * 1.0e6 / std::max(1u, result.Entities); };
+    std::printf("%-5s %8u | transforms %9.3f ms (%6.1f ns/ent) | cull %9.3f ms (%6.1f ns/ent) | extract %9.3f ms (%6.1f ns/ent) | visible %u\n",
+                result.Scene.c_str(), result.Entities,
+                result.Transforms.MedianMs, nsPerEntity(result.Transforms),
+                result.Culling.MedianMs, nsPerEntity(result.Culling),
+                result.Extraction.MedianMs, nsPerEntity(result.Extraction), result.Visible);
+}
+
+static void WriteStats(std::ostream& out, const TimingStats& stats) {
+    out << "{\"min_ms\": " << stats.MinMs << ", \"median_ms\": " << stats.MedianMs << ", \"mean_ms\": " << stats.MeanMs
+        << ", \"p95_ms\": " << stats.P95Ms << ", \"max_ms\": " << stats.MaxMs << ", \"stddev_ms\": " << stats.StdDevMs << "}";
+}
+
+static bool WriteResults(const std::string& path, const SystemsBenchOptions& options, uint32_t workers,
+                         const std::vector<SystemsCase>& cases, const std::vector<std::pair<std::string, uint32_t>>& skipped) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Error: cannot write " << path << std::endl;
+        return false;
+    }
+    out << "{\n  \"version\": \"" << HENKY_BENCH_VERSION << "\", \"warmup\": " << options.Warmup
+        << ", \"repetitions\": " << options.Repetitions << ", \"workers\": " << workers
+        << ", \"budget_ms\": " << options.BudgetMs << ",\n  \"cases\": [";
+    for (size_t i = 0; i < cases.size(); i++) {
+        const SystemsCase& result = cases[i];
+        out << (i ? ",\n" : "\n") << "    {\"scene\": \"" << result.Scene << "\", \"entities\": " << result.Entities
+            << ", \"roots\": " << result.Roots << ", \"max_depth\": " << result.MaxDepth
+            << ", \"visible\": " << result.Visible << ", \"extracted\": " << result.Extracted
+            << ", \"build_ms\": " << result.BuildMs << ",\n     \"transforms\": ";
+        WriteStats(out, result.Transforms);
+        out << ",\n     \"culling\": ";
+        WriteStats(out, result.Culling);
+        out << ",\n     \"extraction\": ";
+        WriteStats(out, result.Extraction);
+        out << "}";
+    }
+    out << "\n  ],\n  \"skipped\": [";
+    for (size_t i = 0; i < skipped.size(); i++) {
+        out << (i ? ", " : "") << "{\"scene\": \"" << skipped[i].first << "\", \"entities\": " << skipped[i].second << "}";
+    }
+    out << "]\n}\n";
+    return static_cast<bool>(out);
+}
+
+static bool ParseSizes(const char* text, std::vector<uint32_t>& sizes) {
+    sizes.clear();
+    for (const char* cursor = text; *cursor;) {
+        char* end = nullptr;
+        unsigned long value = std::strtoul(cursor, &end, 10);
+        if (end == cursor || value == 0) {
+            return false;
+        }
+        if (*end && *end != ',') {
+            return false;
+        }
+        sizes.push_back(static_cast<uint32_t>(value));
+        cursor = *end == ',' ? end + 1 : end;
+    }
+    std::sort(sizes.begin(), sizes.end());
+    return !sizes.empty();
+}
+
+int main(int argc, char** argv) {
+    SystemsBenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        auto next = [&](const char* flag) -> const char* {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << flag << " needs a value" << std::endl;
+                std::exit(1);
+            }
+            return argv[++i];
+        };
+        if (std::strcmp(argv[i], "--scene") == 0) options.Scene = next("--scene");
+        else if (std::strcmp(argv[i], "--sizes") == 0) {
+            if (!ParseSizes(next("--sizes"), options.Sizes)) {
+                std::cerr << "Error: --sizes expects a comma-separated list of entity counts" << std::endl;
+                return 1;
+            }
+        }
+        else if (std::strcmp(argv[i], "--warmup") == 0) options.Warmup = static_cast<uint32_t>(std::stoul(next("--warmup")));
+        else if (std::strcmp(argv[i], "--repetitions") == 0) options.Repetitions = std::max(1u, static_cast<uint32_t>(std::stoul(next("--repetitions"))));
+        else if (std::strcmp(argv[i], "--threads") == 0) options.Threads = static_cast<uint32_t>(std::stoul(next("--threads")));
+        else if (std::strcmp(argv[i], "--budget-ms") == 0) options.BudgetMs = std::stod(next("--budget-ms"));
+        else if (std::strcmp(argv[i], "--output") == 0) options.OutputPath = next("--output");
+        else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::vector<SystemsScene> scenes = CreateScenes();
+    if (!options.Scene.empty()) {
+        scenes.erase(std::remove_if(scenes.begin(), scenes.end(),
+                                    [&](const SystemsScene& scene) { return options.Scene != scene.Name; }),
+                     scenes.end());
+        if (scenes.empty()) {
+            std::cerr << "Error: unknown scene " << options.Scene << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    JobSystem jobSystem(options.Threads);
+    std::vector<SystemsCase> cases;
+    std::vector<std::pair<std::string, uint32_t>> skipped;
+    for (const SystemsScene& scene : scenes) {
+        std::cout << scene.Name << ": " << scene.Description << std::endl;
+        bool overBudget = false;
+        for (uint32_t count : options.Sizes) {
+            if (overBudget) {
+                // Sizes run in ascending order, so a larger one would only be slower
+                std::printf("%-5s %8u | skipped, a smaller size exceeded %.0f ms\n", scene.Name, count, options.BudgetMs);
+                skipped.emplace_back(scene.Name, count);
+                continue;
+            }
+            cases.push_back(RunCase(scene, count, jobSystem, options));
+            PrintCase(cases.back());
+            const SystemsCase& result = cases.back();
+            overBudget = std::max({ result.Transforms.MedianMs, result.Culling.MedianMs, result.Extraction.MedianMs }) > options.BudgetMs;
+        }
+    }
+
+    if (!options.OutputPath.empty() && !WriteResults(options.OutputPath, options, jobSystem.GetWorkerCount(), cases, skipped)) {
+        return 1;
+    }
+    return 0;
+}
@@ -3,12 +3,26 @@
 #ifndef COMMON_GLSL
 #define COMMON_GLSL
 
+// HENKY_BINDLESS is injected by the renderer when ARB_bindless_texture is available
+#ifdef HENKY_BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+
+// HENKY_DRAW_PARAMETERS_ARB is injected on GL 4.5 drivers, which get these shaders as #version 450
+#ifdef HENKY_DRAW_PARAMETERS_ARB
+#extension GL_ARB_shader_draw_parameters : require
+#define BASE_INSTANCE gl_BaseInstanceARB
+#else
+#define BASE_INSTANCE gl_BaseInstance
+#endif
+
+#define MAX_SHADOW_CASCADES 4
+
 // Per-frame constants updated once per frame
 layout(std140, binding = 0) uniform PerFrameConstants {
     mat4 ViewMatrix;
     mat4 ProjectionMatrix;
     mat4 ViewProjectionMatrix;
-    mat4 LightViewProjectionMatrix;
     vec4 CameraPosition;
     vec4 LightDirection;
     vec4 LightColor;
@@ -17,12 +31,93 @@ layout(std140, binding = 0) uniform PerFrameConstants {
     float DeltaTime;
     float ShadowBias;
     float ShadowsEnabled;
+    mat4 CascadeViewProjection[MAX_SHADOW_CASCADES];
+    vec4 CascadeSplits;
+    uint CascadeCount;
+    float ShadowTexelSize;
+    uint LocalLightCount;
+    float AtlasTexelSize;
+    uvec4 ClusterGrid;
+    vec4 ClusterParams;
 };
 
-// Per-draw constants updated for each draw call
-layout(std140, binding = 1) uniform PerDrawConstants {
+// Per-draw constants, indexed by BASE_INSTANCE + gl_InstanceID
+struct PerDrawConstants {
     mat4 WorldMatrix;
     uint MaterialIndex;
 };
 
+layout(std430, binding = 1) readonly buffer PerDrawBuffer {
+    PerDrawConstants Draws[];
+};
+
+// Material table; texture references are bindless handles or texture array layers
+struct MaterialConstants {
+    vec4 BaseColorFactor;
+    uvec2 BaseColorTexture;
+    uvec2 NormalTexture;
+    uvec2 RoughnessMetalnessTexture;
+    float RoughnessFactor;
+    float MetalnessFactor;
+    float AlphaCutoff;
+    uint Flags;
+};
+
+const uint MATERIAL_FLAG_ALPHA_MASK = 1u;
+const uint MATERIAL_FLAG_HAS_NORMAL_TEXTURE = 2u;
+
+layout(std430, binding = 2) readonly buffer MaterialBuffer {
+    MaterialConstants Materials[];
+};
+
+// Point and spot lights
+struct LocalLightConstants {
+    vec4 PositionRange;
+    vec4 ColorIntensity;
+    vec4 DirectionCone;
+    float CosInnerCone;
+    uint Type;
+    uint ShadowIndex;
+    uint Padding;
+};
+
+const uint LOCAL_LIGHT_POINT = 0u;
+const uint LOCAL_LIGHT_SPOT = 1u;
+const uint NO_LOCAL_SHADOW = 0xFFFFFFFFu;
+
+layout(std430, binding = 3) readonly buffer LocalLightBuffer {
+    LocalLightConstants LocalLights[];
+};
+
+// Shadow atlas tiles; point lights own six consecutive entries (+X, -X, +Y, -Y, +Z, -Z)
+struct ShadowTileConstants {
+    mat4 ViewProjection;
+    vec4 AtlasRect;
+};
+
+layout(std430, binding = 4) readonly buffer ShadowTileBuffer {
+    ShadowTileConstants ShadowTiles[];
+};
+
+// Clustered light lists: offset and count into ClusterLightIndices per froxel
+layout(std430, binding = 5) readonly buffer ClusterGridBuffer {
+    uvec2 ClusterRanges[];
+};
+
+layout(std430, binding = 6) readonly buffer ClusterIndexBuffer {
+    uint ClusterLightIndices[];
+};
+
+#ifndef HENKY_BINDLESS
+uniform sampler2DArray uMaterialTextures;
+#endif
+
+vec4 SampleMaterialTexture(uvec2 reference, vec2 uv) {
+#ifdef HENKY_BINDLESS
+    return texture(sampler2D(reference), uv);
+#else
+    return texture(uMaterialTextures, vec3(uv, float(reference.x)));
+#endif
+}
+
 #endif // COMMON_GLSL
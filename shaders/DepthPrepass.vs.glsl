@@ -6,8 +6,9 @@
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec4 aColor;
+layout(location = 3) in vec2 aTexCoord;
 
 void main() {
-    vec4 worldPos = WorldMatrix * vec4(aPosition, 1.0);
+    vec4 worldPos = Draws[BASE_INSTANCE + gl_InstanceID].WorldMatrix * vec4(aPosition, 1.0);
     gl_Position = ViewProjectionMatrix * worldPos;
 }
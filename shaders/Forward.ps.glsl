@@ -3,26 +3,40 @@
 
 #include "Common.glsl"
 
-uniform sampler2DShadow uShadowMap;
+uniform sampler2DArrayShadow uShadowMap;
+uniform sampler2DShadow uShadowAtlas;
 
 in vec3 vWorldPos;
 in vec3 vNormal;
 in vec4 vColor;
-in vec4 vShadowPos;
+in vec2 vTexCoord;
+flat in uint vMaterialIndex;
 
 out vec4 FragColor;
 
-float SampleShadowMapPCF(vec4 shadowPos) {
+float SampleShadowMapPCF(vec3 worldPos) {
+    // Pick the first cascade whose slice contains the fragment
+    float viewDepth = -(ViewMatrix * vec4(worldPos, 1.0)).z;
+    uint cascade = 0u;
+    while (cascade < CascadeCount && viewDepth > CascadeSplits[cascade]) {
+        cascade++;
+    }
+    if (cascade >= CascadeCount) {
+        return 1.0; // Beyond the shadow distance
+    }
+    
+    vec4 shadowPos = CascadeViewProjection[cascade] * vec4(worldPos, 1.0);
+    
     // Perspective divide
     vec3 projCoords = shadowPos.xyz / shadowPos.w;
     
     // Transform to [0,1] range
-    projCoords.xy = projCoords.xy * 0.5 + 0.5;
+    projCoords = projCoords * 0.5 + 0.5;
     
     // Check if in shadow map bounds
     if (projCoords.x < 0.0 || projCoords.x > 1.0 || 
         projCoords.y < 0.0 || projCoords.y > 1.0 ||
-        projCoords.z < 0.0 || projCoords.z > 1.0) {
+        projCoords.z > 1.0) {
         return 1.0; // Not in shadow if outside bounds
     }
     
@@ -30,20 +44,114 @@ float SampleShadowMapPCF(vec4 shadowPos) {
     float depth = projCoords.z - ShadowBias;
     
     // Simple PCF (9 samples)
-    vec2 texelSize = 1.0 / vec2(2048.0, 2048.0); // TODO: make configurable
     float shadow = 0.0;
     
     for (int x = -1; x <= 1; x++) {
         for (int y = -1; y <= 1; y++) {
-            vec2 offset = vec2(x, y) * texelSize;
-            shadow += texture(uShadowMap, vec3(projCoords.xy + offset, depth));
+            vec2 offset = vec2(x, y) * ShadowTexelSize;
+            shadow += texture(uShadowMap, vec4(projCoords.xy + offset, float(cascade), depth));
         }
     }
     
     return shadow / 9.0;
 }
 
+float SampleLocalShadow(LocalLightConstants light, vec3 worldPos) {
+    // Point lights: the cube face is picked by the major axis of the light-to-fragment vector
+    uint tileIndex = light.ShadowIndex;
+    if (light.Type == LOCAL_LIGHT_POINT) {
+        vec3 d = worldPos - light.PositionRange.xyz;
+        vec3 a = abs(d);
+        if (a.x >= a.y && a.x >= a.z) {
+            tileIndex += d.x > 0.0 ? 0u : 1u;
+        } else if (a.y >= a.z) {
+            tileIndex += d.y > 0.0 ? 2u : 3u;
+        } else {
+            tileIndex += d.z > 0.0 ? 4u : 5u;
+        }
+    }
+    
+    ShadowTileConstants tile = ShadowTiles[tileIndex];
+    vec4 shadowPos = tile.ViewProjection * vec4(worldPos, 1.0);
+    vec3 projCoords = shadowPos.xyz / shadowPos.w * 0.5 + 0.5;
+    if (shadowPos.w <= 0.0 || any(lessThan(projCoords, vec3(0.0))) || any(greaterThan(projCoords, vec3(1.0)))) {
+        return 1.0;
+    }
+    
+    // Keep the PCF footprint inside the tile so neighbouring tiles do not bleed in
+    vec2 uv = tile.AtlasRect.xy + projCoords.xy * tile.AtlasRect.zw;
+    vec2 tileMin = tile.AtlasRect.xy + vec2(1.5 * AtlasTexelSize);
+    vec2 tileMax = tile.AtlasRect.xy + tile.AtlasRect.zw - vec2(1.5 * AtlasTexelSize);
+    float depth = projCoords.z - ShadowBias * 0.1;
+    
+    float shadow = 0.0;
+    for (int x = -1; x <= 1; x++) {
+        for (int y = -1; y <= 1; y++) {
+            vec2 sampleUV = clamp(uv + vec2(x, y) * AtlasTexelSize, tileMin, tileMax);
+            shadow += texture(uShadowAtlas, vec3(sampleUV, depth));
+        }
+    }
+    return shadow / 9.0;
+}
+
+vec3 ShadeLocalLights(vec3 worldPos, vec3 N, vec3 V, vec3 baseColor, float roughness, float metalness) {
+    vec3 result = vec3(0.0);
+    float shininess = max(2.0 / (roughness * roughness * roughness * roughness) - 2.0, 1.0);
+    
+    // Froxel of this fragment: screen tile and exponential depth slice
+    float viewDepth = -(ViewMatrix * vec4(worldPos, 1.0)).z;
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * ClusterParams.zw * vec2(ClusterGrid.xy)), ClusterGrid.xy - 1u);
+    uint slice = uint(clamp(log(max(viewDepth, 1e-4)) * ClusterParams.x + ClusterParams.y, 0.0, float(ClusterGrid.z - 1u)));
+    uvec2 range = ClusterRanges[(slice * ClusterGrid.y + tile.y) * ClusterGrid.x + tile.x];
+    
+    for (uint i = 0u; i < range.y; i++) {
+        LocalLightConstants light = LocalLights[ClusterLightIndices[range.x + i]];
+        vec3 toLight = light.PositionRange.xyz - worldPos;
+        float distance = length(toLight);
+        float radius = light.PositionRange.w;
+        if (distance >= radius) {
+            continue;
+        }
+        vec3 L = toLight / distance;
+        
+        // Inverse square falloff windowed to reach zero at the radius
+        float window = clamp(1.0 - pow(distance / radius, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (distance * distance + 1.0);
+        if (light.Type == LOCAL_LIGHT_SPOT) {
+            float cosAngle = dot(-L, light.DirectionCone.xyz);
+            attenuation *= smoothstep(light.DirectionCone.w, light.CosInnerCone, cosAngle);
+        }
+        float NdotL = max(dot(N, L), 0.0);
+        if (attenuation <= 0.0 || NdotL <= 0.0) {
+            continue;
+        }
+        
+        float shadow = 1.0;
+        if (ShadowsEnabled > 0.5 && light.ShadowIndex != NO_LOCAL_SHADOW) {
+            shadow = SampleLocalShadow(light, worldPos);
+        }
+        
+        vec3 H = normalize(L + V);
+        vec3 radiance = light.ColorIntensity.rgb * light.ColorIntensity.a * attenuation * shadow;
+        vec3 diffuse = baseColor * (1.0 - metalness) * NdotL;
+        vec3 specular = mix(vec3(0.3), baseColor, metalness) * pow(max(dot(N, H), 0.0), shininess);
+        result += (diffuse + specular) * radiance;
+    }
+    return result;
+}
+
 void main() {
+    MaterialConstants material = Materials[vMaterialIndex];
+    vec4 albedo = material.BaseColorFactor * SampleMaterialTexture(material.BaseColorTexture, vTexCoord);
+    if ((material.Flags & MATERIAL_FLAG_ALPHA_MASK) != 0u && albedo.a < material.AlphaCutoff) {
+        discard;
+    }
+    
+    // Roughness in G, metalness in R
+    vec2 roughnessMetalness = SampleMaterialTexture(material.RoughnessMetalnessTexture, vTexCoord).gr;
+    float roughness = clamp(material.RoughnessFactor * roughnessMetalness.x, 0.05, 1.0);
+    float metalness = material.MetalnessFactor * roughnessMetalness.y;
+    
     // Normalize inputs
     vec3 N = normalize(vNormal);
     vec3 L = normalize(-LightDirection.xyz);
@@ -51,17 +159,17 @@ void main() {
     vec3 H = normalize(L + V);
     
     // Base color
-    vec3 baseColor = vColor.rgb;
+    vec3 baseColor = vColor.rgb * albedo.rgb;
     
     // Diffuse lighting
     float NdotL = max(dot(N, L), 0.0);
-    vec3 diffuse = baseColor * NdotL * LightColor.rgb * LightColor.a;
+    vec3 diffuse = baseColor * (1.0 - metalness) * NdotL * LightColor.rgb * LightColor.a;
     
     // Specular (simple Blinn-Phong)
     float NdotH = max(dot(N, H), 0.0);
-    float shininess = 32.0;
-    float specular = pow(NdotH, shininess);
-    vec3 specularColor = vec3(1.0, 1.0, 1.0) * specular * 0.3;
+    float shininess = 2.0 / (roughness * roughness * roughness * roughness) - 2.0;
+    float specular = pow(NdotH, max(shininess, 1.0));
+    vec3 specularColor = mix(vec3(0.3), baseColor, metalness) * specular;
     
     // Ambient
     vec3 ambient = baseColor * AmbientColor.rgb * AmbientColor.a;
@@ -69,11 +177,12 @@ void main() {
     // Shadow
     float shadowFactor = 1.0;
     if (ShadowsEnabled > 0.5) {
-        shadowFactor = SampleShadowMapPCF(vShadowPos);
+        shadowFactor = SampleShadowMapPCF(vWorldPos);
     }
     
     // Combine lighting
     vec3 finalColor = ambient + (diffuse + specularColor) * shadowFactor;
+    finalColor += ShadeLocalLights(vWorldPos, N, V, baseColor, roughness, metalness);
     
-    FragColor = vec4(finalColor, vColor.a);
+    FragColor = vec4(finalColor, vColor.a * albedo.a);
 }
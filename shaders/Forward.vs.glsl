@@ -6,21 +6,23 @@
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec4 aColor;
+layout(location = 3) in vec2 aTexCoord;
 
 out vec3 vWorldPos;
 out vec3 vNormal;
 out vec4 vColor;
-out vec4 vShadowPos;
+out vec2 vTexCoord;
+flat out uint vMaterialIndex;
 
 void main() {
-    vec4 worldPos = WorldMatrix * vec4(aPosition, 1.0);
+    PerDrawConstants draw = Draws[BASE_INSTANCE + gl_InstanceID];
+    vec4 worldPos = draw.WorldMatrix * vec4(aPosition, 1.0);
     vWorldPos = worldPos.xyz;
     gl_Position = ViewProjectionMatrix * worldPos;
     
     // Transform normal to world space (assuming uniform scale)
-    vNormal = mat3(WorldMatrix) * aNormal;
+    vNormal = mat3(draw.WorldMatrix) * aNormal;
     vColor = aColor;
-    
-    // Compute shadow map coordinates
-    vShadowPos = LightViewProjectionMatrix * worldPos;
+    vTexCoord = aTexCoord;
+    vMaterialIndex = draw.MaterialIndex;
 }
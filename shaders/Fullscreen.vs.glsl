@@ -0,0 +1,11 @@
+// Fullscreen Triangle Vertex Shader
+#version 460 core
+
+out vec2 vTexCoord;
+
+void main() {
+    // Three vertices covering the viewport, no vertex buffer needed
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    vTexCoord = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -6,8 +6,16 @@
 layout(location = 0) in vec3 aPosition;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec4 aColor;
+layout(location = 3) in vec2 aTexCoord;
+
+uniform int uCascade;
+uniform int uShadowTile; // Shadow atlas tile, or -1 for a directional cascade
 
 void main() {
-    vec4 worldPos = WorldMatrix * vec4(aPosition, 1.0);
-    gl_Position = LightViewProjectionMatrix * worldPos;
+    vec4 worldPos = Draws[BASE_INSTANCE + gl_InstanceID].WorldMatrix * vec4(aPosition, 1.0);
+    if (uShadowTile >= 0) {
+        gl_Position = ShadowTiles[uShadowTile].ViewProjection * worldPos;
+    } else {
+        gl_Position = CascadeViewProjection[uCascade] * worldPos;
+    }
 }
@@ -0,0 +1,14 @@
+// Texture Layer Copy Fragment Shader
+// Resamples a material texture into a layer of the fallback texture array
+#version 460 core
+
+uniform sampler2D uSource;
+uniform float uSourceLod;
+
+in vec2 vTexCoord;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = textureLod(uSource, vTexCoord, uSourceLod);
+}
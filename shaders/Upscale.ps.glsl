@@ -0,0 +1,36 @@
+// Upscale Fragment Shader
+// Resolves the dynamic resolution scene target to the output size: bilinear
+// upsampling plus contrast-adaptive sharpening in the style of AMD FidelityFX CAS
+#version 460 core
+
+uniform sampler2D uSource;
+uniform vec2 uUvScale;     // Rendered part of the target
+uniform vec2 uTexelSize;   // 1 / target size
+uniform float uSharpness;  // 0-1
+
+in vec2 vTexCoord;
+
+out vec4 FragColor;
+
+vec3 SampleScene(vec2 uv) {
+    // Stay inside the rendered rectangle, the rest of the target is stale
+    return textureLod(uSource, clamp(uv, 0.5 * uTexelSize, uUvScale - 0.5 * uTexelSize), 0.0).rgb;
+}
+
+void main() {
+    vec2 uv = vTexCoord * uUvScale;
+    vec3 center = SampleScene(uv);
+    vec3 north = SampleScene(uv + vec2(0.0, uTexelSize.y));
+    vec3 south = SampleScene(uv - vec2(0.0, uTexelSize.y));
+    vec3 east = SampleScene(uv + vec2(uTexelSize.x, 0.0));
+    vec3 west = SampleScene(uv - vec2(uTexelSize.x, 0.0));
+
+    // Sharpen less where the neighbourhood already has high contrast, to avoid ringing
+    vec3 minimum = min(center, min(min(north, south), min(east, west)));
+    vec3 maximum = max(center, max(max(north, south), max(east, west)));
+    vec3 amount = sqrt(clamp(min(minimum, 2.0 - maximum) / max(maximum, vec3(1e-4)), 0.0, 1.0));
+    vec3 weight = amount * (-1.0 / mix(8.0, 5.0, uSharpness)) * step(1e-3, uSharpness);
+
+    vec3 color = (center + (north + south + east + west) * weight) / (1.0 + 4.0 * weight);
+    FragColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
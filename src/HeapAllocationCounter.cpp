@@ -0,0 +1,80 @@
+// Counting replacements of the global allocation functions, compiled into the
+// application only (HENKY_COUNT_HEAP_ALLOCATIONS) so tools and other executables
+// linking the engine keep their own allocator. The array and nothrow forms forward
+// to these by default, so they are counted as well.
+#include "engine/core/FrameAllocator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+void* AllocateHeap(std::size_t size, std::size_t alignment) {
+    Henky3D::FrameArena::CountHeapAllocation();
+    size = std::max<std::size_t>(size, 1);
+    for (;;) {
+        void* memory = nullptr;
+        if (alignment <= alignof(std::max_align_t)) {
+            memory = std::malloc(size);
+        }
+        else {
+#ifdef _WIN32
+            memory = _aligned_malloc(size, alignment);
+#else
+            // aligned_alloc wants a multiple of the alignment
+            memory = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+        }
+        if (memory) {
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+// Must pick the allocator AllocateHeap used for the same alignment
+void FreeAlignedHeap(void* memory, std::size_t alignment) {
+#ifdef _WIN32
+    if (alignment > alignof(std::max_align_t)) {
+        _aligned_free(memory);
+        return;
+    }
+#else
+    (void)alignment;
+#endif
+    std::free(memory);
+}
+
+} // namespace
+
+void* operator new(std::size_t size) {
+    return AllocateHeap(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return AllocateHeap(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t alignment) noexcept {
+    FreeAlignedHeap(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept {
+    FreeAlignedHeap(memory, static_cast<std::size_t>(alignment));
+}
@@ -0,0 +1,124 @@
+#include "AssetArchive.h"
+#include "Lz4.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace Henky3D {
+
+AssetArchive::~AssetArchive() {
+    Close();
+}
+
+bool AssetArchive::Open(const std::string& path) {
+    Close();
+    if (!m_File.Open(path)) {
+        return false;
+    }
+
+    m_Data = m_File.GetData();
+    m_Size = m_File.GetSize();
+    m_Path = path;
+    if (!Validate()) {
+        std::cout << "Warning: Ignoring malformed asset archive " << path << std::endl;
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void AssetArchive::Close() {
+    m_File.Close();
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Entries = nullptr;
+    m_EntryCount = 0;
+    m_Paths = nullptr;
+    m_PathsSize = 0;
+    m_Path.clear();
+}
+
+bool AssetArchive::Validate() {
+    if (m_Size < sizeof(ArchiveHeader)) {
+        return false;
+    }
+    ArchiveHeader header;
+    std::memcpy(&header, m_Data, sizeof(header));
+    if (header.Magic != ArchiveHeader::MagicValue || header.Version != ArchiveHeader::CurrentVersion) {
+        return false;
+    }
+
+    const uint64_t tocBytes = static_cast<uint64_t>(header.EntryCount) * sizeof(ArchiveEntry);
+    if (header.TocOffset % alignof(ArchiveEntry) != 0 || header.TocOffset > m_Size ||
+        tocBytes > m_Size - header.TocOffset || header.PathsOffset > m_Size) {
+        return false;
+    }
+
+    m_Entries = reinterpret_cast<const ArchiveEntry*>(m_Data + header.TocOffset);
+    m_EntryCount = header.EntryCount;
+    m_Paths = reinterpret_cast<const char*>(m_Data + header.PathsOffset);
+    m_PathsSize = m_Size - header.PathsOffset;
+
+    // Bounds-check every payload once so lookups can trust the table
+    for (uint32_t i = 0; i < m_EntryCount; i++) {
+        const ArchiveEntry& entry = m_Entries[i];
+        if (entry.Offset > m_Size || entry.StoredSize > m_Size - entry.Offset || entry.PathOffset >= m_PathsSize) {
+            return false;
+        }
+        if (entry.Compression == static_cast<uint32_t>(ArchiveCompression::None) && entry.StoredSize != entry.Size) {
+            return false;
+        }
+        if (entry.Compression > static_cast<uint32_t>(ArchiveCompression::Lz4)) {
+            return false;
+        }
+        // LZ4 expands at most ~255x, so a larger size is corrupt and must not reach Read's resize
+        if (entry.Compression == static_cast<uint32_t>(ArchiveCompression::Lz4) &&
+            entry.Size > static_cast<uint64_t>(entry.StoredSize) * 255 + 16) {
+            return false;
+        }
+        // GetEntryPath hands out a C string, so it must end inside the mapping
+        if (!std::memchr(m_Paths + entry.PathOffset, '\0', m_PathsSize - entry.PathOffset)) {
+            return false;
+        }
+        if (i > 0 && m_Entries[i - 1].PathHash >= entry.PathHash) {
+            return false; // Unsorted or duplicate hashes
+        }
+    }
+    return true;
+}
+
+const ArchiveEntry* AssetArchive::Find(AssetId id) const {
+    const ArchiveEntry* end = m_Entries + m_EntryCount;
+    const ArchiveEntry* it = std::lower_bound(m_Entries, end, id, [](const ArchiveEntry& entry, AssetId value) {
+        return entry.PathHash < value;
+    });
+    return (it != end && it->PathHash == id) ? it : nullptr;
+}
+
+bool AssetArchive::GetView(const ArchiveEntry& entry, AssetView& view) const {
+    if (entry.Compression != static_cast<uint32_t>(ArchiveCompression::None)) {
+        return false;
+    }
+    view.Data = m_Data + entry.Offset;
+    view.Size = static_cast<size_t>(entry.Size);
+    return true;
+}
+
+bool AssetArchive::Read(const ArchiveEntry& entry, std::vector<uint8_t>& data) const {
+    const uint8_t* stored = m_Data + entry.Offset;
+    data.resize(static_cast<size_t>(entry.Size));
+
+    if (entry.Compression == static_cast<uint32_t>(ArchiveCompression::Lz4)) {
+        return Lz4::Decompress(stored, static_cast<size_t>(entry.StoredSize), data.data(), data.size());
+    }
+    if (!data.empty()) {
+        std::memcpy(data.data(), stored, data.size());
+    }
+    return true;
+}
+
+const char* AssetArchive::GetEntryPath(const ArchiveEntry& entry) const {
+    return m_Paths + entry.PathOffset;
+}
+
+} // namespace Henky3D
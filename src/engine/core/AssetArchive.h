@@ -0,0 +1,96 @@
+#pragma once
+#include "AssetId.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Henky3D {
+
+// On-disk layout of a .hpak archive (little endian):
+//   ArchiveHeader
+//   ArchiveEntry[EntryCount]  - sorted by PathHash for binary search
+//   path strings              - NUL terminated, for listing and diagnostics
+//   entry payloads            - each aligned to PayloadAlignment
+enum class ArchiveCompression : uint32_t {
+    None = 0,
+    Lz4 = 1
+};
+
+struct ArchiveHeader {
+    static constexpr uint32_t MagicValue = 0x4B415048; // "HPAK"
+    static constexpr uint32_t CurrentVersion = 1;
+
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t EntryCount;
+    uint32_t Reserved;
+    uint64_t TocOffset;
+    uint64_t PathsOffset;
+};
+
+struct ArchiveEntry {
+    uint64_t PathHash;         // HashAssetPath of the path relative to the packed root
+    uint64_t Offset;           // Payload offset from the start of the archive
+    uint64_t StoredSize;       // Bytes in the archive
+    uint64_t Size;             // Bytes after decompression
+    uint32_t Compression;      // ArchiveCompression
+    uint32_t PathOffset;       // Offset of the path string from PathsOffset
+};
+
+static_assert(sizeof(ArchiveHeader) == 32, "ArchiveHeader layout is part of the file format");
+static_assert(sizeof(ArchiveEntry) == 40, "ArchiveEntry layout is part of the file format");
+
+// Read-only view of archive bytes; valid while the archive stays open
+struct AssetView {
+    const uint8_t* Data = nullptr;
+    size_t Size = 0;
+};
+
+// Memory-mapped asset pack. Lookups are a binary search over the hashed table
+// of contents; uncompressed entries are handed out as zero-copy views straight
+// into the mapping. All queries are const and safe to call from worker threads.
+class AssetArchive {
+public:
+    static constexpr size_t PayloadAlignment = 64;
+
+    AssetArchive() = default;
+    ~AssetArchive();
+
+    AssetArchive(const AssetArchive&) = delete;
+    AssetArchive& operator=(const AssetArchive&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return m_Data != nullptr; }
+
+    const ArchiveEntry* Find(AssetId id) const;
+    const ArchiveEntry* Find(std::string_view path) const { return Find(HashAssetPath(path)); }
+
+    // Zero-copy view; fails for compressed entries
+    bool GetView(const ArchiveEntry& entry, AssetView& view) const;
+
+    // Decompresses (or copies) the entry into data
+    bool Read(const ArchiveEntry& entry, std::vector<uint8_t>& data) const;
+
+    const char* GetEntryPath(const ArchiveEntry& entry) const;
+    uint32_t GetEntryCount() const { return m_EntryCount; }
+    const ArchiveEntry* GetEntries() const { return m_Entries; }
+    const std::string& GetPath() const { return m_Path; }
+    size_t GetSize() const { return m_Size; }
+
+private:
+    bool Validate();
+
+    MappedFile m_File;
+    std::string m_Path;
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+    const ArchiveEntry* m_Entries = nullptr;
+    uint32_t m_EntryCount = 0;
+    const char* m_Paths = nullptr;
+    size_t m_PathsSize = 0;
+};
+
+} // namespace Henky3D
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+namespace Henky3D {
+
+// 64-bit FNV-1a hash of a normalized asset path, taken over its UTF-8 bytes.
+// Separators are unified and ASCII letters lowercased so "Textures\\Brick.png"
+// and "textures/brick.png" name the same asset.
+using AssetId = uint64_t;
+
+constexpr AssetId InvalidAssetId = 0;
+
+constexpr uint64_t HashAssetPathByte(uint64_t hash, uint32_t byte) {
+    if (byte == '\\') {
+        byte = '/';
+    } else if (byte >= 'A' && byte <= 'Z') {
+        byte += 'a' - 'A';
+    }
+    return (hash ^ byte) * 0x100000001b3ull;
+}
+
+// Narrow paths are taken to be UTF-8, as stored by HenkyAssetPack
+constexpr AssetId HashAssetPath(std::string_view path) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : path) {
+        hash = HashAssetPathByte(hash, static_cast<uint8_t>(c));
+    }
+    return hash == InvalidAssetId ? 1 : hash;
+}
+
+// Wide paths (UTF-16 on Windows, UTF-32 elsewhere) are re-encoded as UTF-8, so
+// both spellings of a path hash to the same ID on every platform
+constexpr AssetId HashAssetPath(std::wstring_view path) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < path.size(); i++) {
+        uint32_t code = static_cast<uint32_t>(path[i]);
+        if (code >= 0xD800 && code <= 0xDBFF && i + 1 < path.size()) {
+            const uint32_t low = static_cast<uint32_t>(path[i + 1]);
+            if (low >= 0xDC00 && low <= 0xDFFF) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                i++;
+            }
+        }
+        if (code < 0x80) {
+            hash = HashAssetPathByte(hash, code);
+        } else if (code < 0x800) {
+            hash = HashAssetPathByte(hash, 0xC0 | (code >> 6));
+            hash = HashAssetPathByte(hash, 0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            hash = HashAssetPathByte(hash, 0xE0 | (code >> 12));
+            hash = HashAssetPathByte(hash, 0x80 | ((code >> 6) & 0x3F));
+            hash = HashAssetPathByte(hash, 0x80 | (code & 0x3F));
+        } else {
+            hash = HashAssetPathByte(hash, 0xF0 | (code >> 18));
+            hash = HashAssetPathByte(hash, 0x80 | ((code >> 12) & 0x3F));
+            hash = HashAssetPathByte(hash, 0x80 | ((code >> 6) & 0x3F));
+            hash = HashAssetPathByte(hash, 0x80 | (code & 0x3F));
+        }
+    }
+    return hash == InvalidAssetId ? 1 : hash;
+}
+
+} // namespace Henky3D
@@ -0,0 +1,291 @@
+#include "FileSystem.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <mach-o/dyld.h>
+#else
+#include <unistd.h>
+#include <limits.h>
+#endif
+
+namespace Henky3D {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Default fallback root relative to the build directory
+constexpr const char* DefaultAssetRoot = "../../..";
+constexpr const char* ArchiveName = "assets.hpak";
+
+struct FileSystemState {
+    std::once_flag InitFlag;
+    std::vector<std::string> Roots;
+    std::vector<std::unique_ptr<AssetArchive>> Archives; // Highest priority last
+};
+
+FileSystemState& GetState() {
+    static FileSystemState state;
+    return state;
+}
+
+void AddRoot(std::vector<std::string>& roots, const fs::path& root) {
+    std::error_code error;
+    if (!fs::is_directory(root, error)) {
+        return;
+    }
+    fs::path normalized = fs::weakly_canonical(root, error);
+    std::string path = error ? root.string() : normalized.string();
+    if (std::find(roots.begin(), roots.end(), path) == roots.end()) {
+        roots.push_back(path);
+    }
+}
+
+bool MountArchive(FileSystemState& state, const std::string& archivePath) {
+    auto archive = std::make_unique<AssetArchive>();
+    if (!archive->Open(archivePath)) {
+        return false;
+    }
+    std::cout << "Mounted asset archive " << archivePath << " (" << archive->GetEntryCount() << " entries)" << std::endl;
+    state.Archives.push_back(std::move(archive));
+    return true;
+}
+
+} // namespace
+
+std::string FileSystem::GetExecutableDirectory() {
+    std::string exePath;
+    
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD len = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    // Check for buffer overflow - GetModuleFileNameA returns MAX_PATH when buffer is too small
+    if (len > 0 && len < MAX_PATH) {
+        exePath = std::string(path, len);
+    }
+#elif defined(__APPLE__)
+    char path[PATH_MAX];
+    uint32_t size = sizeof(path);
+    if (_NSGetExecutablePath(path, &size) == 0) {
+        exePath = std::string(path);
+    }
+    // Note: _NSGetExecutablePath returns -1 and updates size if buffer is too small
+    // For typical use cases, PATH_MAX should be sufficient, so we don't retry
+#else
+    char path[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (len != -1) {
+        path[len] = '\0';
+        exePath = std::string(path);
+    }
+#endif
+    
+    if (!exePath.empty()) {
+        return fs::path(exePath).parent_path().string();
+    }
+    return "";
+}
+
+void FileSystem::Initialize() {
+    FileSystemState& state = GetState();
+    std::call_once(state.InitFlag, [&state]() {
+        // Priority 1: HENKY_ASSET_DIR environment variable
+        if (const char* assetDir = std::getenv("HENKY_ASSET_DIR")) {
+            AddRoot(state.Roots, assetDir);
+        }
+
+        // Priority 2: Relative to executable directory, then one level up
+        std::string exeDir = GetExecutableDirectory();
+        if (!exeDir.empty()) {
+            AddRoot(state.Roots, exeDir);
+            AddRoot(state.Roots, fs::path(exeDir) / "..");
+        }
+
+        // Priority 3: Original relative path from build directory
+        AddRoot(state.Roots, DefaultAssetRoot);
+
+        // Mount lowest priority first so the first root's archive wins
+        for (auto it = state.Roots.rbegin(); it != state.Roots.rend(); ++it) {
+            std::error_code error;
+            fs::path archivePath = fs::path(*it) / ArchiveName;
+            if (fs::exists(archivePath, error)) {
+                MountArchive(state, archivePath.string());
+            }
+        }
+        if (const char* archive = std::getenv("HENKY_ASSET_ARCHIVE")) {
+            if (!MountArchive(state, archive)) {
+                std::cout << "Warning: Failed to mount HENKY_ASSET_ARCHIVE " << archive << std::endl;
+            }
+        }
+    });
+}
+
+void FileSystem::Shutdown() {
+    GetState().Archives.clear();
+}
+
+bool FileSystem::Mount(const std::string& archivePath) {
+    Initialize();
+    return MountArchive(GetState(), archivePath);
+}
+
+const ArchiveEntry* FileSystem::FindArchiveEntry(AssetId id, const AssetArchive** archive) {
+    Initialize();
+    auto& archives = GetState().Archives;
+    for (auto it = archives.rbegin(); it != archives.rend(); ++it) {
+        if (const ArchiveEntry* entry = (*it)->Find(id)) {
+            if (archive) {
+                *archive = it->get();
+            }
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+bool FileSystem::ReadFile(std::string_view path, std::vector<uint8_t>& data) {
+    const AssetArchive* archive = nullptr;
+    if (const ArchiveEntry* entry = FindArchiveEntry(HashAssetPath(path), &archive)) {
+        return archive->Read(*entry, data);
+    }
+
+    std::string loosePath = ResolveLoosePath(path);
+    if (loosePath.empty()) {
+        return false;
+    }
+    std::ifstream file(loosePath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    if (size < 0) {
+        return false;
+    }
+    data.resize(static_cast<size_t>(size));
+    file.seekg(0, std::ios::beg);
+    return size == 0 || static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+
+bool FileSystem::ReadText(std::string_view path, std::string& text) {
+    std::vector<uint8_t> data;
+    if (!ReadFile(path, data)) {
+        return false;
+    }
+    text.assign(data.begin(), data.end());
+    return true;
+}
+
+bool FileSystem::Exists(std::string_view path) {
+    return FindArchiveEntry(HashAssetPath(path)) != nullptr || !ResolveLoosePath(path).empty();
+}
+
+std::string FileSystem::ResolveLoosePath(std::string_view path) {
+    Initialize();
+    std::error_code error;
+    const fs::path relative(path);
+    for (const std::string& root : GetState().Roots) {
+        fs::path candidate = fs::path(root) / relative;
+        if (fs::exists(candidate, error)) {
+            return candidate.string();
+        }
+    }
+    return "";
+}
+
+const std::vector<std::string>& FileSystem::GetSearchRoots() {
+    Initialize();
+    return GetState().Roots;
+}
+
+uint32_t FileSystem::GetMountedArchiveCount() {
+    Initialize();
+    return static_cast<uint32_t>(GetState().Archives.size());
+}
+
+bool AssetFile::Open(std::string_view path) {
+    if (OpenArchiveEntry(HashAssetPath(path))) {
+        return true;
+    }
+    std::string loosePath = FileSystem::ResolveLoosePath(path);
+    return !loosePath.empty() && OpenLoose(loosePath);
+}
+
+bool AssetFile::Open(const std::wstring& path) {
+    if (OpenArchiveEntry(HashAssetPath(std::wstring_view(path)))) {
+        return true;
+    }
+
+    // Paths used as given (absolute or working-directory relative) keep working.
+    // Stays a wide path throughout: narrowing it would throw on Windows for
+    // characters outside the active code page.
+    std::error_code error;
+    const fs::path loosePath(path);
+    if (fs::exists(loosePath, error)) {
+        return OpenLoose(loosePath);
+    }
+    for (const std::string& root : FileSystem::GetSearchRoots()) {
+        fs::path candidate = fs::path(root) / loosePath;
+        if (fs::exists(candidate, error)) {
+            return OpenLoose(candidate);
+        }
+    }
+    return false;
+}
+
+bool AssetFile::OpenArchiveEntry(AssetId id) {
+    const AssetArchive* archive = nullptr;
+    const ArchiveEntry* entry = FileSystem::FindArchiveEntry(id, &archive);
+    if (!entry) {
+        return false;
+    }
+
+    AssetView view;
+    if (archive->GetView(*entry, view)) {
+        m_Data = view.Data;
+        m_Size = view.Size;
+        return true;
+    }
+    if (!archive->Read(*entry, m_Decompressed)) {
+        std::cout << "Warning: Corrupt archive entry " << archive->GetEntryPath(*entry) << std::endl;
+        return false;
+    }
+    m_Data = m_Decompressed.data();
+    m_Size = m_Decompressed.size();
+    return true;
+}
+
+bool AssetFile::OpenLoose(const std::filesystem::path& path) {
+    m_File.open(path, std::ios::binary | std::ios::ate);
+    if (!m_File.is_open()) {
+        return false;
+    }
+    std::streamsize size = m_File.tellg();
+    if (size < 0) {
+        return false;
+    }
+    m_Size = static_cast<size_t>(size);
+    return true;
+}
+
+bool AssetFile::Read(size_t offset, void* dst, size_t size) {
+    if (offset > m_Size || size > m_Size - offset) {
+        return false;
+    }
+    if (m_Data) {
+        std::memcpy(dst, m_Data + offset, size);
+        return true;
+    }
+    m_File.clear();
+    m_File.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+    return static_cast<bool>(m_File.read(static_cast<char*>(dst), static_cast<std::streamsize>(size)));
+}
+
+} // namespace Henky3D
@@ -0,0 +1,68 @@
+#pragma once
+#include "AssetArchive.h"
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Henky3D {
+
+// Resolves asset paths relative to the asset root (e.g. "shaders/Forward.vs.glsl").
+// Mounted archives are searched first with a single hashed lookup; loose files
+// are the fallback, probed under the search roots in order: HENKY_ASSET_DIR,
+// the executable directory, its parent, then the build-tree fallback. Any
+// assets.hpak found in a root (or named by HENKY_ASSET_ARCHIVE) is mounted on
+// first use.
+class FileSystem {
+public:
+    // Idempotent; runs lazily on first use
+    static void Initialize();
+    static void Shutdown();
+
+    // Archives mounted later take priority. Mount before loading starts:
+    // lookups from worker threads do not lock.
+    static bool Mount(const std::string& archivePath);
+
+    static const ArchiveEntry* FindArchiveEntry(AssetId id, const AssetArchive** archive = nullptr);
+
+    static bool ReadFile(std::string_view path, std::vector<uint8_t>& data);
+    static bool ReadText(std::string_view path, std::string& text);
+    static bool Exists(std::string_view path);
+
+    // Loose file under the first search root that has it; empty when absent
+    static std::string ResolveLoosePath(std::string_view path);
+
+    static std::string GetExecutableDirectory();
+    static const std::vector<std::string>& GetSearchRoots();
+    static uint32_t GetMountedArchiveCount();
+};
+
+// Random-access reader over an archive entry or a loose file. Uncompressed
+// archive entries are read straight from the mapping; compressed ones are
+// decompressed once on open.
+class AssetFile {
+public:
+    bool Open(std::string_view path);
+    bool Open(const std::wstring& path);
+
+    size_t GetSize() const { return m_Size; }
+    bool IsFromArchive() const { return m_Data != nullptr; }
+
+    // Whole contents when the file came from an archive, otherwise null
+    const uint8_t* GetData() const { return m_Data; }
+
+    bool Read(size_t offset, void* dst, size_t size);
+
+private:
+    bool OpenArchiveEntry(AssetId id);
+    bool OpenLoose(const std::filesystem::path& path);
+
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+    std::vector<uint8_t> m_Decompressed;
+    std::ifstream m_File;
+};
+
+} // namespace Henky3D
@@ -0,0 +1,107 @@
+#include "FrameAllocator.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Constant-initialized, so it is valid for allocations made before main
+std::atomic<uint64_t> s_HeapAllocations{0};
+std::atomic<bool> s_HeapAllocationsCounted{false};
+
+} // namespace
+
+namespace Henky3D {
+
+FrameArena::FrameArena(size_t blockSize)
+    : m_BlockSize(std::max<size_t>(blockSize, 4096)) {
+    for (Buffer& buffer : m_Buffers) {
+        Block block;
+        block.Size = m_BlockSize;
+        block.Data.reset(new std::byte[block.Size]);
+        buffer.Blocks.push_back(std::move(block));
+    }
+    UpdateCapacity();
+    m_HeapAllocationsAtFrameStart = GetHeapAllocationCount();
+}
+
+void FrameArena::CountHeapAllocation() {
+    s_HeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (!s_HeapAllocationsCounted.load(std::memory_order_relaxed)) {
+        s_HeapAllocationsCounted.store(true, std::memory_order_relaxed);
+    }
+}
+
+bool FrameArena::IsHeapAllocationCountAvailable() {
+    return s_HeapAllocationsCounted.load(std::memory_order_relaxed);
+}
+
+uint64_t FrameArena::GetHeapAllocationCount() {
+    return s_HeapAllocations.load(std::memory_order_relaxed);
+}
+
+void FrameArena::BeginFrame() {
+    const uint64_t heapAllocations = GetHeapAllocationCount();
+    m_Stats.HeapAllocations = heapAllocations - m_HeapAllocationsAtFrameStart;
+    m_Stats.HeapAllocationsCounted = IsHeapAllocationCountAvailable();
+    m_HeapAllocationsAtFrameStart = heapAllocations;
+    m_Stats.UsedBytes = m_Buffers[m_Current].Used;
+    m_Stats.PeakBytes = std::max(m_Stats.PeakBytes, m_Stats.UsedBytes);
+
+    // The other buffer still holds the frame that just ended
+    m_Current ^= 1;
+    Reset(m_Buffers[m_Current]);
+}
+
+void FrameArena::Reset(Buffer& buffer) {
+    if (buffer.Blocks.size() > 1) {
+        // The frame overflowed: one block with room for all of it next time
+        size_t size = 0;
+        for (const Block& block : buffer.Blocks) {
+            size += block.Size;
+        }
+        buffer.Blocks.clear();
+        Block block;
+        block.Size = size;
+        block.Data.reset(new std::byte[block.Size]);
+        buffer.Blocks.push_back(std::move(block));
+        UpdateCapacity();
+    }
+    buffer.BlockIndex = 0;
+    buffer.Offset = 0;
+    buffer.Used = 0;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment) {
+    Buffer& buffer = m_Buffers[m_Current];
+    size = std::max<size_t>(size, 1);
+    Block* block = &buffer.Blocks[buffer.BlockIndex];
+    const uintptr_t base = reinterpret_cast<uintptr_t>(block->Data.get());
+    size_t offset = ((base + buffer.Offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+    if (offset + size > block->Size) {
+        m_Stats.Overflows++;
+        Block extra;
+        extra.Size = std::max(m_BlockSize, size + alignment);
+        extra.Data.reset(new std::byte[extra.Size]);
+        buffer.Blocks.push_back(std::move(extra));
+        buffer.BlockIndex = buffer.Blocks.size() - 1;
+        buffer.Offset = 0;
+        block = &buffer.Blocks[buffer.BlockIndex];
+        const uintptr_t extraBase = reinterpret_cast<uintptr_t>(block->Data.get());
+        offset = ((extraBase + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - extraBase;
+        UpdateCapacity();
+    }
+    buffer.Used += offset + size - buffer.Offset;
+    buffer.Offset = offset + size;
+    return block->Data.get() + offset;
+}
+
+void FrameArena::UpdateCapacity() {
+    m_Stats.CapacityBytes = 0;
+    for (const Buffer& buffer : m_Buffers) {
+        for (const Block& block : buffer.Blocks) {
+            m_Stats.CapacityBytes += block.Size;
+        }
+    }
+}
+
+} // namespace Henky3D
@@ -0,0 +1,111 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Henky3D {
+
+struct FrameArenaStats {
+    size_t UsedBytes = 0;           // Allocated during the last finished frame
+    size_t PeakBytes = 0;           // Largest UsedBytes so far
+    size_t CapacityBytes = 0;       // Reserved by both buffers
+    uint64_t Overflows = 0;         // Allocations that did not fit and took a new block
+    uint64_t HeapAllocations = 0;   // Global operator new calls during the last frame, all threads
+    bool HeapAllocationsCounted = false;    // The executable counts its allocations at all
+};
+
+// Linear allocator for data that lives for a frame. Allocation bumps a pointer
+// and nothing is freed individually; BeginFrame resets the whole buffer at once.
+// Two buffers alternate, so memory allocated in one frame stays valid through the
+// next (e.g. results read by the following frame or by the GPU upload). A buffer
+// that overflowed its block grows into extra blocks for that frame and is merged
+// into a single block of the peak size when it is reset, so steady state uses one
+// block per buffer and never touches the heap. Not thread-safe: one arena per thread.
+class FrameArena {
+public:
+    static constexpr size_t DefaultBlockSize = size_t(1) << 20;
+
+    explicit FrameArena(size_t blockSize = DefaultBlockSize);
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    // Once per frame: frees everything allocated two frames ago
+    void BeginFrame();
+
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    template<typename T>
+    T* AllocateArray(size_t count) {
+        return static_cast<T*>(Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    size_t GetUsedBytes() const { return m_Buffers[m_Current].Used; }
+    const FrameArenaStats& GetStats() const { return m_Stats; }
+
+    // Called by an executable's replacement operator new; without one the count is unavailable
+    static void CountHeapAllocation();
+    static bool IsHeapAllocationCountAvailable();
+    // Process-wide count of global operator new calls since startup
+    static uint64_t GetHeapAllocationCount();
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> Data;
+        size_t Size = 0;
+    };
+
+    struct Buffer {
+        std::vector<Block> Blocks;
+        size_t BlockIndex = 0;      // Block being allocated from
+        size_t Offset = 0;          // Within that block
+        size_t Used = 0;            // Bytes handed out, padding included
+    };
+
+    void Reset(Buffer& buffer);
+    void UpdateCapacity();
+
+    Buffer m_Buffers[2];
+    uint32_t m_Current = 0;
+    size_t m_BlockSize;
+    FrameArenaStats m_Stats;
+    uint64_t m_HeapAllocationsAtFrameStart = 0;
+};
+
+// STL allocator drawing from a FrameArena. Deallocation is a no-op, so containers
+// using it must not outlive the frame after the one they were filled in.
+template<typename T>
+class FrameAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    FrameAllocator(FrameArena& arena) noexcept
+        : m_Arena(&arena) {
+    }
+
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& other) noexcept
+        : m_Arena(other.GetArena()) {
+    }
+
+    T* allocate(size_t count) { return m_Arena->AllocateArray<T>(count); }
+    void deallocate(T*, size_t) noexcept {}
+
+    FrameArena* GetArena() const { return m_Arena; }
+
+    template<typename U>
+    bool operator==(const FrameAllocator<U>& other) const { return m_Arena == other.GetArena(); }
+
+private:
+    FrameArena* m_Arena;
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+} // namespace Henky3D
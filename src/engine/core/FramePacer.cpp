@@ -0,0 +1,150 @@
+#include "FramePacer.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace Henky3D {
+
+namespace {
+
+float ToMs(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+
+} // namespace
+
+FramePacer::FramePacer() {
+#ifdef _WIN32
+    // Plain Sleep rounds up to the 1-15.6 ms system tick; the high resolution timer does not
+    m_WaitableTimer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+    SetSettings(m_Settings);
+}
+
+FramePacer::~FramePacer() {
+#ifdef _WIN32
+    if (m_WaitableTimer) {
+        CloseHandle(m_WaitableTimer);
+    }
+#endif
+}
+
+void FramePacer::SetSettings(const FramePacingSettings& settings) {
+    const uint32_t previousWindow = static_cast<uint32_t>(m_LatencySamples.size());
+    m_Settings = settings;
+    m_Settings.MaxQueuedFrames = std::max(m_Settings.MaxQueuedFrames, 1u);
+    m_Settings.TargetFps = std::max(m_Settings.TargetFps, 0.0f);
+    m_Settings.MinSpinMs = std::max(m_Settings.MinSpinMs, 0.0f);
+    m_Settings.WindowFrames = std::max(m_Settings.WindowFrames, 1u);
+    if (m_Settings.WindowFrames != previousWindow) {
+        ResetLatency();
+    }
+}
+
+void FramePacer::ResetLatency() {
+    m_Latency.Reset();
+    m_LatencySamples.assign(m_Settings.WindowFrames, 0);
+    m_LatencyNext = 0;
+}
+
+void FramePacer::SleepFor(Clock::duration duration) {
+#ifdef _WIN32
+    if (m_WaitableTimer) {
+        LARGE_INTEGER dueTime;
+        // Relative, in 100 ns units
+        dueTime.QuadPart = -static_cast<LONGLONG>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() / 100);
+        if (SetWaitableTimerEx(m_WaitableTimer, &dueTime, 0, nullptr, nullptr, nullptr, 0)) {
+            WaitForSingleObject(m_WaitableTimer, INFINITE);
+            return;
+        }
+    }
+#endif
+    std::this_thread::sleep_for(duration);
+}
+
+void FramePacer::WaitForNextFrame() {
+    HENKY_PROFILE_ZONE("FramePacer::WaitForNextFrame");
+    m_Stats.WaitMs = 0.0f;
+    m_Stats.SpinMs = 0.0f;
+    Clock::time_point now = Clock::now();
+    if (m_Settings.TargetFps <= 0.0f) {
+        m_NextFrame = now;
+        return;
+    }
+
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_Settings.TargetFps));
+    if (now >= m_NextFrame + period) {
+        // More than a frame behind: start a new schedule instead of rushing frames to catch up
+        if (m_NextFrame != Clock::time_point()) {
+            m_Stats.MissedFrames++;
+        }
+        m_NextFrame = now + period;
+        return;
+    }
+
+    const Clock::time_point waitStart = now;
+    // Never spin away more than half the frame, however badly a sleep overshot
+    const auto spinWindow = std::min(std::max(std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<float, std::milli>(m_Settings.MinSpinMs)), m_Oversleep), period / 2);
+    const Clock::time_point sleepUntil = m_NextFrame - spinWindow;
+    if (now < sleepUntil) {
+        SleepFor(sleepUntil - now);
+        now = Clock::now();
+        // Grow to a late wake-up at once, shrink back slowly
+        const auto oversleep = std::max(now - sleepUntil, Clock::duration(0));
+        m_Oversleep = oversleep > m_Oversleep ? oversleep : m_Oversleep - (m_Oversleep - oversleep) / 64;
+        m_Stats.OversleepMs = ToMs(m_Oversleep);
+    }
+
+    const Clock::time_point spinStart = now;
+    while (now < m_NextFrame) {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+    m_Stats.SpinMs = ToMs(now - spinStart);
+    m_Stats.WaitMs = ToMs(now - waitStart);
+    m_NextFrame += period;
+}
+
+void FramePacer::MarkInputSampled() {
+    m_InputTime = Clock::now();
+    m_InputSampled = true;
+}
+
+void FramePacer::MarkPresented(Clock::time_point presentTime) {
+    if (!m_InputSampled) {
+        return;
+    }
+    m_InputSampled = false;
+    const auto latency = std::max(presentTime - m_InputTime, Clock::duration(0));
+    m_Stats.LatencyMs = ToMs(latency);
+
+    const uint32_t microseconds = static_cast<uint32_t>(std::min<int64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(latency).count(), FrameTimeHistogram::MaxValue));
+    if (m_Latency.GetCount() >= m_LatencySamples.size()) {
+        m_Latency.Remove(m_LatencySamples[m_LatencyNext]);
+    }
+    m_Latency.Add(microseconds);
+    m_LatencySamples[m_LatencyNext] = microseconds;
+    m_LatencyNext = (m_LatencyNext + 1) % static_cast<uint32_t>(m_LatencySamples.size());
+}
+
+FramePercentiles FramePacer::GetLatencyPercentiles() const {
+    uint32_t max = 0;
+    for (uint32_t sample : m_LatencySamples) {
+        max = std::max(max, sample);
+    }
+    return FrameStats::GetPercentiles(m_Latency, max);
+}
+
+} // namespace Henky3D
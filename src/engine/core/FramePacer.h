@@ -0,0 +1,70 @@
+#pragma once
+#include "FrameStats.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Henky3D {
+
+struct FramePacingSettings {
+    bool LowLatency = false;        // Throttle the GPU queue to MaxQueuedFrames
+    uint32_t MaxQueuedFrames = 1;   // Frames the GPU may still be working on when the next one starts
+    float TargetFps = 0.0f;         // Frame limiter, 0 = unlimited
+    float MinSpinMs = 0.5f;         // Time always spun before a deadline; more if sleeps wake up later
+    uint32_t WindowFrames = 1000;   // Frames in the rolling latency percentiles
+};
+
+struct FramePacingStats {
+    float LatencyMs = 0.0f;         // Input sample to swap of the last frame
+    float WaitMs = 0.0f;            // Limiter wait before the last frame, sleep plus spin
+    float SpinMs = 0.0f;            // Part of WaitMs spent spinning
+    float OversleepMs = 0.0f;       // Recent worst case of a sleep waking up late
+    uint64_t MissedFrames = 0;      // Deadlines passed before the limiter was reached
+};
+
+// Paces the main loop. WaitForNextFrame holds each frame to the target rate:
+// OS sleeps overshoot by up to a scheduler tick, so it sleeps until the deadline
+// minus the recent oversleep and spins the remainder. Input should be sampled
+// right after the wait (MarkInputSampled) so it is as fresh as possible, and
+// MarkPresented with the time the swap returned records the input-to-swap latency.
+class FramePacer {
+public:
+    FramePacer();
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // Main thread, at the top of the frame before input is polled
+    void WaitForNextFrame();
+    void MarkInputSampled();
+    void MarkPresented(std::chrono::steady_clock::time_point presentTime);
+
+    const FramePacingSettings& GetSettings() const { return m_Settings; }
+    void SetSettings(const FramePacingSettings& settings);
+    const FramePacingStats& GetStats() const { return m_Stats; }
+    FramePercentiles GetLatencyPercentiles() const;
+    void ResetLatency();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void SleepFor(Clock::duration duration);
+
+    FramePacingSettings m_Settings;
+    FramePacingStats m_Stats;
+    Clock::time_point m_NextFrame;
+    Clock::time_point m_InputTime;
+    bool m_InputSampled = false;
+    Clock::duration m_Oversleep{0};
+
+    FrameTimeHistogram m_Latency;
+    std::vector<uint32_t> m_LatencySamples;   // Ring of the window's latencies in microseconds
+    uint32_t m_LatencyNext = 0;
+
+#ifdef _WIN32
+    void* m_WaitableTimer = nullptr;          // High resolution timer, null before Windows 10 1803
+#endif
+};
+
+} // namespace Henky3D
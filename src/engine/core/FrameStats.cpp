@@ -0,0 +1,264 @@
+#include "FrameStats.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+namespace Henky3D {
+
+uint32_t FrameTimeHistogram::GetBucketIndex(uint32_t microseconds) {
+    microseconds = std::min(microseconds, MaxValue);
+    if (microseconds < 2 * SubBucketCount) {
+        return microseconds;
+    }
+    const uint32_t shift = static_cast<uint32_t>(std::bit_width(microseconds)) - 1 - SubBucketBits;
+    return 2 * SubBucketCount + (shift - 1) * SubBucketCount + ((microseconds >> shift) - SubBucketCount);
+}
+
+uint32_t FrameTimeHistogram::GetBucketUpperBound(uint32_t bucket) {
+    if (bucket < 2 * SubBucketCount) {
+        return bucket;
+    }
+    const uint32_t shift = (bucket - 2 * SubBucketCount) / SubBucketCount + 1;
+    const uint32_t sub = (bucket - 2 * SubBucketCount) % SubBucketCount + SubBucketCount;
+    return ((sub + 1) << shift) - 1;
+}
+
+void FrameTimeHistogram::Add(uint32_t microseconds) {
+    m_Buckets[GetBucketIndex(microseconds)]++;
+    m_Count++;
+    m_Sum += microseconds;
+}
+
+void FrameTimeHistogram::Remove(uint32_t microseconds) {
+    m_Buckets[GetBucketIndex(microseconds)]--;
+    m_Count--;
+    m_Sum -= microseconds;
+}
+
+void FrameTimeHistogram::Reset() {
+    std::fill(std::begin(m_Buckets), std::end(m_Buckets), 0u);
+    m_Count = 0;
+    m_Sum = 0;
+}
+
+uint32_t FrameTimeHistogram::GetPercentile(double percentile) const {
+    if (m_Count == 0) {
+        return 0;
+    }
+    const double clamped = std::clamp(percentile, 0.0, 100.0);
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(clamped / 100.0 * static_cast<double>(m_Count))));
+    uint64_t seen = 0;
+    for (uint32_t bucket = 0; bucket < BucketCount; bucket++) {
+        seen += m_Buckets[bucket];
+        if (seen >= rank) {
+            return GetBucketUpperBound(bucket);
+        }
+    }
+    return MaxValue;
+}
+
+uint32_t FrameTimeHistogram::GetMax() const {
+    for (uint32_t bucket = BucketCount; bucket-- > 0;) {
+        if (m_Buckets[bucket]) {
+            return GetBucketUpperBound(bucket);
+        }
+    }
+    return 0;
+}
+
+FrameStats::FrameStats() {
+    m_WindowSamples.reserve(m_Settings.WindowFrames);
+}
+
+void FrameStats::SetSettings(const FrameStatsSettings& settings) {
+    const bool resize = settings.WindowFrames != m_Settings.WindowFrames;
+    m_Settings = settings;
+    m_Settings.WindowFrames = std::max(1u, m_Settings.WindowFrames);
+    if (resize) {
+        // Restart the window rather than reorder the ring
+        m_Window.Reset();
+        m_WindowSamples.clear();
+        m_WindowNext = 0;
+    }
+    while (m_Hitches.size() > m_Settings.MaxHitches) {
+        m_Hitches.pop_front();
+    }
+}
+
+void FrameStats::Reset() {
+    m_Window.Reset();
+    m_Session.Reset();
+    m_WindowSamples.clear();
+    m_WindowNext = 0;
+    m_SessionMax = 0;
+    m_Hitches.clear();
+    m_HitchCount = 0;
+    m_FrameCount = 0;
+    std::fill(std::begin(m_Graph), std::end(m_Graph), 0.0f);
+    m_GraphOffset = 0;
+}
+
+void FrameStats::Record(float frameMs) {
+    const uint32_t microseconds = static_cast<uint32_t>(std::clamp(frameMs * 1000.0f, 0.0f, static_cast<float>(FrameTimeHistogram::MaxValue)));
+    m_FrameCount++;
+
+    // Test against the window as it was before this frame
+    float thresholdMs = m_Settings.HitchThresholdMs;
+    bool testable = m_Settings.HitchThresholdMs > 0.0f;
+    if (m_Settings.HitchMedianFactor > 0.0f) {
+        // Wait for enough frames that the median means something
+        testable = m_Window.GetCount() >= 30;
+        thresholdMs = std::max(thresholdMs, m_Settings.HitchMedianFactor * static_cast<float>(m_Window.GetPercentile(50.0)) / 1000.0f);
+    }
+    if (testable && frameMs > thresholdMs) {
+        FrameHitch hitch;
+        hitch.Frame = Profiler::GetFrameIndex() - 1;
+        hitch.FrameMs = frameMs;
+        hitch.ThresholdMs = thresholdMs;
+        TagHitch(hitch);
+        m_Hitches.push_back(std::move(hitch));
+        while (m_Hitches.size() > m_Settings.MaxHitches) {
+            m_Hitches.pop_front();
+        }
+        m_HitchCount++;
+    }
+
+    if (m_WindowSamples.size() < m_Settings.WindowFrames) {
+        m_WindowSamples.push_back(microseconds);
+    }
+    else {
+        m_Window.Remove(m_WindowSamples[m_WindowNext]);
+        m_WindowSamples[m_WindowNext] = microseconds;
+        m_WindowNext = (m_WindowNext + 1) % m_Settings.WindowFrames;
+    }
+    m_Window.Add(microseconds);
+    m_Session.Add(microseconds);
+    m_SessionMax = std::max(m_SessionMax, microseconds);
+
+    m_Graph[m_GraphOffset] = frameMs;
+    m_GraphOffset = (m_GraphOffset + 1) % GraphFrames;
+}
+
+void FrameStats::TagHitch(FrameHitch& hitch) const {
+    std::vector<ProfileEvent> events;
+    Profiler::CollectEvents(Profiler::GetPreviousFrameBegin(), Profiler::GetFrameBegin(), events);
+    if (events.empty()) {
+        return;
+    }
+
+    // Self time: walk each thread's zones in begin order and subtract children from their parent
+    std::sort(events.begin(), events.end(), [](const ProfileEvent& a, const ProfileEvent& b) {
+        if (a.Thread != b.Thread) return a.Thread < b.Thread;
+        if (a.Begin != b.Begin) return a.Begin < b.Begin;
+        return a.End > b.End;
+    });
+    std::vector<uint64_t> selfTicks(events.size());
+    std::vector<size_t> stack;
+    for (size_t i = 0; i < events.size(); i++) {
+        const ProfileEvent& event = events[i];
+        while (!stack.empty() && (events[stack.back()].Thread != event.Thread || events[stack.back()].End <= event.Begin)) {
+            stack.pop_back();
+        }
+        const uint64_t duration = event.End - event.Begin;
+        selfTicks[i] = duration;
+        if (!stack.empty()) {
+            uint64_t& parent = selfTicks[stack.back()];
+            parent -= std::min(parent, duration);
+        }
+        stack.push_back(i);
+    }
+
+    std::unordered_map<const char*, uint64_t> byName;
+    for (size_t i = 0; i < events.size(); i++) {
+        byName[events[i].Name] += selfTicks[i];
+    }
+    std::vector<std::pair<const char*, uint64_t>> zones(byName.begin(), byName.end());
+    const size_t count = std::min<size_t>(zones.size(), m_Settings.HitchZoneCount);
+    std::partial_sort(zones.begin(), zones.begin() + count, zones.end(),
+                      [](const auto& a, const auto& b) { return a.second > b.second; });
+    for (size_t i = 0; i < count; i++) {
+        FrameHitchZone zone;
+        zone.Name = zones[i].first ? zones[i].first : "";
+        zone.SelfMs = static_cast<float>(Profiler::TicksToMs(zones[i].second));
+        hitch.Zones.push_back(std::move(zone));
+    }
+}
+
+FramePercentiles FrameStats::GetPercentiles(const FrameTimeHistogram& histogram, uint32_t max) {
+    FramePercentiles result;
+    result.Frames = histogram.GetCount();
+    if (result.Frames == 0) {
+        return result;
+    }
+    // Bucket upper bounds can overshoot the slowest frame actually seen
+    auto toMs = [max](uint32_t microseconds) { return static_cast<float>(std::min(microseconds, max)) / 1000.0f; };
+    result.MeanMs = static_cast<float>(histogram.GetMean() / 1000.0);
+    result.P50Ms = toMs(histogram.GetPercentile(50.0));
+    result.P95Ms = toMs(histogram.GetPercentile(95.0));
+    result.P99Ms = toMs(histogram.GetPercentile(99.0));
+    result.P999Ms = toMs(histogram.GetPercentile(99.9));
+    result.MaxMs = toMs(max);
+    return result;
+}
+
+FramePercentiles FrameStats::GetWindowPercentiles() const {
+    uint32_t max = 0;
+    for (uint32_t sample : m_WindowSamples) {
+        max = std::max(max, sample);
+    }
+    return GetPercentiles(m_Window, max);
+}
+
+FramePercentiles FrameStats::GetSessionPercentiles() const {
+    return GetPercentiles(m_Session, m_SessionMax);
+}
+
+bool FrameStats::WriteSummary(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "Warning: cannot write frame summary to " << path << std::endl;
+        return false;
+    }
+
+    auto writePercentiles = [&file](const char* name, const FramePercentiles& p) {
+        file << "  \"" << name << "\": {\"frames\": " << p.Frames << ", \"mean_ms\": " << p.MeanMs
+             << ", \"p50_ms\": " << p.P50Ms << ", \"p95_ms\": " << p.P95Ms << ", \"p99_ms\": " << p.P99Ms
+             << ", \"p99_9_ms\": " << p.P999Ms << ", \"max_ms\": " << p.MaxMs << "},\n";
+    };
+    auto writeString = [&file](const std::string& text) {
+        file << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                file << '\\';
+            }
+            file << (static_cast<unsigned char>(c) < 0x20 ? ' ' : c);
+        }
+        file << '"';
+    };
+
+    file << "{\n";
+    writePercentiles("session", GetSessionPercentiles());
+    writePercentiles("window", GetWindowPercentiles());
+    file << "  \"hitch_threshold_ms\": " << m_Settings.HitchThresholdMs
+         << ",\n  \"hitch_median_factor\": " << m_Settings.HitchMedianFactor
+         << ",\n  \"hitch_count\": " << m_HitchCount << ",\n  \"recent_hitches\": [";
+    for (size_t h = 0; h < m_Hitches.size(); h++) {
+        const FrameHitch& hitch = m_Hitches[h];
+        file << (h ? ",\n" : "\n") << "    {\"frame\": " << hitch.Frame << ", \"frame_ms\": " << hitch.FrameMs
+             << ", \"threshold_ms\": " << hitch.ThresholdMs << ", \"zones\": [";
+        for (size_t z = 0; z < hitch.Zones.size(); z++) {
+            file << (z ? ", " : "") << "{\"name\": ";
+            writeString(hitch.Zones[z].Name);
+            file << ", \"self_ms\": " << hitch.Zones[z].SelfMs << "}";
+        }
+        file << "]}";
+    }
+    file << (m_Hitches.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    return static_cast<bool>(file);
+}
+
+} // namespace Henky3D
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace Henky3D {
+
+// Log-linear frame time buckets in microseconds, HdrHistogram style: exact below
+// 64 us, then 32 sub-buckets per power of two (about 3% relative error) up to ~134 s
+class FrameTimeHistogram {
+public:
+    static constexpr uint32_t SubBucketBits = 5;
+    static constexpr uint32_t SubBucketCount = 1u << SubBucketBits;
+    static constexpr uint32_t MaxBit = 26;
+    static constexpr uint32_t BucketCount = 2 * SubBucketCount + (MaxBit - SubBucketBits) * SubBucketCount;
+    static constexpr uint32_t MaxValue = (2u << MaxBit) - 1;
+
+    void Add(uint32_t microseconds);
+    void Remove(uint32_t microseconds);
+    void Reset();
+
+    uint64_t GetCount() const { return m_Count; }
+    // Upper bound of the bucket holding the given percentile (0-100), capped at the largest recorded value
+    uint32_t GetPercentile(double percentile) const;
+    uint32_t GetMax() const;
+    double GetMean() const { return m_Count ? static_cast<double>(m_Sum) / static_cast<double>(m_Count) : 0.0; }
+
+    static uint32_t GetBucketIndex(uint32_t microseconds);
+    static uint32_t GetBucketUpperBound(uint32_t bucket);
+
+private:
+    uint32_t m_Buckets[BucketCount] = {};
+    uint64_t m_Count = 0;
+    uint64_t m_Sum = 0;
+};
+
+struct FramePercentiles {
+    uint64_t Frames = 0;
+    float MeanMs = 0.0f;
+    float P50Ms = 0.0f;
+    float P95Ms = 0.0f;
+    float P99Ms = 0.0f;
+    float P999Ms = 0.0f;
+    float MaxMs = 0.0f;
+};
+
+struct FrameHitchZone {
+    std::string Name;
+    float SelfMs = 0.0f;         // Zone time minus the time of zones nested in it
+};
+
+struct FrameHitch {
+    uint64_t Frame = 0;
+    float FrameMs = 0.0f;
+    float ThresholdMs = 0.0f;
+    std::vector<FrameHitchZone> Zones;  // Profiler zones with the most self time that frame
+};
+
+struct FrameStatsSettings {
+    uint32_t WindowFrames = 1000;      // Frames in the rolling percentiles
+    float HitchThresholdMs = 20.0f;    // A hitch is slower than this...
+    float HitchMedianFactor = 2.0f;    // ...and than this multiple of the rolling median (0 disables either test)
+    uint32_t HitchZoneCount = 3;
+    uint32_t MaxHitches = 32;          // Most recent hitches kept
+};
+
+// Rolling frame time recorder with percentile reporting and hitch detection.
+// Hitches are tagged with the profiler zones recorded during that frame, so
+// Profiler::BeginFrame must be called before Record.
+class FrameStats {
+public:
+    static constexpr uint32_t GraphFrames = 240;
+
+    FrameStats();
+
+    // Main thread, once per frame with the duration of the frame that just ended
+    void Record(float frameMs);
+    void Reset();
+
+    const FrameStatsSettings& GetSettings() const { return m_Settings; }
+    void SetSettings(const FrameStatsSettings& settings);
+
+    // Over the rolling window, and over every frame since the last reset
+    FramePercentiles GetWindowPercentiles() const;
+    FramePercentiles GetSessionPercentiles() const;
+
+    uint64_t GetHitchCount() const { return m_HitchCount; }
+    const std::deque<FrameHitch>& GetHitches() const { return m_Hitches; }
+
+    // Last GraphFrames frame times, oldest at GetGraphOffset (for ImGui::PlotLines)
+    const float* GetGraph() const { return m_Graph; }
+    uint32_t GetGraphOffset() const { return m_GraphOffset; }
+
+    // Session and window percentiles plus recent hitches as JSON; false if the file cannot be written
+    bool WriteSummary(const std::string& path) const;
+
+    // Percentiles of any histogram, with max the largest value actually added to it
+    static FramePercentiles GetPercentiles(const FrameTimeHistogram& histogram, uint32_t max);
+
+private:
+    void TagHitch(FrameHitch& hitch) const;
+
+    FrameStatsSettings m_Settings;
+    FrameTimeHistogram m_Window;
+    FrameTimeHistogram m_Session;
+    std::vector<uint32_t> m_WindowSamples;   // Ring of the window's frame times in microseconds
+    uint32_t m_WindowNext = 0;
+    uint32_t m_SessionMax = 0;
+
+    std::deque<FrameHitch> m_Hitches;
+    uint64_t m_HitchCount = 0;
+    uint64_t m_FrameCount = 0;
+
+    float m_Graph[GraphFrames] = {};
+    uint32_t m_GraphOffset = 0;
+};
+
+} // namespace Henky3D
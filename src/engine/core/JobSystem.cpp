@@ -0,0 +1,150 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+
+namespace Henky3D {
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    if (workerCount == 0) {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        workerCount = std::max(1u, hardwareThreads > 1 ? hardwareThreads - 1 : 1u);
+    }
+
+    m_Workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_Workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_WorkAvailable.notify_all();
+
+    for (auto& worker : m_Workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void JobSystem::Submit(Job job) {
+    m_PendingJobs.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Queue.push_back(std::move(job));
+    }
+    m_WorkAvailable.notify_one();
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize,
+                            const std::function<void(uint32_t, uint32_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    HENKY_PROFILE_ZONE("JobSystem::ParallelFor");
+    batchSize = std::max(1u, batchSize);
+    const uint32_t batchCount = (count + batchSize - 1) / batchSize;
+    if (batchCount == 1) {
+        body(0, count);
+        return;
+    }
+
+    // Helpers may start after the loop is finished, so they only touch the shared state
+    // until they claim a batch; the caller waits for every claimed batch to complete and
+    // the state goes back to the pool once the last helper is done with it
+    const uint32_t helperCount = std::min<uint32_t>(GetWorkerCount(), batchCount - 1);
+    ParallelForState* state = AcquireParallelForState();
+    state->Body = &body;
+    state->Count = count;
+    state->BatchSize = batchSize;
+    state->BatchCount = batchCount;
+    state->NextBatch.store(0, std::memory_order_relaxed);
+    state->DoneBatches.store(0, std::memory_order_relaxed);
+    state->Users.store(helperCount + 1, std::memory_order_relaxed);
+
+    for (uint32_t i = 0; i < helperCount; i++) {
+        // Two pointers fit std::function's inline storage
+        Submit([this, state]() {
+            RunBatches(*state);
+            ReleaseParallelForState(state);
+        });
+    }
+    RunBatches(*state);
+
+    {
+        std::unique_lock<std::mutex> lock(state->Mutex);
+        state->Done.wait(lock, [state, batchCount]() {
+            return state->DoneBatches.load(std::memory_order_acquire) == batchCount;
+        });
+    }
+    ReleaseParallelForState(state);
+}
+
+void JobSystem::RunBatches(ParallelForState& state) {
+    for (;;) {
+        uint32_t batch = state.NextBatch.fetch_add(1, std::memory_order_relaxed);
+        if (batch >= state.BatchCount) {
+            return;
+        }
+        uint32_t begin = batch * state.BatchSize;
+        (*state.Body)(begin, std::min(state.Count, begin + state.BatchSize));
+        if (state.DoneBatches.fetch_add(1, std::memory_order_acq_rel) + 1 == state.BatchCount) {
+            std::lock_guard<std::mutex> lock(state.Mutex);
+            state.Done.notify_all();
+        }
+    }
+}
+
+JobSystem::ParallelForState* JobSystem::AcquireParallelForState() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (m_FreeParallelForStates.empty()) {
+        m_ParallelForStates.push_back(std::make_unique<ParallelForState>());
+        return m_ParallelForStates.back().get();
+    }
+    ParallelForState* state = m_FreeParallelForStates.back();
+    m_FreeParallelForStates.pop_back();
+    return state;
+}
+
+void JobSystem::ReleaseParallelForState(ParallelForState* state) {
+    if (state->Users.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_FreeParallelForStates.push_back(state);
+    }
+}
+
+void JobSystem::WaitIdle() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Idle.wait(lock, [this]() { return m_PendingJobs.load(std::memory_order_acquire) == 0; });
+}
+
+void JobSystem::WorkerLoop() {
+    Profiler::SetThreadName("Worker");
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkAvailable.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+            if (m_Stopping && m_Queue.empty()) {
+                return;
+            }
+            job = std::move(m_Queue.front());
+            m_Queue.pop_front();
+        }
+
+        {
+            HENKY_PROFILE_ZONE("Job");
+            job();
+        }
+
+        if (m_PendingJobs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Idle.notify_all();
+        }
+    }
+}
+
+} // namespace Henky3D
@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace Henky3D {
+
+// Fixed-size worker thread pool for background engine work (asset decoding, etc.)
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    // workerCount == 0 picks hardware_concurrency - 1 (at least one worker)
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Queue a job for execution on a worker thread
+    void Submit(Job job);
+
+    // Split [0, count) into batches and run body(begin, end) across the workers and
+    // the calling thread; returns once every batch has finished
+    void ParallelFor(uint32_t count, uint32_t batchSize, const std::function<void(uint32_t, uint32_t)>& body);
+
+    // Block until the queue is empty and no job is running
+    void WaitIdle();
+
+    uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_Workers.size()); }
+    uint32_t GetPendingJobCount() const { return m_PendingJobs.load(std::memory_order_relaxed); }
+
+private:
+    // Shared by a ParallelFor call and its helper jobs; pooled so calls do not allocate
+    struct ParallelForState {
+        const std::function<void(uint32_t, uint32_t)>* Body = nullptr;
+        uint32_t Count = 0;
+        uint32_t BatchSize = 0;
+        uint32_t BatchCount = 0;
+        std::atomic<uint32_t> NextBatch{0};
+        std::atomic<uint32_t> DoneBatches{0};
+        std::atomic<uint32_t> Users{0};     // Caller plus helper jobs that have not finished
+        std::mutex Mutex;
+        std::condition_variable Done;
+    };
+
+    void WorkerLoop();
+    ParallelForState* AcquireParallelForState();
+    void ReleaseParallelForState(ParallelForState* state);
+    static void RunBatches(ParallelForState& state);
+
+    std::vector<std::thread> m_Workers;
+    std::deque<Job> m_Queue;
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkAvailable;
+    std::condition_variable m_Idle;
+    std::atomic<uint32_t> m_PendingJobs{0};
+    bool m_Stopping = false;
+    std::vector<std::unique_ptr<ParallelForState>> m_ParallelForStates;
+    std::vector<ParallelForState*> m_FreeParallelForStates;   // Guarded by m_Mutex
+};
+
+} // namespace Henky3D
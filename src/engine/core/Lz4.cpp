@@ -0,0 +1,162 @@
+#include "Lz4.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Henky3D {
+
+namespace {
+
+constexpr size_t MinMatch = 4;
+constexpr size_t LastLiterals = 5;  // The block must end with at least this many literals
+constexpr size_t MatchSafeEnd = 12; // No match may start within this many bytes of the end
+constexpr uint32_t HashBits = 14;
+constexpr size_t MaxOffset = 65535;
+
+uint32_t Read32(const uint8_t* p) {
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+uint32_t HashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+void WriteLength(std::vector<uint8_t>& dst, size_t length) {
+    while (length >= 255) {
+        dst.push_back(255);
+        length -= 255;
+    }
+    dst.push_back(static_cast<uint8_t>(length));
+}
+
+void EmitSequence(std::vector<uint8_t>& dst, const uint8_t* literals, size_t literalLength,
+                  size_t offset, size_t matchLength) {
+    const bool hasMatch = matchLength != 0;
+    const size_t matchCode = hasMatch ? matchLength - MinMatch : 0;
+
+    uint8_t token = static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4);
+    token |= static_cast<uint8_t>(std::min<size_t>(matchCode, 15));
+    dst.push_back(token);
+    if (literalLength >= 15) {
+        WriteLength(dst, literalLength - 15);
+    }
+    dst.insert(dst.end(), literals, literals + literalLength);
+
+    if (hasMatch) {
+        dst.push_back(static_cast<uint8_t>(offset & 0xFF));
+        dst.push_back(static_cast<uint8_t>(offset >> 8));
+        if (matchCode >= 15) {
+            WriteLength(dst, matchCode - 15);
+        }
+    }
+}
+
+} // namespace
+
+size_t Lz4::Compress(const uint8_t* src, size_t size, std::vector<uint8_t>& dst) {
+    const size_t start = dst.size();
+    dst.reserve(start + GetMaxCompressedSize(size));
+
+    size_t anchor = 0;
+    if (size > MatchSafeEnd) {
+        std::vector<uint32_t> table(size_t(1) << HashBits, 0xFFFFFFFFu);
+        const size_t matchLimit = size - LastLiterals;
+        size_t pos = 0;
+
+        while (pos + MatchSafeEnd <= size) {
+            const uint32_t sequence = Read32(src + pos);
+            const uint32_t hash = HashSequence(sequence);
+            const uint32_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(pos);
+
+            if (candidate == 0xFFFFFFFFu || pos - candidate > MaxOffset || Read32(src + candidate) != sequence) {
+                pos++;
+                continue;
+            }
+
+            size_t matchLength = MinMatch;
+            while (pos + matchLength < matchLimit && src[candidate + matchLength] == src[pos + matchLength]) {
+                matchLength++;
+            }
+
+            EmitSequence(dst, src + anchor, pos - anchor, pos - candidate, matchLength);
+            pos += matchLength;
+            anchor = pos;
+        }
+    }
+
+    // Trailing literals close the block
+    EmitSequence(dst, src + anchor, size - anchor, 0, 0);
+    return dst.size() - start;
+}
+
+bool Lz4::Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    const uint8_t* ip = src;
+    const uint8_t* const ipEnd = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* const opEnd = dst + dstSize;
+
+    auto readLength = [&](size_t& length) {
+        uint8_t byte;
+        do {
+            if (ip >= ipEnd) {
+                return false;
+            }
+            byte = *ip++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < ipEnd) {
+        const uint8_t token = *ip++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(literalLength)) {
+            return false;
+        }
+        if (literalLength > static_cast<size_t>(ipEnd - ip) || literalLength > static_cast<size_t>(opEnd - op)) {
+            return false;
+        }
+        if (literalLength > 0) {
+            std::memcpy(op, ip, literalLength);
+        }
+        ip += literalLength;
+        op += literalLength;
+
+        // The last sequence has literals only
+        if (ip == ipEnd) {
+            break;
+        }
+
+        if (ipEnd - ip < 2) {
+            return false;
+        }
+        const size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+            return false;
+        }
+
+        size_t matchLength = token & 0x0F;
+        if (matchLength == 15 && !readLength(matchLength)) {
+            return false;
+        }
+        matchLength += MinMatch;
+        if (matchLength > static_cast<size_t>(opEnd - op)) {
+            return false;
+        }
+
+        // Byte copy: matches may overlap their own output
+        const uint8_t* match = op - offset;
+        for (size_t i = 0; i < matchLength; i++) {
+            op[i] = match[i];
+        }
+        op += matchLength;
+    }
+
+    return op == opEnd;
+}
+
+} // namespace Henky3D
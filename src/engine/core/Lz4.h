@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace Henky3D {
+
+// LZ4 block format (no frame header). Compression is the plain greedy
+// single-pass variant; it is used offline by the packer, while the runtime only
+// needs the decoder.
+class Lz4 {
+public:
+    // Worst-case compressed size for an input of the given length
+    static size_t GetMaxCompressedSize(size_t size) { return size + size / 255 + 16; }
+
+    // Appends the compressed block to dst and returns its size
+    static size_t Compress(const uint8_t* src, size_t size, std::vector<uint8_t>& dst);
+
+    // dstSize must be the exact decompressed size; fails on malformed input
+    static bool Decompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+};
+
+} // namespace Henky3D
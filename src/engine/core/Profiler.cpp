@@ -0,0 +1,340 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+namespace Henky3D {
+
+std::atomic<bool> Profiler::s_Enabled{true};
+
+namespace {
+
+constexpr uint64_t RingMask = Profiler::EventsPerThread - 1;
+
+// Written by the owning thread only; every field is atomic so readers may copy a
+// slot that is being overwritten and discard it afterwards
+struct EventSlot {
+    std::atomic<const char*> Name{nullptr};
+    std::atomic<uint64_t> Begin{0};
+    std::atomic<uint64_t> End{0};
+    std::atomic<uint32_t> Depth{0};
+};
+
+struct ThreadBuffer {
+    uint32_t Index = 0;
+    std::string Name;                       // Guarded by ProfilerState::Mutex
+    uint32_t Depth = 0;                     // Owning thread only
+    std::atomic<uint64_t> Claimed{0};       // Events started, including one being written
+    std::atomic<uint64_t> Written{0};       // Events published
+    std::unique_ptr<EventSlot[]> Slots;
+};
+
+struct ProfilerState {
+    std::mutex Mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> Threads;
+    std::unordered_set<std::string> Interned;
+
+    // Timebase
+    uint64_t BaseTicks = 0;
+    std::chrono::steady_clock::time_point BaseTime;
+    std::atomic<double> TicksPerMs{1.0e6};
+
+    // Main thread
+    uint64_t FrameIndex = 0;
+    uint64_t FrameBegin = 0;
+    uint64_t PreviousFrameBegin = 0;
+
+    uint32_t RequestedFrames = 0;
+    std::string RequestedPath;
+    bool Capturing = false;
+    uint32_t CaptureLength = 0;
+    uint32_t CapturedFrames = 0;
+    std::string CapturePath;
+    std::vector<std::pair<uint64_t, uint64_t>> CaptureFrames;  // Frame index, begin ticks
+    ProfilerStats Stats;
+
+    ProfilerState() {
+        BaseTicks = Profiler::GetTicks();
+        BaseTime = std::chrono::steady_clock::now();
+#if defined(HENKY_PROFILER_TSC)
+        // Rough rate until enough time has passed for BeginFrame to refine it
+        std::chrono::steady_clock::time_point now;
+        do {
+            now = std::chrono::steady_clock::now();
+        } while (now - BaseTime < std::chrono::milliseconds(2));
+        double elapsedMs = std::chrono::duration<double, std::milli>(now - BaseTime).count();
+        TicksPerMs.store(static_cast<double>(Profiler::GetTicks() - BaseTicks) / elapsedMs);
+#endif
+
+        if (const char* frames = std::getenv("HENKY_PROFILE_FRAMES")) {
+            uint32_t count = static_cast<uint32_t>(std::strtoul(frames, nullptr, 10));
+            const char* output = std::getenv("HENKY_PROFILE_OUTPUT");
+            if (count > 0) {
+                RequestedFrames = count;
+                RequestedPath = output ? output : "profile_capture.json";
+            }
+        }
+    }
+};
+
+ProfilerState& GetState() {
+    static ProfilerState state;
+    return state;
+}
+
+thread_local ThreadBuffer* t_Buffer = nullptr;
+
+ThreadBuffer* GetThreadBuffer() {
+    if (!t_Buffer) {
+        ProfilerState& state = GetState();
+        auto buffer = std::make_unique<ThreadBuffer>();
+        buffer->Slots = std::make_unique<EventSlot[]>(Profiler::EventsPerThread);
+
+        std::lock_guard<std::mutex> lock(state.Mutex);
+        buffer->Index = static_cast<uint32_t>(state.Threads.size());
+        buffer->Name = "Thread " + std::to_string(buffer->Index);
+        t_Buffer = buffer.get();
+        state.Threads.push_back(std::move(buffer));
+    }
+    return t_Buffer;
+}
+
+void WriteJsonString(std::ostream& out, const char* text) {
+    out << '"';
+    for (const char* c = text ? text : ""; *c; c++) {
+        switch (*c) {
+        case '"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(*c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(*c));
+                out << escaped;
+            }
+            else {
+                out << *c;
+            }
+        }
+    }
+    out << '"';
+}
+
+} // namespace
+
+double Profiler::GetTicksPerMs() {
+    return GetState().TicksPerMs.load(std::memory_order_relaxed);
+}
+
+void Profiler::EnterZone() {
+    GetThreadBuffer()->Depth++;
+}
+
+void Profiler::LeaveZone(const char* name, uint64_t begin) {
+    const uint64_t end = GetTicks();
+    ThreadBuffer* buffer = GetThreadBuffer();
+    buffer->Depth--;
+
+    // Claim before writing so readers can tell which slot may be torn
+    const uint64_t index = buffer->Written.load(std::memory_order_relaxed);
+    buffer->Claimed.store(index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    EventSlot& slot = buffer->Slots[index & RingMask];
+    slot.Name.store(name, std::memory_order_relaxed);
+    slot.Begin.store(begin, std::memory_order_relaxed);
+    slot.End.store(end, std::memory_order_relaxed);
+    slot.Depth.store(buffer->Depth, std::memory_order_relaxed);
+    buffer->Written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+    ThreadBuffer* buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(GetState().Mutex);
+    buffer->Name = name;
+}
+
+const char* Profiler::Intern(const std::string& name) {
+    ProfilerState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    return state.Interned.insert(name).first->c_str();
+}
+
+bool Profiler::CollectEvents(uint64_t begin, uint64_t end, std::vector<ProfileEvent>& events) {
+    ProfilerState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.Mutex);
+
+    bool complete = true;
+    for (const auto& buffer : state.Threads) {
+        const uint64_t written = buffer->Written.load(std::memory_order_acquire);
+        const uint64_t first = written > EventsPerThread ? written - EventsPerThread : 0;
+        const size_t base = events.size();
+        std::vector<uint64_t> indices;
+        for (uint64_t i = first; i < written; i++) {
+            const EventSlot& slot = buffer->Slots[i & RingMask];
+            ProfileEvent event;
+            event.Begin = slot.Begin.load(std::memory_order_relaxed);
+            event.End = slot.End.load(std::memory_order_relaxed);
+            if (event.End <= begin || event.Begin >= end) {
+                continue;
+            }
+            event.Name = slot.Name.load(std::memory_order_relaxed);
+            event.Depth = slot.Depth.load(std::memory_order_relaxed);
+            event.Thread = buffer->Index;
+            events.push_back(event);
+            indices.push_back(i);
+        }
+
+        // Slots the owner started overwriting while we copied are unreliable
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const uint64_t claimed = buffer->Claimed.load(std::memory_order_relaxed);
+        const uint64_t validFrom = claimed > EventsPerThread ? claimed - EventsPerThread : 0;
+        if (validFrom > first || (first > 0 && buffer->Slots[first & RingMask].End.load(std::memory_order_relaxed) > begin)) {
+            complete = false;
+        }
+        size_t kept = base;
+        for (size_t e = base; e < events.size(); e++) {
+            if (indices[e - base] >= validFrom) {
+                events[kept++] = events[e];
+            }
+        }
+        events.resize(kept);
+    }
+    return complete;
+}
+
+void Profiler::BeginFrame() {
+    ProfilerState& state = GetState();
+    const uint64_t now = GetTicks();
+
+#if defined(HENKY_PROFILER_TSC)
+    // Refine the TSC rate over the whole run; the TSC is assumed invariant
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - state.BaseTime).count();
+    if (elapsedMs > 100.0) {
+        state.TicksPerMs.store(static_cast<double>(now - state.BaseTicks) / elapsedMs, std::memory_order_relaxed);
+    }
+#endif
+
+    state.PreviousFrameBegin = state.FrameBegin;
+    state.FrameBegin = now;
+    state.FrameIndex++;
+
+    if (state.Capturing) {
+        state.CapturedFrames++;
+        if (state.CapturedFrames < state.CaptureLength) {
+            state.CaptureFrames.emplace_back(state.FrameIndex, now);
+        }
+        else {
+            const uint64_t captureBegin = state.CaptureFrames.front().second;
+            std::vector<ProfileEvent> events;
+            bool complete = CollectEvents(captureBegin, now, events);
+            state.Capturing = false;
+
+            std::ofstream file(state.CapturePath);
+            if (!file) {
+                std::cout << "Warning: cannot write profile capture to " << state.CapturePath << std::endl;
+            }
+            else {
+                const double ticksPerUs = GetTicksPerMs() / 1000.0;
+                auto toUs = [ticksPerUs, captureBegin](uint64_t ticks) {
+                    return static_cast<double>(ticks > captureBegin ? ticks - captureBegin : 0) / ticksPerUs;
+                };
+
+                file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+                {
+                    std::lock_guard<std::mutex> lock(state.Mutex);
+                    for (const auto& buffer : state.Threads) {
+                        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->Index << ",\"args\":{\"name\":";
+                        WriteJsonString(file, buffer->Name.c_str());
+                        file << "}},\n";
+                    }
+                }
+                char number[64];
+                for (const auto& frame : state.CaptureFrames) {
+                    std::snprintf(number, sizeof(number), "%.3f", toUs(frame.second));
+                    file << "{\"name\":\"Frame " << frame.first << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":" << number << "},\n";
+                }
+                for (size_t i = 0; i < events.size(); i++) {
+                    const ProfileEvent& event = events[i];
+                    file << "{\"name\":";
+                    WriteJsonString(file, event.Name);
+                    std::snprintf(number, sizeof(number), "%.3f", toUs(event.Begin));
+                    file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.Thread << ",\"ts\":" << number;
+                    std::snprintf(number, sizeof(number), "%.3f", static_cast<double>(event.End - event.Begin) / ticksPerUs);
+                    file << ",\"dur\":" << number << "}" << (i + 1 < events.size() ? ",\n" : "\n");
+                }
+                file << "]}\n";
+
+                state.Stats.CapturesWritten++;
+                state.Stats.LastCaptureEvents = events.size();
+                state.Stats.LastCaptureTruncated = !complete;
+                state.Stats.LastCapturePath = state.CapturePath;
+                std::cout << "Profile capture of " << state.CaptureLength << " frames (" << events.size()
+                          << " zones) written to " << state.CapturePath << std::endl;
+                if (!complete) {
+                    std::cout << "Warning: profiler ring buffers wrapped during the capture; the earliest zones are missing" << std::endl;
+                }
+            }
+        }
+    }
+
+    if (!state.Capturing && state.RequestedFrames > 0) {
+        state.Capturing = true;
+        state.CaptureLength = state.RequestedFrames;
+        state.CapturePath = state.RequestedPath;
+        state.CapturedFrames = 0;
+        state.CaptureFrames.clear();
+        state.CaptureFrames.emplace_back(state.FrameIndex, now);
+        state.RequestedFrames = 0;
+    }
+}
+
+uint64_t Profiler::GetFrameIndex() {
+    return GetState().FrameIndex;
+}
+
+uint64_t Profiler::GetPreviousFrameBegin() {
+    return GetState().PreviousFrameBegin;
+}
+
+uint64_t Profiler::GetFrameBegin() {
+    return GetState().FrameBegin;
+}
+
+void Profiler::RequestCapture(uint32_t frames, const std::string& path) {
+    ProfilerState& state = GetState();
+    state.RequestedFrames = std::max(1u, frames);
+    state.RequestedPath = path;
+}
+
+bool Profiler::IsCapturing() {
+    const ProfilerState& state = GetState();
+    return state.Capturing || state.RequestedFrames > 0;
+}
+
+uint32_t Profiler::GetCapturedFrames() {
+    const ProfilerState& state = GetState();
+    return state.Capturing ? state.CapturedFrames : 0;
+}
+
+uint32_t Profiler::GetCaptureLength() {
+    const ProfilerState& state = GetState();
+    return state.Capturing ? state.CaptureLength : state.RequestedFrames;
+}
+
+ProfilerStats Profiler::GetStats() {
+    ProfilerState& state = GetState();
+    ProfilerStats stats = state.Stats;
+    std::lock_guard<std::mutex> lock(state.Mutex);
+    stats.ThreadCount = static_cast<uint32_t>(state.Threads.size());
+    return stats;
+}
+
+} // namespace Henky3D
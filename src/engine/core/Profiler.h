@@ -0,0 +1,129 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_AMD64) || defined(_M_IX86)
+#define HENKY_PROFILER_TSC 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+
+namespace Henky3D {
+
+// A finished zone; names must outlive the capture (literals, __func__ or Profiler::Intern)
+struct ProfileEvent {
+    const char* Name = nullptr;
+    uint64_t Begin = 0;         // Profiler ticks
+    uint64_t End = 0;
+    uint32_t Thread = 0;        // Registration order; 0 is the first thread to record
+    uint32_t Depth = 0;         // Nesting level on that thread
+};
+
+struct ProfilerStats {
+    uint32_t ThreadCount = 0;
+    uint32_t CapturesWritten = 0;
+    uint64_t LastCaptureEvents = 0;
+    bool LastCaptureTruncated = false;  // A ring buffer wrapped during the capture
+    std::string LastCapturePath;
+};
+
+// CPU zone profiler. Each thread writes finished zones into its own fixed-size
+// ring buffer without locks; readers copy the rings and discard slots that were
+// overwritten while copying. Timestamps come from the TSC on x86 (calibrated
+// against steady_clock) and from steady_clock elsewhere. A capture covers the
+// next N frames and is written as Chrome trace-event JSON (Perfetto, about:tracing).
+// HENKY_PROFILE_FRAMES=N (and optionally HENKY_PROFILE_OUTPUT=path) captures the
+// first N frames after startup. Ring buffers are kept for the whole run, so zones
+// belong on long-lived threads (main thread, job workers).
+class Profiler {
+public:
+    static constexpr uint32_t EventsPerThread = 1u << 15;  // Power of two, 32 bytes each
+
+    static uint64_t GetTicks() {
+#if defined(HENKY_PROFILER_TSC)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+    static double GetTicksPerMs();
+    static double TicksToMs(uint64_t ticks) { return static_cast<double>(ticks) / GetTicksPerMs(); }
+
+    // Main thread, once per frame: marks the frame boundary and finishes captures
+    static void BeginFrame();
+    static uint64_t GetFrameIndex();
+    // Start of the frame before the current one and of the current one, in ticks
+    static uint64_t GetPreviousFrameBegin();
+    static uint64_t GetFrameBegin();
+
+    static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+    static void SetEnabled(bool enabled) { s_Enabled.store(enabled, std::memory_order_relaxed); }
+
+    // Label the calling thread in captures
+    static void SetThreadName(const std::string& name);
+    // Stable copy of a runtime string for use as a zone name
+    static const char* Intern(const std::string& name);
+
+    // Record the next frames and write them to path once they are complete
+    static void RequestCapture(uint32_t frames, const std::string& path);
+    static bool IsCapturing();
+    static uint32_t GetCapturedFrames();
+    static uint32_t GetCaptureLength();
+
+    // Appends the events of every thread that overlap [begin, end); returns false if a
+    // ring has already overwritten part of that range
+    static bool CollectEvents(uint64_t begin, uint64_t end, std::vector<ProfileEvent>& events);
+
+    static ProfilerStats GetStats();
+
+    // Used by ProfileZone
+    static void EnterZone();
+    static void LeaveZone(const char* name, uint64_t begin);
+
+private:
+    static std::atomic<bool> s_Enabled;
+};
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : m_Name(name), m_Active(Profiler::IsEnabled()) {
+        if (m_Active) {
+            Profiler::EnterZone();
+            m_Begin = Profiler::GetTicks();
+        }
+    }
+
+    ~ProfileZone() {
+        if (m_Active) {
+            Profiler::LeaveZone(m_Name, m_Begin);
+        }
+    }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* m_Name;
+    uint64_t m_Begin = 0;
+    bool m_Active;
+};
+
+} // namespace Henky3D
+
+#define HENKY_PROFILE_CONCAT_INNER(a, b) a##b
+#define HENKY_PROFILE_CONCAT(a, b) HENKY_PROFILE_CONCAT_INNER(a, b)
+
+#if defined(HENKY_DISABLE_PROFILER)
+#define HENKY_PROFILE_ZONE(name) ((void)0)
+#else
+#define HENKY_PROFILE_ZONE(name) ::Henky3D::ProfileZone HENKY_PROFILE_CONCAT(henkyProfileZone, __LINE__)(name)
+#endif
+#define HENKY_PROFILE_FUNCTION() HENKY_PROFILE_ZONE(__func__)
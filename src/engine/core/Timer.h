@@ -1,5 +1,7 @@
 #pragma once
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
 
 namespace Henky3D {
 
@@ -53,4 +55,52 @@ private:
     float m_FrameTime = 0.0f;
 };
 
+// Accumulates frame time into fixed simulation steps. Advance returns how many steps
+// to run this frame, at most MaxSteps; time beyond that is dropped, so one slow frame
+// does not make the next one run even more steps.
+class FixedTimestep {
+public:
+    explicit FixedTimestep(float stepSeconds = 1.0f / 60.0f, uint32_t maxSteps = 4)
+        : m_Step(stepSeconds), m_MaxSteps(maxSteps) {}
+
+    uint32_t Advance(float deltaTime) {
+        m_Accumulator += deltaTime;
+        uint32_t steps = static_cast<uint32_t>(m_Accumulator / m_Step);
+        if (steps > m_MaxSteps) {
+            // Keep the phase within the step so interpolation stays continuous
+            const float excess = (steps - m_MaxSteps) * m_Step;
+            m_DroppedTime += excess;
+            m_Accumulator -= excess;
+            steps = m_MaxSteps;
+        }
+        m_Accumulator = std::max(m_Accumulator - steps * m_Step, 0.0f);
+        m_LastSteps = steps;
+        return steps;
+    }
+
+    // Fraction of a step left over after the last Advance: 0 renders the last
+    // simulation step as is, values towards 1 approach the next one
+    float GetAlpha() const { return std::min(m_Accumulator / m_Step, 1.0f); }
+
+    float GetStep() const { return m_Step; }
+    void SetStep(float stepSeconds) { m_Step = std::max(stepSeconds, 1e-4f); }
+    uint32_t GetMaxSteps() const { return m_MaxSteps; }
+    void SetMaxSteps(uint32_t maxSteps) { m_MaxSteps = std::max(maxSteps, 1u); }
+
+    uint32_t GetLastSteps() const { return m_LastSteps; }
+    float GetDroppedTime() const { return m_DroppedTime; }  // Seconds discarded by the step cap
+
+    void Reset() {
+        m_Accumulator = 0.0f;
+        m_LastSteps = 0;
+    }
+
+private:
+    float m_Step;
+    uint32_t m_MaxSteps;
+    float m_Accumulator = 0.0f;
+    uint32_t m_LastSteps = 0;
+    float m_DroppedTime = 0.0f;
+};
+
 } // namespace Henky3D
@@ -1,5 +1,6 @@
 #include "Window.h"
 #include "../input/Input.h"
+#include <cstdlib>
 #include <stdexcept>
 #include <iostream>
 
@@ -10,9 +11,16 @@ extern "C" {
 
 namespace Henky3D {
 
-Window::Window(const std::string& title, uint32_t width, uint32_t height)
-    : m_Width(width), m_Height(height), m_Title(title), m_Handle(nullptr) {
+Window::Window(const std::string& title, uint32_t width, uint32_t height, const WindowOptions& options)
+    : m_Handle(nullptr), m_Width(width), m_Height(height), m_Title(title), m_Headless(options.Headless), m_VSync(options.VSync) {
     
+#if defined(GLFW_PLATFORM_NULL) && defined(__linux__)
+    // Without a display server, GLFW's null platform creates a surfaceless EGL context
+    if (m_Headless && !std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY")) {
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+    }
+#endif
+
     // Initialize GLFW
     if (!glfwInit()) {
         throw std::runtime_error("Failed to initialize GLFW");
@@ -23,9 +31,23 @@ Window::Window(const std::string& title, uint32_t width, uint32_t height)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    if (m_Headless) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#if defined(GLFW_PLATFORM_NULL)
+        if (glfwGetPlatform() == GLFW_PLATFORM_NULL) {
+            glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+        }
+#endif
+    }
     
     // Create window
     m_Handle = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+    if (!m_Handle) {
+        // GL 4.5 drivers such as Mesa llvmpipe; the renderer adapts its shaders
+        std::cout << "Warning: OpenGL 4.6 context unavailable, trying 4.5" << std::endl;
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+        m_Handle = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+    }
     if (!m_Handle) {
         glfwTerminate();
         throw std::runtime_error("Failed to create GLFW window");
@@ -34,8 +56,8 @@ Window::Window(const std::string& title, uint32_t width, uint32_t height)
     // Make OpenGL context current
     glfwMakeContextCurrent(m_Handle);
     
-    // Enable vsync
-    glfwSwapInterval(1);
+    // Vsync unless benchmarking
+    SetVSync(options.VSync);
 
     // Set user pointer for callbacks
     glfwSetWindowUserPointer(m_Handle, this);
@@ -43,7 +65,7 @@ Window::Window(const std::string& title, uint32_t width, uint32_t height)
     // Set resize callback
     glfwSetFramebufferSizeCallback(m_Handle, FramebufferSizeCallback);
     
-    std::cout << "Window created: " << width << "x" << height << std::endl;
+    std::cout << (m_Headless ? "Headless context created: " : "Window created: ") << width << "x" << height << std::endl;
 }
 
 Window::~Window() {
@@ -53,6 +75,11 @@ Window::~Window() {
     glfwTerminate();
 }
 
+void Window::SetVSync(bool enabled) {
+    glfwSwapInterval(enabled ? 1 : 0);
+    m_VSync = enabled;
+}
+
 bool Window::ProcessMessages() {
     glfwPollEvents();
     return !glfwWindowShouldClose(m_Handle);
@@ -6,11 +6,16 @@
 
 namespace Henky3D {
 
+struct WindowOptions {
+    bool Headless = false;  // No visible window; the device renders into an offscreen framebuffer
+    bool VSync = true;
+};
+
 class Window {
 public:
     using EventCallback = std::function<void()>;
 
-    Window(const std::string& title, uint32_t width, uint32_t height);
+    Window(const std::string& title, uint32_t width, uint32_t height, const WindowOptions& options = {});
     ~Window();
 
     bool ProcessMessages();
@@ -19,6 +24,10 @@ public:
     GLFWwindow* GetHandle() const { return m_Handle; }
     uint32_t GetWidth() const { return m_Width; }
     uint32_t GetHeight() const { return m_Height; }
+    bool IsHeadless() const { return m_Headless; }
+
+    void SetVSync(bool enabled);
+    bool IsVSync() const { return m_VSync; }
 
 private:
     static void FramebufferSizeCallback(GLFWwindow* window, int width, int height);
@@ -27,6 +36,8 @@ private:
     uint32_t m_Width;
     uint32_t m_Height;
     std::string m_Title;
+    bool m_Headless;
+    bool m_VSync;
     EventCallback m_EventCallback;
 };
 
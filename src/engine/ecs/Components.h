@@ -17,6 +17,8 @@ struct Transform {
     // Cached world matrix and dirty flag
     mutable glm::mat4 WorldMatrix = glm::mat4(1.0f);
     mutable bool Dirty = true;
+    // Skips render interpolation on the next update, so new objects do not blend in from the origin
+    mutable bool Teleported = true;
 
     glm::mat4 GetLocalMatrix() const {
         glm::mat4 translation = glm::translate(glm::mat4(1.0f), Position);
@@ -34,6 +36,20 @@ struct Transform {
     void MarkDirty() {
         Dirty = true;
     }
+
+    // Moves instantly instead of blending from the previous simulation step
+    void MarkTeleported() {
+        Dirty = true;
+        Teleported = true;
+    }
+};
+
+// Added by TransformSystem to transforms that moved in the last fixed simulation step.
+// While present, Transform::WorldMatrix holds the interpolated matrix for rendering and
+// CurrentWorldMatrix the simulation result, restored by TransformSystem::BeginStep.
+struct TransformInterpolation {
+    glm::mat4 PreviousWorldMatrix;
+    glm::mat4 CurrentWorldMatrix;
 };
 
 struct Frustum {
@@ -154,6 +170,7 @@ struct Camera {
 
 struct Renderable {
     bool Visible = true;
+    bool Static = false; // Never moves; its shadow is cached until the light changes
     glm::vec4 Color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
 };
 
@@ -183,6 +200,9 @@ struct Light {
     glm::vec4 Color = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
     float Intensity = 1.0f;
     float Range = 10.0f;
+    float InnerConeAngle = 0.35f; // Spot lights: half-angles in radians, full intensity inside the inner cone
+    float OuterConeAngle = 0.5f;
+    bool CastShadows = true;      // Point and spot lights get shadow atlas tiles
 };
 
 } // namespace Henky3D
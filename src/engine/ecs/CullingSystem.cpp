@@ -1,15 +1,19 @@
 #include "CullingSystem.h"
+#include "../core/Profiler.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace Henky3D {
 
-std::vector<entt::entity> CullingSystem::CullEntities(ECSWorld* world, const Frustum& frustum) {
-    std::vector<entt::entity> visibleEntities;
-    
+FrameVector<entt::entity> CullingSystem::CullEntities(ECSWorld* world, const Frustum& frustum, FrameArena& arena) {
+    HENKY_PROFILE_ZONE("CullingSystem::CullEntities");
     auto& registry = world->GetRegistry();
     auto view = registry.view<Transform, Renderable, BoundingBox>();
 
+    // Arena memory is cheap to over-reserve and growing would strand the old copies
+    FrameVector<entt::entity> visibleEntities(arena);
+    visibleEntities.reserve(view.size_hint());
+
     for (auto entity : view) {
         auto& transform = view.get<Transform>(entity);
         auto& renderable = view.get<Renderable>(entity);
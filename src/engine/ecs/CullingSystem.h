@@ -1,15 +1,15 @@
 #pragma once
 #include "ECSWorld.h"
 #include "Components.h"
-#include <vector>
+#include "../core/FrameAllocator.h"
 #include <entt/entt.hpp>
 
 namespace Henky3D {
 
 class CullingSystem {
 public:
-    // Perform frustum culling and return list of visible entities
-    static std::vector<entt::entity> CullEntities(ECSWorld* world, const Frustum& frustum);
+    // Perform frustum culling and return list of visible entities; the list lives in the arena until its second BeginFrame
+    static FrameVector<entt::entity> CullEntities(ECSWorld* world, const Frustum& frustum, FrameArena& arena);
 };
 
 } // namespace Henky3D
@@ -1,9 +1,41 @@
 #include "TransformSystem.h"
+#include "../core/Profiler.h"
 #include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 namespace Henky3D {
 
-void TransformSystem::UpdateTransforms(ECSWorld* world) {
+namespace {
+
+// Blends translation, rotation and scale separately; a plain matrix lerp would
+// shrink and shear rotating objects
+glm::mat4 BlendMatrices(const glm::mat4& from, const glm::mat4& to, float alpha) {
+    const glm::vec3 fromScale(glm::length(glm::vec3(from[0])), glm::length(glm::vec3(from[1])), glm::length(glm::vec3(from[2])));
+    const glm::vec3 toScale(glm::length(glm::vec3(to[0])), glm::length(glm::vec3(to[1])), glm::length(glm::vec3(to[2])));
+    constexpr float MinScale = 1e-6f;
+    if (glm::min(glm::min(fromScale.x, fromScale.y), fromScale.z) < MinScale ||
+        glm::min(glm::min(toScale.x, toScale.y), toScale.z) < MinScale) {
+        return from + (to - from) * alpha;
+    }
+
+    const glm::quat fromRotation = glm::quat_cast(glm::mat3(
+        glm::vec3(from[0]) / fromScale.x, glm::vec3(from[1]) / fromScale.y, glm::vec3(from[2]) / fromScale.z));
+    const glm::quat toRotation = glm::quat_cast(glm::mat3(
+        glm::vec3(to[0]) / toScale.x, glm::vec3(to[1]) / toScale.y, glm::vec3(to[2]) / toScale.z));
+    const glm::vec3 scale = glm::mix(fromScale, toScale, alpha);
+
+    glm::mat4 result = glm::mat4_cast(glm::slerp(fromRotation, toRotation, alpha));
+    result[0] *= scale.x;
+    result[1] *= scale.y;
+    result[2] *= scale.z;
+    result[3] = glm::vec4(glm::mix(glm::vec3(from[3]), glm::vec3(to[3]), alpha), 1.0f);
+    return result;
+}
+
+} // namespace
+
+void TransformSystem::UpdateTransforms(ECSWorld* world, bool trackInterpolation) {
+    HENKY_PROFILE_ZONE("TransformSystem::UpdateTransforms");
     auto& registry = world->GetRegistry();
     auto view = registry.view<Transform>();
 
@@ -17,11 +49,31 @@ void TransformSystem::UpdateTransforms(ECSWorld* world) {
         }
 
         // Update this transform and its children
-        UpdateTransformRecursive(world, entity, glm::mat4(1.0f));
+        UpdateTransformRecursive(world, entity, glm::mat4(1.0f), trackInterpolation);
     }
 }
 
-void TransformSystem::UpdateTransformRecursive(ECSWorld* world, entt::entity entity, const glm::mat4& parentWorld) {
+void TransformSystem::BeginStep(ECSWorld* world) {
+    HENKY_PROFILE_ZONE("TransformSystem::BeginStep");
+    auto& registry = world->GetRegistry();
+    auto view = registry.view<Transform, TransformInterpolation>();
+    for (auto entity : view) {
+        view.get<Transform>(entity).WorldMatrix = view.get<TransformInterpolation>(entity).CurrentWorldMatrix;
+    }
+    registry.clear<TransformInterpolation>();
+}
+
+void TransformSystem::Interpolate(ECSWorld* world, float alpha) {
+    HENKY_PROFILE_ZONE("TransformSystem::Interpolate");
+    auto view = world->GetRegistry().view<Transform, TransformInterpolation>();
+    for (auto entity : view) {
+        const auto& interpolation = view.get<TransformInterpolation>(entity);
+        view.get<Transform>(entity).WorldMatrix =
+            BlendMatrices(interpolation.PreviousWorldMatrix, interpolation.CurrentWorldMatrix, alpha);
+    }
+}
+
+void TransformSystem::UpdateTransformRecursive(ECSWorld* world, entt::entity entity, const glm::mat4& parentWorld, bool trackInterpolation) {
     auto& registry = world->GetRegistry();
     
     if (!registry.valid(entity) || !registry.any_of<Transform>(entity)) {
@@ -34,8 +86,12 @@ void TransformSystem::UpdateTransformRecursive(ECSWorld* world, entt::entity ent
     if (transform.Dirty) {
         glm::mat4 localMatrix = transform.GetLocalMatrix();
         glm::mat4 worldMatrix = parentWorld * localMatrix;
+        if (trackInterpolation && !transform.Teleported && worldMatrix != transform.WorldMatrix) {
+            registry.emplace_or_replace<TransformInterpolation>(entity, transform.WorldMatrix, worldMatrix);
+        }
         transform.WorldMatrix = worldMatrix;
         transform.Dirty = false;
+        transform.Teleported = false;
     }
 
     // Update all children
@@ -44,7 +100,7 @@ void TransformSystem::UpdateTransformRecursive(ECSWorld* world, entt::entity ent
     for (auto childEntity : allTransforms) {
         auto& childTransform = allTransforms.get<Transform>(childEntity);
         if (childTransform.Parent == entity) {
-            UpdateTransformRecursive(world, childEntity, worldMatrix);
+            UpdateTransformRecursive(world, childEntity, worldMatrix, trackInterpolation);
         }
     }
 }
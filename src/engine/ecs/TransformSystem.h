@@ -6,11 +6,18 @@ namespace Henky3D {
 
 class TransformSystem {
 public:
-    // Update all transforms in the hierarchy, computing world matrices
-    static void UpdateTransforms(ECSWorld* world);
+    // Update all transforms in the hierarchy, computing world matrices. With
+    // trackInterpolation, transforms that move get a TransformInterpolation for Interpolate.
+    static void UpdateTransforms(ECSWorld* world, bool trackInterpolation = false);
+
+    // Fixed-step render interpolation: BeginStep runs before each simulation step and
+    // puts back the simulation matrices, Interpolate runs before rendering and blends
+    // the transforms that moved in the last step, alpha = 0 previous, 1 current step
+    static void BeginStep(ECSWorld* world);
+    static void Interpolate(ECSWorld* world, float alpha);
 
 private:
-    static void UpdateTransformRecursive(ECSWorld* world, entt::entity entity, const glm::mat4& parentWorld);
+    static void UpdateTransformRecursive(ECSWorld* world, entt::entity entity, const glm::mat4& parentWorld, bool trackInterpolation);
 };
 
 } // namespace Henky3D
@@ -0,0 +1,362 @@
+#include "WorldPartition.h"
+#include "WorldSnapshot.h"
+#include "Components.h"
+#include "../core/JobSystem.h"
+#include "../core/Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+namespace Henky3D {
+
+WorldPartition::WorldPartition(ECSWorld* world, JobSystem* jobSystem, const WorldPartitionSettings& settings)
+    : m_World(world), m_JobSystem(jobSystem), m_Shared(std::make_shared<SharedState>()) {
+    SetSettings(settings);
+}
+
+WorldPartition::~WorldPartition() {
+    Close();
+}
+
+uint64_t WorldPartition::GetCellKey(int32_t x, int32_t z) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z);
+}
+
+std::string WorldPartition::GetCellFileName(int32_t x, int32_t z) {
+    return "cell_" + std::to_string(x) + "_" + std::to_string(z) + ".hsnap";
+}
+
+bool WorldPartition::Build(ECSWorld* world, float cellSize, const std::string& directory) {
+    HENKY_PROFILE_ZONE("WorldPartition::Build");
+    if (cellSize <= 0.0f) {
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    auto& registry = world->GetRegistry();
+    auto cellOf = [cellSize](const glm::vec3& position) {
+        return std::make_pair(static_cast<int32_t>(std::floor(position.x / cellSize)),
+                              static_cast<int32_t>(std::floor(position.z / cellSize)));
+    };
+
+    // Ordered so the manifest and file contents do not depend on hash order
+    std::map<std::pair<int32_t, int32_t>, std::vector<entt::entity>> cells;
+    auto transforms = registry.view<Transform>();
+    for (auto entity : transforms) {
+        // Whole hierarchies go to the cell of their root; the step bound guards against cycles
+        entt::entity root = entity;
+        for (size_t steps = 0; steps < transforms.size(); steps++) {
+            const entt::entity parent = registry.get<Transform>(root).Parent;
+            if (parent == entt::null || !registry.valid(parent) || !registry.all_of<Transform>(parent)) {
+                break;
+            }
+            root = parent;
+        }
+        cells[cellOf(registry.get<Transform>(root).Position)].push_back(entity);
+    }
+    auto lights = registry.view<Light>();
+    for (auto entity : lights) {
+        const Light& light = lights.get<Light>(entity);
+        if (light.LightType != Light::Type::Directional && !registry.all_of<Transform>(entity)) {
+            cells[cellOf(light.Position)].push_back(entity);
+        }
+    }
+
+    std::vector<PartitionCell> entries;
+    entries.reserve(cells.size());
+    for (const auto& [coordinates, entities] : cells) {
+        const std::string path = (std::filesystem::path(directory) / GetCellFileName(coordinates.first, coordinates.second)).string();
+        if (!WorldSnapshot::Save(world, entities, path)) {
+            return false;
+        }
+        entries.push_back({ coordinates.first, coordinates.second, static_cast<uint32_t>(entities.size()), 0 });
+    }
+
+    PartitionHeader header = {};
+    header.Magic = PartitionHeader::MagicValue;
+    header.Version = PartitionHeader::CurrentVersion;
+    header.CellCount = static_cast<uint32_t>(entries.size());
+    header.CellSize = cellSize;
+    const std::string manifestPath = (std::filesystem::path(directory) / ManifestName).string();
+    std::ofstream manifest(manifestPath, std::ios::binary);
+    manifest.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    manifest.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PartitionCell)));
+    if (!manifest) {
+        std::cout << "Warning: cannot write world partition manifest " << manifestPath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WorldPartition::Open(const std::string& directory) {
+    Close();
+    const std::string manifestPath = (std::filesystem::path(directory) / ManifestName).string();
+    std::ifstream manifest(manifestPath, std::ios::binary);
+    PartitionHeader header = {};
+    if (!manifest.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.Magic != PartitionHeader::MagicValue ||
+        header.Version != PartitionHeader::CurrentVersion || !(header.CellSize > 0.0f)) {
+        std::cout << "Warning: cannot open world partition " << manifestPath << std::endl;
+        return false;
+    }
+    std::vector<PartitionCell> entries(header.CellCount);
+    if (!manifest.read(reinterpret_cast<char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PartitionCell)))) {
+        std::cout << "Warning: truncated world partition manifest " << manifestPath << std::endl;
+        return false;
+    }
+
+    m_Directory = directory;
+    m_CellSize = header.CellSize;
+    m_Cells.resize(entries.size());
+    m_CellIndex.reserve(entries.size());
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        m_Cells[i].X = entries[i].X;
+        m_Cells[i].Z = entries[i].Z;
+        m_Cells[i].EntityCount = entries[i].EntityCount;
+        m_CellIndex[GetCellKey(entries[i].X, entries[i].Z)] = i;
+    }
+    return true;
+}
+
+void WorldPartition::CancelLoads() {
+    // Load jobs hold their own reference to the shared state and drop results once cancelled
+    m_Shared->Cancelled.store(true, std::memory_order_release);
+    m_Shared = std::make_shared<SharedState>();
+    m_InFlight = 0;
+}
+
+void WorldPartition::Close() {
+    CancelLoads();
+    auto& registry = m_World->GetRegistry();
+    for (uint32_t index : m_Active) {
+        Cell& cell = m_Cells[index];
+        for (uint32_t i = 0; i < cell.Progress; i++) {
+            if (registry.valid(cell.Entities[i])) {
+                registry.destroy(cell.Entities[i]);
+            }
+        }
+    }
+    m_Active.clear();
+    m_Cells.clear();
+    m_CellIndex.clear();
+    m_Directory.clear();
+    m_CellSize = 0.0f;
+    m_Stats = {};
+}
+
+void WorldPartition::SetSettings(const WorldPartitionSettings& settings) {
+    m_Settings = settings;
+    m_Settings.UnloadRadius = std::max(m_Settings.UnloadRadius, m_Settings.LoadRadius);
+    m_Settings.MaxInFlight = std::max(1u, m_Settings.MaxInFlight);
+    m_Settings.InstantiateBatch = std::max(1u, m_Settings.InstantiateBatch);
+}
+
+float WorldPartition::GetDistance(const Cell& cell, const glm::vec3& position) const {
+    // To the nearest point of the cell on the ground plane
+    const float minX = cell.X * m_CellSize;
+    const float minZ = cell.Z * m_CellSize;
+    const float dx = std::max({ minX - position.x, 0.0f, position.x - (minX + m_CellSize) });
+    const float dz = std::max({ minZ - position.z, 0.0f, position.z - (minZ + m_CellSize) });
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+void WorldPartition::Update(const glm::vec3& cameraPosition) {
+    if (m_Cells.empty()) {
+        return;
+    }
+    HENKY_PROFILE_ZONE("WorldPartition::Update");
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t index : m_Active) {
+        Cell& cell = m_Cells[index];
+        cell.Distance = GetDistance(cell, cameraPosition);
+        if (cell.Distance > m_Settings.UnloadRadius &&
+            (cell.State == CellState::Instantiating || cell.State == CellState::Resident)) {
+            // Destroy whatever was created so far, newest first
+            if (cell.State == CellState::Resident) {
+                m_Stats.ResidentEntities -= cell.EntityCount;
+                m_Stats.ResidentBytes -= cell.Bytes;
+            }
+            cell.Snapshot.reset();
+            cell.State = CellState::Unloading;
+        }
+    }
+
+    CollectLoads(cameraPosition);
+    StartLoads(cameraPosition);
+    RunSlicedWork();
+
+    m_Active.erase(std::remove_if(m_Active.begin(), m_Active.end(), [this](uint32_t index) {
+        return m_Cells[index].State == CellState::Unloaded || m_Cells[index].State == CellState::Failed;
+    }), m_Active.end());
+
+    m_Stats.ResidentCells = 0;
+    m_Stats.LoadingCells = 0;
+    m_Stats.PendingCells = 0;
+    for (uint32_t index : m_Active) {
+        switch (m_Cells[index].State) {
+            case CellState::Resident: m_Stats.ResidentCells++; break;
+            case CellState::Loading: m_Stats.LoadingCells++; break;
+            default: m_Stats.PendingCells++; break;
+        }
+    }
+    m_Stats.UpdateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void WorldPartition::CollectLoads(const glm::vec3& cameraPosition) {
+    std::vector<LoadResult> completed;
+    {
+        std::lock_guard<std::mutex> lock(m_Shared->Mutex);
+        completed.swap(m_Shared->Completed);
+    }
+    for (LoadResult& result : completed) {
+        m_InFlight--;
+        Cell& cell = m_Cells[result.Cell];
+        if (!result.Snapshot) {
+            std::cout << "Warning: cannot load world cell " << GetCellFileName(cell.X, cell.Z) << std::endl;
+            cell.State = CellState::Failed;
+            m_Stats.TotalFailed++;
+            continue;
+        }
+        // The camera may have moved away while the file was read
+        if (GetDistance(cell, cameraPosition) > m_Settings.UnloadRadius) {
+            cell.State = CellState::Unloaded;
+            continue;
+        }
+        cell.Bytes = result.Snapshot->GetSize();
+        cell.EntityCount = result.Snapshot->GetEntityCount();
+        cell.Snapshot = std::move(result.Snapshot);
+        cell.Entities.clear();
+        cell.Progress = 0;
+        cell.State = CellState::Instantiating;
+    }
+}
+
+void WorldPartition::StartLoads(const glm::vec3& cameraPosition) {
+    if (m_InFlight >= m_Settings.MaxInFlight) {
+        return;
+    }
+
+    // Only the cells inside the load radius's bounding square need a lookup
+    const float radius = m_Settings.LoadRadius;
+    const int32_t minX = static_cast<int32_t>(std::floor((cameraPosition.x - radius) / m_CellSize));
+    const int32_t maxX = static_cast<int32_t>(std::floor((cameraPosition.x + radius) / m_CellSize));
+    const int32_t minZ = static_cast<int32_t>(std::floor((cameraPosition.z - radius) / m_CellSize));
+    const int32_t maxZ = static_cast<int32_t>(std::floor((cameraPosition.z + radius) / m_CellSize));
+    std::vector<std::pair<float, uint32_t>> candidates;
+    for (int32_t z = minZ; z <= maxZ; z++) {
+        for (int32_t x = minX; x <= maxX; x++) {
+            auto it = m_CellIndex.find(GetCellKey(x, z));
+            if (it == m_CellIndex.end() || m_Cells[it->second].State != CellState::Unloaded) {
+                continue;
+            }
+            const float distance = GetDistance(m_Cells[it->second], cameraPosition);
+            if (distance <= radius) {
+                candidates.emplace_back(distance, it->second);
+            }
+        }
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    for (const auto& candidate : candidates) {
+        if (m_InFlight >= m_Settings.MaxInFlight) {
+            break;
+        }
+        Cell& cell = m_Cells[candidate.second];
+        cell.State = CellState::Loading;
+        cell.Distance = candidate.first;
+        m_Active.push_back(candidate.second);
+        m_InFlight++;
+
+        std::shared_ptr<SharedState> shared = m_Shared;
+        const uint32_t index = candidate.second;
+        const std::string path = (std::filesystem::path(m_Directory) / GetCellFileName(cell.X, cell.Z)).string();
+        m_JobSystem->Submit([shared, index, path]() {
+            HENKY_PROFILE_ZONE("WorldPartition::LoadCell");
+            if (shared->Cancelled.load(std::memory_order_acquire)) {
+                return;
+            }
+            LoadResult result;
+            result.Cell = index;
+            auto snapshot = std::make_unique<WorldSnapshot>();
+            if (snapshot->Open(path)) {
+                snapshot->Prefetch();
+                result.Snapshot = std::move(snapshot);
+            }
+            std::lock_guard<std::mutex> lock(shared->Mutex);
+            shared->Completed.push_back(std::move(result));
+        });
+    }
+}
+
+void WorldPartition::RunSlicedWork() {
+    // Unloads first to give memory back, then the nearest cells
+    std::vector<uint32_t> work;
+    for (uint32_t index : m_Active) {
+        const CellState state = m_Cells[index].State;
+        if (state == CellState::Unloading || state == CellState::Instantiating) {
+            work.push_back(index);
+        }
+    }
+    std::sort(work.begin(), work.end(), [this](uint32_t a, uint32_t b) {
+        const bool unloadA = m_Cells[a].State == CellState::Unloading;
+        const bool unloadB = m_Cells[b].State == CellState::Unloading;
+        if (unloadA != unloadB) {
+            return unloadA;
+        }
+        return m_Cells[a].Distance < m_Cells[b].Distance;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t index : work) {
+        for (;;) {
+            const bool more = StepCell(m_Cells[index]);
+            if (std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= m_Settings.InstantiateBudgetMs) {
+                return;
+            }
+            if (!more) {
+                break;
+            }
+        }
+    }
+}
+
+bool WorldPartition::StepCell(Cell& cell) {
+    // One batch; returns true while the cell has more work
+    auto& registry = m_World->GetRegistry();
+    if (cell.State == CellState::Instantiating) {
+        cell.Progress += cell.Snapshot->Instantiate(m_World, cell.Entities, cell.Progress, m_Settings.InstantiateBatch);
+        if (cell.Progress < cell.EntityCount) {
+            return true;
+        }
+        cell.Snapshot.reset();
+        cell.State = CellState::Resident;
+        m_Stats.ResidentEntities += cell.EntityCount;
+        m_Stats.ResidentBytes += cell.Bytes;
+        m_Stats.TotalLoaded++;
+        return false;
+    }
+
+    // Children were created after their parents, so destroy from the end
+    const uint32_t end = cell.Progress;
+    cell.Progress -= std::min(cell.Progress, m_Settings.InstantiateBatch);
+    for (uint32_t i = cell.Progress; i < end; i++) {
+        if (registry.valid(cell.Entities[i])) {
+            registry.destroy(cell.Entities[i]);
+        }
+    }
+    if (cell.Progress > 0) {
+        return true;
+    }
+    cell.Entities.clear();
+    cell.Entities.shrink_to_fit();
+    cell.State = CellState::Unloaded;
+    m_Stats.TotalUnloaded++;
+    return false;
+}
+
+} // namespace Henky3D
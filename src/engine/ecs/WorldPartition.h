@@ -0,0 +1,155 @@
+#pragma once
+#include "ECSWorld.h"
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Henky3D {
+
+class JobSystem;
+class WorldSnapshot;
+
+// On-disk layout of a partitioned world (little endian): a manifest
+//   PartitionHeader
+//   PartitionCell[CellCount]
+// in partition.hpart, and one WorldSnapshot per cell in cell_<x>_<z>.hsnap next to it.
+// Cell (x, z) covers [x, x + 1) * CellSize on the X axis and the same on Z.
+struct PartitionHeader {
+    static constexpr uint32_t MagicValue = 0x54525048; // "HPRT"
+    static constexpr uint32_t CurrentVersion = 1;
+
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t CellCount;
+    float CellSize;
+};
+
+struct PartitionCell {
+    int32_t X;
+    int32_t Z;
+    uint32_t EntityCount;
+    uint32_t Reserved;
+};
+
+static_assert(sizeof(PartitionHeader) == 16, "PartitionHeader layout is part of the file format");
+static_assert(sizeof(PartitionCell) == 16, "PartitionCell layout is part of the file format");
+
+struct WorldPartitionSettings {
+    float LoadRadius = 192.0f;          // Cells whose nearest point (XZ) is closer than this are loaded
+    float UnloadRadius = 256.0f;        // ...and only unloaded beyond this one
+    uint32_t MaxInFlight = 4;           // Cell files being mapped and validated on workers at once
+    float InstantiateBudgetMs = 1.0f;   // Main thread time per frame for creating and destroying entities
+    uint32_t InstantiateBatch = 512;    // Entities per step; at least one step runs each frame
+};
+
+struct WorldPartitionStats {
+    uint32_t ResidentCells = 0;
+    uint32_t LoadingCells = 0;          // Reading on a worker
+    uint32_t PendingCells = 0;          // Being instantiated or destroyed in time slices
+    uint32_t ResidentEntities = 0;
+    size_t ResidentBytes = 0;           // Snapshot bytes of the resident cells
+    uint64_t TotalLoaded = 0;
+    uint64_t TotalUnloaded = 0;
+    uint64_t TotalFailed = 0;
+    float UpdateMs = 0.0f;
+};
+
+// Streams the cells of a partitioned world into an ECSWorld around the camera.
+// Cell snapshots are mapped and validated on the job system (bounded by
+// MaxInFlight), then instantiated and later destroyed on the main thread in
+// batches within a per-frame time budget, nearest cells first. The gap between
+// the load and unload radius keeps cells near the boundary from thrashing.
+class WorldPartition {
+public:
+    static constexpr const char* ManifestName = "partition.hpart";
+
+    WorldPartition(ECSWorld* world, JobSystem* jobSystem, const WorldPartitionSettings& settings = {});
+    ~WorldPartition();
+
+    WorldPartition(const WorldPartition&) = delete;
+    WorldPartition& operator=(const WorldPartition&) = delete;
+
+    // Splits a world into cells and writes the manifest and cell snapshots to directory.
+    // Hierarchies go to the cell of their root transform and point/spot lights to the cell
+    // of their position; cameras, directional lights and other unplaced entities are skipped.
+    static bool Build(ECSWorld* world, float cellSize, const std::string& directory);
+
+    bool Open(const std::string& directory);
+    // Destroys the entities of every loaded cell and forgets the manifest
+    void Close();
+    bool IsOpen() const { return !m_Cells.empty(); }
+
+    // Main thread, once per frame before the transform update
+    void Update(const glm::vec3& cameraPosition);
+
+    float GetCellSize() const { return m_CellSize; }
+    uint32_t GetCellCount() const { return static_cast<uint32_t>(m_Cells.size()); }
+    const std::string& GetDirectory() const { return m_Directory; }
+
+    const WorldPartitionSettings& GetSettings() const { return m_Settings; }
+    void SetSettings(const WorldPartitionSettings& settings);
+    const WorldPartitionStats& GetStats() const { return m_Stats; }
+
+private:
+    enum class CellState {
+        Unloaded,
+        Loading,
+        Instantiating,
+        Resident,
+        Unloading,
+        Failed
+    };
+
+    struct Cell {
+        int32_t X = 0;
+        int32_t Z = 0;
+        uint32_t EntityCount = 0;
+        CellState State = CellState::Unloaded;
+        std::unique_ptr<WorldSnapshot> Snapshot;  // Held while instantiating
+        std::vector<entt::entity> Entities;       // Indexed by snapshot entity
+        uint32_t Progress = 0;                    // Entities created so far
+        size_t Bytes = 0;
+        float Distance = 0.0f;
+    };
+
+    struct LoadResult {
+        uint32_t Cell = 0;
+        std::unique_ptr<WorldSnapshot> Snapshot;  // Null when the file could not be opened
+    };
+
+    // Shared with in-flight load jobs so they can outlive the partition
+    struct SharedState {
+        std::mutex Mutex;
+        std::vector<LoadResult> Completed;
+        std::atomic<bool> Cancelled{false};
+    };
+
+    static uint64_t GetCellKey(int32_t x, int32_t z);
+    static std::string GetCellFileName(int32_t x, int32_t z);
+    float GetDistance(const Cell& cell, const glm::vec3& position) const;
+    void CollectLoads(const glm::vec3& cameraPosition);
+    void StartLoads(const glm::vec3& cameraPosition);
+    void RunSlicedWork();
+    bool StepCell(Cell& cell);
+    void CancelLoads();
+
+    ECSWorld* m_World;
+    JobSystem* m_JobSystem;
+    WorldPartitionSettings m_Settings;
+    WorldPartitionStats m_Stats;
+    std::string m_Directory;
+    float m_CellSize = 0.0f;
+    std::vector<Cell> m_Cells;
+    std::unordered_map<uint64_t, uint32_t> m_CellIndex;
+    std::vector<uint32_t> m_Active;               // Cells in any state but Unloaded and Failed
+    uint32_t m_InFlight = 0;
+    std::shared_ptr<SharedState> m_Shared;
+};
+
+} // namespace Henky3D
@@ -0,0 +1,320 @@
+#include "WorldSnapshot.h"
+#include "Components.h"
+#include "../graphics/Material.h"
+#include "../core/Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include <unordered_map>
+
+namespace Henky3D {
+
+namespace {
+
+// Parent links are stored as snapshot entity indices
+constexpr uint32_t NoParent = 0xFFFFFFFFu;
+
+template<typename Function>
+void ForEachComponent(Function&& function) {
+    function(std::type_identity<Transform>{}, SnapshotComponent::Transform);
+    function(std::type_identity<Renderable>{}, SnapshotComponent::Renderable);
+    function(std::type_identity<BoundingBox>{}, SnapshotComponent::BoundingBox);
+    function(std::type_identity<Light>{}, SnapshotComponent::Light);
+    function(std::type_identity<Camera>{}, SnapshotComponent::Camera);
+    function(std::type_identity<Material>{}, SnapshotComponent::Material);
+}
+
+// Calls function with the type of a stored component; false for unknown components
+template<typename Function>
+bool WithComponent(uint32_t component, Function&& function) {
+    bool found = false;
+    ForEachComponent([&](auto type, SnapshotComponent id) {
+        if (static_cast<uint32_t>(id) == component) {
+            function(type);
+            found = true;
+        }
+    });
+    return found;
+}
+
+size_t AlignUp(size_t value) {
+    return (value + WorldSnapshot::PayloadAlignment - 1) & ~(WorldSnapshot::PayloadAlignment - 1);
+}
+
+} // namespace
+
+static_assert(std::is_trivially_copyable_v<Transform> && std::is_trivially_copyable_v<Renderable> &&
+              std::is_trivially_copyable_v<BoundingBox> && std::is_trivially_copyable_v<Light> &&
+              std::is_trivially_copyable_v<Camera> && std::is_trivially_copyable_v<Material>,
+              "Snapshot components are stored as raw bytes");
+
+bool WorldSnapshot::Save(ECSWorld* world, const std::string& path) {
+    auto& registry = world->GetRegistry();
+    std::vector<entt::entity> entities;
+    ForEachComponent([&](auto type, SnapshotComponent) {
+        for (auto entity : registry.view<typename decltype(type)::type>()) {
+            entities.push_back(entity);
+        }
+    });
+    std::sort(entities.begin(), entities.end());
+    entities.erase(std::unique(entities.begin(), entities.end()), entities.end());
+    return Save(world, entities, path);
+}
+
+bool WorldSnapshot::Save(ECSWorld* world, const std::vector<entt::entity>& entities, const std::string& path) {
+    HENKY_PROFILE_ZONE("WorldSnapshot::Save");
+    auto& registry = world->GetRegistry();
+
+    std::unordered_map<entt::entity, uint32_t> indices;
+    indices.reserve(entities.size());
+    std::vector<entt::entity> ordered;
+    ordered.reserve(entities.size());
+    for (entt::entity entity : entities) {
+        if (registry.valid(entity) && indices.emplace(entity, 0).second) {
+            ordered.push_back(entity);
+        }
+    }
+
+    // Number parents before their children so any prefix of the snapshot can be instantiated
+    std::vector<uint32_t> depths(ordered.size(), 0);
+    for (size_t i = 0; i < ordered.size(); i++) {
+        const Transform* transform = registry.try_get<Transform>(ordered[i]);
+        // Bounded by the entity count in case of a parent cycle
+        for (uint32_t steps = 0; transform && steps < ordered.size(); steps++) {
+            if (transform->Parent == entt::null || !indices.count(transform->Parent)) {
+                break;
+            }
+            depths[i]++;
+            transform = registry.try_get<Transform>(transform->Parent);
+        }
+    }
+    std::vector<uint32_t> order(ordered.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&depths](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+    std::vector<entt::entity> sorted(ordered.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        sorted[i] = ordered[order[i]];
+        indices[sorted[i]] = i;
+    }
+
+    struct PendingColumn {
+        SnapshotColumn Column;
+        std::vector<uint32_t> Entities;
+        std::vector<uint8_t> Data;
+    };
+    std::vector<PendingColumn> columns;
+    ForEachComponent([&](auto type, SnapshotComponent id) {
+        using Component = typename decltype(type)::type;
+        PendingColumn pending = {};
+        pending.Column.Component = static_cast<uint32_t>(id);
+        pending.Column.ElementSize = sizeof(Component);
+        for (uint32_t i = 0; i < sorted.size(); i++) {
+            const Component* component = registry.try_get<Component>(sorted[i]);
+            if (!component) {
+                continue;
+            }
+            Component stored = *component;
+            if constexpr (std::is_same_v<Component, Transform>) {
+                auto parent = indices.find(stored.Parent);
+                stored.Parent = static_cast<entt::entity>(parent != indices.end() ? parent->second : NoParent);
+                stored.Dirty = true;
+                stored.Teleported = true;
+            }
+            pending.Entities.push_back(i);
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&stored);
+            pending.Data.insert(pending.Data.end(), bytes, bytes + sizeof(Component));
+        }
+        if (!pending.Entities.empty()) {
+            pending.Column.Count = static_cast<uint32_t>(pending.Entities.size());
+            columns.push_back(std::move(pending));
+        }
+    });
+
+    SnapshotHeader header = {};
+    header.Magic = SnapshotHeader::MagicValue;
+    header.Version = SnapshotHeader::CurrentVersion;
+    header.EntityCount = static_cast<uint32_t>(sorted.size());
+    header.ColumnCount = static_cast<uint32_t>(columns.size());
+    header.ColumnsOffset = sizeof(SnapshotHeader);
+    size_t offset = AlignUp(sizeof(SnapshotHeader) + columns.size() * sizeof(SnapshotColumn));
+    for (PendingColumn& pending : columns) {
+        pending.Column.EntitiesOffset = offset;
+        offset = AlignUp(offset + pending.Entities.size() * sizeof(uint32_t));
+        pending.Column.DataOffset = offset;
+        offset = AlignUp(offset + pending.Data.size());
+    }
+    header.Size = offset;
+
+    std::vector<uint8_t> file(offset, 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    for (size_t i = 0; i < columns.size(); i++) {
+        const PendingColumn& pending = columns[i];
+        std::memcpy(file.data() + sizeof(header) + i * sizeof(SnapshotColumn), &pending.Column, sizeof(SnapshotColumn));
+        std::memcpy(file.data() + pending.Column.EntitiesOffset, pending.Entities.data(), pending.Entities.size() * sizeof(uint32_t));
+        std::memcpy(file.data() + pending.Column.DataOffset, pending.Data.data(), pending.Data.size());
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()))) {
+        std::cout << "Warning: cannot write world snapshot " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WorldSnapshot::Open(const std::string& path) {
+    Close();
+    if (!m_File.Open(path)) {
+        return false;
+    }
+    if (!Open(m_File.GetData(), m_File.GetSize())) {
+        std::cout << "Warning: Ignoring malformed world snapshot " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool WorldSnapshot::Open(const uint8_t* data, size_t size) {
+    m_Data = data;
+    m_Size = size;
+    if (!data || !Validate()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void WorldSnapshot::Close() {
+    m_File.Close();
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Columns = nullptr;
+    m_ColumnCount = 0;
+    m_EntityCount = 0;
+}
+
+bool WorldSnapshot::Validate() {
+    if (m_Size < sizeof(SnapshotHeader)) {
+        return false;
+    }
+    SnapshotHeader header;
+    std::memcpy(&header, m_Data, sizeof(header));
+    if (header.Magic != SnapshotHeader::MagicValue || header.Version != SnapshotHeader::CurrentVersion ||
+        header.Size != m_Size || header.EntityCount == NoParent) {
+        return false;
+    }
+    const uint64_t columnBytes = static_cast<uint64_t>(header.ColumnCount) * sizeof(SnapshotColumn);
+    if (header.ColumnsOffset % alignof(SnapshotColumn) != 0 || header.ColumnsOffset > m_Size ||
+        columnBytes > m_Size - header.ColumnsOffset) {
+        return false;
+    }
+    m_Columns = reinterpret_cast<const SnapshotColumn*>(m_Data + header.ColumnsOffset);
+    m_ColumnCount = header.ColumnCount;
+    m_EntityCount = header.EntityCount;
+
+    // Check every column once so Instantiate can trust the offsets and indices
+    uint32_t seen = 0;
+    for (uint32_t c = 0; c < m_ColumnCount; c++) {
+        const SnapshotColumn& column = m_Columns[c];
+        bool layoutMatches = false;
+        size_t alignment = 1;
+        const bool known = WithComponent(column.Component, [&](auto type) {
+            using Component = typename decltype(type)::type;
+            layoutMatches = column.ElementSize == sizeof(Component);
+            alignment = alignof(Component);
+        });
+        if (!known || (seen & (1u << column.Component))) {
+            return false;
+        }
+        seen |= 1u << column.Component;
+        if (!layoutMatches) {
+            std::cout << "Warning: World snapshot was written with a different component layout" << std::endl;
+            return false;
+        }
+        const uint64_t indexBytes = static_cast<uint64_t>(column.Count) * sizeof(uint32_t);
+        const uint64_t dataBytes = static_cast<uint64_t>(column.Count) * column.ElementSize;
+        if (column.EntitiesOffset > m_Size || indexBytes > m_Size - column.EntitiesOffset ||
+            column.DataOffset > m_Size || dataBytes > m_Size - column.DataOffset ||
+            reinterpret_cast<uintptr_t>(m_Data + column.EntitiesOffset) % alignof(uint32_t) != 0 ||
+            reinterpret_cast<uintptr_t>(m_Data + column.DataOffset) % alignment != 0) {
+            return false;
+        }
+        const uint32_t* indices = reinterpret_cast<const uint32_t*>(m_Data + column.EntitiesOffset);
+        for (uint32_t i = 0; i < column.Count; i++) {
+            if (indices[i] >= m_EntityCount || (i > 0 && indices[i - 1] >= indices[i])) {
+                return false; // Out of range, unsorted or duplicate
+            }
+        }
+    }
+    return true;
+}
+
+void WorldSnapshot::Prefetch() const {
+    volatile uint8_t sink = 0;
+    for (size_t offset = 0; offset < m_Size; offset += 4096) {
+        sink = sink + m_Data[offset];
+    }
+}
+
+uint32_t WorldSnapshot::Instantiate(ECSWorld* world, std::vector<entt::entity>& entities, uint32_t first, uint32_t count) const {
+    if (!m_Data || first >= m_EntityCount) {
+        return 0;
+    }
+    count = std::min(count, m_EntityCount - first);
+    HENKY_PROFILE_ZONE("WorldSnapshot::Instantiate");
+    auto& registry = world->GetRegistry();
+
+    const uint32_t end = first + count;
+    if (entities.size() < end) {
+        entities.resize(end, entt::null);
+    }
+    registry.create(entities.begin() + first, entities.begin() + end);
+
+    std::vector<entt::entity> targets;
+    std::vector<Transform> transforms;
+    for (uint32_t c = 0; c < m_ColumnCount; c++) {
+        const SnapshotColumn& column = m_Columns[c];
+        const uint32_t* indices = reinterpret_cast<const uint32_t*>(m_Data + column.EntitiesOffset);
+        const uint32_t* begin = std::lower_bound(indices, indices + column.Count, first);
+        const uint32_t* last = std::lower_bound(begin, indices + column.Count, end);
+        const uint32_t rows = static_cast<uint32_t>(last - begin);
+        if (rows == 0) {
+            continue;
+        }
+
+        // Indices are unique and sorted, so a column with a row for every entity in the range
+        // lines up with the new entities and needs no handle list
+        const entt::entity* handles = entities.data() + first;
+        if (rows != count) {
+            targets.resize(rows);
+            for (uint32_t i = 0; i < rows; i++) {
+                targets[i] = entities[begin[i]];
+            }
+            handles = targets.data();
+        }
+
+        WithComponent(column.Component, [&](auto type) {
+            using Component = typename decltype(type)::type;
+            const Component* rowsBegin = reinterpret_cast<const Component*>(m_Data + column.DataOffset) + (begin - indices);
+            if constexpr (std::is_same_v<Component, Transform>) {
+                // Parents were saved before their children, so they are already in entities
+                transforms.assign(rowsBegin, rowsBegin + rows);
+                for (uint32_t i = 0; i < rows; i++) {
+                    const uint32_t parent = static_cast<uint32_t>(transforms[i].Parent);
+                    transforms[i].Parent = parent < begin[i] ? entities[parent] : entt::null;
+                }
+                registry.insert<Transform>(handles, handles + rows, transforms.begin());
+            }
+            else {
+                registry.insert<Component>(handles, handles + rows, rowsBegin);
+            }
+        });
+    }
+    return count;
+}
+
+} // namespace Henky3D
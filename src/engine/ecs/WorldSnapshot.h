@@ -0,0 +1,105 @@
+#pragma once
+#include "ECSWorld.h"
+#include "../core/MappedFile.h"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <entt/entt.hpp>
+
+namespace Henky3D {
+
+// On-disk layout of a .hsnap world snapshot (little endian):
+//   SnapshotHeader
+//   SnapshotColumn[ColumnCount]
+//   per column: uint32 entity indices (ascending), then the raw components - each aligned to PayloadAlignment
+// Entities are numbered 0..EntityCount-1 in the order they are created on load; parents
+// are always numbered before their children. Components are stored in their in-memory
+// layout, so a snapshot only loads into a build with the same component sizes (like cooked
+// textures, snapshots are build artifacts, not an interchange format).
+enum class SnapshotComponent : uint32_t {
+    Transform = 1,
+    Renderable = 2,
+    BoundingBox = 3,
+    Light = 4,
+    Camera = 5,
+    Material = 6
+};
+
+struct SnapshotHeader {
+    static constexpr uint32_t MagicValue = 0x504E5348; // "HSNP"
+    static constexpr uint32_t CurrentVersion = 1;
+
+    uint32_t Magic;
+    uint32_t Version;
+    uint32_t EntityCount;
+    uint32_t ColumnCount;
+    uint64_t ColumnsOffset;
+    uint64_t Size;             // Total file size, catches truncation
+};
+
+struct SnapshotColumn {
+    uint32_t Component;        // SnapshotComponent
+    uint32_t ElementSize;      // sizeof the component when written
+    uint32_t Count;            // Entities with this component
+    uint32_t Reserved;
+    uint64_t EntitiesOffset;   // Count uint32 entity indices
+    uint64_t DataOffset;       // Count components
+};
+
+static_assert(sizeof(SnapshotHeader) == 32, "SnapshotHeader layout is part of the file format");
+static_assert(sizeof(SnapshotColumn) == 32, "SnapshotColumn layout is part of the file format");
+
+// Binary ECS snapshot with one column per component type. Loading maps the file and
+// bulk-inserts each column into its EnTT storage: no per-entity parsing, only the
+// Transform column is copied to translate parent indices into the new entities.
+// Material indices are stored as they are, so the materials must be registered in
+// the same order before the snapshot is loaded.
+class WorldSnapshot {
+public:
+    static constexpr size_t PayloadAlignment = 64;
+
+    WorldSnapshot() = default;
+
+    WorldSnapshot(const WorldSnapshot&) = delete;
+    WorldSnapshot& operator=(const WorldSnapshot&) = delete;
+
+    // Every entity with at least one snapshot component; false if the file cannot be written
+    static bool Save(ECSWorld* world, const std::string& path);
+    // Only the given entities; parents outside the list are saved as no parent
+    static bool Save(ECSWorld* world, const std::vector<entt::entity>& entities, const std::string& path);
+
+    // Maps and validates the file
+    bool Open(const std::string& path);
+    // Snapshot bytes owned by the caller, e.g. an archive view; must outlive the snapshot
+    bool Open(const uint8_t* data, size_t size);
+    void Close();
+    bool IsOpen() const { return m_Data != nullptr; }
+
+    uint32_t GetEntityCount() const { return m_EntityCount; }
+    size_t GetSize() const { return m_Size; }
+
+    // Touches every page so a later Instantiate does not fault them in on its thread
+    void Prefetch() const;
+
+    // Creates snapshot entities [first, first + count) in world. entities is indexed by
+    // snapshot entity and grows as needed; it must already hold the entities below first,
+    // since their children may be in this range. Returns the number of entities created.
+    uint32_t Instantiate(ECSWorld* world, std::vector<entt::entity>& entities, uint32_t first, uint32_t count) const;
+    // Whole snapshot at once
+    uint32_t Instantiate(ECSWorld* world, std::vector<entt::entity>& entities) const {
+        return Instantiate(world, entities, 0, m_EntityCount);
+    }
+
+private:
+    bool Validate();
+
+    MappedFile m_File;
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+    const SnapshotColumn* m_Columns = nullptr;
+    uint32_t m_ColumnCount = 0;
+    uint32_t m_EntityCount = 0;
+};
+
+} // namespace Henky3D
@@ -0,0 +1,351 @@
+#include "AssetLoader.h"
+#include "AssetRegistry.h"
+#include "../core/JobSystem.h"
+#include "../core/FileSystem.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+namespace Henky3D {
+
+namespace {
+
+std::string_view Trim(std::string_view text) {
+    const char* whitespace = " \t\r\n";
+    size_t begin = text.find_first_not_of(whitespace);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    size_t end = text.find_last_not_of(whitespace);
+    return text.substr(begin, end - begin + 1);
+}
+
+// .hmat files are UTF-8. Decoded by hand so a malformed byte turns into U+FFFD
+// instead of an exception on a worker thread.
+std::wstring ToWide(std::string_view path) {
+    std::wstring wide;
+    wide.reserve(path.size());
+    for (size_t i = 0; i < path.size();) {
+        const uint8_t lead = static_cast<uint8_t>(path[i]);
+        const size_t length = lead < 0x80 ? 1 : lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+        uint32_t code = length == 1 ? lead : length == 2 ? lead & 0x1F : length == 3 ? lead & 0x0F : lead & 0x07;
+        bool valid = length != 0 && i + length <= path.size();
+        for (size_t j = 1; valid && j < length; j++) {
+            const uint8_t next = static_cast<uint8_t>(path[i + j]);
+            valid = (next & 0xC0) == 0x80;
+            code = (code << 6) | (next & 0x3F);
+        }
+        if (!valid || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+            wide.push_back(static_cast<wchar_t>(0xFFFD));
+            i++;
+            continue;
+        }
+        i += length;
+        if constexpr (sizeof(wchar_t) == 2) {
+            // UTF-16: code points above the BMP take a surrogate pair
+            if (code >= 0x10000) {
+                code -= 0x10000;
+                wide.push_back(static_cast<wchar_t>(0xD800 + (code >> 10)));
+                wide.push_back(static_cast<wchar_t>(0xDC00 + (code & 0x3FF)));
+                continue;
+            }
+        }
+        wide.push_back(static_cast<wchar_t>(code));
+    }
+    return wide;
+}
+
+} // namespace
+
+AssetLoader::AssetLoader(AssetRegistry* registry, JobSystem* jobSystem)
+    : m_Registry(registry), m_JobSystem(jobSystem), m_Shared(std::make_shared<SharedState>()) {
+}
+
+AssetLoader::~AssetLoader() {
+    // Parse jobs hold their own reference to the shared state and drop results once cancelled
+    m_Shared->Cancelled.store(true, std::memory_order_release);
+
+    for (Node& node : m_Nodes) {
+        if (node.Kind == NodeKind::Texture) {
+            m_Registry->Release(node.Texture);
+        } else if (node.Kind == NodeKind::Material) {
+            for (TextureHandle texture : node.Textures) {
+                m_Registry->Release(texture);
+            }
+        }
+    }
+}
+
+uint32_t AssetLoader::AllocateNode(NodeKind kind) {
+    uint32_t index;
+    if (!m_FreeNodes.empty()) {
+        index = m_FreeNodes.back();
+        m_FreeNodes.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_Nodes.size());
+        m_Nodes.emplace_back();
+    }
+    m_Nodes[index].Kind = kind;
+    return index;
+}
+
+void AssetLoader::FreeNode(uint32_t index) {
+    m_Nodes[index] = Node();
+    m_FreeNodes.push_back(index);
+}
+
+AssetFuture<TextureHandle> AssetLoader::LoadTextureAsync(const std::wstring& path) {
+    uint32_t index = AcquireTextureNode(path);
+
+    // The caller gets its own reference, independent of the node's
+    m_Registry->AddRef(m_Nodes[index].Texture);
+    return m_Nodes[index].TextureResult;
+}
+
+AssetFuture<uint32_t> AssetLoader::LoadMaterialAsync(const MaterialDesc& desc) {
+    uint32_t index = AllocateNode(NodeKind::Material);
+    m_Nodes[index].Material = desc;
+    m_Nodes[index].MaterialResult = AssetFuture<uint32_t>::Create();
+    AddTextureDependencies(index);
+    return m_Nodes[index].MaterialResult;
+}
+
+AssetFuture<uint32_t> AssetLoader::LoadMaterialAsync(const std::string& path) {
+    uint32_t index = AllocateNode(NodeKind::Material);
+    Node& node = m_Nodes[index];
+    node.MaterialResult = AssetFuture<uint32_t>::Create();
+    node.Unresolved = 1; // The parse itself; texture dependencies are only known afterwards
+
+    m_Shared->InFlight.fetch_add(1, std::memory_order_relaxed);
+    std::shared_ptr<SharedState> shared = m_Shared;
+    m_JobSystem->Submit([shared, path, index]() {
+        if (!shared->Cancelled.load(std::memory_order_acquire)) {
+            ParsedMaterial parsed;
+            parsed.Node = index;
+            std::string text;
+            if (!FileSystem::ReadText(path, text)) {
+                parsed.Error = "failed to open " + path;
+            } else if (ParseMaterial(text, parsed.Desc, parsed.Error)) {
+                parsed.Succeeded = true;
+            } else {
+                parsed.Error = path + ": " + parsed.Error;
+            }
+            std::lock_guard<std::mutex> lock(shared->Mutex);
+            shared->Completed.push_back(std::move(parsed));
+        }
+        shared->InFlight.fetch_sub(1, std::memory_order_release);
+    });
+    return node.MaterialResult;
+}
+
+uint32_t AssetLoader::AcquireTextureNode(const std::wstring& path) {
+    AssetId id = HashAssetPath(path);
+    auto it = m_TextureNodes.find(id);
+    if (it != m_TextureNodes.end()) {
+        return it->second;
+    }
+
+    // LoadTexture hits the registry cache when the texture is already known
+    TextureHandle handle = m_Registry->LoadTexture(path);
+    uint32_t index = AllocateNode(NodeKind::Texture);
+    m_Nodes[index].Texture = handle;
+    m_Nodes[index].TextureId = id;
+    m_Nodes[index].TextureResult = AssetFuture<TextureHandle>::Create();
+    m_TextureNodes[id] = index;
+    m_PendingTextures.push_back(index);
+    return index;
+}
+
+void AssetLoader::AddTextureDependencies(uint32_t materialNode) {
+    static constexpr std::wstring MaterialDesc::* Paths[3] = {
+        &MaterialDesc::BaseColorTexture,
+        &MaterialDesc::NormalTexture,
+        &MaterialDesc::RoughnessMetalnessTexture
+    };
+
+    for (uint32_t slot = 0; slot < 3; slot++) {
+        if ((m_Nodes[materialNode].Material.*Paths[slot]).empty()) {
+            continue;
+        }
+        // Copied: acquiring a texture node can grow m_Nodes and move the material node
+        const std::wstring path = m_Nodes[materialNode].Material.*Paths[slot];
+        uint32_t textureNode = AcquireTextureNode(path);
+        Node& material = m_Nodes[materialNode];
+        material.Textures[slot] = m_Nodes[textureNode].Texture;
+        m_Registry->AddRef(material.Textures[slot]);
+        m_Nodes[textureNode].Dependents.push_back(materialNode);
+        material.Unresolved++;
+    }
+
+    if (m_Nodes[materialNode].Unresolved == 0) {
+        m_ReadyMaterials.push_back(materialNode);
+    }
+}
+
+void AssetLoader::Update() {
+    m_Stats.CompletedThisFrame = 0;
+
+    // Parsed material files reveal their texture dependencies
+    std::vector<ParsedMaterial> parsed;
+    {
+        std::lock_guard<std::mutex> lock(m_Shared->Mutex);
+        parsed.swap(m_Shared->Completed);
+    }
+    for (ParsedMaterial& result : parsed) {
+        if (!result.Succeeded) {
+            std::cout << "Warning: Material load failed: " << result.Error << std::endl;
+            ResolveMaterial(result.Node, true);
+            continue;
+        }
+        m_Nodes[result.Node].Material = std::move(result.Desc);
+        m_Nodes[result.Node].Unresolved--;
+        AddTextureDependencies(result.Node);
+    }
+
+    // Texture nodes resolve when the streamer has made the initial mips resident
+    for (size_t i = 0; i < m_PendingTextures.size();) {
+        uint32_t index = m_PendingTextures[i];
+        const TextureAsset* texture = m_Registry->GetTextureMutable(m_Nodes[index].Texture);
+        if (texture && texture->State == TextureState::Loading) {
+            i++;
+            continue;
+        }
+        m_PendingTextures[i] = m_PendingTextures.back();
+        m_PendingTextures.pop_back();
+        ResolveTexture(index, !texture || texture->State == TextureState::Failed);
+    }
+
+    // Resolving may queue further materials, so drain until stable
+    while (!m_ReadyMaterials.empty()) {
+        uint32_t index = m_ReadyMaterials.back();
+        m_ReadyMaterials.pop_back();
+        ResolveMaterial(index, false);
+    }
+
+    m_Stats.PendingParses = m_Shared->InFlight.load(std::memory_order_acquire);
+    m_Stats.PendingTextures = static_cast<uint32_t>(m_PendingTextures.size());
+    m_Stats.PendingMaterials = 0;
+    for (const Node& node : m_Nodes) {
+        if (node.Kind == NodeKind::Material) {
+            m_Stats.PendingMaterials++;
+        }
+    }
+}
+
+void AssetLoader::ResolveTexture(uint32_t index, bool failed) {
+    Node& node = m_Nodes[index];
+    TextureHandle handle = node.Texture;
+    AssetFuture<TextureHandle> result = node.TextureResult;
+    std::vector<uint32_t> dependents = std::move(node.Dependents);
+
+    m_TextureNodes.erase(node.TextureId);
+    FreeNode(index);
+    m_Registry->Release(handle);
+
+    for (uint32_t dependent : dependents) {
+        OnDependencyResolved(dependent);
+    }
+
+    m_Stats.CompletedThisFrame++;
+    m_Stats.TotalCompleted++;
+    if (failed) {
+        m_Stats.TotalFailed++;
+    }
+    // Callbacks run last: they may start new loads that reuse this slot
+    result.Resolve(failed ? AssetLoadStatus::Failed : AssetLoadStatus::Ready, handle);
+}
+
+void AssetLoader::OnDependencyResolved(uint32_t index) {
+    Node& node = m_Nodes[index];
+    if (node.Kind == NodeKind::Material && --node.Unresolved == 0) {
+        m_ReadyMaterials.push_back(index);
+    }
+}
+
+void AssetLoader::ResolveMaterial(uint32_t index, bool failed) {
+    Node& node = m_Nodes[index];
+    AssetFuture<uint32_t> result = node.MaterialResult;
+
+    uint32_t materialIndex = 0;
+    if (!failed) {
+        MaterialAsset material = node.Material.Params;
+        material.BaseColorTexture = node.Textures[0];
+        material.NormalTexture = node.Textures[1];
+        material.RoughnessMetalnessTexture = node.Textures[2];
+        materialIndex = m_Registry->CreateMaterial(material);
+    }
+
+    // The material now holds its own references
+    for (TextureHandle texture : node.Textures) {
+        m_Registry->Release(texture);
+    }
+    FreeNode(index);
+
+    m_Stats.CompletedThisFrame++;
+    m_Stats.TotalCompleted++;
+    if (failed) {
+        m_Stats.TotalFailed++;
+    }
+    result.Resolve(failed ? AssetLoadStatus::Failed : AssetLoadStatus::Ready, materialIndex);
+}
+
+bool AssetLoader::IsIdle() const {
+    return m_Shared->InFlight.load(std::memory_order_acquire) == 0 &&
+           m_Nodes.size() == m_FreeNodes.size();
+}
+
+bool AssetLoader::ParseMaterial(std::string_view text, MaterialDesc& desc, std::string& error) {
+    uint32_t lineNumber = 0;
+    while (!text.empty()) {
+        size_t lineEnd = text.find('\n');
+        std::string_view line = text.substr(0, lineEnd);
+        text = lineEnd == std::string_view::npos ? std::string_view() : text.substr(lineEnd + 1);
+        lineNumber++;
+
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            error = "line " + std::to_string(lineNumber) + ": expected key = value";
+            return false;
+        }
+        std::string_view key = Trim(line.substr(0, equals));
+        std::string value(Trim(line.substr(equals + 1)));
+        std::istringstream stream(value);
+
+        MaterialAsset& params = desc.Params;
+        bool valid = true;
+        if (key == "name") {
+            params.Name = value;
+        } else if (key == "base_color") {
+            valid = static_cast<bool>(stream >> params.BaseColorFactor.x >> params.BaseColorFactor.y >>
+                                      params.BaseColorFactor.z >> params.BaseColorFactor.w);
+        } else if (key == "roughness") {
+            valid = static_cast<bool>(stream >> params.RoughnessFactor);
+        } else if (key == "metalness") {
+            valid = static_cast<bool>(stream >> params.MetalnessFactor);
+        } else if (key == "alpha_cutoff") {
+            params.AlphaMask = true;
+            valid = static_cast<bool>(stream >> params.AlphaCutoff);
+        } else if (key == "base_color_texture") {
+            desc.BaseColorTexture = ToWide(value);
+        } else if (key == "normal_texture") {
+            desc.NormalTexture = ToWide(value);
+        } else if (key == "roughness_metalness_texture") {
+            desc.RoughnessMetalnessTexture = ToWide(value);
+        } else {
+            error = "line " + std::to_string(lineNumber) + ": unknown key '" + std::string(key) + "'";
+            return false;
+        }
+
+        if (!valid) {
+            error = "line " + std::to_string(lineNumber) + ": bad value for '" + std::string(key) + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace Henky3D
@@ -0,0 +1,188 @@
+#pragma once
+#include "Material.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Henky3D {
+
+class AssetRegistry;
+class JobSystem;
+
+enum class AssetLoadStatus {
+    Pending,
+    Ready,
+    Failed
+};
+
+// Result of an asynchronous load. Completion happens on the render thread inside
+// AssetLoader::Update, so futures are polled or chained with Then rather than
+// waited on; blocking the render thread would stall the uploads they depend on.
+template<typename T>
+class AssetFuture {
+public:
+    using Callback = std::function<void(AssetLoadStatus, const T&)>;
+
+    bool IsValid() const { return m_State != nullptr; }
+    AssetLoadStatus GetStatus() const { return m_State ? m_State->Status : AssetLoadStatus::Failed; }
+    bool IsReady() const { return GetStatus() == AssetLoadStatus::Ready; }
+    bool IsDone() const { return GetStatus() != AssetLoadStatus::Pending; }
+
+    // Meaningful once the future is ready
+    const T& Get() const { return m_State->Value; }
+
+    // Runs on completion, or right away when the future is already done
+    void Then(Callback callback) const {
+        if (m_State->Status != AssetLoadStatus::Pending) {
+            callback(m_State->Status, m_State->Value);
+        } else {
+            m_State->Callbacks.push_back(std::move(callback));
+        }
+    }
+
+private:
+    friend class AssetLoader;
+
+    struct State {
+        AssetLoadStatus Status = AssetLoadStatus::Pending;
+        T Value{};
+        std::vector<Callback> Callbacks;
+    };
+
+    static AssetFuture Create() {
+        AssetFuture future;
+        future.m_State = std::make_shared<State>();
+        return future;
+    }
+
+    void Resolve(AssetLoadStatus status, const T& value) const {
+        m_State->Status = status;
+        m_State->Value = value;
+        std::vector<Callback> callbacks = std::move(m_State->Callbacks);
+        for (auto& callback : callbacks) {
+            callback(status, m_State->Value);
+        }
+    }
+
+    std::shared_ptr<State> m_State;
+};
+
+// Material whose textures are named by path; built in code or parsed from a .hmat file
+struct MaterialDesc {
+    MaterialAsset Params; // Factors and flags; texture handles are filled in by the loader
+    std::wstring BaseColorTexture;
+    std::wstring NormalTexture;
+    std::wstring RoughnessMetalnessTexture;
+};
+
+struct AssetLoaderStats {
+    uint32_t PendingParses = 0;
+    uint32_t PendingTextures = 0;
+    uint32_t PendingMaterials = 0;
+    uint32_t CompletedThisFrame = 0;
+    uint64_t TotalCompleted = 0;
+    uint64_t TotalFailed = 0;
+};
+
+// Asynchronous loads with dependency tracking. Each request is a node in a graph
+// (material -> textures); a node resolves once every dependency has, so a
+// material is created only after its textures are resident. The stages are
+// pipelined across threads: material files are read and parsed on workers,
+// textures are read and decoded on workers by the streamer, and uploads run on
+// the render thread within the streamer's frame budget. Texture nodes are
+// shared, so materials using the same texture wait on a single load.
+class AssetLoader {
+public:
+    AssetLoader(AssetRegistry* registry, JobSystem* jobSystem);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+    // Ready once the initial mips are resident; the handle carries one reference for the caller
+    AssetFuture<TextureHandle> LoadTextureAsync(const std::wstring& path);
+
+    // Ready with the material index once every texture is resident. Textures that
+    // fail to load leave the material on their placeholders.
+    AssetFuture<uint32_t> LoadMaterialAsync(const MaterialDesc& desc);
+
+    // Reads and parses a .hmat file (FileSystem path) on a worker first
+    AssetFuture<uint32_t> LoadMaterialAsync(const std::string& path);
+
+    // Resolve finished nodes and fire callbacks (render thread, after the streamer update)
+    void Update();
+
+    bool IsIdle() const;
+    const AssetLoaderStats& GetStats() const { return m_Stats; }
+
+    // "key = value" lines; '#' starts a comment
+    static bool ParseMaterial(std::string_view text, MaterialDesc& desc, std::string& error);
+
+private:
+    static constexpr uint32_t InvalidNode = 0xFFFFFFFF;
+
+    enum class NodeKind {
+        Free,
+        Texture,
+        Material
+    };
+
+    struct Node {
+        NodeKind Kind = NodeKind::Free;
+        uint32_t Unresolved = 0;            // Dependencies (and a pending parse) still outstanding
+        std::vector<uint32_t> Dependents;
+
+        // Texture nodes
+        TextureHandle Texture;              // Holds a reference while the node is pending
+        AssetId TextureId = InvalidAssetId;
+        AssetFuture<TextureHandle> TextureResult;
+
+        // Material nodes
+        MaterialDesc Material;
+        TextureHandle Textures[3];          // Referenced until the material is created
+        AssetFuture<uint32_t> MaterialResult;
+    };
+
+    struct ParsedMaterial {
+        uint32_t Node = InvalidNode;
+        MaterialDesc Desc;
+        std::string Error;
+        bool Succeeded = false;
+    };
+
+    // Shared with in-flight parse jobs so they can outlive the loader
+    struct SharedState {
+        std::mutex Mutex;
+        std::vector<ParsedMaterial> Completed;
+        std::atomic<uint32_t> InFlight{0};
+        std::atomic<bool> Cancelled{false};
+    };
+
+    uint32_t AllocateNode(NodeKind kind);
+    void FreeNode(uint32_t index);
+    uint32_t AcquireTextureNode(const std::wstring& path);
+    void AddTextureDependencies(uint32_t materialNode);
+    void ResolveTexture(uint32_t index, bool failed);
+    void ResolveMaterial(uint32_t index, bool failed);
+    void OnDependencyResolved(uint32_t index);
+
+    AssetRegistry* m_Registry;
+    JobSystem* m_JobSystem;
+    AssetLoaderStats m_Stats;
+
+    std::vector<Node> m_Nodes;
+    std::vector<uint32_t> m_FreeNodes;
+    std::unordered_map<AssetId, uint32_t> m_TextureNodes; // Pending texture node per asset
+    std::vector<uint32_t> m_PendingTextures;
+    std::vector<uint32_t> m_ReadyMaterials;               // Materials with no dependencies left
+
+    std::shared_ptr<SharedState> m_Shared;
+};
+
+} // namespace Henky3D
@@ -1,14 +1,24 @@
 #include "AssetRegistry.h"
+#include "../core/JobSystem.h"
+#include <algorithm>
 #include <stdexcept>
 #include <iostream>
 
 namespace Henky3D {
 
-AssetRegistry::AssetRegistry(GraphicsDevice* device)
+AssetRegistry::AssetRegistry(GraphicsDevice* device, JobSystem* jobSystem)
     : m_Device(device) {
+    m_Streamer = std::make_unique<TextureStreamer>(jobSystem);
+    m_Residency = std::make_unique<TextureResidency>(this, m_Streamer.get());
+    m_Loader = std::make_unique<AssetLoader>(this, jobSystem);
 }
 
 AssetRegistry::~AssetRegistry() {
+    // Stop streaming before the textures it writes into go away
+    m_Loader.reset();
+    m_Residency.reset();
+    m_Streamer.reset();
+    
     // Cleanup textures
     for (auto& texture : m_Textures) {
         if (texture && texture->Texture) {
@@ -30,17 +40,26 @@ void AssetRegistry::InitializeDefaults() {
     uint8_t rmPixel[] = { 0, 128, 0, 255 };
     m_DefaultRoughnessMetalnessTexture = CreateDefaultTexture("DefaultRM", 1, 1, rmPixel, GL_RGBA8);
     
+    // Material 0 is the untextured default that entities without a material resolve to
+    MaterialAsset defaultMaterial;
+    defaultMaterial.Name = "Default";
+    CreateMaterial(defaultMaterial);
+    
     std::cout << "Default textures initialized" << std::endl;
 }
 
 TextureHandle AssetRegistry::CreateDefaultTexture(const std::string& name, uint32_t width, uint32_t height,
                                                    const uint8_t* data, GLenum format) {
-    auto texture = std::make_unique<TextureAsset>();
+    TextureHandle handle = AllocateTextureSlot();
+    TextureAsset* texture = m_Textures[handle.Index].get();
     texture->Path = std::wstring(name.begin(), name.end());
+    texture->Id = HashAssetPath(name);
     texture->Width = width;
     texture->Height = height;
     texture->Format = format;
+    texture->VramBytes = static_cast<size_t>(width) * height * 4;
     texture->IsDefault = true;
+    texture->RefCount = 1; // Pinned for the registry's lifetime
     
     // Create OpenGL texture
     glGenTextures(1, &texture->Texture);
@@ -55,41 +74,210 @@ TextureHandle AssetRegistry::CreateDefaultTexture(const std::string& name, uint3
     
     glBindTexture(GL_TEXTURE_2D, 0);
     
+    return handle;
+}
+
+TextureHandle AssetRegistry::AllocateTextureSlot() {
     TextureHandle handle;
-    handle.Index = static_cast<uint32_t>(m_Textures.size());
-    m_Textures.push_back(std::move(texture));
-    
+    if (!m_FreeTextureSlots.empty()) {
+        handle.Index = m_FreeTextureSlots.back();
+        m_FreeTextureSlots.pop_back();
+    } else {
+        handle.Index = static_cast<uint32_t>(m_Textures.size());
+        m_Textures.push_back(std::make_unique<TextureAsset>());
+    }
+    handle.Generation = m_Textures[handle.Index]->Generation;
     return handle;
 }
 
-TextureHandle AssetRegistry::LoadTexture(const std::wstring& path) {
+void AssetRegistry::Update() {
+    m_Streamer->Update();
+    m_Loader->Update();
+    EvictUnreferenced();
+}
+
+TextureHandle AssetRegistry::LoadTexture(const std::wstring& path, TextureHandle placeholder) {
     // Check cache
-    auto it = m_TextureCache.find(path);
+    AssetId id = HashAssetPath(path);
+    auto it = m_TextureCache.find(id);
     if (it != m_TextureCache.end()) {
+        AddRef(it->second);
         return it->second;
     }
     
-    // For now, return default white texture
-    // TODO: Implement actual texture loading with stb_image
-    std::wcout << L"Warning: Texture loading not implemented, using default: " << path << std::endl;
-    return m_DefaultWhiteTexture;
+    if (!placeholder.IsValid()) {
+        placeholder = m_DefaultWhiteTexture;
+    }
+    
+    TextureHandle handle = LoadTextureSTB(path, id, placeholder);
+    m_TextureCache[id] = handle;
+    return handle;
 }
 
-TextureHandle AssetRegistry::LoadTextureSTB(const std::wstring& path) {
-    // TODO: Implement using stb_image
-    return m_DefaultWhiteTexture;
+TextureHandle AssetRegistry::LoadTextureSTB(const std::wstring& path, AssetId id, TextureHandle placeholder) {
+    TextureHandle handle = AllocateTextureSlot();
+    TextureAsset* texture = m_Textures[handle.Index].get();
+    texture->Path = path;
+    texture->Id = id;
+    texture->Placeholder = placeholder;
+    texture->RefCount = 1;
+    AddRef(placeholder);
+    
+    // Decode on a worker; the streamer uploads the coarse mips and flips the state to Resident,
+    // finer levels follow on demand from the residency manager
+    m_Streamer->Request(texture);
+    
+    return handle;
+}
+
+void AssetRegistry::AddRef(TextureHandle handle) {
+    if (TextureAsset* texture = GetTextureMutable(handle)) {
+        texture->RefCount++;
+    }
+}
+
+void AssetRegistry::Release(TextureHandle handle) {
+    TextureAsset* texture = GetTextureMutable(handle);
+    if (texture && texture->RefCount > 0) {
+        texture->RefCount--;
+    }
 }
 
 const TextureAsset* AssetRegistry::GetTexture(TextureHandle handle) const {
     if (!handle.IsValid() || handle.Index >= m_Textures.size()) {
         return nullptr;
     }
-    return m_Textures[handle.Index].get();
+    
+    const TextureAsset* texture = m_Textures[handle.Index].get();
+    if (texture->Generation != handle.Generation || texture->Id == InvalidAssetId) {
+        return nullptr; // Stale handle
+    }
+    if (texture->State != TextureState::Resident && texture->Placeholder.IsValid()) {
+        if (const TextureAsset* placeholder = GetTexture(texture->Placeholder)) {
+            return placeholder;
+        }
+    }
+    return texture;
+}
+
+TextureAsset* AssetRegistry::GetTextureMutable(TextureHandle handle) {
+    if (!handle.IsValid() || handle.Index >= m_Textures.size()) {
+        return nullptr;
+    }
+    TextureAsset* texture = m_Textures[handle.Index].get();
+    if (texture->Generation != handle.Generation || texture->Id == InvalidAssetId) {
+        return nullptr;
+    }
+    return texture;
+}
+
+TextureAsset* AssetRegistry::GetTextureSlot(uint32_t index) {
+    if (index >= m_Textures.size() || m_Textures[index]->Id == InvalidAssetId) {
+        return nullptr;
+    }
+    return m_Textures[index].get();
+}
+
+TextureHandle AssetRegistry::FindTexture(AssetId id) const {
+    auto it = m_TextureCache.find(id);
+    return it != m_TextureCache.end() ? it->second : TextureHandle{};
+}
+
+bool AssetRegistry::IsTextureResident(TextureHandle handle) const {
+    if (!handle.IsValid() || handle.Index >= m_Textures.size()) {
+        return false;
+    }
+    const TextureAsset* texture = m_Textures[handle.Index].get();
+    return texture->Generation == handle.Generation && texture->Id != InvalidAssetId &&
+           texture->State == TextureState::Resident;
+}
+
+size_t AssetRegistry::GetTextureMemoryUsage() const {
+    size_t total = 0;
+    for (const auto& texture : m_Textures) {
+        total += texture->VramBytes;
+    }
+    return total;
+}
+
+size_t AssetRegistry::GetCpuFootprint(const TextureAsset& texture) {
+    return sizeof(TextureAsset) + texture.Path.capacity() * sizeof(wchar_t);
+}
+
+size_t AssetRegistry::GetCpuMemoryUsage() const {
+    size_t total = m_Materials.capacity() * sizeof(MaterialAsset) +
+                   m_TextureCache.size() * (sizeof(AssetId) + sizeof(TextureHandle));
+    for (const auto& texture : m_Textures) {
+        total += GetCpuFootprint(*texture);
+    }
+    return total;
+}
+
+void AssetRegistry::DestroyTexture(uint32_t index) {
+    TextureAsset* texture = m_Textures[index].get();
+    if (texture->Texture) {
+        m_Streamer->ReleaseTexture(texture->Texture);
+    }
+    m_TextureCache.erase(texture->Id);
+    TextureHandle placeholder = texture->Placeholder;
+    
+    // Bumping the generation invalidates every outstanding handle to this slot
+    uint32_t generation = texture->Generation + 1;
+    *texture = TextureAsset();
+    texture->Generation = generation;
+    m_FreeTextureSlots.push_back(index);
+    
+    Release(placeholder);
+}
+
+void AssetRegistry::EvictUnreferenced() {
+    size_t gpuBytes = GetTextureMemoryUsage();
+    size_t cpuBytes = GetCpuMemoryUsage();
+    
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < m_Textures.size(); i++) {
+        const TextureAsset& texture = *m_Textures[i];
+        // Textures the streamer still writes into are skipped until their request lands
+        if (texture.Id != InvalidAssetId && !texture.IsDefault && texture.RefCount == 0 &&
+            texture.State != TextureState::Loading && texture.PendingMip == TextureAsset::NoPendingMip) {
+            candidates.push_back(i);
+        }
+    }
+    
+    if (gpuBytes > m_Budget.GpuBytes || cpuBytes > m_Budget.CpuBytes) {
+        // Least recently drawn first
+        std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+            return m_Textures[a]->LastUsedFrame < m_Textures[b]->LastUsedFrame;
+        });
+        
+        size_t evicted = 0;
+        for (uint32_t index : candidates) {
+            if (gpuBytes <= m_Budget.GpuBytes && cpuBytes <= m_Budget.CpuBytes) {
+                break;
+            }
+            gpuBytes -= m_Textures[index]->VramBytes;
+            cpuBytes -= GetCpuFootprint(*m_Textures[index]) - sizeof(TextureAsset);
+            DestroyTexture(index);
+            evicted++;
+        }
+        m_Stats.TotalEvictions += evicted;
+        candidates.erase(candidates.begin(), candidates.begin() + evicted);
+    }
+    
+    m_Stats.LiveTextures = static_cast<uint32_t>(m_Textures.size() - m_FreeTextureSlots.size());
+    m_Stats.UnreferencedTextures = static_cast<uint32_t>(candidates.size());
+    m_Stats.FreeSlots = static_cast<uint32_t>(m_FreeTextureSlots.size());
+    m_Stats.CpuBytes = cpuBytes;
+    m_Stats.GpuBytes = gpuBytes;
 }
 
 uint32_t AssetRegistry::CreateMaterial(const MaterialAsset& material) {
     uint32_t index = static_cast<uint32_t>(m_Materials.size());
     m_Materials.push_back(material);
+    AddRef(material.BaseColorTexture);
+    AddRef(material.NormalTexture);
+    AddRef(material.RoughnessMetalnessTexture);
+    MarkMaterialDirty(index);
     return index;
 }
 
@@ -104,7 +292,25 @@ MaterialAsset* AssetRegistry::GetMaterialMutable(uint32_t index) {
     if (index >= m_Materials.size()) {
         return nullptr;
     }
+    // Callers may edit through the pointer, so the GPU copy is refreshed
+    MarkMaterialDirty(index);
     return &m_Materials[index];
 }
 
+void AssetRegistry::MarkMaterialDirty(uint32_t index) {
+    m_DirtyMaterialBegin = std::min(m_DirtyMaterialBegin, index);
+    m_DirtyMaterialEnd = std::max(m_DirtyMaterialEnd, index + 1);
+}
+
+bool AssetRegistry::ConsumeDirtyMaterials(uint32_t& begin, uint32_t& end) {
+    if (m_DirtyMaterialBegin >= m_DirtyMaterialEnd) {
+        return false;
+    }
+    begin = m_DirtyMaterialBegin;
+    end = m_DirtyMaterialEnd;
+    m_DirtyMaterialBegin = 0xFFFFFFFF;
+    m_DirtyMaterialEnd = 0;
+    return true;
+}
+
 } // namespace Henky3D
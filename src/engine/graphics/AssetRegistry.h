@@ -1,6 +1,9 @@
 #pragma once
 #include "Material.h"
 #include "GraphicsDevice.h"
+#include "TextureStreamer.h"
+#include "TextureResidency.h"
+#include "AssetLoader.h"
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -8,37 +11,92 @@
 
 namespace Henky3D {
 
+class JobSystem;
+
+// Memory limits that trigger eviction of unreferenced assets
+struct AssetBudget {
+    size_t CpuBytes = 64 * 1024 * 1024;   // Asset records, paths and other CPU-side data
+    size_t GpuBytes = 512 * 1024 * 1024;  // Resident texture memory
+};
+
+struct AssetRegistryStats {
+    uint32_t LiveTextures = 0;
+    uint32_t UnreferencedTextures = 0;
+    uint32_t FreeSlots = 0;
+    size_t CpuBytes = 0;
+    size_t GpuBytes = 0;
+    uint64_t TotalEvictions = 0;
+};
+
 class AssetRegistry {
 public:
-    AssetRegistry(GraphicsDevice* device);
+    AssetRegistry(GraphicsDevice* device, JobSystem* jobSystem);
     ~AssetRegistry();
 
     // Initialize default/fallback textures
     void InitializeDefaults();
 
+    // Pump texture streaming, resolve async loads and evict unreferenced assets over budget
+    // (render thread, once per frame)
+    void Update();
+
     // Texture management
-    TextureHandle LoadTexture(const std::wstring& path);
+    // Returns immediately with one reference held by the caller; lookups resolve to the
+    // placeholder (default white if invalid) until the streamed texture is resident
+    TextureHandle LoadTexture(const std::wstring& path, TextureHandle placeholder = {});
+    void AddRef(TextureHandle handle);
+    void Release(TextureHandle handle); // Unreferenced textures stay cached until evicted
     TextureHandle GetDefaultWhiteTexture() const { return m_DefaultWhiteTexture; }
     TextureHandle GetDefaultNormalTexture() const { return m_DefaultNormalTexture; }
     TextureHandle GetDefaultRoughnessMetalnessTexture() const { return m_DefaultRoughnessMetalnessTexture; }
     const TextureAsset* GetTexture(TextureHandle handle) const;
+    TextureAsset* GetTextureMutable(TextureHandle handle); // The asset itself, never the placeholder
+    TextureHandle FindTexture(AssetId id) const;
+    bool IsTextureResident(TextureHandle handle) const;
+    size_t GetTextureMemoryUsage() const; // Sum of TextureAsset::VramBytes
+    size_t GetCpuMemoryUsage() const;
+
+    // Slot iteration for systems that walk every texture; free slots return nullptr
+    uint32_t GetTextureSlotCount() const { return static_cast<uint32_t>(m_Textures.size()); }
+    TextureAsset* GetTextureSlot(uint32_t index);
+
+    void SetMemoryBudget(const AssetBudget& budget) { m_Budget = budget; }
+    const AssetBudget& GetMemoryBudget() const { return m_Budget; }
+    const AssetRegistryStats& GetStats() const { return m_Stats; }
+    TextureStreamer* GetTextureStreamer() { return m_Streamer.get(); }
+    TextureResidency* GetTextureResidency() { return m_Residency.get(); }
+    AssetLoader* GetAssetLoader() { return m_Loader.get(); }
 
     // Material management
+    // Materials hold a reference on the textures they were created with
     uint32_t CreateMaterial(const MaterialAsset& material);
     const MaterialAsset* GetMaterial(uint32_t index) const;
     MaterialAsset* GetMaterialMutable(uint32_t index);
     uint32_t GetMaterialCount() const { return static_cast<uint32_t>(m_Materials.size()); }
 
+    // Range of materials created or handed out mutably since the last call; resets it
+    bool ConsumeDirtyMaterials(uint32_t& begin, uint32_t& end);
+
 private:
     TextureHandle CreateDefaultTexture(const std::string& name, uint32_t width, uint32_t height, 
                                        const uint8_t* data, GLenum format);
-    TextureHandle LoadTextureSTB(const std::wstring& path);
+    TextureHandle LoadTextureSTB(const std::wstring& path, AssetId id, TextureHandle placeholder);
+    TextureHandle AllocateTextureSlot();
+    void DestroyTexture(uint32_t index);
+    void EvictUnreferenced();
+    static size_t GetCpuFootprint(const TextureAsset& texture);
     
     GraphicsDevice* m_Device;
+    std::unique_ptr<TextureStreamer> m_Streamer;
+    std::unique_ptr<TextureResidency> m_Residency;
+    std::unique_ptr<AssetLoader> m_Loader;
     
-    // Texture storage
+    // Texture storage; slots are recycled through the free list with a bumped generation
     std::vector<std::unique_ptr<TextureAsset>> m_Textures;
-    std::unordered_map<std::wstring, TextureHandle> m_TextureCache;
+    std::vector<uint32_t> m_FreeTextureSlots;
+    std::unordered_map<AssetId, TextureHandle> m_TextureCache;
+    AssetBudget m_Budget;
+    AssetRegistryStats m_Stats;
     
     // Default textures
     TextureHandle m_DefaultWhiteTexture;
@@ -47,6 +105,10 @@ private:
     
     // Material storage
     std::vector<MaterialAsset> m_Materials;
+    uint32_t m_DirtyMaterialBegin = 0xFFFFFFFF;
+    uint32_t m_DirtyMaterialEnd = 0;
+
+    void MarkMaterialDirty(uint32_t index);
 };
 
 } // namespace Henky3D
@@ -0,0 +1,89 @@
+#include "CommandBuffer.h"
+
+namespace Henky3D {
+
+void CommandBuffer::Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    ViewportCommand& command = Record<ViewportCommand>();
+    command.X = x;
+    command.Y = y;
+    command.Width = width;
+    command.Height = height;
+}
+
+void CommandBuffer::Scissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+    ScissorCommand& command = Record<ScissorCommand>();
+    command.X = x;
+    command.Y = y;
+    command.Width = width;
+    command.Height = height;
+}
+
+void CommandBuffer::Clear(GLbitfield mask) {
+    Record<ClearCommand>().Mask = mask;
+}
+
+void CommandBuffer::Uniform1i(GLint location, GLint value) {
+    Uniform1iCommand& command = Record<Uniform1iCommand>();
+    command.Location = location;
+    command.Value = value;
+}
+
+void CommandBuffer::BindStorageBuffer(GLuint binding, GLuint buffer) {
+    BindStorageBufferCommand& command = Record<BindStorageBufferCommand>();
+    command.Binding = binding;
+    command.Buffer = buffer;
+}
+
+void CommandBuffer::DrawElementsInstanced(GLsizei indexCount, uint32_t instanceCount, uint32_t firstInstance) {
+    DrawElementsInstancedCommand& command = Record<DrawElementsInstancedCommand>();
+    command.Mode = GL_TRIANGLES;
+    command.IndexCount = indexCount;
+    command.InstanceCount = instanceCount;
+    command.FirstInstance = firstInstance;
+}
+
+uint32_t CommandBuffer::Replay(uint32_t instanceBase) const {
+    const uint8_t* cursor = m_Data.data();
+    const uint8_t* end = cursor + m_Data.size();
+    uint32_t executed = 0;
+    while (cursor < end) {
+        const CommandHeader* header = reinterpret_cast<const CommandHeader*>(cursor);
+        switch (header->Type) {
+        case CommandType::Viewport: {
+            const auto* command = reinterpret_cast<const ViewportCommand*>(cursor);
+            glViewport(command->X, command->Y, command->Width, command->Height);
+            break;
+        }
+        case CommandType::Scissor: {
+            const auto* command = reinterpret_cast<const ScissorCommand*>(cursor);
+            glScissor(command->X, command->Y, command->Width, command->Height);
+            break;
+        }
+        case CommandType::Clear:
+            glClear(reinterpret_cast<const ClearCommand*>(cursor)->Mask);
+            break;
+        case CommandType::Uniform1i: {
+            const auto* command = reinterpret_cast<const Uniform1iCommand*>(cursor);
+            glUniform1i(command->Location, command->Value);
+            break;
+        }
+        case CommandType::BindStorageBuffer: {
+            const auto* command = reinterpret_cast<const BindStorageBufferCommand*>(cursor);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, command->Binding, command->Buffer);
+            break;
+        }
+        case CommandType::DrawElementsInstanced: {
+            const auto* command = reinterpret_cast<const DrawElementsInstancedCommand*>(cursor);
+            glDrawElementsInstancedBaseInstance(command->Mode, command->IndexCount, GL_UNSIGNED_INT,
+                                                reinterpret_cast<const void*>(static_cast<uintptr_t>(command->IndexOffset) * sizeof(uint32_t)),
+                                                command->InstanceCount, instanceBase + command->FirstInstance);
+            break;
+        }
+        }
+        cursor += header->Size;
+        executed++;
+    }
+    return executed;
+}
+
+} // namespace Henky3D
@@ -0,0 +1,111 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Henky3D {
+
+enum class CommandType : uint16_t {
+    Viewport,
+    Scissor,
+    Clear,
+    Uniform1i,
+    BindStorageBuffer,
+    DrawElementsInstanced
+};
+
+// Every command starts with its type and total size in bytes
+struct CommandHeader {
+    CommandType Type;
+    uint16_t Size;
+};
+
+struct ViewportCommand {
+    static constexpr CommandType Type = CommandType::Viewport;
+    CommandHeader Header;
+    GLint X, Y;
+    GLsizei Width, Height;
+};
+
+struct ScissorCommand {
+    static constexpr CommandType Type = CommandType::Scissor;
+    CommandHeader Header;
+    GLint X, Y;
+    GLsizei Width, Height;
+};
+
+struct ClearCommand {
+    static constexpr CommandType Type = CommandType::Clear;
+    CommandHeader Header;
+    GLbitfield Mask;
+};
+
+struct Uniform1iCommand {
+    static constexpr CommandType Type = CommandType::Uniform1i;
+    CommandHeader Header;
+    GLint Location;
+    GLint Value;
+};
+
+struct BindStorageBufferCommand {
+    static constexpr CommandType Type = CommandType::BindStorageBuffer;
+    CommandHeader Header;
+    GLuint Binding;
+    GLuint Buffer;
+};
+
+// glDrawElementsInstancedBaseInstance with 32-bit indices from the bound VAO
+struct DrawElementsInstancedCommand {
+    static constexpr CommandType Type = CommandType::DrawElementsInstanced;
+    CommandHeader Header;
+    GLenum Mode;
+    GLsizei IndexCount;
+    uint32_t IndexOffset;      // In indices
+    uint32_t InstanceCount;
+    uint32_t FirstInstance;    // Relative to the instance base passed to Replay
+};
+
+// Linear stream of plain GL commands. Any thread can record into its own buffer;
+// only the GL thread replays. Reset keeps the storage, so steady-state recording
+// does not allocate. Draws take an instance base at replay so buffers recorded
+// against a chunk-local instance list can be rebased once chunks are packed.
+class CommandBuffer {
+public:
+    void Reset() {
+        m_Data.clear();
+        m_CommandCount = 0;
+    }
+
+    template<typename T>
+    T& Record() {
+        const size_t offset = m_Data.size();
+        m_Data.resize(offset + sizeof(T));
+        T* command = reinterpret_cast<T*>(m_Data.data() + offset);
+        std::memset(command, 0, sizeof(T));
+        command->Header.Type = T::Type;
+        command->Header.Size = static_cast<uint16_t>(sizeof(T));
+        m_CommandCount++;
+        return *command;
+    }
+
+    void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+    void Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+    void Clear(GLbitfield mask);
+    void Uniform1i(GLint location, GLint value);
+    void BindStorageBuffer(GLuint binding, GLuint buffer);
+    void DrawElementsInstanced(GLsizei indexCount, uint32_t instanceCount, uint32_t firstInstance);
+
+    // GL thread only; returns the number of commands executed
+    uint32_t Replay(uint32_t instanceBase = 0) const;
+
+    uint32_t GetCommandCount() const { return m_CommandCount; }
+    size_t GetSize() const { return m_Data.size(); }
+    size_t GetCapacity() const { return m_Data.capacity(); }
+
+private:
+    std::vector<uint8_t> m_Data;
+    uint32_t m_CommandCount = 0;
+};
+
+} // namespace Henky3D
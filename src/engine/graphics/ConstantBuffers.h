@@ -4,12 +4,15 @@
 
 namespace Henky3D {
 
+constexpr uint32_t MaxShadowCascades = 4;
+constexpr uint32_t MaxLocalLights = 1024;
+constexpr uint32_t NoLocalShadow = 0xFFFFFFFFu;
+
 // Per-frame constants updated once per frame
 struct alignas(16) PerFrameConstants {
     glm::mat4 ViewMatrix;
     glm::mat4 ProjectionMatrix;
     glm::mat4 ViewProjectionMatrix;
-    glm::mat4 LightViewProjectionMatrix;
     glm::vec4 CameraPosition;
     glm::vec4 LightDirection;  // w component unused
     glm::vec4 LightColor;      // rgb = color, a = intensity
@@ -18,13 +21,68 @@ struct alignas(16) PerFrameConstants {
     float DeltaTime;
     float ShadowBias;
     float ShadowsEnabled;  // 1.0 = enabled, 0.0 = disabled
+    glm::mat4 CascadeViewProjection[MaxShadowCascades];
+    glm::vec4 CascadeSplits;   // View-space far distance of each cascade
+    uint32_t CascadeCount;
+    float ShadowTexelSize;     // 1 / shadow map resolution
+    uint32_t LocalLightCount;  // Entries in the local light buffer, filled in by the renderer
+    float AtlasTexelSize;      // 1 / shadow atlas resolution
+    glm::uvec4 ClusterGrid;    // xyz = light cluster tiles and depth slices
+    glm::vec4 ClusterParams;   // x = slice scale, y = slice bias (slice = log(depth) * x + y), zw = 1 / viewport size
 };
 
-// Per-draw constants updated for each draw call
+// Per-draw constants, one entry per instance in the draw SSBO (std430, binding 1)
 struct alignas(16) PerDrawConstants {
     glm::mat4 WorldMatrix;
     uint32_t MaterialIndex;
     uint32_t Padding[3];
 };
 
+// GPU material table entry (std430, binding 2). Texture references are bindless
+// handles split into two words, or a texture array layer in X when bindless is unavailable.
+struct alignas(16) MaterialConstants {
+    glm::vec4 BaseColorFactor;
+    glm::uvec2 BaseColorTexture;
+    glm::uvec2 NormalTexture;
+    glm::uvec2 RoughnessMetalnessTexture;
+    float RoughnessFactor;
+    float MetalnessFactor;
+    float AlphaCutoff;
+    uint32_t Flags;            // MaterialFlag bits
+    uint32_t Padding[2];
+};
+
+// Point or spot light (std430, binding 3)
+struct alignas(16) LocalLightConstants {
+    glm::vec4 PositionRange;   // xyz = position, w = range
+    glm::vec4 ColorIntensity;  // rgb = color, a = intensity
+    glm::vec4 DirectionCone;   // xyz = spot direction, w = cos of the outer cone angle
+    float CosInnerCone;
+    uint32_t Type;             // LocalLightType
+    uint32_t ShadowIndex;      // First ShadowTileConstants entry, or NoLocalShadow
+    uint32_t Padding;
+};
+
+enum LocalLightType : uint32_t {
+    LocalLightPoint = 0,
+    LocalLightSpot = 1
+};
+
+// One shadow atlas tile (std430, binding 4): point lights use six, spot lights one
+struct alignas(16) ShadowTileConstants {
+    glm::mat4 ViewProjection;  // Projection the tile was last rendered with
+    glm::vec4 AtlasRect;       // xy = offset, zw = size, in atlas UV
+};
+
+enum MaterialFlag : uint32_t {
+    MaterialFlagAlphaMask = 1u << 0,
+    MaterialFlagHasNormalTexture = 1u << 1
+};
+
+static_assert(sizeof(PerFrameConstants) == 592, "PerFrameConstants must match the std140 layout");
+static_assert(sizeof(PerDrawConstants) == 80, "PerDrawConstants must match the std430 layout");
+static_assert(sizeof(MaterialConstants) == 64, "MaterialConstants must match the std430 layout");
+static_assert(sizeof(LocalLightConstants) == 64, "LocalLightConstants must match the std430 layout");
+static_assert(sizeof(ShadowTileConstants) == 80, "ShadowTileConstants must match the std430 layout");
+
 } // namespace Henky3D
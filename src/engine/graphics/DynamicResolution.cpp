@@ -0,0 +1,215 @@
+#include "DynamicResolution.h"
+#include "../core/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace Henky3D {
+
+DynamicResolution::DynamicResolution(GraphicsDevice* device)
+    : m_Device(device) {
+    // Core profile needs a bound VAO even for the buffer-less fullscreen triangle
+    glGenVertexArrays(1, &m_VAO);
+}
+
+DynamicResolution::~DynamicResolution() {
+    DestroyTarget();
+    if (m_VAO) glDeleteVertexArrays(1, &m_VAO);
+}
+
+void DynamicResolution::SetUpscaleProgram(GLuint program) {
+    m_UpscaleProgram = program;
+    m_SourceLocation = glGetUniformLocation(program, "uSource");
+    m_UvScaleLocation = glGetUniformLocation(program, "uUvScale");
+    m_TexelSizeLocation = glGetUniformLocation(program, "uTexelSize");
+    m_SharpnessLocation = glGetUniformLocation(program, "uSharpness");
+}
+
+void DynamicResolution::SetSettings(const DynamicResolutionSettings& settings) {
+    m_Settings = settings;
+    m_Settings.MaxScale = std::clamp(m_Settings.MaxScale, 0.1f, 1.0f);
+    m_Settings.MinScale = std::clamp(m_Settings.MinScale, 0.1f, m_Settings.MaxScale);
+    m_Settings.TargetGpuMs = std::max(m_Settings.TargetGpuMs, 0.1f);
+    m_Settings.Sharpness = std::clamp(m_Settings.Sharpness, 0.0f, 1.0f);
+    m_Scale = std::clamp(m_Scale, m_Settings.MinScale, m_Settings.MaxScale);
+    m_FramesSinceChange = 0;
+}
+
+uint32_t DynamicResolution::GetRenderWidth() const {
+    const float scale = m_Settings.Enabled ? m_Scale : 1.0f;
+    return std::max(1u, static_cast<uint32_t>(std::lround(m_Device->GetWidth() * scale)));
+}
+
+uint32_t DynamicResolution::GetRenderHeight() const {
+    const float scale = m_Settings.Enabled ? m_Scale : 1.0f;
+    return std::max(1u, static_cast<uint32_t>(std::lround(m_Device->GetHeight() * scale)));
+}
+
+void DynamicResolution::Update(const GpuProfiler& profiler, const char* scaledPass) {
+    m_Stats.Scale = m_Settings.Enabled ? m_Scale : 1.0f;
+    m_Stats.RenderWidth = GetRenderWidth();
+    m_Stats.RenderHeight = GetRenderHeight();
+
+    const GpuFrameTimings& frame = profiler.GetLatestFrame();
+    if (frame.FrameIndex == m_LastGpuFrame || frame.Passes.empty()) {
+        return;
+    }
+    m_LastGpuFrame = frame.FrameIndex;
+
+    // Frames still rendered at the previous scale say nothing about the current one
+    m_FramesSinceChange = std::min(m_FramesSinceChange + 1, SettleFrames + SampleFrames);
+    if (m_FramesSinceChange < SettleFrames) {
+        return;
+    }
+    float scaledMs = 0.0f;
+    for (const GpuPassTiming& pass : frame.Passes) {
+        if (pass.Depth == 0 && pass.Name == scaledPass) {
+            scaledMs += pass.GpuMs;
+        }
+    }
+    if (m_FramesSinceChange == SettleFrames) {
+        m_Stats.FrameGpuMs = frame.TotalMs;
+        m_Stats.ScaledGpuMs = scaledMs;
+    }
+    else {
+        constexpr float Smoothing = 0.25f;
+        m_Stats.FrameGpuMs += (frame.TotalMs - m_Stats.FrameGpuMs) * Smoothing;
+        m_Stats.ScaledGpuMs += (scaledMs - m_Stats.ScaledGpuMs) * Smoothing;
+    }
+    if (!m_Settings.Enabled || m_FramesSinceChange < SettleFrames + SampleFrames) {
+        return;
+    }
+
+    const float error = m_Stats.FrameGpuMs / m_Settings.TargetGpuMs - 1.0f;
+    if (std::abs(error) < m_Settings.DeadBand) {
+        return;
+    }
+    float desired = m_Settings.MaxScale;
+    if (m_Stats.ScaledGpuMs > 0.0f) {
+        // Only the scaled pass shrinks with the resolution, in proportion to the pixel count
+        const float fixedMs = std::max(m_Stats.FrameGpuMs - m_Stats.ScaledGpuMs, 0.0f);
+        const float scaledBudget = std::max(m_Settings.TargetGpuMs - fixedMs, 0.0f);
+        desired = m_Scale * std::sqrt(scaledBudget / m_Stats.ScaledGpuMs);
+    }
+    desired = std::clamp(desired, m_Scale - m_Settings.MaxStepDown, m_Scale + m_Settings.MaxStepUp);
+    desired = std::clamp(desired, m_Settings.MinScale, m_Settings.MaxScale);
+    if (std::abs(desired - m_Scale) > 0.005f) {
+        m_Scale = desired;
+        m_FramesSinceChange = 0;
+        m_Stats.Adjustments++;
+    }
+}
+
+void DynamicResolution::EnsureTarget() {
+    // Allocated at the output size once; scaling only changes the viewport into it
+    const uint32_t width = std::max(m_Device->GetWidth(), 1u);
+    const uint32_t height = std::max(m_Device->GetHeight(), 1u);
+    if (m_Framebuffer && width == m_TargetWidth && height == m_TargetHeight) {
+        return;
+    }
+    DestroyTarget();
+
+    glGenTextures(1, &m_ColorTexture);
+    glBindTexture(GL_TEXTURE_2D, m_ColorTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenRenderbuffers(1, &m_DepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_ColorTexture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Warning: dynamic resolution target is incomplete, rendering at full resolution" << std::endl;
+        DestroyTarget();
+        m_Settings.Enabled = false;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Device->GetBackBuffer());
+    m_TargetWidth = width;
+    m_TargetHeight = height;
+}
+
+void DynamicResolution::DestroyTarget() {
+    if (m_Framebuffer) glDeleteFramebuffers(1, &m_Framebuffer);
+    if (m_ColorTexture) glDeleteTextures(1, &m_ColorTexture);
+    if (m_DepthBuffer) glDeleteRenderbuffers(1, &m_DepthBuffer);
+    m_Framebuffer = 0;
+    m_ColorTexture = 0;
+    m_DepthBuffer = 0;
+    m_TargetWidth = 0;
+    m_TargetHeight = 0;
+}
+
+void DynamicResolution::BeginScene() {
+    if (m_Settings.Enabled) {
+        EnsureTarget();
+    }
+    if (!m_Settings.Enabled) {
+        glBindFramebuffer(GL_FRAMEBUFFER, m_Device->GetBackBuffer());
+        glViewport(0, 0, m_Device->GetWidth(), m_Device->GetHeight());
+        return;
+    }
+
+    const uint32_t width = GetRenderWidth();
+    const uint32_t height = GetRenderHeight();
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    glViewport(0, 0, width, height);
+    // Only the rendered corner; the rest of the target is never sampled
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+void DynamicResolution::Resolve() {
+    if (!m_Settings.Enabled || !m_Framebuffer) {
+        return;
+    }
+    HENKY_PROFILE_ZONE("DynamicResolution::Resolve");
+    const uint32_t renderWidth = GetRenderWidth();
+    const uint32_t renderHeight = GetRenderHeight();
+    const GLuint backBuffer = m_Device->GetBackBuffer();
+
+    if (m_Settings.Filter == UpscaleFilter::Bilinear || !m_UpscaleProgram) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, m_Framebuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, backBuffer);
+        glBlitFramebuffer(0, 0, renderWidth, renderHeight, 0, 0, m_Device->GetWidth(), m_Device->GetHeight(),
+                          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+    else {
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, backBuffer);
+        glViewport(0, 0, m_Device->GetWidth(), m_Device->GetHeight());
+        glUseProgram(m_UpscaleProgram);
+        glUniform1i(m_SourceLocation, 0);
+        glUniform2f(m_UvScaleLocation, static_cast<float>(renderWidth) / m_TargetWidth,
+                    static_cast<float>(renderHeight) / m_TargetHeight);
+        glUniform2f(m_TexelSizeLocation, 1.0f / m_TargetWidth, 1.0f / m_TargetHeight);
+        glUniform1f(m_SharpnessLocation, m_Settings.Sharpness);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, m_ColorTexture);
+        glBindVertexArray(m_VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+
+        if (depthTest) glEnable(GL_DEPTH_TEST);
+        if (cullFace) glEnable(GL_CULL_FACE);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, backBuffer);
+    glViewport(0, 0, m_Device->GetWidth(), m_Device->GetHeight());
+}
+
+} // namespace Henky3D
@@ -0,0 +1,94 @@
+#pragma once
+#include "GraphicsDevice.h"
+#include "GpuProfiler.h"
+#include <glad/gl.h>
+#include <cstdint>
+
+namespace Henky3D {
+
+enum class UpscaleFilter {
+    Bilinear,   // glBlitFramebuffer
+    Sharpen     // Fullscreen resolve with contrast-adaptive sharpening
+};
+
+struct DynamicResolutionSettings {
+    bool Enabled = false;
+    float TargetGpuMs = 14.0f;      // GPU frame time to hold, a little under the frame budget
+    float MinScale = 0.5f;          // Per axis
+    float MaxScale = 1.0f;
+    float DeadBand = 0.05f;         // Relative error left alone, so the scale does not hunt around the target
+    float MaxStepDown = 0.1f;       // Largest scale change per adjustment when over budget...
+    float MaxStepUp = 0.03f;        // ...and under it, slower so one cheap frame does not start an oscillation
+    UpscaleFilter Filter = UpscaleFilter::Sharpen;
+    float Sharpness = 0.5f;         // 0-1
+};
+
+struct DynamicResolutionStats {
+    float Scale = 1.0f;
+    uint32_t RenderWidth = 0;
+    uint32_t RenderHeight = 0;
+    float FrameGpuMs = 0.0f;        // Smoothed sum of the top-level GPU passes
+    float ScaledGpuMs = 0.0f;       // Smoothed time of the pass that scales with the pixel count
+    uint64_t Adjustments = 0;
+};
+
+// Renders the scene into a target of the output size through a viewport scaled
+// by a controller on the measured GPU time, then upscales into the back buffer.
+// The controller models the frame as fixed passes plus one pass whose cost
+// follows the pixel count, and solves for the scale that meets the target. GPU
+// timings arrive GpuProfiler::Latency frames late, so after every change it waits
+// for frames rendered at the new scale before adjusting again.
+class DynamicResolution {
+public:
+    DynamicResolution(GraphicsDevice* device);
+    ~DynamicResolution();
+
+    void SetUpscaleProgram(GLuint program);
+
+    // Once per frame before rendering, with the top-level pass that draws the scene
+    void Update(const GpuProfiler& profiler, const char* scaledPass);
+
+    // Binds and clears the scene target at the scaled viewport, or the back buffer when disabled
+    void BeginScene();
+    // Scene target into the whole back buffer; leaves the back buffer bound for the overlay
+    void Resolve();
+
+    GLuint GetSceneTexture() const { return m_ColorTexture; }
+    uint32_t GetRenderWidth() const;
+    uint32_t GetRenderHeight() const;
+
+    const DynamicResolutionSettings& GetSettings() const { return m_Settings; }
+    void SetSettings(const DynamicResolutionSettings& settings);
+    const DynamicResolutionStats& GetStats() const { return m_Stats; }
+
+private:
+    // Resolved frames after a change before the timings show the new scale, then frames to average
+    static constexpr uint32_t SettleFrames = GpuProfiler::Latency + 1;
+    static constexpr uint32_t SampleFrames = 4;
+
+    void EnsureTarget();
+    void DestroyTarget();
+
+    GraphicsDevice* m_Device;
+    DynamicResolutionSettings m_Settings;
+    DynamicResolutionStats m_Stats;
+    float m_Scale = 1.0f;
+
+    GLuint m_Framebuffer = 0;
+    GLuint m_ColorTexture = 0;
+    GLuint m_DepthBuffer = 0;
+    uint32_t m_TargetWidth = 0;
+    uint32_t m_TargetHeight = 0;
+
+    GLuint m_UpscaleProgram = 0;
+    GLuint m_VAO = 0;
+    GLint m_SourceLocation = -1;
+    GLint m_UvScaleLocation = -1;
+    GLint m_TexelSizeLocation = -1;
+    GLint m_SharpnessLocation = -1;
+
+    uint64_t m_LastGpuFrame = 0;
+    uint32_t m_FramesSinceChange = 0;
+};
+
+} // namespace Henky3D
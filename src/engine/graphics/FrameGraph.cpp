@@ -1,50 +1,465 @@
 #include "FrameGraph.h"
+#include "../core/Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <stdexcept>
 
 namespace Henky3D {
 
+FrameGraphResource FrameGraphBuilder::CreateTexture(const std::string& name, const FrameGraphTextureDesc& desc) {
+    FrameGraphResource resource = m_Graph.CreateResource(name, FrameGraph::ResourceType::Texture, m_Pass);
+    m_Graph.m_Resources[m_Graph.m_Nodes[resource].Resource].TextureDesc = desc;
+    m_Graph.m_Passes[m_Pass].Writes.push_back(resource);
+    return resource;
+}
+
+FrameGraphResource FrameGraphBuilder::CreateBuffer(const std::string& name, const FrameGraphBufferDesc& desc) {
+    FrameGraphResource resource = m_Graph.CreateResource(name, FrameGraph::ResourceType::Buffer, m_Pass);
+    m_Graph.m_Resources[m_Graph.m_Nodes[resource].Resource].BufferDesc = desc;
+    m_Graph.m_Passes[m_Pass].Writes.push_back(resource);
+    return resource;
+}
+
+FrameGraphResource FrameGraphBuilder::Read(FrameGraphResource resource) {
+    if (resource >= m_Graph.m_Nodes.size()) {
+        throw std::runtime_error("FrameGraph: pass '" + m_Graph.m_Passes[m_Pass].Name + "' reads an invalid resource");
+    }
+    m_Graph.m_Passes[m_Pass].Reads.push_back(resource);
+    return resource;
+}
+
+FrameGraphResource FrameGraphBuilder::Write(FrameGraphResource resource) {
+    if (resource >= m_Graph.m_Nodes.size()) {
+        throw std::runtime_error("FrameGraph: pass '" + m_Graph.m_Passes[m_Pass].Name + "' writes an invalid resource");
+    }
+    // Writes keep the previous contents, so they depend on the version they overwrite
+    m_Graph.m_Passes[m_Pass].Reads.push_back(resource);
+    FrameGraphResource version = m_Graph.AddVersion(resource, m_Pass);
+    m_Graph.m_Passes[m_Pass].Writes.push_back(version);
+    return version;
+}
+
+void FrameGraphBuilder::SideEffect() {
+    m_Graph.m_Passes[m_Pass].SideEffect = true;
+}
+
 FrameGraph::FrameGraph(GraphicsDevice* device)
     : m_Device(device) {
 }
 
 FrameGraph::~FrameGraph() {
+    ReleasePhysical();
 }
 
-void FrameGraph::AddPass(const std::string& name, std::function<void()> execute) {
+void FrameGraph::AddPass(const std::string& name, const std::function<void(FrameGraphBuilder&)>& setup,
+                         std::function<void(const FrameGraph&)> execute) {
     RenderPass pass;
     pass.Name = name;
-    pass.Execute = execute;
+    pass.ProfileName = Profiler::Intern(name);
+    pass.Execute = std::move(execute);
     pass.Enabled = true;
-    m_Passes.push_back(pass);
+    m_Passes.push_back(std::move(pass));
+
+    const uint32_t index = static_cast<uint32_t>(m_Passes.size() - 1);
+    m_PassLookup[name] = index;
+    if (setup) {
+        FrameGraphBuilder builder(*this, index);
+        setup(builder);
+    }
+    m_Dirty = true;
 }
 
-void FrameGraph::SetPassEnabled(const std::string& name, bool enabled) {
-    for (auto& pass : m_Passes) {
-        if (pass.Name == name) {
-            pass.Enabled = enabled;
-            return;
-        }
+void FrameGraph::AddPass(const std::string& name, std::function<void()> execute) {
+    AddPass(name, [](FrameGraphBuilder& builder) { builder.SideEffect(); },
+            [execute = std::move(execute)](const FrameGraph&) {
+                if (execute) {
+                    execute();
+                }
+            });
+}
+
+FrameGraphResource FrameGraph::ImportTexture(const std::string& name, GLuint texture, const FrameGraphTextureDesc& desc) {
+    FrameGraphResource resource = CreateResource(name, ResourceType::Texture, NoIndex);
+    ResourceEntry& entry = m_Resources[m_Nodes[resource].Resource];
+    entry.Imported = true;
+    entry.ImportedHandle = texture;
+    entry.TextureDesc = desc;
+    return resource;
+}
+
+FrameGraphResource FrameGraph::ImportBuffer(const std::string& name, GLuint buffer, const FrameGraphBufferDesc& desc) {
+    FrameGraphResource resource = CreateResource(name, ResourceType::Buffer, NoIndex);
+    ResourceEntry& entry = m_Resources[m_Nodes[resource].Resource];
+    entry.Imported = true;
+    entry.ImportedHandle = buffer;
+    entry.BufferDesc = desc;
+    return resource;
+}
+
+void FrameGraph::SetImportedHandle(FrameGraphResource resource, GLuint handle) {
+    // Imports are not part of the compiled layout, so swapping them needs no recompile
+    m_Resources[m_Nodes[resource].Resource].ImportedHandle = handle;
+}
+
+void FrameGraph::SetTextureDesc(FrameGraphResource resource, const FrameGraphTextureDesc& desc) {
+    ResourceEntry& entry = m_Resources[m_Nodes[resource].Resource];
+    if (!(entry.TextureDesc == desc)) {
+        entry.TextureDesc = desc;
+        m_Dirty = true;
     }
 }
 
-bool FrameGraph::IsPassEnabled(const std::string& name) const {
-    for (const auto& pass : m_Passes) {
-        if (pass.Name == name) {
-            return pass.Enabled;
+FrameGraphResource FrameGraph::CreateResource(const std::string& name, ResourceType type, uint32_t producer) {
+    ResourceEntry entry;
+    entry.Name = name;
+    entry.Type = type;
+    m_Resources.push_back(entry);
+
+    ResourceNode node;
+    node.Resource = static_cast<uint32_t>(m_Resources.size() - 1);
+    node.Producer = producer;
+    node.Previous = InvalidFrameGraphResource;
+    m_Nodes.push_back(node);
+    m_Dirty = true;
+    return static_cast<FrameGraphResource>(m_Nodes.size() - 1);
+}
+
+FrameGraphResource FrameGraph::AddVersion(FrameGraphResource previous, uint32_t producer) {
+    ResourceNode node;
+    node.Resource = m_Nodes[previous].Resource;
+    node.Producer = producer;
+    node.Previous = previous;
+    m_Nodes.push_back(node);
+    m_Dirty = true;
+    return static_cast<FrameGraphResource>(m_Nodes.size() - 1);
+}
+
+uint32_t FrameGraph::GetLiveProducer(FrameGraphResource resource) const {
+    // A disabled pass passes its input version through unchanged
+    while (resource != InvalidFrameGraphResource) {
+        const ResourceNode& node = m_Nodes[resource];
+        if (node.Producer == NoIndex || m_Passes[node.Producer].Enabled) {
+            return node.Producer;
         }
+        resource = node.Previous;
+    }
+    return NoIndex;
+}
+
+void FrameGraph::SetPassEnabled(std::string_view name, bool enabled) {
+    auto it = m_PassLookup.find(name);
+    if (it != m_PassLookup.end() && m_Passes[it->second].Enabled != enabled) {
+        m_Passes[it->second].Enabled = enabled;
+        m_Dirty = true;
     }
-    return false;
+}
+
+bool FrameGraph::IsPassEnabled(std::string_view name) const {
+    auto it = m_PassLookup.find(name);
+    return it != m_PassLookup.end() && m_Passes[it->second].Enabled;
 }
 
 void FrameGraph::Execute() {
-    for (const auto& pass : m_Passes) {
-        if (pass.Enabled && pass.Execute) {
-            pass.Execute();
+    HENKY_PROFILE_ZONE("FrameGraph::Execute");
+    if (m_Device && (m_Device->GetWidth() != m_CompiledWidth || m_Device->GetHeight() != m_CompiledHeight)) {
+        m_Dirty = true;
+    }
+    if (m_Dirty) {
+        Compile();
+    }
+
+    for (uint32_t pass : m_Order) {
+        if (!m_Passes[pass].Execute) {
+            continue;
+        }
+        HENKY_PROFILE_ZONE(m_Passes[pass].ProfileName);
+        if (m_GpuProfiler) {
+            m_GpuProfiler->BeginPass(m_Passes[pass].ProfileName);
+        }
+        m_Passes[pass].Execute(*this);
+        if (m_GpuProfiler) {
+            m_GpuProfiler->EndPass();
+        }
+    }
+}
+
+void FrameGraph::Compile() {
+    auto startTime = std::chrono::steady_clock::now();
+    const uint32_t passCount = static_cast<uint32_t>(m_Passes.size());
+
+    // Live passes: side-effect passes and, transitively, the producers of what they read
+    std::vector<bool> live(passCount, false);
+    std::vector<uint32_t> stack;
+    for (uint32_t p = 0; p < passCount; p++) {
+        if (m_Passes[p].Enabled && m_Passes[p].SideEffect) {
+            live[p] = true;
+            stack.push_back(p);
+        }
+    }
+    while (!stack.empty()) {
+        uint32_t p = stack.back();
+        stack.pop_back();
+        for (FrameGraphResource read : m_Passes[p].Reads) {
+            uint32_t producer = GetLiveProducer(read);
+            if (producer != NoIndex && !live[producer]) {
+                live[producer] = true;
+                stack.push_back(producer);
+            }
+        }
+    }
+
+    // The version a read actually sees once disabled writers are skipped
+    auto effectiveVersion = [this](FrameGraphResource resource) {
+        while (m_Nodes[resource].Producer != NoIndex && !m_Passes[m_Nodes[resource].Producer].Enabled &&
+               m_Nodes[resource].Previous != InvalidFrameGraphResource) {
+            resource = m_Nodes[resource].Previous;
+        }
+        return resource;
+    };
+
+    std::unordered_map<FrameGraphResource, std::vector<uint32_t>> readers;
+    for (uint32_t p = 0; p < passCount; p++) {
+        if (!live[p]) continue;
+        for (FrameGraphResource read : m_Passes[p].Reads) {
+            readers[effectiveVersion(read)].push_back(p);
         }
     }
+
+    // Edges: producer before reader, and readers of a version before the pass overwriting it
+    std::vector<std::vector<uint32_t>> successors(passCount);
+    std::vector<uint32_t> incoming(passCount, 0);
+    auto addEdge = [&](uint32_t from, uint32_t to) {
+        if (from == to) return;
+        std::vector<uint32_t>& edges = successors[from];
+        if (std::find(edges.begin(), edges.end(), to) == edges.end()) {
+            edges.push_back(to);
+            incoming[to]++;
+        }
+    };
+    for (uint32_t p = 0; p < passCount; p++) {
+        if (!live[p]) continue;
+        for (FrameGraphResource read : m_Passes[p].Reads) {
+            uint32_t producer = GetLiveProducer(read);
+            if (producer != NoIndex) {
+                addEdge(producer, p);
+            }
+        }
+        for (FrameGraphResource write : m_Passes[p].Writes) {
+            if (m_Nodes[write].Previous == InvalidFrameGraphResource) continue;
+            auto it = readers.find(effectiveVersion(m_Nodes[write].Previous));
+            if (it != readers.end()) {
+                for (uint32_t reader : it->second) {
+                    addEdge(reader, p);
+                }
+            }
+        }
+    }
+
+    // Kahn's algorithm; ties keep insertion order so independent passes stay stable
+    m_Order.clear();
+    std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<uint32_t>> ready;
+    uint32_t liveCount = 0;
+    for (uint32_t p = 0; p < passCount; p++) {
+        if (!live[p]) continue;
+        liveCount++;
+        if (incoming[p] == 0) {
+            ready.push(p);
+        }
+    }
+    while (!ready.empty()) {
+        uint32_t p = ready.top();
+        ready.pop();
+        m_Order.push_back(p);
+        for (uint32_t next : successors[p]) {
+            if (--incoming[next] == 0) {
+                ready.push(next);
+            }
+        }
+    }
+    if (m_Order.size() != liveCount) {
+        throw std::runtime_error("FrameGraph: passes have cyclic resource dependencies");
+    }
+
+    AllocateTransients();
+
+    m_Stats.PassCount = passCount;
+    m_Stats.CulledPassCount = 0;
+    for (uint32_t p = 0; p < passCount; p++) {
+        if (m_Passes[p].Enabled && !live[p]) {
+            m_Stats.CulledPassCount++;
+        }
+    }
+    m_Stats.CompileCount++;
+    m_Stats.CompileTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    m_CompiledWidth = m_Device ? m_Device->GetWidth() : 0;
+    m_CompiledHeight = m_Device ? m_Device->GetHeight() : 0;
+    m_Dirty = false;
+}
+
+void FrameGraph::AllocateTransients() {
+    // Lifetime of each transient resource in execution order
+    std::vector<uint32_t> firstUse(m_Resources.size(), NoIndex);
+    std::vector<uint32_t> lastUse(m_Resources.size(), NoIndex);
+    for (uint32_t position = 0; position < m_Order.size(); position++) {
+        const RenderPass& pass = m_Passes[m_Order[position]];
+        for (const std::vector<FrameGraphResource>* uses : { &pass.Reads, &pass.Writes }) {
+            for (FrameGraphResource use : *uses) {
+                uint32_t resource = m_Nodes[use].Resource;
+                if (m_Resources[resource].Imported) continue;
+                if (firstUse[resource] == NoIndex) {
+                    firstUse[resource] = position;
+                }
+                lastUse[resource] = position;
+            }
+        }
+    }
+
+    std::vector<std::vector<uint32_t>> startsAt(m_Order.size());
+    std::vector<std::vector<uint32_t>> endsAt(m_Order.size());
+    m_Stats.TransientResources = 0;
+    for (uint32_t r = 0; r < m_Resources.size(); r++) {
+        m_Resources[r].Physical = NoIndex;
+        if (firstUse[r] != NoIndex) {
+            startsAt[firstUse[r]].push_back(r);
+            endsAt[lastUse[r]].push_back(r);
+            m_Stats.TransientResources++;
+        }
+    }
+
+    // Greedy assignment: a slot freed after a resource's last use can back the next one
+    for (PhysicalResource& physical : m_Physical) {
+        physical.InUse = false;
+    }
+    std::vector<bool> assigned(m_Physical.size(), false);
+    for (uint32_t position = 0; position < m_Order.size(); position++) {
+        for (uint32_t r : startsAt[position]) {
+            uint32_t slot = AcquirePhysical(m_Resources[r]);
+            m_Resources[r].Physical = slot;
+            assigned.resize(m_Physical.size(), false);
+            assigned[slot] = true;
+        }
+        for (uint32_t r : endsAt[position]) {
+            m_Physical[m_Resources[r].Physical].InUse = false;
+        }
+    }
+
+    // Drop pool entries the new layout does not use, e.g. targets of the old size after a resize
+    std::vector<uint32_t> remap(m_Physical.size(), NoIndex);
+    std::vector<PhysicalResource> kept;
+    for (uint32_t i = 0; i < m_Physical.size(); i++) {
+        if (assigned[i]) {
+            remap[i] = static_cast<uint32_t>(kept.size());
+            kept.push_back(m_Physical[i]);
+        } else if (m_Physical[i].Type == ResourceType::Texture) {
+            glDeleteTextures(1, &m_Physical[i].Handle);
+        } else {
+            glDeleteBuffers(1, &m_Physical[i].Handle);
+        }
+    }
+    m_Physical = std::move(kept);
+    for (ResourceEntry& resource : m_Resources) {
+        if (resource.Physical != NoIndex) {
+            resource.Physical = remap[resource.Physical];
+        }
+    }
+    m_Stats.PhysicalResources = static_cast<uint32_t>(m_Physical.size());
+}
+
+uint32_t FrameGraph::AcquirePhysical(const ResourceEntry& resource) {
+    const FrameGraphTextureDesc desc = ResolveDesc(resource.TextureDesc);
+
+    // Textures need an identical description; buffers take the smallest free one that fits
+    uint32_t best = NoIndex;
+    for (uint32_t i = 0; i < m_Physical.size(); i++) {
+        const PhysicalResource& physical = m_Physical[i];
+        if (physical.InUse || physical.Type != resource.Type) continue;
+        if (resource.Type == ResourceType::Texture) {
+            if (physical.TextureDesc == desc) {
+                best = i;
+                break;
+            }
+        } else if (physical.BufferSize >= resource.BufferDesc.Size &&
+                   (best == NoIndex || physical.BufferSize < m_Physical[best].BufferSize)) {
+            best = i;
+        }
+    }
+
+    if (best == NoIndex) {
+        PhysicalResource physical;
+        physical.Type = resource.Type;
+        if (resource.Type == ResourceType::Texture) {
+            physical.TextureDesc = desc;
+            GLenum target = desc.Layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+            glGenTextures(1, &physical.Handle);
+            glBindTexture(target, physical.Handle);
+            if (desc.Layers > 1) {
+                glTexStorage3D(target, 1, desc.Format, desc.Width, desc.Height, desc.Layers);
+            } else {
+                glTexStorage2D(target, 1, desc.Format, desc.Width, desc.Height);
+            }
+            glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(target, 0);
+        } else {
+            physical.BufferSize = std::max<size_t>(resource.BufferDesc.Size, 16);
+            glGenBuffers(1, &physical.Handle);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, physical.Handle);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, physical.BufferSize, nullptr, GL_DYNAMIC_DRAW);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        }
+        m_Physical.push_back(physical);
+        best = static_cast<uint32_t>(m_Physical.size() - 1);
+    }
+
+    m_Physical[best].InUse = true;
+    return best;
+}
+
+FrameGraphTextureDesc FrameGraph::ResolveDesc(const FrameGraphTextureDesc& desc) const {
+    FrameGraphTextureDesc resolved = desc;
+    if (resolved.Width == 0) resolved.Width = m_Device ? std::max(m_Device->GetWidth(), 1u) : 1;
+    if (resolved.Height == 0) resolved.Height = m_Device ? std::max(m_Device->GetHeight(), 1u) : 1;
+    resolved.Layers = std::max(resolved.Layers, 1u);
+    return resolved;
+}
+
+void FrameGraph::ReleasePhysical() {
+    for (PhysicalResource& physical : m_Physical) {
+        if (physical.Type == ResourceType::Texture) {
+            glDeleteTextures(1, &physical.Handle);
+        } else {
+            glDeleteBuffers(1, &physical.Handle);
+        }
+    }
+    m_Physical.clear();
+}
+
+GLuint FrameGraph::GetTexture(FrameGraphResource resource) const {
+    const ResourceEntry& entry = m_Resources[m_Nodes[resource].Resource];
+    if (entry.Imported) {
+        return entry.ImportedHandle;
+    }
+    return entry.Physical != NoIndex ? m_Physical[entry.Physical].Handle : 0;
+}
+
+GLuint FrameGraph::GetBuffer(FrameGraphResource resource) const {
+    return GetTexture(resource);
 }
 
 void FrameGraph::Clear() {
+    ReleasePhysical();
     m_Passes.clear();
+    m_PassLookup.clear();
+    m_Resources.clear();
+    m_Nodes.clear();
+    m_Order.clear();
+    m_Stats = FrameGraphStats();
+    m_Dirty = true;
 }
 
 size_t FrameGraph::GetEnabledPassCount() const {
@@ -1,48 +1,187 @@
 #pragma once
 #include "GraphicsDevice.h"
+#include "GpuProfiler.h"
+#include <glad/gl.h>
 #include <functional>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 
 namespace Henky3D {
 
 // Forward declarations
 class Renderer;
 class ECSWorld;
+class FrameGraph;
+
+// A version of a graph resource; every write produces a new handle
+using FrameGraphResource = uint32_t;
+constexpr FrameGraphResource InvalidFrameGraphResource = 0xFFFFFFFFu;
+
+struct FrameGraphTextureDesc {
+    uint32_t Width = 0;        // 0 = back buffer size
+    uint32_t Height = 0;
+    uint32_t Layers = 1;       // > 1 creates a 2D array texture
+    GLenum Format = GL_RGBA8;
+
+    bool operator==(const FrameGraphTextureDesc& other) const {
+        return Width == other.Width && Height == other.Height && Layers == other.Layers && Format == other.Format;
+    }
+};
+
+struct FrameGraphBufferDesc {
+    size_t Size = 0;
+};
+
+struct FrameGraphStats {
+    uint32_t PassCount = 0;
+    uint32_t CulledPassCount = 0;      // Enabled passes whose outputs nothing consumes
+    uint32_t TransientResources = 0;   // Transient textures and buffers used by live passes
+    uint32_t PhysicalResources = 0;    // GL objects backing them after lifetime-based reuse
+    uint64_t CompileCount = 0;
+    float CompileTimeMs = 0.0f;
+};
+
+// Declares what a pass reads and writes while it is added to the graph
+class FrameGraphBuilder {
+public:
+    FrameGraphBuilder(FrameGraph& graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+    // Transient resources live only between their first and last use in the compiled graph
+    FrameGraphResource CreateTexture(const std::string& name, const FrameGraphTextureDesc& desc);
+    FrameGraphResource CreateBuffer(const std::string& name, const FrameGraphBufferDesc& desc);
+
+    FrameGraphResource Read(FrameGraphResource resource);
+    // Returns the new version; later readers must use it to be ordered after this pass
+    FrameGraphResource Write(FrameGraphResource resource);
+
+    // Never cull this pass (presents, readbacks, anything visible outside the graph)
+    void SideEffect();
+
+private:
+    FrameGraph& m_Graph;
+    uint32_t m_Pass;
+};
 
 // Represents a render pass in the frame graph
 struct RenderPass {
     std::string Name;
-    std::function<void()> Execute;
+    const char* ProfileName = nullptr;        // Interned copy of Name for CPU zones
+    std::function<void(const FrameGraph&)> Execute;
     bool Enabled = true;
+    bool SideEffect = false;
+    std::vector<FrameGraphResource> Reads;
+    std::vector<FrameGraphResource> Writes;   // Versions produced by this pass
 };
 
-// Lightweight frame graph for pass ordering and barrier management
+// Frame graph of passes connected through the resources they declare. Compiling
+// culls passes that contribute nothing to a side-effect pass, orders the rest
+// topologically and maps transient resources onto a pool of GL objects, reusing
+// one object for resources whose lifetimes do not overlap. The compiled graph is
+// kept across frames until a pass, its enable state or a resource size changes.
 class FrameGraph {
 public:
     FrameGraph(GraphicsDevice* device);
     ~FrameGraph();
 
-    // Add passes
+    // Add passes; setup declares resources and runs once, execute runs every frame
+    void AddPass(const std::string& name, const std::function<void(FrameGraphBuilder&)>& setup,
+                 std::function<void(const FrameGraph&)> execute);
+    // Pass without declared resources; never culled and ordered by insertion
     void AddPass(const std::string& name, std::function<void()> execute);
-    
-    // Enable/disable specific passes
-    void SetPassEnabled(const std::string& name, bool enabled);
-    bool IsPassEnabled(const std::string& name) const;
-    
-    // Execute all enabled passes
+
+    // Resources owned outside the graph, e.g. the back buffer (handle 0) or the shadow map
+    FrameGraphResource ImportTexture(const std::string& name, GLuint texture, const FrameGraphTextureDesc& desc = {});
+    FrameGraphResource ImportBuffer(const std::string& name, GLuint buffer, const FrameGraphBufferDesc& desc = {});
+    void SetImportedHandle(FrameGraphResource resource, GLuint handle);
+    void SetTextureDesc(FrameGraphResource resource, const FrameGraphTextureDesc& desc);
+
+    // Enable/disable specific passes; per-frame calls with a literal build no string
+    void SetPassEnabled(std::string_view name, bool enabled);
+    bool IsPassEnabled(std::string_view name) const;
+
+    // Compile if the setup changed, then execute the live passes in dependency order
     void Execute();
     
-    // Clear all passes (typically called per-frame)
+    // Time every executed pass on the GPU; null disables
+    void SetGpuProfiler(GpuProfiler* profiler) { m_GpuProfiler = profiler; }
+
+    // Clear all passes and resources
     void Clear();
-    
+
+    // Valid inside a pass's execute callback
+    GLuint GetTexture(FrameGraphResource resource) const;
+    GLuint GetBuffer(FrameGraphResource resource) const;
+
     // Get statistics
     size_t GetPassCount() const { return m_Passes.size(); }
     size_t GetEnabledPassCount() const;
+    const std::vector<uint32_t>& GetExecutionOrder() const { return m_Order; }
+    const FrameGraphStats& GetStats() const { return m_Stats; }
 
 private:
+    friend class FrameGraphBuilder;
+
+    static constexpr uint32_t NoIndex = 0xFFFFFFFFu;
+
+    enum class ResourceType { Texture, Buffer };
+
+    struct ResourceEntry {
+        std::string Name;
+        ResourceType Type = ResourceType::Texture;
+        bool Imported = false;
+        GLuint ImportedHandle = 0;
+        FrameGraphTextureDesc TextureDesc;
+        FrameGraphBufferDesc BufferDesc;
+        uint32_t Physical = NoIndex;  // Pool slot of a transient resource after compilation
+    };
+
+    // One version of a resource
+    struct ResourceNode {
+        uint32_t Resource;
+        uint32_t Producer;            // Pass that wrote this version, NoIndex for imports
+        FrameGraphResource Previous;  // Version this one overwrote
+    };
+
+    struct PhysicalResource {
+        ResourceType Type = ResourceType::Texture;
+        FrameGraphTextureDesc TextureDesc;  // Resolved size
+        size_t BufferSize = 0;
+        GLuint Handle = 0;
+        bool InUse = false;
+    };
+
+    // Lets the pass lookup take a string_view without converting it to std::string
+    struct PassNameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
+
+    FrameGraphResource CreateResource(const std::string& name, ResourceType type, uint32_t producer);
+    FrameGraphResource AddVersion(FrameGraphResource previous, uint32_t producer);
+    uint32_t GetLiveProducer(FrameGraphResource resource) const;
+    FrameGraphTextureDesc ResolveDesc(const FrameGraphTextureDesc& desc) const;
+
+    void Compile();
+    void AllocateTransients();
+    uint32_t AcquirePhysical(const ResourceEntry& resource);
+    void ReleasePhysical();
+
     GraphicsDevice* m_Device;
+    GpuProfiler* m_GpuProfiler = nullptr;
     std::vector<RenderPass> m_Passes;
+    std::unordered_map<std::string, uint32_t, PassNameHash, std::equal_to<>> m_PassLookup;
+    std::vector<ResourceEntry> m_Resources;
+    std::vector<ResourceNode> m_Nodes;
+    std::vector<PhysicalResource> m_Physical;
+
+    // Compiled state
+    bool m_Dirty = true;
+    uint32_t m_CompiledWidth = 0;
+    uint32_t m_CompiledHeight = 0;
+    std::vector<uint32_t> m_Order;
+    FrameGraphStats m_Stats;
 };
 
 } // namespace Henky3D
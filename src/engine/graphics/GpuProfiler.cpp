@@ -0,0 +1,227 @@
+#include "GpuProfiler.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace Henky3D {
+
+namespace {
+
+const GLenum StatisticTargets[GpuStatisticCount] = {
+    GL_VERTICES_SUBMITTED_ARB,
+    GL_PRIMITIVES_SUBMITTED_ARB,
+    GL_VERTEX_SHADER_INVOCATIONS_ARB,
+    GL_FRAGMENT_SHADER_INVOCATIONS_ARB,
+    GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+    GL_CLIPPING_OUTPUT_PRIMITIVES_ARB
+};
+
+} // namespace
+
+GpuProfiler::GpuProfiler()
+    : m_PipelineStatistics(GLAD_GL_ARB_pipeline_statistics_query != 0 || GLAD_GL_VERSION_4_6 != 0) {
+}
+
+GpuProfiler::~GpuProfiler() {
+    for (FrameSlot& slot : m_Slots) {
+        if (!slot.TimestampQueries.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(slot.TimestampQueries.size()), slot.TimestampQueries.data());
+        }
+        if (!slot.StatisticsQueries.empty()) {
+            glDeleteQueries(static_cast<GLsizei>(slot.StatisticsQueries.size()), slot.StatisticsQueries.data());
+        }
+    }
+}
+
+void GpuProfiler::BeginFrame() {
+    if (m_Recording) {
+        while (!m_OpenScopes.empty()) {
+            EndPass();
+        }
+        m_Slots[m_Current].Pending = !m_Slots[m_Current].Scopes.empty();
+    }
+
+    // Oldest first, so history stays in frame order
+    for (uint32_t i = 1; i <= Latency; i++) {
+        FrameSlot& slot = m_Slots[(m_Current + i) % Latency];
+        if (slot.Pending) {
+            TryResolve(slot);
+        }
+    }
+
+    m_Current = (m_Current + 1) % Latency;
+    FrameSlot& slot = m_Slots[m_Current];
+    if (slot.Pending) {
+        // The GPU is more than Latency frames behind; drop rather than wait
+        slot.Pending = false;
+        m_Stats.DroppedFrames++;
+    }
+    slot.Scopes.clear();
+    slot.TimestampsUsed = 0;
+    slot.StatisticsUsed = 0;
+    slot.FrameIndex = ++m_FrameIndex;
+    m_Recording = m_Enabled;
+}
+
+uint32_t GpuProfiler::AcquireTimestamp(FrameSlot& slot) {
+    if (slot.TimestampsUsed == slot.TimestampQueries.size()) {
+        const size_t first = slot.TimestampQueries.size();
+        slot.TimestampQueries.resize(first + 16);
+        glGenQueries(16, slot.TimestampQueries.data() + first);
+    }
+    return slot.TimestampsUsed++;
+}
+
+void GpuProfiler::BeginPass(const char* name) {
+    if (!m_Recording) {
+        return;
+    }
+
+    FrameSlot& slot = m_Slots[m_Current];
+    Scope scope;
+    scope.Name = name;
+    scope.Depth = static_cast<uint32_t>(m_OpenScopes.size());
+    scope.BeginQuery = AcquireTimestamp(slot);
+    scope.EndQuery = NoIndex;
+    scope.StatisticsBase = NoIndex;
+    glQueryCounter(slot.TimestampQueries[scope.BeginQuery], GL_TIMESTAMP);
+
+    // Pipeline statistics queries cannot nest, so only top-level passes get them
+    if (m_PipelineStatistics && scope.Depth == 0) {
+        if (slot.StatisticsUsed + GpuStatisticCount > slot.StatisticsQueries.size()) {
+            const size_t first = slot.StatisticsQueries.size();
+            slot.StatisticsQueries.resize(first + GpuStatisticCount * 4);
+            glGenQueries(GpuStatisticCount * 4, slot.StatisticsQueries.data() + first);
+        }
+        scope.StatisticsBase = slot.StatisticsUsed;
+        slot.StatisticsUsed += GpuStatisticCount;
+        for (uint32_t i = 0; i < GpuStatisticCount; i++) {
+            glBeginQuery(StatisticTargets[i], slot.StatisticsQueries[scope.StatisticsBase + i]);
+        }
+    }
+
+    slot.Scopes.push_back(scope);
+    m_OpenScopes.push_back(static_cast<uint32_t>(slot.Scopes.size() - 1));
+}
+
+void GpuProfiler::EndPass() {
+    if (!m_Recording || m_OpenScopes.empty()) {
+        return;
+    }
+
+    FrameSlot& slot = m_Slots[m_Current];
+    Scope& scope = slot.Scopes[m_OpenScopes.back()];
+    m_OpenScopes.pop_back();
+    if (scope.StatisticsBase != NoIndex) {
+        for (uint32_t i = 0; i < GpuStatisticCount; i++) {
+            glEndQuery(StatisticTargets[i]);
+        }
+    }
+    scope.EndQuery = AcquireTimestamp(slot);
+    glQueryCounter(slot.TimestampQueries[scope.EndQuery], GL_TIMESTAMP);
+}
+
+bool GpuProfiler::TryResolve(FrameSlot& slot) {
+    for (uint32_t i = 0; i < slot.TimestampsUsed; i++) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(slot.TimestampQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < slot.StatisticsUsed; i++) {
+        GLuint available = 0;
+        glGetQueryObjectuiv(slot.StatisticsQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return false;
+        }
+    }
+
+    // The frame leaving the history lends its storage, so steady state does not allocate
+    GpuFrameTimings frame;
+    if (m_History.size() >= HistoryFrames) {
+        frame = std::move(m_History.front());
+        m_History.pop_front();
+    }
+    frame.FrameIndex = slot.FrameIndex;
+    frame.TotalMs = 0.0f;
+    size_t passCount = 0;
+    for (const Scope& scope : slot.Scopes) {
+        if (scope.EndQuery == NoIndex) {
+            continue;
+        }
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(slot.TimestampQueries[scope.BeginQuery], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.TimestampQueries[scope.EndQuery], GL_QUERY_RESULT, &end);
+
+        if (passCount == frame.Passes.size()) {
+            frame.Passes.emplace_back();
+        }
+        GpuPassTiming& timing = frame.Passes[passCount++];
+        timing.Name.assign(scope.Name);
+        timing.Depth = scope.Depth;
+        timing.GpuMs = end > begin ? static_cast<float>(end - begin) / 1.0e6f : 0.0f;
+        timing.HasStatistics = scope.StatisticsBase != NoIndex;
+        std::fill(std::begin(timing.Statistics), std::end(timing.Statistics), 0);
+        if (timing.HasStatistics) {
+            for (uint32_t i = 0; i < GpuStatisticCount; i++) {
+                GLuint64 value = 0;
+                glGetQueryObjectui64v(slot.StatisticsQueries[scope.StatisticsBase + i], GL_QUERY_RESULT, &value);
+                timing.Statistics[i] = value;
+            }
+        }
+        if (timing.Depth == 0) {
+            frame.TotalMs += timing.GpuMs;
+        }
+    }
+    frame.Passes.resize(passCount);
+
+    slot.Pending = false;
+    m_Stats.ResolvedFrames++;
+    m_Latest = frame;
+    m_History.push_back(std::move(frame));
+    return true;
+}
+
+bool GpuProfiler::ExportCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        std::cout << "Warning: cannot write GPU profile to " << path << std::endl;
+        return false;
+    }
+
+    file << "frame,pass,depth,gpu_ms";
+    for (uint32_t i = 0; i < GpuStatisticCount; i++) {
+        file << ',' << GetStatisticName(static_cast<GpuStatistic>(i));
+    }
+    file << '\n';
+    for (const GpuFrameTimings& frame : m_History) {
+        for (const GpuPassTiming& pass : frame.Passes) {
+            file << frame.FrameIndex << ',' << pass.Name << ',' << pass.Depth << ',' << pass.GpuMs;
+            for (uint32_t i = 0; i < GpuStatisticCount; i++) {
+                file << ',';
+                if (pass.HasStatistics) {
+                    file << pass.Statistics[i];
+                }
+            }
+            file << '\n';
+        }
+    }
+    return static_cast<bool>(file);
+}
+
+const char* GpuProfiler::GetStatisticName(GpuStatistic statistic) {
+    switch (statistic) {
+    case GpuStatisticVertices: return "vertices";
+    case GpuStatisticPrimitives: return "primitives";
+    case GpuStatisticVertexInvocations: return "vs_invocations";
+    case GpuStatisticFragmentInvocations: return "fs_invocations";
+    case GpuStatisticClippingInput: return "clipping_input";
+    case GpuStatisticClippingOutput: return "clipping_output";
+    default: return "unknown";
+    }
+}
+
+} // namespace Henky3D
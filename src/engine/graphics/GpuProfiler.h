@@ -0,0 +1,110 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace Henky3D {
+
+// ARB_pipeline_statistics_query counters collected per top-level pass
+enum GpuStatistic : uint32_t {
+    GpuStatisticVertices = 0,
+    GpuStatisticPrimitives,
+    GpuStatisticVertexInvocations,
+    GpuStatisticFragmentInvocations,
+    GpuStatisticClippingInput,
+    GpuStatisticClippingOutput,
+    GpuStatisticCount
+};
+
+struct GpuPassTiming {
+    std::string Name;
+    uint32_t Depth = 0;            // Nesting level; statistics are only collected at depth 0
+    float GpuMs = 0.0f;
+    bool HasStatistics = false;
+    uint64_t Statistics[GpuStatisticCount] = {};
+};
+
+struct GpuFrameTimings {
+    uint64_t FrameIndex = 0;
+    float TotalMs = 0.0f;          // Sum of the top-level passes
+    std::vector<GpuPassTiming> Passes;
+};
+
+struct GpuProfilerStats {
+    uint64_t ResolvedFrames = 0;
+    uint64_t DroppedFrames = 0;    // Still in flight when their ring slot came around again
+};
+
+// GPU pass timing from GL_TIMESTAMP query pairs. Queries live in a ring of
+// Latency frames and are only read once GL_QUERY_RESULT_AVAILABLE says so, so
+// collecting results never waits on the GPU. Scopes may nest; top-level scopes
+// also record pipeline statistics when ARB_pipeline_statistics_query is present.
+class GpuProfiler {
+public:
+    static constexpr uint32_t Latency = 4;
+    static constexpr uint32_t HistoryFrames = 600; // Resolved frames kept for CSV export
+
+    GpuProfiler();
+    ~GpuProfiler();
+
+    // Render thread: resolve finished frames and start recording a new one
+    void BeginFrame();
+
+    // Names must outlive the frame's resolve (literals or Profiler::Intern)
+    void BeginPass(const char* name);
+    void EndPass();
+
+    bool IsEnabled() const { return m_Enabled; }
+    void SetEnabled(bool enabled) { m_Enabled = enabled; }
+    bool HasPipelineStatistics() const { return m_PipelineStatistics; }
+
+    // Most recent resolved frame, Latency or more frames old
+    const GpuFrameTimings& GetLatestFrame() const { return m_Latest; }
+    const std::deque<GpuFrameTimings>& GetHistory() const { return m_History; }
+    const GpuProfilerStats& GetStats() const { return m_Stats; }
+
+    // One row per pass and frame of the history; returns false if the file cannot be written
+    bool ExportCsv(const std::string& path) const;
+
+    static const char* GetStatisticName(GpuStatistic statistic);
+
+private:
+    struct Scope {
+        const char* Name;
+        uint32_t Depth;
+        uint32_t BeginQuery;       // Index into the slot's timestamp queries
+        uint32_t EndQuery;
+        uint32_t StatisticsBase;   // Index into the slot's statistics queries, or NoIndex
+    };
+
+    struct FrameSlot {
+        std::vector<Scope> Scopes;
+        std::vector<GLuint> TimestampQueries;
+        std::vector<GLuint> StatisticsQueries;
+        uint32_t TimestampsUsed = 0;
+        uint32_t StatisticsUsed = 0;
+        uint64_t FrameIndex = 0;
+        bool Pending = false;
+    };
+
+    static constexpr uint32_t NoIndex = 0xFFFFFFFFu;
+
+    uint32_t AcquireTimestamp(FrameSlot& slot);
+    bool TryResolve(FrameSlot& slot);
+
+    FrameSlot m_Slots[Latency];
+    uint32_t m_Current = 0;
+    uint64_t m_FrameIndex = 0;
+    std::vector<uint32_t> m_OpenScopes;
+    bool m_Enabled = true;
+    bool m_PipelineStatistics;
+    bool m_Recording = false;
+
+    GpuFrameTimings m_Latest;
+    std::deque<GpuFrameTimings> m_History;
+    GpuProfilerStats m_Stats;
+};
+
+} // namespace Henky3D
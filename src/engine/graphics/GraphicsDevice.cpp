@@ -1,21 +1,79 @@
 #include "GraphicsDevice.h"
 #include "../core/Window.h"
+#include "../core/Profiler.h"
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
 #include <iostream>
 
 namespace Henky3D {
 
 GraphicsDevice::GraphicsDevice(Window* window)
-    : m_Window(window->GetHandle()), m_Width(window->GetWidth()), m_Height(window->GetHeight()) {
+    : m_Window(window->GetHandle()), m_Width(window->GetWidth()), m_Height(window->GetHeight()),
+      m_Headless(window->IsHeadless()) {
     
     InitializeOpenGL();
+    if (m_Headless) {
+        CreateOffscreenTarget();
+        m_MaxQueuedFrames = MaxFramesInFlight;
+    }
     
     std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
     std::cout << "OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
 }
 
 GraphicsDevice::~GraphicsDevice() {
-    // OpenGL cleanup is handled by GLFW
+    ReleaseFrameFences();
+    DestroyOffscreenTarget();
+}
+
+void GraphicsDevice::ReleaseFrameFences() {
+    for (GLsync& fence : m_FrameFences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    m_FenceIndex = 0;
+    m_FenceCount = 0;
+}
+
+void GraphicsDevice::SetMaxQueuedFrames(uint32_t frames) {
+    frames = std::min(frames, MaxQueuedFramesLimit);
+    if (frames != m_MaxQueuedFrames) {
+        ReleaseFrameFences();
+        m_MaxQueuedFrames = frames;
+    }
+}
+
+void GraphicsDevice::CreateOffscreenTarget() {
+    glGenRenderbuffers(1, &m_OffscreenColor);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_OffscreenColor);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_Width, m_Height);
+    glGenRenderbuffers(1, &m_OffscreenDepth);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_OffscreenDepth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_Width, m_Height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &m_OffscreenFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_OffscreenFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_OffscreenColor);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_OffscreenDepth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("Offscreen framebuffer is incomplete");
+    }
+}
+
+void GraphicsDevice::DestroyOffscreenTarget() {
+    if (m_OffscreenFramebuffer) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &m_OffscreenFramebuffer);
+        glDeleteRenderbuffers(1, &m_OffscreenColor);
+        glDeleteRenderbuffers(1, &m_OffscreenDepth);
+        m_OffscreenFramebuffer = 0;
+        m_OffscreenColor = 0;
+        m_OffscreenDepth = 0;
+    }
 }
 
 void GraphicsDevice::InitializeOpenGL() {
@@ -43,12 +101,43 @@ void GraphicsDevice::InitializeOpenGL() {
 }
 
 void GraphicsDevice::BeginFrame() {
-    // Nothing special needed for OpenGL
+    glBindFramebuffer(GL_FRAMEBUFFER, m_OffscreenFramebuffer);
 }
 
 void GraphicsDevice::EndFrame() {
-    // Swap buffers
-    glfwSwapBuffers(m_Window);
+    if (!m_Headless) {
+        glfwSwapBuffers(m_Window);
+    }
+    m_LastPresentTime = std::chrono::steady_clock::now();
+    m_LastQueueWaitMs = 0.0f;
+    if (m_MaxQueuedFrames == 0) {
+        return;
+    }
+
+    // Headless there is no swap chain to pace us, and windowed the driver may queue
+    // several frames: wait until no more than m_MaxQueuedFrames are unfinished
+    m_FrameFences[(m_FenceIndex + m_FenceCount) % FenceRingSize] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_FenceCount++;
+    if (m_FenceCount > m_MaxQueuedFrames) {
+        HENKY_PROFILE_ZONE("GraphicsDevice::WaitForQueuedFrames");
+        const auto waitStart = std::chrono::steady_clock::now();
+        while (m_FenceCount > m_MaxQueuedFrames) {
+            GLsync& fence = m_FrameFences[m_FenceIndex];
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fence);
+            fence = nullptr;
+            m_FenceIndex = (m_FenceIndex + 1) % FenceRingSize;
+            m_FenceCount--;
+        }
+        m_LastQueueWaitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+    }
+}
+
+void GraphicsDevice::ReadBackBuffer(std::vector<uint8_t>& pixels) const {
+    pixels.resize(static_cast<size_t>(m_Width) * m_Height * 4);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_OffscreenFramebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
 }
 
 void GraphicsDevice::WaitForGPU() {
@@ -59,6 +148,10 @@ void GraphicsDevice::WaitForGPU() {
 void GraphicsDevice::ResizeBuffers(uint32_t width, uint32_t height) {
     m_Width = width;
     m_Height = height;
+    if (m_Headless) {
+        DestroyOffscreenTarget();
+        CreateOffscreenTarget();
+    }
     
     // Update viewport
     glViewport(0, 0, width, height);
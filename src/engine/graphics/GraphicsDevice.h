@@ -1,6 +1,7 @@
 #pragma once
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
 #include <memory>
 #include <vector>
 
@@ -11,6 +12,8 @@ class Window;
 class GraphicsDevice {
 public:
     static constexpr int FrameCount = 1; // OpenGL doesn't need double buffering like D3D12
+    static constexpr uint32_t MaxFramesInFlight = 2; // Headless throttling, in place of swap buffer pacing
+    static constexpr uint32_t MaxQueuedFramesLimit = 4;
     
     GraphicsDevice(Window* window);
     ~GraphicsDevice();
@@ -20,16 +23,46 @@ public:
     void WaitForGPU(); // No-op for OpenGL
     void ResizeBuffers(uint32_t width, uint32_t height);
 
+    // Framebuffer the scene renders into: 0 for a window, an offscreen FBO when headless
+    GLuint GetBackBuffer() const { return m_OffscreenFramebuffer; }
+    bool IsHeadless() const { return m_Headless; }
+    // RGBA8 pixels of the back buffer, bottom row first
+    void ReadBackBuffer(std::vector<uint8_t>& pixels) const;
+
+    // EndFrame waits until at most this many frames are still running on the GPU, so the
+    // CPU cannot run ahead and queue up latency. 0 leaves it to the driver (windowed default).
+    void SetMaxQueuedFrames(uint32_t frames);
+    uint32_t GetMaxQueuedFrames() const { return m_MaxQueuedFrames; }
+    float GetLastQueueWaitMs() const { return m_LastQueueWaitMs; }
+    // When the last swap returned, before any queue throttling
+    std::chrono::steady_clock::time_point GetLastPresentTime() const { return m_LastPresentTime; }
+
     GLFWwindow* GetWindow() const { return m_Window; }
     uint32_t GetWidth() const { return m_Width; }
     uint32_t GetHeight() const { return m_Height; }
 
 private:
     void InitializeOpenGL();
+    void CreateOffscreenTarget();
+    void DestroyOffscreenTarget();
 
     GLFWwindow* m_Window;
     uint32_t m_Width;
     uint32_t m_Height;
+    bool m_Headless;
+    GLuint m_OffscreenFramebuffer = 0;
+    GLuint m_OffscreenColor = 0;
+    GLuint m_OffscreenDepth = 0;
+    void ReleaseFrameFences();
+
+    // The new frame's fence goes in before the wait, so the ring holds one more than the limit
+    static constexpr uint32_t FenceRingSize = MaxQueuedFramesLimit + 1;
+    GLsync m_FrameFences[FenceRingSize] = {};          // Ring of the frames in flight, oldest at m_FenceIndex
+    uint32_t m_FenceIndex = 0;
+    uint32_t m_FenceCount = 0;
+    uint32_t m_MaxQueuedFrames = 0;
+    float m_LastQueueWaitMs = 0.0f;
+    std::chrono::steady_clock::time_point m_LastPresentTime;
 };
 
 } // namespace Henky3D
@@ -0,0 +1,238 @@
+#include "Ktx2.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Henky3D {
+
+namespace {
+
+constexpr uint8_t Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+constexpr size_t HeaderSize = 80;       // Identifier + header + index
+constexpr size_t LevelEntrySize = 24;   // byteOffset, byteLength, uncompressedByteLength
+
+// Khronos data format descriptor values used by the basic descriptor block
+constexpr uint8_t ModelRGBSDA = 1;
+constexpr uint8_t ModelBC1A = 128;
+constexpr uint8_t ModelBC3 = 130;
+constexpr uint8_t ModelBC5 = 132;
+constexpr uint8_t ModelBC7 = 134;
+constexpr uint8_t PrimariesBT709 = 1;
+constexpr uint8_t TransferLinear = 1;
+
+uint32_t ReadU32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint64_t ReadU64(const uint8_t* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+void AppendU8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+void AppendU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+void WriteU32At(std::vector<uint8_t>& out, size_t offset, uint32_t value) {
+    std::memcpy(out.data() + offset, &value, sizeof(value));
+}
+
+void WriteU64At(std::vector<uint8_t>& out, size_t offset, uint64_t value) {
+    std::memcpy(out.data() + offset, &value, sizeof(value));
+}
+
+void AlignTo(std::vector<uint8_t>& out, size_t alignment) {
+    while (out.size() % alignment != 0) {
+        out.push_back(0);
+    }
+}
+
+struct DfdSample {
+    uint16_t BitOffset;
+    uint8_t BitLength;   // Stored as length - 1
+    uint8_t ChannelType;
+    uint32_t Upper;
+};
+
+// Basic data format descriptor block for the formats the cook step emits
+void AppendDataFormatDescriptor(std::vector<uint8_t>& out, uint32_t vkFormat) {
+    uint8_t model = ModelRGBSDA;
+    uint8_t blockDimension = 0;
+    uint8_t bytesPlane0 = 4;
+    std::vector<DfdSample> samples;
+
+    switch (vkFormat) {
+        case Ktx2::VkFormatBC1RGBUnorm:
+            model = ModelBC1A; blockDimension = 3; bytesPlane0 = 8;
+            samples = { { 0, 63, 0, 0xFFFFFFFFu } };
+            break;
+        case Ktx2::VkFormatBC3Unorm:
+            model = ModelBC3; blockDimension = 3; bytesPlane0 = 16;
+            samples = { { 0, 63, 15, 0xFFFFFFFFu }, { 64, 63, 0, 0xFFFFFFFFu } };
+            break;
+        case Ktx2::VkFormatBC5Unorm:
+            model = ModelBC5; blockDimension = 3; bytesPlane0 = 16;
+            samples = { { 0, 63, 0, 0xFFFFFFFFu }, { 64, 63, 1, 0xFFFFFFFFu } };
+            break;
+        case Ktx2::VkFormatBC7Unorm:
+            model = ModelBC7; blockDimension = 3; bytesPlane0 = 16;
+            samples = { { 0, 127, 0, 0xFFFFFFFFu } };
+            break;
+        default:
+            samples = { { 0, 7, 0, 255 }, { 8, 7, 1, 255 }, { 16, 7, 2, 255 }, { 24, 7, 15, 255 } };
+            break;
+    }
+
+    const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+    AppendU32(out, 4 + blockSize);            // dfdTotalSize
+    AppendU32(out, 0);                        // vendorId = Khronos, descriptorType = basic
+    AppendU32(out, 2u | (blockSize << 16));   // versionNumber, descriptorBlockSize
+    AppendU8(out, model);
+    AppendU8(out, PrimariesBT709);
+    AppendU8(out, TransferLinear);
+    AppendU8(out, 0);                         // flags: straight alpha
+    for (int i = 0; i < 4; i++) {
+        AppendU8(out, i < 2 ? blockDimension : 0);
+    }
+    AppendU8(out, bytesPlane0);
+    for (int i = 1; i < 8; i++) {
+        AppendU8(out, 0);
+    }
+    for (const auto& sample : samples) {
+        AppendU32(out, static_cast<uint32_t>(sample.BitOffset) | (static_cast<uint32_t>(sample.BitLength) << 16) |
+                       (static_cast<uint32_t>(sample.ChannelType) << 24));
+        AppendU32(out, 0);                    // samplePosition
+        AppendU32(out, 0);                    // sampleLower
+        AppendU32(out, sample.Upper);
+    }
+}
+
+} // namespace
+
+bool Ktx2::IsKtx2(const uint8_t* data, size_t size) {
+    return size >= sizeof(Identifier) && std::memcmp(data, Identifier, sizeof(Identifier)) == 0;
+}
+
+bool Ktx2::ParseHeader(const uint8_t* data, size_t size, Header& header, size_t fileSize) {
+    if (size < HeaderSize || !IsKtx2(data, size)) {
+        return false;
+    }
+    if (fileSize == 0) {
+        fileSize = size;
+    }
+
+    header.VkFormat = ReadU32(data + 12);
+    header.Width = ReadU32(data + 20);
+    header.Height = ReadU32(data + 24);
+    uint32_t depth = ReadU32(data + 28);
+    uint32_t layerCount = ReadU32(data + 32);
+    uint32_t faceCount = ReadU32(data + 36);
+    uint32_t levelCount = std::max(1u, ReadU32(data + 40));
+    uint32_t supercompression = ReadU32(data + 44);
+
+    if (header.Width == 0 || header.Height == 0 || depth > 1 || layerCount > 1 || faceCount != 1 || supercompression != 0) {
+        return false;
+    }
+    if (levelCount > 32 || size < HeaderSize + levelCount * LevelEntrySize) {
+        return false;
+    }
+
+    header.Levels.resize(levelCount);
+    for (uint32_t i = 0; i < levelCount; i++) {
+        const uint8_t* entry = data + HeaderSize + i * LevelEntrySize;
+        Level& level = header.Levels[i];
+        level.Offset = ReadU64(entry);
+        level.Length = ReadU64(entry + 8);
+        level.Width = std::max(1u, header.Width >> i);
+        level.Height = std::max(1u, header.Height >> i);
+        if (level.Length == 0 || level.Offset > fileSize || level.Length > fileSize - level.Offset) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::vector<uint8_t> Ktx2::Write(uint32_t vkFormat, uint32_t width, uint32_t height,
+                                 const std::vector<std::vector<uint8_t>>& levels) {
+    const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+    std::vector<uint8_t> out(HeaderSize + levelCount * LevelEntrySize, 0);
+
+    std::memcpy(out.data(), Identifier, sizeof(Identifier));
+    WriteU32At(out, 12, vkFormat);
+    WriteU32At(out, 16, 1);          // typeSize
+    WriteU32At(out, 20, width);
+    WriteU32At(out, 24, height);
+    WriteU32At(out, 28, 0);          // pixelDepth
+    WriteU32At(out, 32, 0);          // layerCount
+    WriteU32At(out, 36, 1);          // faceCount
+    WriteU32At(out, 40, levelCount);
+    WriteU32At(out, 44, 0);          // supercompressionScheme
+
+    // Data format descriptor follows the level index
+    const size_t dfdOffset = out.size();
+    AppendDataFormatDescriptor(out, vkFormat);
+    WriteU32At(out, 48, static_cast<uint32_t>(dfdOffset));
+    WriteU32At(out, 52, static_cast<uint32_t>(out.size() - dfdOffset));
+
+    // Mip data is stored smallest level first, each level 16-byte aligned
+    for (uint32_t i = levelCount; i-- > 0;) {
+        AlignTo(out, 16);
+        const size_t entry = HeaderSize + i * LevelEntrySize;
+        WriteU64At(out, entry, out.size());
+        WriteU64At(out, entry + 8, levels[i].size());
+        WriteU64At(out, entry + 16, levels[i].size());
+        out.insert(out.end(), levels[i].begin(), levels[i].end());
+    }
+
+    return out;
+}
+
+uint32_t Ktx2::GetVkFormat(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return VkFormatBC1RGBUnorm;
+        case BlockFormat::BC3: return VkFormatBC3Unorm;
+        case BlockFormat::BC5: return VkFormatBC5Unorm;
+        case BlockFormat::BC7: return VkFormatBC7Unorm;
+    }
+    return VkFormatBC7Unorm;
+}
+
+bool Ktx2::GetGLFormat(uint32_t vkFormat, GLenum& internalFormat, bool& compressed, uint32_t& blockBytes) {
+    compressed = true;
+    switch (vkFormat) {
+        case VkFormatBC1RGBUnorm:
+            internalFormat = TextureCompression::GetGLInternalFormat(BlockFormat::BC1);
+            blockBytes = 8;
+            return true;
+        case VkFormatBC3Unorm:
+            internalFormat = TextureCompression::GetGLInternalFormat(BlockFormat::BC3);
+            blockBytes = 16;
+            return true;
+        case VkFormatBC5Unorm:
+            internalFormat = TextureCompression::GetGLInternalFormat(BlockFormat::BC5);
+            blockBytes = 16;
+            return true;
+        case VkFormatBC7Unorm:
+            internalFormat = TextureCompression::GetGLInternalFormat(BlockFormat::BC7);
+            blockBytes = 16;
+            return true;
+        case VkFormatR8G8B8A8Unorm:
+            internalFormat = GL_RGBA8;
+            compressed = false;
+            blockBytes = 4;
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace Henky3D
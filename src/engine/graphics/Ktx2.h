@@ -0,0 +1,54 @@
+#pragma once
+#include "TextureCompression.h"
+#include <glad/gl.h>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Henky3D {
+
+// Minimal KTX2 container support: single 2D image, no supercompression
+class Ktx2 {
+public:
+    // Vulkan format identifiers stored in the KTX2 header
+    static constexpr uint32_t VkFormatR8G8B8A8Unorm = 37;
+    static constexpr uint32_t VkFormatBC1RGBUnorm = 131;
+    static constexpr uint32_t VkFormatBC3Unorm = 137;
+    static constexpr uint32_t VkFormatBC5Unorm = 141;
+    static constexpr uint32_t VkFormatBC7Unorm = 145;
+
+    struct Level {
+        uint64_t Offset = 0; // Byte offset from the start of the file
+        uint64_t Length = 0;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+    };
+
+    struct Header {
+        uint32_t VkFormat = 0;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+        std::vector<Level> Levels; // Level 0 is the largest
+    };
+
+    static bool IsKtx2(const uint8_t* data, size_t size);
+
+    // Bytes needed to parse the header and level index (levelCount from the header)
+    static constexpr size_t GetHeaderSize(uint32_t levelCount) { return 80 + static_cast<size_t>(levelCount) * 24; }
+
+    // Validate the header and level index; levels must lie inside [0, fileSize).
+    // data may hold only the header region when fileSize is given.
+    static bool ParseHeader(const uint8_t* data, size_t size, Header& header, size_t fileSize = 0);
+
+    // Serialize pre-encoded levels (largest first) into a KTX2 file image
+    static std::vector<uint8_t> Write(uint32_t vkFormat, uint32_t width, uint32_t height,
+                                      const std::vector<std::vector<uint8_t>>& levels);
+
+    static uint32_t GetVkFormat(BlockFormat format);
+
+    // GL upload parameters for a KTX2 format; returns false for unsupported formats
+    static bool GetGLFormat(uint32_t vkFormat, GLenum& internalFormat, bool& compressed, uint32_t& blockBytes);
+};
+
+} // namespace Henky3D
@@ -0,0 +1,270 @@
+#include "LightClusters.h"
+#include "../core/JobSystem.h"
+#include "../core/Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define HENKY_CLUSTER_SSE2 1
+#endif
+
+namespace Henky3D {
+
+namespace {
+
+// Bounds of padding lanes; no light can reach them
+constexpr float EmptyBound = 1e30f;
+
+} // namespace
+
+LightClusters::LightClusters(JobSystem* jobSystem, const LightClusterSettings& settings)
+    : m_JobSystem(jobSystem), m_Settings(settings) {
+    const uint32_t clusterCount = m_Settings.TilesX * m_Settings.TilesY * m_Settings.Slices;
+    m_Grid.resize(clusterCount, glm::uvec2(0));
+    m_ClusterLights.resize(clusterCount);
+    m_SliceStride = (m_Settings.TilesX * m_Settings.TilesY + 3) & ~3u;
+    m_Stats.ClusterCount = clusterCount;
+
+    glGenBuffers(1, &m_GridBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_GridBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, clusterCount * sizeof(glm::uvec2), nullptr, GL_DYNAMIC_DRAW);
+
+    m_IndexCapacity = 1024;
+    glGenBuffers(1, &m_IndexBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_IndexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_IndexCapacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+LightClusters::~LightClusters() {
+    if (m_GridBuffer) glDeleteBuffers(1, &m_GridBuffer);
+    if (m_IndexBuffer) glDeleteBuffers(1, &m_IndexBuffer);
+}
+
+void LightClusters::UpdateClusterBounds(const glm::mat4& projection) {
+    m_Projection = projection;
+
+    // Planes of a GL perspective projection
+    m_NearPlane = projection[3][2] / (projection[2][2] - 1.0f);
+    m_FarPlane = projection[3][2] / (projection[2][2] + 1.0f);
+
+    const uint32_t slices = m_Settings.Slices;
+    m_SliceNear.resize(slices + 1);
+    for (uint32_t s = 0; s <= slices; s++) {
+        m_SliceNear[s] = m_NearPlane * std::pow(m_FarPlane / m_NearPlane, static_cast<float>(s) / slices);
+    }
+
+    const size_t count = static_cast<size_t>(m_SliceStride) * slices;
+    for (std::vector<float>* lane : { &m_MinX, &m_MinY, &m_MinZ, &m_CenterX, &m_CenterY, &m_CenterZ }) {
+        lane->assign(count, EmptyBound);
+    }
+    for (std::vector<float>* lane : { &m_MaxX, &m_MaxY, &m_MaxZ, &m_Radius }) {
+        lane->assign(count, -EmptyBound);
+    }
+
+    // View-space x at depth z is ndc * z / P[0][0]; boxes cover both ends of the slice
+    const float invScaleX = 1.0f / projection[0][0];
+    const float invScaleY = 1.0f / projection[1][1];
+    for (uint32_t s = 0; s < slices; s++) {
+        const float zNear = m_SliceNear[s];
+        const float zFar = m_SliceNear[s + 1];
+        for (uint32_t y = 0; y < m_Settings.TilesY; y++) {
+            const float ndcY0 = -1.0f + 2.0f * y / m_Settings.TilesY;
+            const float ndcY1 = -1.0f + 2.0f * (y + 1) / m_Settings.TilesY;
+            for (uint32_t x = 0; x < m_Settings.TilesX; x++) {
+                const float ndcX0 = -1.0f + 2.0f * x / m_Settings.TilesX;
+                const float ndcX1 = -1.0f + 2.0f * (x + 1) / m_Settings.TilesX;
+
+                glm::vec3 boxMin;
+                glm::vec3 boxMax;
+                boxMin.x = std::min(ndcX0 * zNear, ndcX0 * zFar) * invScaleX;
+                boxMax.x = std::max(ndcX1 * zNear, ndcX1 * zFar) * invScaleX;
+                boxMin.y = std::min(ndcY0 * zNear, ndcY0 * zFar) * invScaleY;
+                boxMax.y = std::max(ndcY1 * zNear, ndcY1 * zFar) * invScaleY;
+                boxMin.z = -zFar;
+                boxMax.z = -zNear;
+
+                const size_t i = static_cast<size_t>(s) * m_SliceStride + y * m_Settings.TilesX + x;
+                const glm::vec3 center = (boxMin + boxMax) * 0.5f;
+                m_MinX[i] = boxMin.x; m_MinY[i] = boxMin.y; m_MinZ[i] = boxMin.z;
+                m_MaxX[i] = boxMax.x; m_MaxY[i] = boxMax.y; m_MaxZ[i] = boxMax.z;
+                m_CenterX[i] = center.x; m_CenterY[i] = center.y; m_CenterZ[i] = center.z;
+                m_Radius[i] = glm::length(boxMax - center);
+            }
+        }
+    }
+}
+
+void LightClusters::Build(const std::vector<LocalLightConstants>& lights, const glm::mat4& view, const glm::mat4& projection) {
+    HENKY_PROFILE_ZONE("LightClusters::Build");
+    auto startTime = std::chrono::steady_clock::now();
+
+    if (projection != m_Projection) {
+        UpdateClusterBounds(projection);
+    }
+
+    m_ViewLights.resize(lights.size());
+    for (size_t i = 0; i < lights.size(); i++) {
+        const LocalLightConstants& light = lights[i];
+        ViewLight& viewLight = m_ViewLights[i];
+        viewLight.Position = glm::vec3(view * glm::vec4(glm::vec3(light.PositionRange), 1.0f));
+        viewLight.Range = light.PositionRange.w;
+        viewLight.Direction = glm::vec3(view * glm::vec4(glm::vec3(light.DirectionCone), 0.0f));
+        viewLight.CosOuter = light.DirectionCone.w;
+        viewLight.SinOuter = std::sqrt(std::max(0.0f, 1.0f - viewLight.CosOuter * viewLight.CosOuter));
+        viewLight.Spot = light.Type == LocalLightSpot;
+        viewLight.NearDepth = -viewLight.Position.z - viewLight.Range;
+        viewLight.FarDepth = -viewLight.Position.z + viewLight.Range;
+    }
+
+    // Slices touch disjoint clusters, so every job writes its own lists
+    m_JobSystem->ParallelFor(m_Settings.Slices, m_Settings.SlicesPerJob, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t slice = begin; slice < end; slice++) {
+            BinSlice(slice);
+        }
+    });
+
+    // Flatten in cluster order
+    m_Indices.clear();
+    uint32_t maxLights = 0;
+    for (size_t i = 0; i < m_ClusterLights.size(); i++) {
+        const std::vector<uint32_t>& clusterLights = m_ClusterLights[i];
+        m_Grid[i] = glm::uvec2(static_cast<uint32_t>(m_Indices.size()), static_cast<uint32_t>(clusterLights.size()));
+        m_Indices.insert(m_Indices.end(), clusterLights.begin(), clusterLights.end());
+        maxLights = std::max(maxLights, static_cast<uint32_t>(clusterLights.size()));
+    }
+
+    m_Stats.LightCount = static_cast<uint32_t>(lights.size());
+    m_Stats.IndexCount = static_cast<uint32_t>(m_Indices.size());
+    m_Stats.MaxLightsPerCluster = maxLights;
+    m_Stats.AverageLightsPerCluster = static_cast<float>(m_Indices.size()) / static_cast<float>(m_Stats.ClusterCount);
+    m_Stats.BinningTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_GridBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_Grid.size() * sizeof(glm::uvec2), m_Grid.data());
+
+    if (m_Indices.size() > m_IndexCapacity) {
+        while (m_IndexCapacity < m_Indices.size()) {
+            m_IndexCapacity *= 2;
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_IndexBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_IndexCapacity * sizeof(uint32_t), nullptr, GL_DYNAMIC_DRAW);
+    }
+    if (!m_Indices.empty()) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_IndexBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_Indices.size() * sizeof(uint32_t), m_Indices.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void LightClusters::BinSlice(uint32_t slice) {
+    HENKY_PROFILE_ZONE("LightClusters::BinSlice");
+    const uint32_t tileCount = m_Settings.TilesX * m_Settings.TilesY;
+    const size_t boundsBase = static_cast<size_t>(slice) * m_SliceStride;
+    const size_t clusterBase = static_cast<size_t>(slice) * tileCount;
+    for (uint32_t t = 0; t < tileCount; t++) {
+        m_ClusterLights[clusterBase + t].clear();
+    }
+
+    const float sliceNear = m_SliceNear[slice];
+    const float sliceFar = m_SliceNear[slice + 1];
+    for (uint32_t lightIndex = 0; lightIndex < m_ViewLights.size(); lightIndex++) {
+        const ViewLight& light = m_ViewLights[lightIndex];
+        if (light.FarDepth < sliceNear || light.NearDepth > sliceFar) {
+            continue;
+        }
+        const float rangeSq = light.Range * light.Range;
+
+#ifdef HENKY_CLUSTER_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 px = _mm_set1_ps(light.Position.x);
+        const __m128 py = _mm_set1_ps(light.Position.y);
+        const __m128 pz = _mm_set1_ps(light.Position.z);
+        const __m128 range = _mm_set1_ps(light.Range);
+        const __m128 rangeSq4 = _mm_set1_ps(rangeSq);
+        const __m128 dx = _mm_set1_ps(light.Direction.x);
+        const __m128 dy = _mm_set1_ps(light.Direction.y);
+        const __m128 dz = _mm_set1_ps(light.Direction.z);
+        const __m128 cosOuter = _mm_set1_ps(light.CosOuter);
+        const __m128 sinOuter = _mm_set1_ps(light.SinOuter);
+
+        for (uint32_t t = 0; t < tileCount; t += 4) {
+            const size_t i = boundsBase + t;
+
+            // Squared distance from the light to the cluster box
+            __m128 ex = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinX[i]), px), zero),
+                                   _mm_max_ps(_mm_sub_ps(px, _mm_loadu_ps(&m_MaxX[i])), zero));
+            __m128 ey = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinY[i]), py), zero),
+                                   _mm_max_ps(_mm_sub_ps(py, _mm_loadu_ps(&m_MaxY[i])), zero));
+            __m128 ez = _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_MinZ[i]), pz), zero),
+                                   _mm_max_ps(_mm_sub_ps(pz, _mm_loadu_ps(&m_MaxZ[i])), zero));
+            __m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez));
+            __m128 hit = _mm_cmple_ps(distSq, rangeSq4);
+
+            if (light.Spot && _mm_movemask_ps(hit)) {
+                // Cone against the cluster's bounding sphere: outside the cone angle, past the range or behind the apex
+                __m128 radius = _mm_loadu_ps(&m_Radius[i]);
+                __m128 vx = _mm_sub_ps(_mm_loadu_ps(&m_CenterX[i]), px);
+                __m128 vy = _mm_sub_ps(_mm_loadu_ps(&m_CenterY[i]), py);
+                __m128 vz = _mm_sub_ps(_mm_loadu_ps(&m_CenterZ[i]), pz);
+                __m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+                __m128 axial = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, dx), _mm_mul_ps(vy, dy)), _mm_mul_ps(vz, dz));
+                __m128 lateral = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(lenSq, _mm_mul_ps(axial, axial)), zero));
+                __m128 closest = _mm_sub_ps(_mm_mul_ps(cosOuter, lateral), _mm_mul_ps(axial, sinOuter));
+                __m128 inAngle = _mm_cmple_ps(closest, radius);
+                __m128 inFront = _mm_cmple_ps(axial, _mm_add_ps(radius, range));
+                __m128 inBack = _mm_cmpge_ps(axial, _mm_sub_ps(zero, radius));
+                hit = _mm_and_ps(hit, _mm_and_ps(inAngle, _mm_and_ps(inFront, inBack)));
+            }
+
+            const int mask = _mm_movemask_ps(hit);
+            for (uint32_t lane = 0; mask && lane < 4; lane++) {
+                if (mask & (1 << lane)) {
+                    m_ClusterLights[clusterBase + t + lane].push_back(lightIndex);
+                }
+            }
+        }
+#else
+        for (uint32_t t = 0; t < tileCount; t++) {
+            const size_t i = boundsBase + t;
+            const glm::vec3 boxMin(m_MinX[i], m_MinY[i], m_MinZ[i]);
+            const glm::vec3 boxMax(m_MaxX[i], m_MaxY[i], m_MaxZ[i]);
+            const glm::vec3 excess = glm::max(boxMin - light.Position, glm::vec3(0.0f)) +
+                                     glm::max(light.Position - boxMax, glm::vec3(0.0f));
+            if (glm::dot(excess, excess) > rangeSq) {
+                continue;
+            }
+            if (light.Spot) {
+                const glm::vec3 toCenter = glm::vec3(m_CenterX[i], m_CenterY[i], m_CenterZ[i]) - light.Position;
+                const float radius = m_Radius[i];
+                const float axial = glm::dot(toCenter, light.Direction);
+                const float lateral = std::sqrt(std::max(0.0f, glm::dot(toCenter, toCenter) - axial * axial));
+                const float closest = light.CosOuter * lateral - axial * light.SinOuter;
+                if (closest > radius || axial > radius + light.Range || axial < -radius) {
+                    continue;
+                }
+            }
+            m_ClusterLights[clusterBase + t].push_back(lightIndex);
+        }
+#endif
+    }
+}
+
+void LightClusters::Bind() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, GridBinding, m_GridBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, IndexBinding, m_IndexBuffer);
+}
+
+void LightClusters::WriteConstants(PerFrameConstants& constants, uint32_t viewportWidth, uint32_t viewportHeight) const {
+    // slice = log(depth) * scale + bias, the inverse of the exponential split in UpdateClusterBounds
+    const float logDepthRange = std::log(m_FarPlane / m_NearPlane);
+    const float sliceScale = static_cast<float>(m_Settings.Slices) / logDepthRange;
+    constants.ClusterGrid = glm::uvec4(m_Settings.TilesX, m_Settings.TilesY, m_Settings.Slices, 0);
+    constants.ClusterParams = glm::vec4(sliceScale, -std::log(m_NearPlane) * sliceScale,
+                                        1.0f / static_cast<float>(std::max(viewportWidth, 1u)),
+                                        1.0f / static_cast<float>(std::max(viewportHeight, 1u)));
+}
+
+} // namespace Henky3D
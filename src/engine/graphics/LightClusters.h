@@ -0,0 +1,91 @@
+#pragma once
+#include "ConstantBuffers.h"
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace Henky3D {
+
+class JobSystem;
+
+struct LightClusterSettings {
+    uint32_t TilesX = 16;
+    uint32_t TilesY = 9;
+    uint32_t Slices = 24;          // Exponential depth slices between the near and far planes
+    uint32_t SlicesPerJob = 1;     // Binning batch size on the job system
+};
+
+struct LightClusterStats {
+    uint32_t ClusterCount = 0;
+    uint32_t LightCount = 0;
+    uint32_t IndexCount = 0;       // Light references across all clusters
+    uint32_t MaxLightsPerCluster = 0;
+    float AverageLightsPerCluster = 0.0f;
+    float BinningTimeMs = 0.0f;    // CPU time of the parallel binning, upload excluded
+};
+
+// Splits the view frustum into froxels (screen tiles x exponential depth slices)
+// and bins point and spot lights into them on the CPU. Depth slices are binned
+// in parallel on the job system; each job tests four clusters at a time against
+// a light with SSE2 (sphere vs cluster box, then cone vs cluster sphere for spot
+// lights). The result is a compact light index list plus an offset/count pair
+// per cluster, uploaded to SSBOs the forward pass walks per fragment.
+class LightClusters {
+public:
+    static constexpr GLuint GridBinding = 5;
+    static constexpr GLuint IndexBinding = 6;
+
+    LightClusters(JobSystem* jobSystem, const LightClusterSettings& settings = {});
+    ~LightClusters();
+
+    // Render thread, after the local lights are gathered for the frame
+    void Build(const std::vector<LocalLightConstants>& lights, const glm::mat4& view, const glm::mat4& projection);
+    void Bind() const;
+
+    // Grid size and slice mapping for the shaders
+    void WriteConstants(PerFrameConstants& constants, uint32_t viewportWidth, uint32_t viewportHeight) const;
+
+    const LightClusterSettings& GetSettings() const { return m_Settings; }
+    const LightClusterStats& GetStats() const { return m_Stats; }
+
+private:
+    // View-space light with its depth range, shared by every binning job
+    struct ViewLight {
+        glm::vec3 Position;
+        float Range;
+        glm::vec3 Direction;
+        float CosOuter;
+        float SinOuter;
+        bool Spot;
+        float NearDepth;           // Positive view depths covered by the bounding sphere
+        float FarDepth;
+    };
+
+    void UpdateClusterBounds(const glm::mat4& projection);
+    void BinSlice(uint32_t slice);
+
+    JobSystem* m_JobSystem;
+    LightClusterSettings m_Settings;
+    LightClusterStats m_Stats;
+
+    // Cluster bounds in view space, structure of arrays padded to groups of four per slice
+    glm::mat4 m_Projection = glm::mat4(0.0f);
+    float m_NearPlane = 0.1f;
+    float m_FarPlane = 1000.0f;
+    uint32_t m_SliceStride = 0;
+    std::vector<float> m_MinX, m_MinY, m_MinZ;
+    std::vector<float> m_MaxX, m_MaxY, m_MaxZ;
+    std::vector<float> m_CenterX, m_CenterY, m_CenterZ, m_Radius;
+    std::vector<float> m_SliceNear; // Positive view depth of each slice boundary, Slices + 1 entries
+
+    std::vector<ViewLight> m_ViewLights;
+    std::vector<std::vector<uint32_t>> m_ClusterLights; // Per cluster; each slice is written by one job
+    std::vector<glm::uvec2> m_Grid;                    // Offset and count per cluster
+    std::vector<uint32_t> m_Indices;
+
+    GLuint m_GridBuffer = 0;
+    GLuint m_IndexBuffer = 0;
+    uint32_t m_IndexCapacity = 0;
+};
+
+} // namespace Henky3D
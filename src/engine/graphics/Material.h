@@ -1,4 +1,5 @@
 #pragma once
+#include "../core/AssetId.h"
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <string>
@@ -6,20 +7,49 @@
 
 namespace Henky3D {
 
-// Handle for texture resources
+// Generational handle for texture resources; a handle whose slot was evicted
+// and reused no longer resolves
 struct TextureHandle {
-    uint32_t Index = 0xFFFFFFFF; // Index into texture registry
+    uint32_t Index = 0xFFFFFFFF; // Slot in the texture registry
+    uint32_t Generation = 0;     // Must match the slot's generation
     bool IsValid() const { return Index != 0xFFFFFFFF; }
+    bool operator==(const TextureHandle& other) const { return Index == other.Index && Generation == other.Generation; }
+    bool operator!=(const TextureHandle& other) const { return !(*this == other); }
+};
+
+// Streaming state of a texture asset
+enum class TextureState {
+    Loading,  // Decode or upload still in flight
+    Resident, // GL texture holds at least the coarse mip tail
+    Failed    // Load failed, placeholder stays bound
 };
 
 // Texture asset with OpenGL texture
 struct TextureAsset {
+    static constexpr uint32_t NoPendingMip = 0xFFFFFFFF;
+
     std::wstring Path;
+    AssetId Id = InvalidAssetId; // Hash of Path, the cache key
     GLuint Texture = 0;
-    uint32_t Width = 0;
+    uint32_t Width = 0;      // Full-resolution size of mip 0
     uint32_t Height = 0;
+    uint32_t MipLevels = 1;  // Length of the full mip chain
     GLenum Format = GL_RGBA8;
+    size_t VramBytes = 0;    // GPU memory held by the resident mip levels
     bool IsDefault = false; // True for fallback textures
+    TextureState State = TextureState::Resident;
+    TextureHandle Placeholder; // Returned by lookups until the texture is resident
+
+    // Registry bookkeeping: unreferenced assets may be evicted to meet the memory budget
+    uint32_t Generation = 0;
+    uint32_t RefCount = 0;
+
+    // Mip residency: the GL texture holds levels [ResidentMip, MipLevels)
+    uint32_t ResidentMip = 0;
+    uint32_t PendingMip = NoPendingMip; // Finest level of an in-flight streaming request
+    uint32_t DesiredMip = 0;            // Finest level wanted by visible entities
+    float StreamingPriority = 0.0f;     // Largest on-screen size in pixels among its users
+    uint64_t LastUsedFrame = 0;
 };
 
 // Material asset with PBR parameters
@@ -0,0 +1,287 @@
+#include "MaterialTable.h"
+#include "AssetRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace Henky3D {
+
+MaterialTable::MaterialTable(AssetRegistry* registry, const MaterialTableSettings& settings)
+    : m_Registry(registry), m_Settings(settings), m_Bindless(GLAD_GL_ARB_bindless_texture != 0) {
+    m_Stats.Bindless = m_Bindless;
+    EnsureCapacity(16);
+
+    if (!m_Bindless) {
+        std::cout << "Warning: ARB_bindless_texture not supported, material textures use a "
+                  << m_Settings.FallbackLayerSize << "x" << m_Settings.FallbackLayerSize << " texture array" << std::endl;
+        CreateFallbackArray();
+    }
+
+    // Streamed textures swap their GL storage; drop handles before the old one goes away
+    m_Registry->GetTextureStreamer()->SetReleaseCallback([this](GLuint texture) {
+        OnTextureReleased(texture);
+    });
+}
+
+MaterialTable::~MaterialTable() {
+    m_Registry->GetTextureStreamer()->SetReleaseCallback(nullptr);
+
+    for (const auto& [texture, handle] : m_Handles) {
+        glMakeTextureHandleNonResidentARB(handle);
+    }
+    if (m_Buffer) glDeleteBuffers(1, &m_Buffer);
+    if (m_TextureArray) glDeleteTextures(1, &m_TextureArray);
+    if (m_CopyFramebuffer) glDeleteFramebuffers(1, &m_CopyFramebuffer);
+    if (m_CopyVAO) glDeleteVertexArrays(1, &m_CopyVAO);
+}
+
+void MaterialTable::CreateFallbackArray() {
+    const uint32_t size = m_Settings.FallbackLayerSize;
+    uint32_t mipLevels = 1;
+    while ((size >> mipLevels) > 0) {
+        mipLevels++;
+    }
+
+    glGenTextures(1, &m_TextureArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureArray);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipLevels, GL_RGBA8, size, size, m_Settings.FallbackLayerCount);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    glGenFramebuffers(1, &m_CopyFramebuffer);
+    glGenVertexArrays(1, &m_CopyVAO);
+    m_LayerSources.assign(m_Settings.FallbackLayerCount, 0);
+
+    // Layer 0 holds the default white texture and doubles as the overflow layer
+    m_Layers[m_Registry->GetDefaultWhiteTexture().Index] = 0;
+}
+
+void MaterialTable::EnsureCapacity(uint32_t materialCount) {
+    if (materialCount <= m_Capacity) {
+        return;
+    }
+
+    uint32_t capacity = std::max(16u, m_Capacity);
+    while (capacity < materialCount) {
+        capacity *= 2;
+    }
+
+    if (m_Buffer) {
+        glDeleteBuffers(1, &m_Buffer);
+    }
+    glGenBuffers(1, &m_Buffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(MaterialConstants), nullptr, GL_DYNAMIC_DRAW);
+    m_Capacity = capacity;
+
+    // A fresh buffer needs every entry again
+    m_Resolved.assign(m_Resolved.size(), ResolvedTextures{});
+}
+
+void MaterialTable::Update() {
+    const uint32_t count = m_Registry->GetMaterialCount();
+    const uint32_t previousCount = static_cast<uint32_t>(m_Entries.size());
+    const uint32_t previousCapacity = m_Capacity;
+    EnsureCapacity(count);
+    m_Entries.resize(count);
+    m_Resolved.resize(count);
+
+    uint32_t dirtyBegin = count;
+    uint32_t dirtyEnd = 0;
+    if (m_Capacity != previousCapacity) {
+        dirtyBegin = 0;
+        dirtyEnd = count;
+    } else if (count > previousCount) {
+        dirtyBegin = previousCount;
+        dirtyEnd = count;
+    }
+
+    uint32_t editedBegin = 0, editedEnd = 0;
+    if (m_Registry->ConsumeDirtyMaterials(editedBegin, editedEnd)) {
+        dirtyBegin = std::min(dirtyBegin, editedBegin);
+        dirtyEnd = std::max(dirtyEnd, std::min(editedEnd, count));
+    }
+
+    // Streaming swaps GL textures underneath unchanged materials
+    uint32_t textureIndex = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i >= dirtyBegin && i < dirtyEnd) {
+            continue;
+        }
+        const MaterialAsset* material = m_Registry->GetMaterial(i);
+        const GLuint current[3] = {
+            ResolveTexture(material->BaseColorTexture, m_Registry->GetDefaultWhiteTexture(), textureIndex)->Texture,
+            ResolveTexture(material->NormalTexture, m_Registry->GetDefaultNormalTexture(), textureIndex)->Texture,
+            ResolveTexture(material->RoughnessMetalnessTexture, m_Registry->GetDefaultRoughnessMetalnessTexture(), textureIndex)->Texture
+        };
+        if (!std::equal(std::begin(current), std::end(current), std::begin(m_Resolved[i].Textures))) {
+            dirtyBegin = std::min(dirtyBegin, i);
+            dirtyEnd = std::max(dirtyEnd, i + 1);
+        }
+    }
+
+    m_Stats.MaterialsUploadedThisFrame = 0;
+    if (dirtyBegin < dirtyEnd) {
+        for (uint32_t i = dirtyBegin; i < dirtyEnd; i++) {
+            BuildEntry(i, m_Entries[i], m_Resolved[i]);
+        }
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_Buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, dirtyBegin * sizeof(MaterialConstants),
+                        (dirtyEnd - dirtyBegin) * sizeof(MaterialConstants), &m_Entries[dirtyBegin]);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        m_Stats.MaterialsUploadedThisFrame = dirtyEnd - dirtyBegin;
+    }
+
+    if (m_LayersChanged) {
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureArray);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        m_LayersChanged = false;
+    }
+
+    m_Stats.MaterialCount = count;
+    m_Stats.ResidentHandles = static_cast<uint32_t>(m_Bindless ? m_Handles.size() : m_Layers.size());
+}
+
+void MaterialTable::BuildEntry(uint32_t index, MaterialConstants& entry, ResolvedTextures& resolved) {
+    const MaterialAsset* material = m_Registry->GetMaterial(index);
+    const TextureHandle fallbacks[3] = {
+        m_Registry->GetDefaultWhiteTexture(),
+        m_Registry->GetDefaultNormalTexture(),
+        m_Registry->GetDefaultRoughnessMetalnessTexture()
+    };
+    const TextureHandle handles[3] = {
+        material->BaseColorTexture, material->NormalTexture, material->RoughnessMetalnessTexture
+    };
+    glm::uvec2* references[3] = {
+        &entry.BaseColorTexture, &entry.NormalTexture, &entry.RoughnessMetalnessTexture
+    };
+
+    for (int slot = 0; slot < 3; slot++) {
+        uint32_t textureIndex = 0;
+        const TextureAsset* texture = ResolveTexture(handles[slot], fallbacks[slot], textureIndex);
+        resolved.Textures[slot] = texture->Texture;
+        *references[slot] = GetTextureReference(*texture, textureIndex);
+    }
+
+    entry.BaseColorFactor = material->BaseColorFactor;
+    entry.RoughnessFactor = material->RoughnessFactor;
+    entry.MetalnessFactor = material->MetalnessFactor;
+    entry.AlphaCutoff = material->AlphaCutoff;
+    entry.Flags = (material->AlphaMask ? MaterialFlagAlphaMask : 0u) |
+                  (material->HasNormalTexture() ? MaterialFlagHasNormalTexture : 0u);
+    entry.Padding[0] = entry.Padding[1] = 0;
+}
+
+const TextureAsset* MaterialTable::ResolveTexture(TextureHandle handle, TextureHandle fallback, uint32_t& textureIndex) const {
+    // GetTexture already substitutes the placeholder while a texture streams in,
+    // and returns nothing for handles whose asset was evicted
+    const TextureAsset* texture = m_Registry->GetTexture(handle);
+    if (!texture || !texture->Texture) {
+        handle = fallback;
+        texture = m_Registry->GetTexture(fallback);
+    }
+    textureIndex = handle.Index;
+    return texture;
+}
+
+glm::uvec2 MaterialTable::GetTextureReference(const TextureAsset& texture, uint32_t textureIndex) {
+    if (m_Bindless) {
+        auto it = m_Handles.find(texture.Texture);
+        if (it == m_Handles.end()) {
+            GLuint64 handle = glGetTextureHandleARB(texture.Texture);
+            glMakeTextureHandleResidentARB(handle);
+            it = m_Handles.emplace(texture.Texture, handle).first;
+        }
+        return glm::uvec2(static_cast<uint32_t>(it->second), static_cast<uint32_t>(it->second >> 32));
+    }
+
+    uint32_t layer = AcquireLayer(textureIndex);
+    if (m_LayerSources[layer] != texture.Texture) {
+        CopyToLayer(texture, textureIndex, layer);
+    }
+    return glm::uvec2(layer, 0);
+}
+
+uint32_t MaterialTable::AcquireLayer(uint32_t textureIndex) {
+    auto it = m_Layers.find(textureIndex);
+    if (it != m_Layers.end()) {
+        return it->second;
+    }
+
+    uint32_t layer = static_cast<uint32_t>(m_Layers.size());
+    if (layer >= m_Settings.FallbackLayerCount) {
+        std::cout << "Warning: Material texture array is full, texture " << textureIndex << " renders white" << std::endl;
+        layer = 0;
+    }
+    m_Layers[textureIndex] = layer;
+    return layer;
+}
+
+void MaterialTable::CopyToLayer(const TextureAsset& texture, uint32_t textureIndex, uint32_t layer) {
+    if (!m_CopyProgram || (layer == 0 && textureIndex != m_Registry->GetDefaultWhiteTexture().Index)) {
+        return;
+    }
+
+    // Sample the resident level closest to the layer size
+    uint32_t sourceSize = std::max(1u, std::max(texture.Width, texture.Height) >> texture.ResidentMip);
+    float lod = std::max(0.0f, std::log2(static_cast<float>(sourceSize) / m_Settings.FallbackLayerSize));
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_CopyFramebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_TextureArray, 0, static_cast<GLint>(layer));
+    glViewport(0, 0, m_Settings.FallbackLayerSize, m_Settings.FallbackLayerSize);
+
+    glUseProgram(m_CopyProgram);
+    glUniform1i(glGetUniformLocation(m_CopyProgram, "uSource"), 0);
+    glUniform1f(glGetUniformLocation(m_CopyProgram, "uSourceLod"), lod);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture.Texture);
+    glBindVertexArray(m_CopyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(framebuffer));
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest) glEnable(GL_DEPTH_TEST);
+    if (cullFace) glEnable(GL_CULL_FACE);
+
+    m_LayerSources[layer] = texture.Texture;
+    m_LayersChanged = true;
+}
+
+void MaterialTable::Bind() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BufferBinding, m_Buffer);
+    if (!m_Bindless) {
+        glActiveTexture(GL_TEXTURE0 + FallbackTextureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_TextureArray);
+        glActiveTexture(GL_TEXTURE0);
+    }
+}
+
+void MaterialTable::OnTextureReleased(GLuint texture) {
+    auto it = m_Handles.find(texture);
+    if (it != m_Handles.end()) {
+        glMakeTextureHandleNonResidentARB(it->second);
+        m_Handles.erase(it);
+    }
+    for (auto& source : m_LayerSources) {
+        if (source == texture) {
+            source = 0;
+        }
+    }
+}
+
+} // namespace Henky3D
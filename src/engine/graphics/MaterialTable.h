@@ -0,0 +1,91 @@
+#pragma once
+#include "ConstantBuffers.h"
+#include "Material.h"
+#include <glad/gl.h>
+#include <vector>
+#include <unordered_map>
+
+namespace Henky3D {
+
+class AssetRegistry;
+
+struct MaterialTableSettings {
+    uint32_t FallbackLayerSize = 256;  // Texture array layer size without bindless support
+    uint32_t FallbackLayerCount = 64;
+};
+
+struct MaterialTableStats {
+    uint32_t MaterialCount = 0;
+    uint32_t MaterialsUploadedThisFrame = 0;
+    uint32_t ResidentHandles = 0;      // Bindless handles, or used array layers in fallback mode
+    bool Bindless = false;
+};
+
+// Mirrors AssetRegistry materials into a shader storage buffer so any draw can
+// fetch its material by index. Textures are referenced through ARB_bindless_texture
+// handles; without the extension they are resampled into layers of one texture
+// array. Only dirty material ranges are re-uploaded.
+class MaterialTable {
+public:
+    static constexpr GLuint BufferBinding = 2;
+    static constexpr GLuint FallbackTextureUnit = 1;
+
+    MaterialTable(AssetRegistry* registry, const MaterialTableSettings& settings = {});
+    ~MaterialTable();
+
+    bool IsBindless() const { return m_Bindless; }
+
+    // Fullscreen program used to resample textures into the fallback array
+    void SetLayerCopyProgram(GLuint program) { m_CopyProgram = program; }
+
+    // Sync dirty materials and texture references (render thread, before drawing)
+    void Update();
+
+    // Bind the material buffer and, in fallback mode, the texture array
+    void Bind() const;
+
+    // Called by the texture streamer before it deletes a texture
+    void OnTextureReleased(GLuint texture);
+
+    const MaterialTableStats& GetStats() const { return m_Stats; }
+
+private:
+    // GL textures a material entry currently points at
+    struct ResolvedTextures {
+        GLuint Textures[3] = { 0, 0, 0 };
+    };
+
+    // The asset a slot samples right now (placeholder or fallback included); textureIndex keys its layer
+    const TextureAsset* ResolveTexture(TextureHandle handle, TextureHandle fallback, uint32_t& textureIndex) const;
+    glm::uvec2 GetTextureReference(const TextureAsset& texture, uint32_t textureIndex);
+    void BuildEntry(uint32_t index, MaterialConstants& entry, ResolvedTextures& resolved);
+    void EnsureCapacity(uint32_t materialCount);
+
+    void CreateFallbackArray();
+    uint32_t AcquireLayer(uint32_t textureIndex);
+    void CopyToLayer(const TextureAsset& texture, uint32_t textureIndex, uint32_t layer);
+
+    AssetRegistry* m_Registry;
+    MaterialTableSettings m_Settings;
+    MaterialTableStats m_Stats;
+    bool m_Bindless;
+
+    GLuint m_Buffer = 0;
+    uint32_t m_Capacity = 0;
+    std::vector<MaterialConstants> m_Entries;
+    std::vector<ResolvedTextures> m_Resolved;
+
+    // Bindless mode: one resident handle per GL texture
+    std::unordered_map<GLuint, GLuint64> m_Handles;
+
+    // Fallback mode: layers keyed by texture registry index
+    GLuint m_TextureArray = 0;
+    GLuint m_CopyFramebuffer = 0;
+    GLuint m_CopyVAO = 0;
+    GLuint m_CopyProgram = 0;
+    std::unordered_map<uint32_t, uint32_t> m_Layers;
+    std::vector<GLuint> m_LayerSources; // GL texture last copied into each layer
+    bool m_LayersChanged = false;
+};
+
+} // namespace Henky3D
@@ -1,114 +1,53 @@
 #include "Renderer.h"
 #include "../ecs/ECSWorld.h"
 #include "../ecs/Components.h"
+#include "../core/JobSystem.h"
+#include "../core/FileSystem.h"
+#include "../core/Profiler.h"
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cstddef>
 #include <stdexcept>
-#include <fstream>
 #include <sstream>
 #include <iostream>
-#include <filesystem>
-#include <cstdlib>
-
-#ifdef _WIN32
-#include <windows.h>
-#elif defined(__APPLE__)
-#include <mach-o/dyld.h>
-#else
-#include <unistd.h>
-#include <limits.h>
-#endif
 
 namespace Henky3D {
 
-// Default fallback path for shaders relative to build directory
-static constexpr const char* kDefaultShaderPath = "../../../shaders/";
-
-static std::string GetExecutableDirectory() {
-    std::string exePath;
-    
-#ifdef _WIN32
-    char path[MAX_PATH];
-    DWORD len = GetModuleFileNameA(nullptr, path, MAX_PATH);
-    // Check for buffer overflow - GetModuleFileNameA returns MAX_PATH when buffer is too small
-    if (len > 0 && len < MAX_PATH) {
-        exePath = std::string(path, len);
-    }
-#elif defined(__APPLE__)
-    char path[PATH_MAX];
-    uint32_t size = sizeof(path);
-    if (_NSGetExecutablePath(path, &size) == 0) {
-        exePath = std::string(path);
-    }
-    // Note: _NSGetExecutablePath returns -1 and updates size if buffer is too small
-    // For typical use cases, PATH_MAX should be sufficient, so we don't retry
-#else
-    char path[PATH_MAX];
-    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
-    if (len != -1) {
-        path[len] = '\0';
-        exePath = std::string(path);
-    }
-#endif
-    
-    if (!exePath.empty()) {
-        return std::filesystem::path(exePath).parent_path().string();
-    }
-    return "";
-}
-
-static std::string GetShaderPath(const char* filename) {
-    namespace fs = std::filesystem;
-    
-    // Priority 1: HENKY_ASSET_DIR environment variable
-    if (const char* assetDir = std::getenv("HENKY_ASSET_DIR")) {
-        fs::path path = fs::path(assetDir) / "shaders" / filename;
-        if (fs::exists(path)) {
-            return path.string();
-        }
-    }
-    
-    // Priority 2: Relative to executable directory
-    std::string exeDir = GetExecutableDirectory();
-    if (!exeDir.empty()) {
-        // Try shaders/ subdirectory relative to exe
-        fs::path path = fs::path(exeDir) / "shaders" / filename;
-        if (fs::exists(path)) {
-            return path.string();
-        }
-        
-        // Try ../shaders/ (one level up from exe)
-        path = fs::path(exeDir) / ".." / "shaders" / filename;
-        if (fs::exists(path)) {
-            try {
-                return fs::canonical(path).string();
-            } catch (const fs::filesystem_error&) {
-                // If canonicalization fails, use the path as-is
-                return path.string();
-            }
-        }
-    }
-    
-    // Priority 3: Fallback to original relative path from build directory
-    fs::path fallbackPath = fs::path(kDefaultShaderPath) / filename;
-    if (fs::exists(fallbackPath)) {
-        return fallbackPath.string();
-    }
-    
-    // If nothing worked, return the relative path and let it fail with a clear error
-    return std::string(kDefaultShaderPath) + filename;
-}
-
 Renderer::Renderer(GraphicsDevice* device) 
-    : m_Device(device), m_DepthPrepassEnabled(true), m_ShadowsEnabled(true),
-      m_ForwardProgram(0), m_DepthPrepassProgram(0), m_ShadowProgram(0),
+    : m_Device(device), m_OwnedFrameArena(std::make_unique<FrameArena>()), m_FrameArena(m_OwnedFrameArena.get()),
+      m_ForwardProgram(0), m_DepthPrepassProgram(0), m_ShadowProgram(0), m_LayerCopyProgram(0), m_UpscaleProgram(0),
       m_CubeVAO(0), m_CubeVBO(0), m_CubeIBO(0), m_IndexCount(0),
-      m_PerFrameUBO(0), m_PerDrawUBO(0) {
-    
-    m_AssetRegistry = std::make_unique<AssetRegistry>(device);
+      m_PerFrameUBO(0), m_DrawBuffer(0), m_ImmediateDrawBuffer(0), m_DrawCapacity(0),
+      m_StaticCasterSignature(0), m_ShadowDrawBuffer(0), m_ShadowDrawCapacity(0),
+      m_ShadowDraws(*m_FrameArena), m_AtlasCasters(*m_FrameArena), m_AtlasChunkCount(0),
+      m_LocalLightBuffer(0), m_LocalLightCapacity(0), m_ShadowTileBuffer(0), m_ShadowTileCapacity(0),
+      m_FrameIndex(0), m_PreparedFrame(0),
+      m_DepthPrepassEnabled(true), m_ShadowsEnabled(true), m_RecordCommands(true) {
+    
+    m_JobSystem = std::make_unique<JobSystem>();
+    m_AssetRegistry = std::make_unique<AssetRegistry>(device, m_JobSystem.get());
     m_ShadowMap = std::make_unique<ShadowMap>(device, 2048);
+    m_ShadowAtlas = std::make_unique<ShadowAtlas>(device);
+    m_LightClusters = std::make_unique<LightClusters>(m_JobSystem.get());
+    m_GpuProfiler = std::make_unique<GpuProfiler>();
+    m_DynamicResolution = std::make_unique<DynamicResolution>(device);
     
     // Initialize default textures
     m_AssetRegistry->InitializeDefaults();
+    m_MaterialTable = std::make_unique<MaterialTable>(m_AssetRegistry.get());
+    if (m_MaterialTable->IsBindless()) {
+        m_ShaderDefines = "#define HENKY_BINDLESS 1\n";
+    }
+    // GL 4.5 drivers (e.g. Mesa llvmpipe) get 450 shaders with gl_BaseInstance from ARB_shader_draw_parameters
+    if (!GLAD_GL_VERSION_4_6) {
+        if (!GLAD_GL_ARB_shader_draw_parameters) {
+            throw std::runtime_error("OpenGL 4.6 or ARB_shader_draw_parameters is required");
+        }
+        m_ShaderVersion = "#version 450 core";
+        m_ShaderDefines += "#define HENKY_DRAW_PARAMETERS_ARB 1\n";
+    }
     
     CreateShaderPrograms();
     CreateCubeGeometry();
@@ -119,47 +58,56 @@ Renderer::Renderer(GraphicsDevice* device)
     glBufferData(GL_UNIFORM_BUFFER, sizeof(PerFrameConstants), nullptr, GL_DYNAMIC_DRAW);
     glBindBufferBase(GL_UNIFORM_BUFFER, 0, m_PerFrameUBO);
     
-    glGenBuffers(1, &m_PerDrawUBO);
-    glBindBuffer(GL_UNIFORM_BUFFER, m_PerDrawUBO);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(PerDrawConstants), nullptr, GL_DYNAMIC_DRAW);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, m_PerDrawUBO);
+    glGenBuffers(1, &m_ImmediateDrawBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ImmediateDrawBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(PerDrawConstants), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
     
     std::cout << "Renderer initialized with OpenGL" << std::endl;
 }
 
 Renderer::~Renderer() {
+    // Bindless handles must be released while the textures still exist
+    m_MaterialTable.reset();
+    
     if (m_CubeVAO) glDeleteVertexArrays(1, &m_CubeVAO);
     if (m_CubeVBO) glDeleteBuffers(1, &m_CubeVBO);
     if (m_CubeIBO) glDeleteBuffers(1, &m_CubeIBO);
     if (m_PerFrameUBO) glDeleteBuffers(1, &m_PerFrameUBO);
-    if (m_PerDrawUBO) glDeleteBuffers(1, &m_PerDrawUBO);
+    if (m_DrawBuffer) glDeleteBuffers(1, &m_DrawBuffer);
+    if (m_ImmediateDrawBuffer) glDeleteBuffers(1, &m_ImmediateDrawBuffer);
+    if (m_ShadowDrawBuffer) glDeleteBuffers(1, &m_ShadowDrawBuffer);
+    if (m_LocalLightBuffer) glDeleteBuffers(1, &m_LocalLightBuffer);
+    if (m_ShadowTileBuffer) glDeleteBuffers(1, &m_ShadowTileBuffer);
     if (m_ForwardProgram) glDeleteProgram(m_ForwardProgram);
     if (m_DepthPrepassProgram) glDeleteProgram(m_DepthPrepassProgram);
     if (m_ShadowProgram) glDeleteProgram(m_ShadowProgram);
+    if (m_LayerCopyProgram) glDeleteProgram(m_LayerCopyProgram);
+    if (m_UpscaleProgram) glDeleteProgram(m_UpscaleProgram);
 }
 
 std::string Renderer::LoadShaderSource(const char* filename) {
-    std::string path = GetShaderPath(filename);
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    std::string path = std::string("shaders/") + filename;
+    std::string text;
+    if (!FileSystem::ReadText(path, text)) {
         throw std::runtime_error("Failed to open shader file: " + path);
     }
     
+    std::stringstream source(text);
     std::stringstream buffer;
     std::string line;
-    while (std::getline(file, line)) {
+    while (std::getline(source, line)) {
         // Simple #include handling for Common.glsl
         if (line.find("#include") != std::string::npos) {
             size_t start = line.find('"');
             size_t end = line.rfind('"');
             if (start != std::string::npos && end != std::string::npos && start < end) {
                 std::string includeName = line.substr(start + 1, end - start - 1);
-                std::string includePath = GetShaderPath(includeName.c_str());
-                std::ifstream includeFile(includePath);
-                if (includeFile.is_open()) {
-                    std::string includeLine;
-                    while (std::getline(includeFile, includeLine)) {
-                        buffer << includeLine << "\n";
+                std::string includeText;
+                if (FileSystem::ReadText("shaders/" + includeName, includeText)) {
+                    buffer << includeText;
+                    if (!includeText.empty() && includeText.back() != '\n') {
+                        buffer << "\n";
                     }
                     continue;
                 }
@@ -172,6 +120,17 @@ std::string Renderer::LoadShaderSource(const char* filename) {
 
 GLuint Renderer::LoadAndCompileShader(const char* filename, GLenum shaderType) {
     std::string source = LoadShaderSource(filename);
+    
+    // Feature defines go right after the #version line
+    size_t versionPos = source.find("#version");
+    if (!m_ShaderVersion.empty() && versionPos != std::string::npos) {
+        size_t lineEnd = source.find('\n', versionPos);
+        source.replace(versionPos, (lineEnd == std::string::npos ? source.size() : lineEnd) - versionPos, m_ShaderVersion);
+    }
+    if (!m_ShaderDefines.empty() && versionPos != std::string::npos) {
+        size_t lineEnd = source.find('\n', versionPos);
+        source.insert(lineEnd == std::string::npos ? source.size() : lineEnd + 1, m_ShaderDefines);
+    }
     const char* sourceCStr = source.c_str();
     
     GLuint shader = glCreateShader(shaderType);
@@ -219,48 +178,63 @@ void Renderer::CreateShaderPrograms() {
     m_ForwardProgram = CreateShaderProgram("Forward.vs.glsl", "Forward.ps.glsl");
     m_DepthPrepassProgram = CreateShaderProgram("DepthPrepass.vs.glsl", "DepthPrepass.ps.glsl");
     m_ShadowProgram = CreateShaderProgram("Shadow.vs.glsl", "Shadow.ps.glsl");
+    m_UpscaleProgram = CreateShaderProgram("Fullscreen.vs.glsl", "Upscale.ps.glsl");
+    m_DynamicResolution->SetUpscaleProgram(m_UpscaleProgram);
+    
+    // Without bindless textures, materials sample one texture array on a fixed unit
+    if (!m_MaterialTable->IsBindless()) {
+        m_LayerCopyProgram = CreateShaderProgram("Fullscreen.vs.glsl", "TextureLayerCopy.ps.glsl");
+        m_MaterialTable->SetLayerCopyProgram(m_LayerCopyProgram);
+        
+        glUseProgram(m_ForwardProgram);
+        GLint location = glGetUniformLocation(m_ForwardProgram, "uMaterialTextures");
+        if (location >= 0) {
+            glUniform1i(location, MaterialTable::FallbackTextureUnit);
+        }
+        glUseProgram(0);
+    }
     
     std::cout << "Shader programs created successfully" << std::endl;
 }
 
 void Renderer::CreateCubeGeometry() {
-    // Cube vertices with normals and colors
+    // Cube vertices with normals, colors and per-face texture coordinates
     Vertex vertices[] = {
         // Front face (red-ish)
-        {{-0.5f, -0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.3f, 0.3f, 1.0f}},
-        {{0.5f, -0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.3f, 0.3f, 1.0f}},
-        {{0.5f, 0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.3f, 0.3f, 1.0f}},
-        {{-0.5f, 0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.3f, 0.3f, 1.0f}},
+        {{-0.5f, -0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.3f, 0.3f, 1.0f}, {0.0f, 0.0f}},
+        {{0.5f, -0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.3f, 0.3f, 1.0f}, {1.0f, 0.0f}},
+        {{0.5f, 0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.3f, 0.3f, 1.0f}, {1.0f, 1.0f}},
+        {{-0.5f, 0.5f, 0.5f}, {0.0f, 0.0f, 1.0f}, {1.0f, 0.3f, 0.3f, 1.0f}, {0.0f, 1.0f}},
         
         // Back face (green-ish)
-        {{0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.3f, 1.0f, 0.3f, 1.0f}},
-        {{-0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.3f, 1.0f, 0.3f, 1.0f}},
-        {{-0.5f, 0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.3f, 1.0f, 0.3f, 1.0f}},
-        {{0.5f, 0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.3f, 1.0f, 0.3f, 1.0f}},
+        {{0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.3f, 1.0f, 0.3f, 1.0f}, {0.0f, 0.0f}},
+        {{-0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.3f, 1.0f, 0.3f, 1.0f}, {1.0f, 0.0f}},
+        {{-0.5f, 0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.3f, 1.0f, 0.3f, 1.0f}, {1.0f, 1.0f}},
+        {{0.5f, 0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {0.3f, 1.0f, 0.3f, 1.0f}, {0.0f, 1.0f}},
         
         // Top face (blue-ish)
-        {{-0.5f, 0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}, {0.3f, 0.3f, 1.0f, 1.0f}},
-        {{0.5f, 0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}, {0.3f, 0.3f, 1.0f, 1.0f}},
-        {{0.5f, 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.3f, 0.3f, 1.0f, 1.0f}},
-        {{-0.5f, 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.3f, 0.3f, 1.0f, 1.0f}},
+        {{-0.5f, 0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}, {0.3f, 0.3f, 1.0f, 1.0f}, {0.0f, 0.0f}},
+        {{0.5f, 0.5f, 0.5f}, {0.0f, 1.0f, 0.0f}, {0.3f, 0.3f, 1.0f, 1.0f}, {1.0f, 0.0f}},
+        {{0.5f, 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.3f, 0.3f, 1.0f, 1.0f}, {1.0f, 1.0f}},
+        {{-0.5f, 0.5f, -0.5f}, {0.0f, 1.0f, 0.0f}, {0.3f, 0.3f, 1.0f, 1.0f}, {0.0f, 1.0f}},
         
         // Bottom face (yellow-ish)
-        {{-0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.3f, 1.0f}},
-        {{0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.3f, 1.0f}},
-        {{0.5f, -0.5f, 0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.3f, 1.0f}},
-        {{-0.5f, -0.5f, 0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.3f, 1.0f}},
+        {{-0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.3f, 1.0f}, {0.0f, 0.0f}},
+        {{0.5f, -0.5f, -0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.3f, 1.0f}, {1.0f, 0.0f}},
+        {{0.5f, -0.5f, 0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.3f, 1.0f}, {1.0f, 1.0f}},
+        {{-0.5f, -0.5f, 0.5f}, {0.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.3f, 1.0f}, {0.0f, 1.0f}},
         
         // Right face (magenta-ish)
-        {{0.5f, -0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f, 1.0f}},
-        {{0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f, 1.0f}},
-        {{0.5f, 0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f, 1.0f}},
-        {{0.5f, 0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f, 1.0f}},
+        {{0.5f, -0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f, 1.0f}, {0.0f, 0.0f}},
+        {{0.5f, -0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f, 1.0f}, {1.0f, 0.0f}},
+        {{0.5f, 0.5f, -0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f, 1.0f}, {1.0f, 1.0f}},
+        {{0.5f, 0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.3f, 1.0f, 1.0f}, {0.0f, 1.0f}},
         
         // Left face (cyan-ish)
-        {{-0.5f, -0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {0.3f, 1.0f, 1.0f, 1.0f}},
-        {{-0.5f, -0.5f, 0.5f}, {-1.0f, 0.0f, 0.0f}, {0.3f, 1.0f, 1.0f, 1.0f}},
-        {{-0.5f, 0.5f, 0.5f}, {-1.0f, 0.0f, 0.0f}, {0.3f, 1.0f, 1.0f, 1.0f}},
-        {{-0.5f, 0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {0.3f, 1.0f, 1.0f, 1.0f}},
+        {{-0.5f, -0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {0.3f, 1.0f, 1.0f, 1.0f}, {0.0f, 0.0f}},
+        {{-0.5f, -0.5f, 0.5f}, {-1.0f, 0.0f, 0.0f}, {0.3f, 1.0f, 1.0f, 1.0f}, {1.0f, 0.0f}},
+        {{-0.5f, 0.5f, 0.5f}, {-1.0f, 0.0f, 0.0f}, {0.3f, 1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}},
+        {{-0.5f, 0.5f, -0.5f}, {-1.0f, 0.0f, 0.0f}, {0.3f, 1.0f, 1.0f, 1.0f}, {0.0f, 1.0f}},
     };
     
     uint32_t indices[] = {
@@ -295,6 +269,10 @@ void Renderer::CreateCubeGeometry() {
     glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Color));
     glEnableVertexAttribArray(2);
     
+    // Texture coordinate attribute
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoord));
+    glEnableVertexAttribArray(3);
+    
     // Create IBO
     glGenBuffers(1, &m_CubeIBO);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_CubeIBO);
@@ -306,7 +284,29 @@ void Renderer::CreateCubeGeometry() {
 }
 
 void Renderer::BeginFrame() {
+    HENKY_PROFILE_ZONE("Renderer::BeginFrame");
     m_Stats = RenderStats();
+    m_FrameIndex++;
+    m_GpuProfiler->BeginFrame();
+
+    // Fresh arena lists sized like last frame's, so steady state allocates each once
+    if (m_FrameArena == m_OwnedFrameArena.get()) {
+        m_FrameArena->BeginFrame();
+    }
+    const size_t shadowDrawCount = m_ShadowDraws.size();
+    const size_t atlasCasterCount = m_AtlasCasters.size();
+    m_ShadowDraws = FrameVector<PerDrawConstants>(*m_FrameArena);
+    m_ShadowDraws.reserve(shadowDrawCount);
+    m_AtlasCasters = FrameVector<glm::uvec2>(*m_FrameArena);
+    m_AtlasCasters.reserve(atlasCasterCount);
+    
+    // Upload streamed textures within the per-frame budget
+    m_AssetRegistry->Update();
+}
+
+void Renderer::SetFrameArena(FrameArena* arena) {
+    // The current lists stay valid: the previous arena outlives them or is the owned one
+    m_FrameArena = arena ? arena : m_OwnedFrameArena.get();
 }
 
 void Renderer::SetPerFrameConstants(const PerFrameConstants& constants) {
@@ -317,133 +317,523 @@ void Renderer::SetPerFrameConstants(const PerFrameConstants& constants) {
     glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PerFrameConstants), &constants);
 }
 
+void Renderer::PrepareDraws(ECSWorld* world) {
+    // Shadow, prepass and forward passes share one instance list per frame
+    if (m_PreparedFrame == m_FrameIndex) {
+        return;
+    }
+    m_PreparedFrame = m_FrameIndex;
+    HENKY_PROFILE_ZONE("Renderer::PrepareDraws");
+    
+    // Material references may have changed through streaming since BeginFrame
+    m_MaterialTable->Update();
+    
+    m_Stats.CulledCount += ExtractDraws(world, *m_JobSystem, m_AssetRegistry->GetMaterialCount(),
+                                        m_DrawEntities, m_Draws, m_DrawBounds);
+    const uint32_t drawCount = static_cast<uint32_t>(m_Draws.size());
+    
+    // Static casters added, removed or moved invalidate the cached shadow layers
+    uint64_t signature = 0xcbf29ce484222325ull;
+    for (uint32_t i = 0; i < drawCount; i++) {
+        if (!m_DrawBounds[i].Static) {
+            continue;
+        }
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(&m_Draws[i].WorldMatrix);
+        for (size_t word = 0; word < sizeof(glm::mat4) / sizeof(uint32_t); word++) {
+            signature = (signature ^ words[word]) * 0x100000001b3ull;
+        }
+    }
+    m_StaticCasterSignature = signature;
+    
+    UploadStorage(m_DrawBuffer, m_DrawCapacity, m_Draws);
+    
+    PrepareLights(world);
+}
+
+uint32_t Renderer::ExtractDraws(ECSWorld* world, JobSystem& jobSystem, uint32_t materialCount,
+                                std::vector<entt::entity>& entities, std::vector<PerDrawConstants>& draws,
+                                std::vector<DrawBounds>& bounds) {
+    HENKY_PROFILE_ZONE("Renderer::ExtractDraws");
+    auto& registry = world->GetRegistry();
+    auto view = registry.view<Transform, Renderable>();
+    
+    uint32_t hiddenCount = 0;
+    entities.clear();
+    for (auto entity : view) {
+        if (!view.get<Renderable>(entity).Visible) {
+            hiddenCount++;
+            continue;
+        }
+        entities.push_back(entity);
+    }
+    
+    // Per-draw state is built on the job system, one chunk of entities per batch
+    const uint32_t drawCount = static_cast<uint32_t>(entities.size());
+    draws.resize(drawCount);
+    bounds.resize(drawCount);
+    // Const access only: a non-const try_get may create missing component pools
+    const entt::registry& sharedRegistry = registry;
+    jobSystem.ParallelFor(drawCount, 256, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            const entt::entity entity = entities[i];
+            PerDrawConstants& perDraw = draws[i];
+            perDraw = {};
+            perDraw.WorldMatrix = view.get<Transform>(entity).GetWorldMatrix();
+            if (const Material* material = sharedRegistry.try_get<Material>(entity)) {
+                perDraw.MaterialIndex = material->MaterialIndex < materialCount ? material->MaterialIndex : 0;
+            }
+            
+            // Same conservative scale as the culling system; entities without bounds use the unit cube
+            const BoundingBox* boundingBox = sharedRegistry.try_get<BoundingBox>(entity);
+            const BoundingBox localBounds = boundingBox ? *boundingBox : BoundingBox();
+            const glm::mat4& worldMatrix = perDraw.WorldMatrix;
+            float maxScale = std::max({ glm::length(glm::vec3(worldMatrix[0])), glm::length(glm::vec3(worldMatrix[1])),
+                                        glm::length(glm::vec3(worldMatrix[2])) });
+            DrawBounds& drawBounds = bounds[i];
+            drawBounds.Center = glm::vec3(worldMatrix * glm::vec4(localBounds.GetCenter(), 1.0f));
+            drawBounds.Extents = localBounds.GetExtents() * maxScale;
+            drawBounds.Static = view.get<Renderable>(entity).Static;
+        }
+    });
+    return hiddenCount;
+}
+
+void Renderer::PrepareLights(ECSWorld* world) {
+    HENKY_PROFILE_ZONE("Renderer::PrepareLights");
+    m_LocalLights.clear();
+    m_AtlasLights.clear();
+    m_AtlasLightSources.clear();
+    
+    Frustum viewFrustum;
+    viewFrustum.ExtractFromMatrix(m_PerFrameConstants.ViewProjectionMatrix);
+    const glm::vec3 cameraPosition = glm::vec3(m_PerFrameConstants.CameraPosition);
+    const float focalLength = m_PerFrameConstants.ProjectionMatrix[1][1];
+    
+    auto view = world->GetRegistry().view<Light>();
+    for (auto entity : view) {
+        const Light& light = view.get<Light>(entity);
+        if (light.LightType == Light::Type::Directional) {
+            continue;
+        }
+        if (!viewFrustum.TestBox(light.Position, glm::vec3(light.Range))) {
+            continue;
+        }
+        if (m_LocalLights.size() >= MaxLocalLights) {
+            // Counted every frame, reported once: a streamed world can stay over the limit
+            m_Stats.SkippedLocalLights++;
+            if (!m_LocalLightLimitWarned) {
+                std::cout << "Warning: more than " << MaxLocalLights << " visible local lights, the rest are skipped" << std::endl;
+                m_LocalLightLimitWarned = true;
+            }
+            continue;
+        }
+        
+        const bool spot = light.LightType == Light::Type::Spot;
+        LocalLightConstants constants = {};
+        constants.PositionRange = glm::vec4(light.Position, light.Range);
+        constants.ColorIntensity = glm::vec4(glm::vec3(light.Color), light.Intensity);
+        constants.DirectionCone = glm::vec4(glm::normalize(light.Direction), spot ? std::cos(light.OuterConeAngle) : -1.0f);
+        constants.CosInnerCone = spot ? std::cos(light.InnerConeAngle) : -1.0f;
+        constants.Type = spot ? LocalLightSpot : LocalLightPoint;
+        constants.ShadowIndex = NoLocalShadow;
+        m_LocalLights.push_back(constants);
+        
+        if (!light.CastShadows) {
+            continue;
+        }
+        
+        // Projected diameter as a fraction of the screen height; a light around the camera fills it
+        float distance = std::max(glm::length(light.Position - cameraPosition), light.Range);
+        ShadowAtlasLight atlasLight;
+        atlasLight.Key = static_cast<uint64_t>(entt::to_integral(entity));
+        atlasLight.FaceCount = ShadowAtlas::ComputeFaceMatrices(light, atlasLight.FaceViewProjection);
+        atlasLight.Importance = std::min(1.0f, light.Range * focalLength / distance);
+        m_AtlasLights.push_back(atlasLight);
+        m_AtlasLightSources.push_back(static_cast<uint32_t>(m_LocalLights.size() - 1));
+    }
+}
+
+template<typename T, typename Allocator>
+void Renderer::UploadStorage(GLuint& buffer, uint32_t& capacity, const std::vector<T, Allocator>& items) {
+    if (items.size() > capacity) {
+        capacity = std::max<uint32_t>(64, capacity);
+        while (capacity < items.size()) {
+            capacity *= 2;
+        }
+        if (buffer) {
+            glDeleteBuffers(1, &buffer);
+        }
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+    }
+    
+    if (!items.empty()) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, items.size() * sizeof(T), items.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void Renderer::DrawInstances(GLuint drawBuffer, uint32_t firstInstance, uint32_t instanceCount, bool shadowPass) {
+    if (instanceCount == 0) {
+        return;
+    }
+    
+    // Every instance fetches its transform and material by gl_BaseInstance + gl_InstanceID
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, drawBuffer);
+    m_MaterialTable->Bind();
+    
+    glBindVertexArray(m_CubeVAO);
+    glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, nullptr,
+                                        instanceCount, firstInstance);
+    
+    if (shadowPass) {
+        m_Stats.ShadowDrawCount++;
+        m_Stats.ShadowInstanceCount += instanceCount;
+        m_Stats.ShadowTriangleCount += instanceCount * (m_IndexCount / 3);
+        return;
+    }
+    m_Stats.DrawCount++;
+    m_Stats.InstanceCount += instanceCount;
+    m_Stats.TriangleCount += instanceCount * (m_IndexCount / 3);
+}
+
 void Renderer::DrawCube(const glm::mat4& worldMatrix, const glm::vec4& color) {
-    PerDrawConstants perDraw;
+    PerDrawConstants perDraw = {};
     perDraw.WorldMatrix = worldMatrix;
     perDraw.MaterialIndex = 0;
     
-    glBindBuffer(GL_UNIFORM_BUFFER, m_PerDrawUBO);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PerDrawConstants), &perDraw);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ImmediateDrawBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(PerDrawConstants), &perDraw);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_ImmediateDrawBuffer);
+    m_MaterialTable->Bind();
     
     glBindVertexArray(m_CubeVAO);
-    glDrawElements(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, 0);
+    glDrawElementsInstancedBaseInstance(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, nullptr, 1, 0);
     
     m_Stats.DrawCount++;
+    m_Stats.InstanceCount++;
     m_Stats.TriangleCount += m_IndexCount / 3;
 }
 
 void Renderer::RenderShadowPass(ECSWorld* world) {
+    HENKY_PROFILE_ZONE("Renderer::RenderShadowPass");
     if (!m_ShadowsEnabled || !m_ShadowMap) {
         return;
     }
     
+    PrepareDraws(world);
+    
+    const bool cacheStatic = m_ShadowMap->GetSettings().CacheStaticCasters;
+    m_ShadowMap->SetStaticCasterSignature(m_StaticCasterSignature);
+    
+    const uint32_t cascadeCount = m_ShadowMap->GetCascadeCount();
+    
+    // Light-space box of the receivers the camera sees, per cascade
+    Frustum viewFrustum;
+    viewFrustum.ExtractFromMatrix(m_PerFrameConstants.ViewProjectionMatrix);
+    glm::vec3 receiverMin[MaxShadowCascades];
+    glm::vec3 receiverMax[MaxShadowCascades];
+    for (uint32_t cascade = 0; cascade < cascadeCount; cascade++) {
+        receiverMin[cascade] = glm::vec3(FLT_MAX);
+        receiverMax[cascade] = glm::vec3(-FLT_MAX);
+    }
+    for (size_t i = 0; i < m_Draws.size(); i++) {
+        const DrawBounds& bounds = m_DrawBounds[i];
+        if (!viewFrustum.TestBox(bounds.Center, bounds.Extents)) {
+            continue;
+        }
+        for (uint32_t cascade = 0; cascade < cascadeCount; cascade++) {
+            const ShadowCascade& shadowCascade = m_ShadowMap->GetCascade(cascade);
+            if (!ShadowMap::TestCaster(shadowCascade, bounds.Center, bounds.Extents)) {
+                continue;
+            }
+            glm::vec3 boxMin, boxMax;
+            ShadowMap::GetLightBounds(shadowCascade, bounds.Center, bounds.Extents, boxMin, boxMax);
+            receiverMin[cascade] = glm::min(receiverMin[cascade], boxMin);
+            receiverMax[cascade] = glm::max(receiverMax[cascade], boxMax);
+        }
+    }
+    
+    // Each cascade only draws the casters that can shadow a visible receiver: static casters
+    // when its cache must be rebuilt, followed by the dynamic ones. The cache is culled
+    // against the cascade volume alone so it stays valid as the receivers change.
+    bool rebuildCache[MaxShadowCascades] = {};
+    uint32_t firstCaster[MaxShadowCascades] = {};
+    uint32_t staticCount[MaxShadowCascades] = {};
+    uint32_t dynamicCount[MaxShadowCascades] = {};
+    m_ShadowDraws.clear();
+    for (uint32_t cascade = 0; cascade < cascadeCount; cascade++) {
+        rebuildCache[cascade] = cacheStatic && !m_ShadowMap->IsStaticCacheValid(cascade);
+        firstCaster[cascade] = static_cast<uint32_t>(m_ShadowDraws.size());
+        const ShadowCascade& bounds = m_ShadowMap->GetCascade(cascade);
+        
+        if (rebuildCache[cascade]) {
+            for (size_t i = 0; i < m_Draws.size(); i++) {
+                if (m_DrawBounds[i].Static &&
+                    ShadowMap::TestCaster(bounds, m_DrawBounds[i].Center, m_DrawBounds[i].Extents)) {
+                    m_ShadowDraws.push_back(m_Draws[i]);
+                }
+            }
+            staticCount[cascade] = static_cast<uint32_t>(m_ShadowDraws.size()) - firstCaster[cascade];
+        }
+        
+        for (size_t i = 0; i < m_Draws.size(); i++) {
+            if (cacheStatic && m_DrawBounds[i].Static) {
+                continue;
+            }
+            if (ShadowMap::TestCaster(bounds, m_DrawBounds[i].Center, m_DrawBounds[i].Extents,
+                                      receiverMin[cascade], receiverMax[cascade])) {
+                m_ShadowDraws.push_back(m_Draws[i]);
+            } else {
+                m_Stats.ShadowCulledCount++;
+            }
+        }
+        dynamicCount[cascade] = static_cast<uint32_t>(m_ShadowDraws.size()) - firstCaster[cascade] - staticCount[cascade];
+    }
+    
+    // Local light faces that dynamic casters touch are re-rendered every frame
+    for (ShadowAtlasLight& atlasLight : m_AtlasLights) {
+        for (uint32_t face = 0; face < atlasLight.FaceCount; face++) {
+            Frustum faceFrustum;
+            faceFrustum.ExtractFromMatrix(atlasLight.FaceViewProjection[face]);
+            for (size_t i = 0; i < m_Draws.size(); i++) {
+                if (!m_DrawBounds[i].Static && faceFrustum.TestBox(m_DrawBounds[i].Center, m_DrawBounds[i].Extents)) {
+                    atlasLight.FaceHasDynamicCasters[face] = true;
+                    break;
+                }
+            }
+        }
+    }
+    m_ShadowAtlas->Update(m_AtlasLights, m_StaticCasterSignature);
+    for (size_t i = 0; i < m_AtlasLights.size(); i++) {
+        m_LocalLights[m_AtlasLightSources[i]].ShadowIndex = m_AtlasLights[i].ShadowIndex;
+    }
+    
+    // Casters of the atlas faces picked for this frame go after the cascade casters
+    GLint cascadeLoc = glGetUniformLocation(m_ShadowProgram, "uCascade");
+    GLint tileLoc = glGetUniformLocation(m_ShadowProgram, "uShadowTile");
+    if (m_RecordCommands) {
+        RecordLocalShadows(tileLoc);
+    } else {
+        CullLocalShadowCasters();
+    }
+    
+    UploadStorage(m_ShadowDrawBuffer, m_ShadowDrawCapacity, m_ShadowDraws);
+    UploadStorage(m_ShadowTileBuffer, m_ShadowTileCapacity, m_ShadowAtlas->GetTileConstants());
+    
     // Bind shadow framebuffer
     m_ShadowMap->BeginShadowPass();
     
     // Use shadow shader program
     glUseProgram(m_ShadowProgram);
+    glUniform1i(tileLoc, -1);
     
-    // Render all renderable entities
-    auto& registry = world->GetRegistry();
-    auto view = registry.view<Transform, Renderable>();
-    
-    for (auto entity : view) {
-        auto& transform = view.get<Transform>(entity);
-        auto& renderable = view.get<Renderable>(entity);
+    for (uint32_t cascade = 0; cascade < cascadeCount; cascade++) {
+        m_ShadowMap->BeginCascade(cascade);
+        glUniform1i(cascadeLoc, static_cast<GLint>(cascade));
         
-        if (!renderable.Visible) {
-            m_Stats.CulledCount++;
-            continue;
+        if (rebuildCache[cascade]) {
+            m_ShadowMap->BeginStaticCache(cascade);
+            DrawInstances(m_ShadowDrawBuffer, firstCaster[cascade], staticCount[cascade], true);
+            m_ShadowMap->EndStaticCache(cascade);
         }
         
-        // Update per-draw constants
-        PerDrawConstants perDraw;
-        perDraw.WorldMatrix = transform.GetWorldMatrix();
-        perDraw.MaterialIndex = 0;
-        
-        glBindBuffer(GL_UNIFORM_BUFFER, m_PerDrawUBO);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PerDrawConstants), &perDraw);
+        m_ShadowMap->BeginDynamicCasters(cascade);
+        DrawInstances(m_ShadowDrawBuffer, firstCaster[cascade] + staticCount[cascade], dynamicCount[cascade], true);
         
-        // Draw
-        glBindVertexArray(m_CubeVAO);
-        glDrawElements(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, 0);
-        
-        m_Stats.DrawCount++;
-        m_Stats.TriangleCount += m_IndexCount / 3;
+        const uint32_t casters = staticCount[cascade] + dynamicCount[cascade];
+        m_ShadowMap->EndCascade(cascade, casters, casters * (m_IndexCount / 3), dynamicCount[cascade] > 0);
     }
     
     m_ShadowMap->EndShadowPass();
+    
+    RenderLocalShadows(tileLoc);
+}
+
+void Renderer::CullLocalShadowCasters() {
+    HENKY_PROFILE_ZONE("Renderer::CullLocalShadowCasters");
+    m_AtlasCasters.clear();
+    for (const ShadowAtlasUpdate& update : m_ShadowAtlas->GetUpdates()) {
+        Frustum faceFrustum;
+        faceFrustum.ExtractFromMatrix(m_AtlasLights[update.Light].FaceViewProjection[update.Face]);
+        const uint32_t first = static_cast<uint32_t>(m_ShadowDraws.size());
+        for (size_t i = 0; i < m_Draws.size(); i++) {
+            if (faceFrustum.TestBox(m_DrawBounds[i].Center, m_DrawBounds[i].Extents)) {
+                m_ShadowDraws.push_back(m_Draws[i]);
+            } else {
+                m_Stats.ShadowCulledCount++;
+            }
+        }
+        m_AtlasCasters.push_back(glm::uvec2(first, static_cast<uint32_t>(m_ShadowDraws.size()) - first));
+    }
+}
+
+void Renderer::RecordLocalShadows(GLint tileLocation) {
+    HENKY_PROFILE_ZONE("Renderer::RecordLocalShadows");
+    auto startTime = std::chrono::steady_clock::now();
+    const std::vector<ShadowAtlasUpdate>& updates = m_ShadowAtlas->GetUpdates();
+    const uint32_t updateCount = static_cast<uint32_t>(updates.size());
+    
+    // One chunk of tiles per thread; each culls into its own caster list and command buffer
+    const uint32_t threadCount = m_JobSystem->GetWorkerCount() + 1;
+    const uint32_t batchSize = std::max(1u, (updateCount + threadCount - 1) / threadCount);
+    m_AtlasChunkCount = (updateCount + batchSize - 1) / batchSize;
+    if (m_AtlasChunks.size() < m_AtlasChunkCount) {
+        m_AtlasChunks.resize(m_AtlasChunkCount);
+    }
+    const GLsizei indexCount = static_cast<GLsizei>(m_IndexCount);
+    m_JobSystem->ParallelFor(updateCount, batchSize, [&](uint32_t begin, uint32_t end) {
+        HENKY_PROFILE_ZONE("RecordAtlasChunk");
+        AtlasCommandChunk& chunk = m_AtlasChunks[begin / batchSize];
+        chunk.Commands.Reset();
+        chunk.Casters.clear();
+        chunk.CulledCount = 0;
+        chunk.DrawCount = 0;
+        for (uint32_t u = begin; u < end; u++) {
+            const ShadowAtlasUpdate& update = updates[u];
+            Frustum faceFrustum;
+            faceFrustum.ExtractFromMatrix(m_AtlasLights[update.Light].FaceViewProjection[update.Face]);
+            const uint32_t first = static_cast<uint32_t>(chunk.Casters.size());
+            for (size_t i = 0; i < m_Draws.size(); i++) {
+                if (faceFrustum.TestBox(m_DrawBounds[i].Center, m_DrawBounds[i].Extents)) {
+                    chunk.Casters.push_back(m_Draws[i]);
+                } else {
+                    chunk.CulledCount++;
+                }
+            }
+            
+            m_ShadowAtlas->RecordTile(update, chunk.Commands);
+            chunk.Commands.Uniform1i(tileLocation, static_cast<GLint>(update.Tile));
+            const uint32_t casterCount = static_cast<uint32_t>(chunk.Casters.size()) - first;
+            if (casterCount > 0) {
+                chunk.Commands.DrawElementsInstanced(indexCount, casterCount, first);
+                chunk.DrawCount++;
+            }
+        }
+    });
+    
+    // Pack the chunks' casters after the cascade casters; replay rebases their draws
+    uint32_t commandCount = 0;
+    for (uint32_t c = 0; c < m_AtlasChunkCount; c++) {
+        AtlasCommandChunk& chunk = m_AtlasChunks[c];
+        chunk.InstanceBase = static_cast<uint32_t>(m_ShadowDraws.size());
+        m_ShadowDraws.insert(m_ShadowDraws.end(), chunk.Casters.begin(), chunk.Casters.end());
+        m_Stats.ShadowCulledCount += chunk.CulledCount;
+        commandCount += chunk.Commands.GetCommandCount();
+    }
+    m_Stats.AtlasCommandCount = commandCount;
+    m_Stats.AtlasRecorded = true;
+    m_Stats.AtlasRecordMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Renderer::RenderLocalShadows(GLint tileLocation) {
+    HENKY_PROFILE_ZONE("Renderer::RenderLocalShadows");
+    const std::vector<ShadowAtlasUpdate>& updates = m_ShadowAtlas->GetUpdates();
+    if (updates.empty()) {
+        return;
+    }
+    
+    auto startTime = std::chrono::steady_clock::now();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_ShadowTileBuffer);
+    m_ShadowAtlas->BeginPass();
+    if (m_RecordCommands) {
+        // Shared state once, then the recorded tiles in order
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_ShadowDrawBuffer);
+        m_MaterialTable->Bind();
+        glBindVertexArray(m_CubeVAO);
+        for (uint32_t c = 0; c < m_AtlasChunkCount; c++) {
+            const AtlasCommandChunk& chunk = m_AtlasChunks[c];
+            chunk.Commands.Replay(chunk.InstanceBase);
+            m_Stats.ShadowDrawCount += chunk.DrawCount;
+            m_Stats.ShadowInstanceCount += static_cast<uint32_t>(chunk.Casters.size());
+            m_Stats.ShadowTriangleCount += static_cast<uint32_t>(chunk.Casters.size()) * (m_IndexCount / 3);
+        }
+    } else {
+        // Viewport, scissor, clear, uniform and draw per tile, counted like the recorded commands
+        for (size_t i = 0; i < updates.size(); i++) {
+            m_ShadowAtlas->BeginTile(updates[i]);
+            glUniform1i(tileLocation, static_cast<GLint>(updates[i].Tile));
+            DrawInstances(m_ShadowDrawBuffer, m_AtlasCasters[i].x, m_AtlasCasters[i].y, true);
+            m_Stats.AtlasCommandCount += m_AtlasCasters[i].y > 0 ? 5 : 4;
+        }
+    }
+    m_ShadowAtlas->EndPass();
+    m_Stats.AtlasSubmitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
 }
 
 void Renderer::RenderScene(ECSWorld* world, bool enableDepthPrepass, bool enableShadows) {
-    auto& registry = world->GetRegistry();
+    HENKY_PROFILE_ZONE("Renderer::RenderScene");
+    PrepareDraws(world);
+    const uint32_t instanceCount = static_cast<uint32_t>(m_Draws.size());
+    
+    // Local lights for the forward pass; shadow indices were filled in by the shadow pass
+    if (!enableShadows) {
+        for (LocalLightConstants& light : m_LocalLights) {
+            light.ShadowIndex = NoLocalShadow;
+        }
+    }
+    UploadStorage(m_LocalLightBuffer, m_LocalLightCapacity, m_LocalLights);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_LocalLightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_ShadowTileBuffer);
+    
+    // Bin the lights into view-space clusters so fragments only walk lights that reach them
+    m_LightClusters->Build(m_LocalLights, m_PerFrameConstants.ViewMatrix, m_PerFrameConstants.ProjectionMatrix);
+    m_LightClusters->Bind();
+    
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    m_PerFrameConstants.LocalLightCount = static_cast<uint32_t>(m_LocalLights.size());
+    m_PerFrameConstants.AtlasTexelSize = 1.0f / static_cast<float>(m_ShadowAtlas->GetResolution());
+    m_LightClusters->WriteConstants(m_PerFrameConstants, static_cast<uint32_t>(viewport[2]), static_cast<uint32_t>(viewport[3]));
+    glBindBuffer(GL_UNIFORM_BUFFER, m_PerFrameUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(PerFrameConstants, LocalLightCount),
+                    sizeof(PerFrameConstants) - offsetof(PerFrameConstants, LocalLightCount),
+                    &m_PerFrameConstants.LocalLightCount);
     
     // Depth prepass (optional)
     if (enableDepthPrepass) {
+        m_GpuProfiler->BeginPass("DepthPrepass");
         glUseProgram(m_DepthPrepassProgram);
         glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
         
-        auto view = registry.view<Transform, Renderable>();
-        for (auto entity : view) {
-            auto& transform = view.get<Transform>(entity);
-            auto& renderable = view.get<Renderable>(entity);
-            
-            if (!renderable.Visible) continue;
-            
-            PerDrawConstants perDraw;
-            perDraw.WorldMatrix = transform.GetWorldMatrix();
-            perDraw.MaterialIndex = 0;
-            
-            glBindBuffer(GL_UNIFORM_BUFFER, m_PerDrawUBO);
-            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PerDrawConstants), &perDraw);
-            
-            glBindVertexArray(m_CubeVAO);
-            glDrawElements(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, 0);
-        }
+        DrawInstances(m_DrawBuffer, 0, instanceCount);
         
         glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
         glDepthFunc(GL_EQUAL);
+        m_GpuProfiler->EndPass();
     }
     
     // Forward pass
+    m_GpuProfiler->BeginPass("Forward");
     glUseProgram(m_ForwardProgram);
     
     // Bind shadow map if shadows are enabled
     if (enableShadows && m_ShadowMap) {
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_ShadowMap->GetDepthTexture());
+        glBindTexture(GL_TEXTURE_2D_ARRAY, m_ShadowMap->GetDepthTexture());
         GLint shadowMapLoc = glGetUniformLocation(m_ForwardProgram, "uShadowMap");
         if (shadowMapLoc >= 0) {
             glUniform1i(shadowMapLoc, 0);
         }
     }
-    
-    auto view = registry.view<Transform, Renderable>();
-    for (auto entity : view) {
-        auto& transform = view.get<Transform>(entity);
-        auto& renderable = view.get<Renderable>(entity);
-        
-        if (!renderable.Visible) {
-            m_Stats.CulledCount++;
-            continue;
+    // Bound even without shadows so the sampler never aliases unit 0's array texture
+    if (m_ShadowAtlas) {
+        glActiveTexture(GL_TEXTURE0 + ShadowAtlas::TextureUnit);
+        glBindTexture(GL_TEXTURE_2D, m_ShadowAtlas->GetDepthTexture());
+        GLint atlasLoc = glGetUniformLocation(m_ForwardProgram, "uShadowAtlas");
+        if (atlasLoc >= 0) {
+            glUniform1i(atlasLoc, ShadowAtlas::TextureUnit);
         }
-        
-        // Update per-draw constants
-        PerDrawConstants perDraw;
-        perDraw.WorldMatrix = transform.GetWorldMatrix();
-        perDraw.MaterialIndex = 0;
-        
-        glBindBuffer(GL_UNIFORM_BUFFER, m_PerDrawUBO);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(PerDrawConstants), &perDraw);
-        
-        // Draw
-        glBindVertexArray(m_CubeVAO);
-        glDrawElements(GL_TRIANGLES, m_IndexCount, GL_UNSIGNED_INT, 0);
-        
-        m_Stats.DrawCount++;
-        m_Stats.TriangleCount += m_IndexCount / 3;
+        glActiveTexture(GL_TEXTURE0);
     }
     
+    // Materials come from the material table, so mixed materials still share one draw
+    DrawInstances(m_DrawBuffer, 0, instanceCount);
+    m_GpuProfiler->EndPass();
+    
     if (enableDepthPrepass) {
         glDepthFunc(GL_LESS);
     }
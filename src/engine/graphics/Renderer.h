@@ -3,6 +3,13 @@
 #include "ConstantBuffers.h"
 #include "AssetRegistry.h"
 #include "ShadowMap.h"
+#include "ShadowAtlas.h"
+#include "LightClusters.h"
+#include "MaterialTable.h"
+#include "CommandBuffer.h"
+#include "GpuProfiler.h"
+#include "DynamicResolution.h"
+#include "../core/FrameAllocator.h"
 #include <glad/gl.h>
 #include <glm/glm.hpp>
 #include <vector>
@@ -12,17 +19,41 @@
 namespace Henky3D {
 
 class ECSWorld;
+class JobSystem;
 
 struct Vertex {
     glm::vec3 Position;
     glm::vec3 Normal;
     glm::vec4 Color;
+    glm::vec2 TexCoord;
+};
+
+// Conservative world-space box of a draw, used for per-pass culling
+struct DrawBounds {
+    glm::vec3 Center;
+    glm::vec3 Extents;
+    bool Static;
 };
 
 struct RenderStats {
-    uint32_t DrawCount = 0;
+    uint32_t DrawCount = 0;      // Draw calls issued by the camera passes
+    uint32_t InstanceCount = 0;  // Instances drawn across the camera passes
     uint32_t CulledCount = 0;
     uint32_t TriangleCount = 0;
+    
+    // Shadow pass, summed over cascades
+    uint32_t ShadowDrawCount = 0;
+    uint32_t ShadowInstanceCount = 0;
+    uint32_t ShadowCulledCount = 0;  // Caster tests rejected by the cascade or receiver volumes
+    uint32_t ShadowTriangleCount = 0;
+    
+    // Shadow atlas tiles: recorded on workers and replayed, or issued directly
+    uint32_t AtlasCommandCount = 0;
+    float AtlasRecordMs = 0.0f;      // Parallel caster culling and recording
+    float AtlasSubmitMs = 0.0f;      // GL thread time of the replay or the direct calls
+    bool AtlasRecorded = false;
+
+    uint32_t SkippedLocalLights = 0; // Visible point and spot lights over MaxLocalLights
 };
 
 class Renderer {
@@ -42,9 +73,30 @@ public:
     bool GetShadowsEnabled() const { return m_ShadowsEnabled; }
     void SetShadowsEnabled(bool enabled) { m_ShadowsEnabled = enabled; }
     
+    // Record atlas tile commands on the job system instead of calling GL directly
+    bool GetRecordCommands() const { return m_RecordCommands; }
+    void SetRecordCommands(bool enabled) { m_RecordCommands = enabled; }
+    
     const RenderStats& GetStats() const { return m_Stats; }
     AssetRegistry* GetAssetRegistry() { return m_AssetRegistry.get(); }
+    JobSystem* GetJobSystem() { return m_JobSystem.get(); }
     ShadowMap* GetShadowMap() { return m_ShadowMap.get(); }
+    ShadowAtlas* GetShadowAtlas() { return m_ShadowAtlas.get(); }
+    LightClusters* GetLightClusters() { return m_LightClusters.get(); }
+    GpuProfiler* GetGpuProfiler() { return m_GpuProfiler.get(); }
+    DynamicResolution* GetDynamicResolution() { return m_DynamicResolution.get(); }
+
+    // Per-frame lists come from this arena; the renderer flips its own unless the application shares one
+    void SetFrameArena(FrameArena* arena);
+    FrameArena* GetFrameArena() { return m_FrameArena; }
+    uint32_t GetLocalLightCount() const { return static_cast<uint32_t>(m_LocalLights.size()); }
+    MaterialTable* GetMaterialTable() { return m_MaterialTable.get(); }
+
+    // Render extraction: per-draw constants and world bounds of every visible renderable,
+    // built on the job system without touching GL. Returns the number of hidden renderables.
+    static uint32_t ExtractDraws(ECSWorld* world, JobSystem& jobSystem, uint32_t materialCount,
+                                 std::vector<entt::entity>& entities, std::vector<PerDrawConstants>& draws,
+                                 std::vector<DrawBounds>& bounds);
 
 private:
     void CreateShaderPrograms();
@@ -52,15 +104,35 @@ private:
     GLuint LoadAndCompileShader(const char* filename, GLenum shaderType);
     GLuint CreateShaderProgram(const char* vsFile, const char* fsFile);
     std::string LoadShaderSource(const char* filename);
+    void PrepareDraws(ECSWorld* world);
+    void PrepareLights(ECSWorld* world);
+    void CullLocalShadowCasters();
+    void RecordLocalShadows(GLint tileLocation);
+    void RenderLocalShadows(GLint tileLocation);
+    template<typename T, typename Allocator>
+    void UploadStorage(GLuint& buffer, uint32_t& capacity, const std::vector<T, Allocator>& items);
+    void DrawInstances(GLuint drawBuffer, uint32_t firstInstance, uint32_t instanceCount, bool shadowPass = false);
 
     GraphicsDevice* m_Device;
+    std::unique_ptr<JobSystem> m_JobSystem;
     std::unique_ptr<AssetRegistry> m_AssetRegistry;
     std::unique_ptr<ShadowMap> m_ShadowMap;
+    std::unique_ptr<ShadowAtlas> m_ShadowAtlas;
+    std::unique_ptr<LightClusters> m_LightClusters;
+    std::unique_ptr<GpuProfiler> m_GpuProfiler;
+    std::unique_ptr<MaterialTable> m_MaterialTable;
+    std::unique_ptr<DynamicResolution> m_DynamicResolution;
+    std::unique_ptr<FrameArena> m_OwnedFrameArena;
+    FrameArena* m_FrameArena;
     
     // Shader programs
     GLuint m_ForwardProgram;
     GLuint m_DepthPrepassProgram;
     GLuint m_ShadowProgram;
+    GLuint m_LayerCopyProgram;
+    GLuint m_UpscaleProgram;
+    std::string m_ShaderDefines; // Injected after #version
+    std::string m_ShaderVersion; // Replaces the #version line when not empty
     
     // Cube geometry
     GLuint m_CubeVAO;
@@ -70,11 +142,49 @@ private:
     
     // Uniform buffers
     GLuint m_PerFrameUBO;
-    GLuint m_PerDrawUBO;
+    
+    // Per-draw SSBO: one PerDrawConstants entry per visible entity, shared by all passes
+    GLuint m_DrawBuffer;
+    GLuint m_ImmediateDrawBuffer; // Single entry for DrawCube
+    uint32_t m_DrawCapacity;
+    std::vector<PerDrawConstants> m_Draws;
+    std::vector<entt::entity> m_DrawEntities; // Visible renderables, filled into m_Draws in parallel
+    std::vector<DrawBounds> m_DrawBounds; // World-space bounds, parallel to m_Draws
+    uint64_t m_StaticCasterSignature;     // Hash of static draw transforms, drives the shadow cache
+    
+    // Shadow casters culled per cascade, packed back to back in one SSBO; frame arena lists
+    GLuint m_ShadowDrawBuffer;
+    uint32_t m_ShadowDrawCapacity;
+    FrameVector<PerDrawConstants> m_ShadowDraws;
+    FrameVector<glm::uvec2> m_AtlasCasters; // First shadow draw and count per atlas update
+    
+    // Atlas tiles recorded by workers, one chunk of updates each; casters are chunk-local until packed
+    struct AtlasCommandChunk {
+        CommandBuffer Commands;
+        std::vector<PerDrawConstants> Casters;
+        uint32_t InstanceBase = 0;
+        uint32_t CulledCount = 0;
+        uint32_t DrawCount = 0;
+    };
+    std::vector<AtlasCommandChunk> m_AtlasChunks;
+    uint32_t m_AtlasChunkCount;
+    
+    // Visible point and spot lights (SSBO binding 3) and their shadow atlas tiles (binding 4)
+    GLuint m_LocalLightBuffer;
+    uint32_t m_LocalLightCapacity;
+    std::vector<LocalLightConstants> m_LocalLights;
+    std::vector<ShadowAtlasLight> m_AtlasLights;
+    std::vector<uint32_t> m_AtlasLightSources; // m_LocalLights index of each atlas light
+    GLuint m_ShadowTileBuffer;
+    uint32_t m_ShadowTileCapacity;
+    uint64_t m_FrameIndex;
+    uint64_t m_PreparedFrame;
     
     PerFrameConstants m_PerFrameConstants;
     bool m_DepthPrepassEnabled;
     bool m_ShadowsEnabled;
+    bool m_RecordCommands;
+    bool m_LocalLightLimitWarned = false;
     
     RenderStats m_Stats;
 };
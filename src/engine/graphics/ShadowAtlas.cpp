@@ -0,0 +1,359 @@
+#include "ShadowAtlas.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <iostream>
+
+namespace Henky3D {
+
+namespace {
+
+bool IsPowerOfTwo(uint32_t value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+bool RemoveTile(std::vector<glm::uvec2>& tiles, glm::uvec2 tile) {
+    auto it = std::find(tiles.begin(), tiles.end(), tile);
+    if (it == tiles.end()) {
+        return false;
+    }
+    *it = tiles.back();
+    tiles.pop_back();
+    return true;
+}
+
+} // namespace
+
+ShadowAtlas::ShadowAtlas(GraphicsDevice* device, const ShadowAtlasSettings& settings)
+    : m_Device(device), m_Settings(settings), m_LevelCount(0) {
+    if (!IsPowerOfTwo(m_Settings.Resolution) || !IsPowerOfTwo(m_Settings.MaxTileSize) ||
+        !IsPowerOfTwo(m_Settings.MinTileSize) || m_Settings.MinTileSize > m_Settings.MaxTileSize ||
+        m_Settings.MaxTileSize > m_Settings.Resolution) {
+        throw std::runtime_error("Shadow atlas sizes must be powers of two with MinTileSize <= MaxTileSize <= Resolution");
+    }
+
+    for (uint32_t size = m_Settings.MaxTileSize; size >= m_Settings.MinTileSize; size >>= 1) {
+        m_LevelCount++;
+    }
+    m_FreeTiles.resize(m_LevelCount);
+    for (uint32_t y = 0; y < m_Settings.Resolution; y += m_Settings.MaxTileSize) {
+        for (uint32_t x = 0; x < m_Settings.Resolution; x += m_Settings.MaxTileSize) {
+            m_FreeTiles[0].push_back(glm::uvec2(x, y));
+        }
+    }
+
+    glGenTextures(1, &m_DepthTexture);
+    glBindTexture(GL_TEXTURE_2D, m_DepthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, m_Settings.Resolution, m_Settings.Resolution);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &m_Framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_DepthTexture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw std::runtime_error("Shadow atlas framebuffer is not complete");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    std::cout << "Shadow atlas created: " << m_Settings.Resolution << "x" << m_Settings.Resolution << ", tiles "
+              << m_Settings.MinTileSize << "-" << m_Settings.MaxTileSize << std::endl;
+}
+
+ShadowAtlas::~ShadowAtlas() {
+    if (m_DepthTexture) glDeleteTextures(1, &m_DepthTexture);
+    if (m_Framebuffer) glDeleteFramebuffers(1, &m_Framebuffer);
+}
+
+uint32_t ShadowAtlas::ComputeFaceMatrices(const Light& light, glm::mat4 outViewProjection[6]) {
+    const float nearPlane = std::max(0.05f, light.Range * 0.01f);
+
+    if (light.LightType == Light::Type::Spot) {
+        glm::vec3 direction = glm::normalize(light.Direction);
+        glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        float fov = std::clamp(2.0f * light.OuterConeAngle, 0.1f, glm::pi<float>() - 0.1f);
+        outViewProjection[0] = glm::perspective(fov, 1.0f, nearPlane, light.Range) *
+                               glm::lookAt(light.Position, light.Position + direction, up);
+        return 1;
+    }
+
+    // Cube faces in +X, -X, +Y, -Y, +Z, -Z order; the shader picks one by the major axis
+    static const glm::vec3 directions[6] = {
+        { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+        { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+    };
+    static const glm::vec3 ups[6] = {
+        { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f },
+        { 0.0f, 0.0f, -1.0f }, { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+    };
+    const glm::mat4 projection = glm::perspective(glm::half_pi<float>(), 1.0f, nearPlane, light.Range);
+    for (uint32_t face = 0; face < 6; face++) {
+        outViewProjection[face] = projection * glm::lookAt(light.Position, light.Position + directions[face], ups[face]);
+    }
+    return 6;
+}
+
+uint32_t ShadowAtlas::GetDesiredLevel(const ShadowAtlasLight& light) const {
+    // Point lights spread over six faces, so each face gets half the resolution
+    float size = static_cast<float>(m_Settings.MaxTileSize) * std::clamp(light.Importance, 0.0f, 1.0f);
+    if (light.FaceCount > 1) {
+        size *= 0.5f;
+    }
+    float level = std::floor(std::log2(static_cast<float>(m_Settings.MaxTileSize) / std::max(size, 1.0f)));
+    return std::min(static_cast<uint32_t>(std::max(level, 0.0f)), m_LevelCount - 1);
+}
+
+void ShadowAtlas::Update(std::vector<ShadowAtlasLight>& lights, uint64_t staticSignature) {
+    m_FrameIndex++;
+    m_Updates.clear();
+    m_Tiles.clear();
+    m_Stats = ShadowAtlasStats();
+
+    for (const ShadowAtlasLight& light : lights) {
+        m_Records[light.Key].LastFrame = m_FrameIndex;
+    }
+
+    // Lights that are gone (or culled) return their tiles
+    for (auto it = m_Records.begin(); it != m_Records.end();) {
+        if (it->second.LastFrame != m_FrameIndex) {
+            FreeLight(it->second);
+            it = m_Records.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    m_Order.resize(lights.size());
+    std::iota(m_Order.begin(), m_Order.end(), 0u);
+    std::sort(m_Order.begin(), m_Order.end(), [&lights](uint32_t a, uint32_t b) {
+        if (lights[a].Importance != lights[b].Importance) {
+            return lights[a].Importance > lights[b].Importance;
+        }
+        return lights[a].Key < lights[b].Key;
+    });
+
+    // When the lights want more than the atlas holds, every light drops the same number
+    // of levels so relative resolution is kept
+    const uint64_t capacity = static_cast<uint64_t>(m_Settings.Resolution) * m_Settings.Resolution;
+    uint32_t levelBias = 0;
+    for (; levelBias + 1 < m_LevelCount; levelBias++) {
+        uint64_t area = 0;
+        for (const ShadowAtlasLight& light : lights) {
+            uint64_t size = GetTileSize(std::min(GetDesiredLevel(light) + levelBias, m_LevelCount - 1));
+            area += light.FaceCount * size * size;
+        }
+        if (area <= capacity) {
+            break;
+        }
+    }
+    m_Stats.LevelBias = levelBias;
+
+    // Allocate tiles, most important lights first
+    for (size_t position = 0; position < m_Order.size(); position++) {
+        const ShadowAtlasLight& light = lights[m_Order[position]];
+        LightRecord& record = m_Records[light.Key];
+        const uint32_t desired = std::min(GetDesiredLevel(light) + levelBias, m_LevelCount - 1);
+
+        // Keep tiles that are the right size or one step too large, so lights moving
+        // across a size boundary do not reallocate every frame
+        if (record.Level != NoLevel && record.FaceCount == light.FaceCount &&
+            (record.Level == desired || record.Level + 1 == desired)) {
+            continue;
+        }
+
+        FreeLight(record);
+        auto tryAllocate = [&]() {
+            for (uint32_t level = desired; level < m_LevelCount; level++) {
+                if (AllocateLight(record, level, light.FaceCount)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        bool allocated = tryAllocate();
+        for (size_t victim = m_Order.size(); !allocated && victim-- > position + 1;) {
+            LightRecord& victimRecord = m_Records[lights[m_Order[victim]].Key];
+            if (victimRecord.Level != NoLevel) {
+                FreeLight(victimRecord);
+                allocated = tryAllocate();
+            }
+        }
+    }
+
+    // Pick stale faces to re-render within the budget; the rest keep the depth and
+    // projection they were last rendered with
+    uint32_t budget = m_Settings.MaxTileUpdatesPerFrame;
+    const float texelScale = 1.0f / static_cast<float>(m_Settings.Resolution);
+    uint64_t allocatedTexels = 0;
+    for (uint32_t index : m_Order) {
+        ShadowAtlasLight& light = lights[index];
+        LightRecord& record = m_Records[light.Key];
+        light.ShadowIndex = NoLocalShadow;
+        if (record.Level == NoLevel) {
+            m_Stats.LightsWithoutTile++;
+            continue;
+        }
+
+        const uint32_t tileSize = GetTileSize(record.Level);
+        const uint32_t firstTile = static_cast<uint32_t>(m_Tiles.size());
+        bool complete = true;
+        for (uint32_t face = 0; face < record.FaceCount; face++) {
+            bool valid = record.Rendered[face] && record.RenderedSignature[face] == staticSignature &&
+                         !light.FaceHasDynamicCasters[face] &&
+                         record.RenderedViewProjection[face] == light.FaceViewProjection[face];
+            if (valid) {
+                m_Stats.TilesCached++;
+            } else if (budget > 0) {
+                budget--;
+                record.Rendered[face] = true;
+                record.RenderedViewProjection[face] = light.FaceViewProjection[face];
+                record.RenderedSignature[face] = staticSignature;
+
+                ShadowAtlasUpdate update;
+                update.Light = index;
+                update.Face = face;
+                update.Tile = firstTile + face;
+                update.Viewport = glm::uvec4(record.Tiles[face].x, record.Tiles[face].y, tileSize, tileSize);
+                m_Updates.push_back(update);
+                m_Stats.TilesRendered++;
+            } else if (record.Rendered[face]) {
+                m_Stats.TilesDeferred++;
+            } else {
+                complete = false;
+            }
+
+            ShadowTileConstants tile;
+            tile.ViewProjection = record.RenderedViewProjection[face];
+            tile.AtlasRect = glm::vec4(glm::vec2(record.Tiles[face]) * texelScale, glm::vec2(tileSize * texelScale));
+            m_Tiles.push_back(tile);
+        }
+
+        m_Stats.TilesInUse += record.FaceCount;
+        allocatedTexels += static_cast<uint64_t>(record.FaceCount) * tileSize * tileSize;
+        if (complete) {
+            light.ShadowIndex = firstTile;
+            m_Stats.ShadowedLights++;
+        } else {
+            m_Stats.LightsWithoutTile++;
+        }
+    }
+    m_Stats.Occupancy = static_cast<float>(allocatedTexels) /
+                        (static_cast<float>(m_Settings.Resolution) * static_cast<float>(m_Settings.Resolution));
+}
+
+bool ShadowAtlas::AllocateTile(uint32_t level, glm::uvec2& outTile) {
+    std::vector<glm::uvec2>& freeTiles = m_FreeTiles[level];
+    if (!freeTiles.empty()) {
+        outTile = freeTiles.back();
+        freeTiles.pop_back();
+        return true;
+    }
+    if (level == 0) {
+        return false;
+    }
+
+    // Split a tile of the next larger size into four
+    glm::uvec2 parent;
+    if (!AllocateTile(level - 1, parent)) {
+        return false;
+    }
+    const uint32_t size = GetTileSize(level);
+    outTile = parent;
+    freeTiles.push_back(parent + glm::uvec2(size, 0));
+    freeTiles.push_back(parent + glm::uvec2(0, size));
+    freeTiles.push_back(parent + glm::uvec2(size, size));
+    return true;
+}
+
+void ShadowAtlas::FreeTile(uint32_t level, glm::uvec2 tile) {
+    std::vector<glm::uvec2>& freeTiles = m_FreeTiles[level];
+    if (level > 0) {
+        // Merge back into the parent once all four quadrants are free
+        const uint32_t size = GetTileSize(level);
+        const uint32_t parentSize = size * 2;
+        const glm::uvec2 parent = (tile / parentSize) * parentSize;
+        const glm::uvec2 quadrants[4] = { parent, parent + glm::uvec2(size, 0), parent + glm::uvec2(0, size),
+                                          parent + glm::uvec2(size, size) };
+        uint32_t freeSiblings = 0;
+        for (const glm::uvec2& quadrant : quadrants) {
+            if (quadrant != tile && std::find(freeTiles.begin(), freeTiles.end(), quadrant) != freeTiles.end()) {
+                freeSiblings++;
+            }
+        }
+        if (freeSiblings == 3) {
+            for (const glm::uvec2& quadrant : quadrants) {
+                if (quadrant != tile) {
+                    RemoveTile(freeTiles, quadrant);
+                }
+            }
+            FreeTile(level - 1, parent);
+            return;
+        }
+    }
+    freeTiles.push_back(tile);
+}
+
+bool ShadowAtlas::AllocateLight(LightRecord& record, uint32_t level, uint32_t faceCount) {
+    for (uint32_t face = 0; face < faceCount; face++) {
+        if (!AllocateTile(level, record.Tiles[face])) {
+            for (uint32_t allocated = 0; allocated < face; allocated++) {
+                FreeTile(level, record.Tiles[allocated]);
+            }
+            return false;
+        }
+    }
+    record.Level = level;
+    record.FaceCount = faceCount;
+    for (bool& rendered : record.Rendered) {
+        rendered = false;
+    }
+    return true;
+}
+
+void ShadowAtlas::FreeLight(LightRecord& record) {
+    if (record.Level == NoLevel) {
+        return;
+    }
+    for (uint32_t face = 0; face < record.FaceCount; face++) {
+        FreeTile(record.Level, record.Tiles[face]);
+    }
+    record.Level = NoLevel;
+    record.FaceCount = 0;
+}
+
+void ShadowAtlas::BeginPass() {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_PreviousFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
+    glEnable(GL_SCISSOR_TEST);
+}
+
+void ShadowAtlas::BeginTile(const ShadowAtlasUpdate& update) {
+    const glm::uvec4& viewport = update.Viewport;
+    glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+    glScissor(viewport.x, viewport.y, viewport.z, viewport.w);
+    glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::RecordTile(const ShadowAtlasUpdate& update, CommandBuffer& commands) const {
+    const glm::uvec4& viewport = update.Viewport;
+    commands.Viewport(viewport.x, viewport.y, viewport.z, viewport.w);
+    commands.Scissor(viewport.x, viewport.y, viewport.z, viewport.w);
+    commands.Clear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::EndPass() {
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_PreviousFramebuffer));
+}
+
+} // namespace Henky3D
@@ -0,0 +1,123 @@
+#pragma once
+#include "GraphicsDevice.h"
+#include "ConstantBuffers.h"
+#include "CommandBuffer.h"
+#include "../ecs/Components.h"
+#include <glad/gl.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+
+namespace Henky3D {
+
+struct ShadowAtlasSettings {
+    uint32_t Resolution = 4096;
+    uint32_t MaxTileSize = 1024;      // Tile of a light filling the screen
+    uint32_t MinTileSize = 128;
+    uint32_t MaxTileUpdatesPerFrame = 8; // Faces rendered per frame; the rest keep last frame's depth
+};
+
+struct ShadowAtlasStats {
+    uint32_t ShadowedLights = 0;   // Lights with complete shadows this frame
+    uint32_t LightsWithoutTile = 0; // Did not fit, or never rendered yet and over budget
+    uint32_t TilesInUse = 0;
+    uint32_t TilesRendered = 0;
+    uint32_t TilesCached = 0;
+    uint32_t TilesDeferred = 0;    // Stale but over the update budget
+    float Occupancy = 0.0f;        // Fraction of the atlas area allocated
+    uint32_t LevelBias = 0;        // Levels every light was shrunk by to fit
+};
+
+// A shadowed local light as the renderer sees it this frame
+struct ShadowAtlasLight {
+    uint64_t Key = 0;              // Stable identity across frames, e.g. the entity
+    uint32_t FaceCount = 1;        // 6 for point lights, 1 for spot lights
+    glm::mat4 FaceViewProjection[6];
+    bool FaceHasDynamicCasters[6] = {};
+    float Importance = 0.0f;       // Projected size on screen, 1 = full screen height
+
+    uint32_t ShadowIndex = NoLocalShadow; // Output: first tile entry, or NoLocalShadow
+};
+
+// A face the renderer has to draw into the atlas this frame
+struct ShadowAtlasUpdate {
+    uint32_t Light;                // Index into the lights passed to Update
+    uint32_t Face;
+    uint32_t Tile;                 // Entry in GetTileConstants
+    glm::uvec4 Viewport;           // x, y, size, size in texels
+};
+
+// One depth texture shared by the shadows of every point and spot light. Tiles
+// are square power-of-two blocks handed out by a quadtree buddy allocator, sized
+// by each light's screen-space importance and shrunk uniformly when the atlas
+// is oversubscribed; the most important lights allocate first and may take
+// tiles from less important ones. Tiles keep their depth across frames and are
+// only re-rendered when the light moves, the static caster signature changes or
+// dynamic casters touch them, at most MaxTileUpdatesPerFrame faces per frame.
+class ShadowAtlas {
+public:
+    static constexpr GLuint TextureUnit = 2;
+
+    ShadowAtlas(GraphicsDevice* device, const ShadowAtlasSettings& settings = {});
+    ~ShadowAtlas();
+
+    // Face projections of a point or spot light; returns the face count
+    static uint32_t ComputeFaceMatrices(const Light& light, glm::mat4 outViewProjection[6]);
+
+    // Assign tiles and pick the faces to render; fills each light's ShadowIndex
+    void Update(std::vector<ShadowAtlasLight>& lights, uint64_t staticSignature);
+
+    const std::vector<ShadowAtlasUpdate>& GetUpdates() const { return m_Updates; }
+    const std::vector<ShadowTileConstants>& GetTileConstants() const { return m_Tiles; }
+
+    void BeginPass();
+    void BeginTile(const ShadowAtlasUpdate& update);
+    void RecordTile(const ShadowAtlasUpdate& update, CommandBuffer& commands) const; // Same as BeginTile, any thread
+    void EndPass();
+
+    GLuint GetDepthTexture() const { return m_DepthTexture; }
+    uint32_t GetResolution() const { return m_Settings.Resolution; }
+    void SetMaxTileUpdatesPerFrame(uint32_t count) { m_Settings.MaxTileUpdatesPerFrame = count; }
+    const ShadowAtlasSettings& GetSettings() const { return m_Settings; }
+    const ShadowAtlasStats& GetStats() const { return m_Stats; }
+
+private:
+    static constexpr uint32_t NoLevel = 0xFFFFFFFFu;
+
+    struct LightRecord {
+        uint32_t Level = NoLevel;  // Tile level of every face; NoLevel = no tiles
+        uint32_t FaceCount = 0;
+        glm::uvec2 Tiles[6];
+        bool Rendered[6] = {};
+        glm::mat4 RenderedViewProjection[6];
+        uint64_t RenderedSignature[6] = {};
+        uint64_t LastFrame = 0;
+    };
+
+    uint32_t GetTileSize(uint32_t level) const { return m_Settings.MaxTileSize >> level; }
+    uint32_t GetDesiredLevel(const ShadowAtlasLight& light) const;
+
+    // Buddy allocator over square tiles; level 0 is MaxTileSize
+    bool AllocateTile(uint32_t level, glm::uvec2& outTile);
+    void FreeTile(uint32_t level, glm::uvec2 tile);
+    bool AllocateLight(LightRecord& record, uint32_t level, uint32_t faceCount);
+    void FreeLight(LightRecord& record);
+
+    GraphicsDevice* m_Device;
+    ShadowAtlasSettings m_Settings;
+    ShadowAtlasStats m_Stats;
+    uint32_t m_LevelCount;
+    uint64_t m_FrameIndex = 0;
+
+    GLuint m_Framebuffer = 0;
+    GLint m_PreviousFramebuffer = 0;  // Restored by EndPass
+    GLuint m_DepthTexture = 0;
+
+    std::vector<std::vector<glm::uvec2>> m_FreeTiles; // Per level
+    std::unordered_map<uint64_t, LightRecord> m_Records;
+    std::vector<ShadowAtlasUpdate> m_Updates;
+    std::vector<ShadowTileConstants> m_Tiles;
+    std::vector<uint32_t> m_Order; // Scratch, lights by importance
+};
+
+} // namespace Henky3D
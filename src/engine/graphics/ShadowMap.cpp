@@ -1,17 +1,24 @@
 #include "ShadowMap.h"
+#include "../ecs/ECSWorld.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
 #include <stdexcept>
 #include <iostream>
 
 namespace Henky3D {
 
-ShadowMap::ShadowMap(GraphicsDevice* device, uint32_t resolution)
-    : m_Device(device), m_Resolution(resolution), m_Framebuffer(0), m_DepthTexture(0) {
+ShadowMap::ShadowMap(GraphicsDevice* device, uint32_t resolution, const ShadowSettings& settings)
+    : m_Device(device), m_Resolution(resolution), m_Settings(settings), m_Framebuffer(0), m_DepthTexture(0),
+      m_StaticTexture(0) {
+    m_Settings.CascadeCount = std::clamp(m_Settings.CascadeCount, 1u, MaxShadowCascades);
+    glGenQueries(QueryLatency * MaxShadowCascades, &m_TimerQueries[0][0]);
     CreateResources();
 }
 
 ShadowMap::~ShadowMap() {
     DestroyResources();
+    glDeleteQueries(QueryLatency * MaxShadowCascades, &m_TimerQueries[0][0]);
 }
 
 void ShadowMap::CreateResources() {
@@ -19,26 +26,30 @@ void ShadowMap::CreateResources() {
     glGenFramebuffers(1, &m_Framebuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
     
-    // Create depth texture
+    // One depth layer per cascade; the maximum is allocated so the count can change freely
+    glGenTextures(1, &m_StaticTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_StaticTexture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, m_Resolution, m_Resolution, MaxShadowCascades);
+    
     glGenTextures(1, &m_DepthTexture);
-    glBindTexture(GL_TEXTURE_2D, m_DepthTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, m_Resolution, m_Resolution, 
-                 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_DepthTexture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, m_Resolution, m_Resolution, MaxShadowCascades);
     
     // Set texture parameters for shadow sampling
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
     float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
     
     // Enable shadow comparison mode
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
     
-    // Attach depth texture to framebuffer
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_DepthTexture, 0);
+    // Attach the first layer to validate the framebuffer; cascades re-attach their own layer
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_DepthTexture, 0, 0);
     
     // No color attachment needed for shadow map
     glDrawBuffer(GL_NONE);
@@ -51,7 +62,13 @@ void ShadowMap::CreateResources() {
     
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     
-    std::cout << "Shadow map created: " << m_Resolution << "x" << m_Resolution << std::endl;
+    for (uint32_t i = 0; i < MaxShadowCascades; i++) {
+        m_CacheValid[i] = false;
+        m_LayerMatchesCache[i] = false;
+    }
+    
+    std::cout << "Shadow map created: " << m_Resolution << "x" << m_Resolution << " x "
+              << MaxShadowCascades << " cascades" << std::endl;
 }
 
 void ShadowMap::DestroyResources() {
@@ -59,6 +76,10 @@ void ShadowMap::DestroyResources() {
         glDeleteTextures(1, &m_DepthTexture);
         m_DepthTexture = 0;
     }
+    if (m_StaticTexture) {
+        glDeleteTextures(1, &m_StaticTexture);
+        m_StaticTexture = 0;
+    }
     if (m_Framebuffer) {
         glDeleteFramebuffers(1, &m_Framebuffer);
         m_Framebuffer = 0;
@@ -73,42 +94,256 @@ void ShadowMap::Resize(uint32_t resolution) {
     CreateResources();
 }
 
+void ShadowMap::SetCascadeCount(uint32_t count) {
+    m_Settings.CascadeCount = std::clamp(count, 1u, MaxShadowCascades);
+}
+
+void ShadowMap::UpdateCascades(const Camera& camera, const glm::vec3& lightDirection, float receiverDistance) {
+    const uint32_t cascadeCount = m_Settings.CascadeCount;
+    const float nearPlane = camera.NearPlane;
+
+    // Round the receiver distance up to coarse steps so the splits (and the static cache)
+    // only change when the farthest receiver moves by a sizeable amount
+    const float step = m_Settings.MaxDistance / static_cast<float>(ReceiverDistanceSteps);
+    if (receiverDistance < m_Settings.MaxDistance) {
+        receiverDistance = std::max(step, std::ceil(receiverDistance / step) * step);
+    }
+    const float farPlane = std::max(nearPlane + 0.01f,
+                                    std::min({ camera.FarPlane, m_Settings.MaxDistance, receiverDistance }));
+
+    // Practical split scheme: blend of logarithmic and uniform distribution
+    float splits[MaxShadowCascades + 1];
+    splits[0] = nearPlane;
+    for (uint32_t i = 1; i <= cascadeCount; i++) {
+        float t = static_cast<float>(i) / static_cast<float>(cascadeCount);
+        float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+        float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+        splits[i] = m_Settings.SplitLambda * logSplit + (1.0f - m_Settings.SplitLambda) * uniformSplit;
+    }
+
+    const glm::mat4 inverseView = glm::inverse(camera.GetViewMatrix());
+    const float tanHalfFov = std::tan(camera.FOV * 0.5f);
+    const glm::vec3 lightDir = glm::normalize(lightDirection);
+    const glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    const glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+
+    for (uint32_t i = 0; i < cascadeCount; i++) {
+        ShadowCascade& cascade = m_Cascades[i];
+        cascade.SplitNear = splits[i];
+        cascade.SplitFar = splits[i + 1];
+
+        // Slice corners in world space
+        glm::vec3 corners[8];
+        glm::vec3 center(0.0f);
+        for (uint32_t c = 0; c < 8; c++) {
+            float depth = (c & 4) ? cascade.SplitFar : cascade.SplitNear;
+            float x = ((c & 1) ? 1.0f : -1.0f) * depth * tanHalfFov * camera.AspectRatio;
+            float y = ((c & 2) ? 1.0f : -1.0f) * depth * tanHalfFov;
+            corners[c] = glm::vec3(inverseView * glm::vec4(x, y, -depth, 1.0f));
+            center += corners[c];
+        }
+        center /= 8.0f;
+
+        // A bounding sphere keeps the projection size constant while the camera turns
+        float radius = 0.0f;
+        for (const glm::vec3& corner : corners) {
+            radius = std::max(radius, glm::length(corner - center));
+        }
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        cascade.Radius = radius;
+
+        // Snap the center to whole shadow texels in light space so edges do not crawl as the
+        // camera moves; the matrix also stays bit-identical until a texel boundary is crossed,
+        // which is what keeps the static cache valid
+        const float texelSize = 2.0f * radius / static_cast<float>(m_Resolution);
+        glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+        lightCenter = glm::floor(lightCenter / texelSize) * texelSize;
+
+        // Eye sits radius back from the center along the light direction (-Z in light view)
+        glm::mat4 lightView = lightRotation;
+        lightView[3] = glm::vec4(-lightCenter.x, -lightCenter.y, -(lightCenter.z + radius), 1.0f);
+        glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, 2.0f * radius);
+
+        cascade.ViewProjection = lightProjection * lightView;
+        cascade.Bounds.ExtractFromMatrix(cascade.ViewProjection);
+    }
+}
+
+void ShadowMap::WriteConstants(PerFrameConstants& constants) const {
+    constants.CascadeCount = m_Settings.CascadeCount;
+    constants.ShadowTexelSize = 1.0f / static_cast<float>(m_Resolution);
+    for (uint32_t i = 0; i < MaxShadowCascades; i++) {
+        const ShadowCascade& cascade = m_Cascades[std::min(i, m_Settings.CascadeCount - 1)];
+        constants.CascadeViewProjection[i] = cascade.ViewProjection;
+        constants.CascadeSplits[i] = i < m_Settings.CascadeCount ? cascade.SplitFar : 0.0f;
+    }
+}
+
+bool ShadowMap::TestCaster(const ShadowCascade& cascade, const glm::vec3& center, const glm::vec3& extents) {
+    // Planes: left, right, bottom, top, near (skipped), far
+    for (int i = 0; i < 6; i++) {
+        if (i == 4) {
+            continue;
+        }
+        const glm::vec4& plane = cascade.Bounds.Planes[i];
+        float r = glm::dot(extents, glm::abs(glm::vec3(plane)));
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -r) {
+            return false;
+        }
+    }
+    return true;
+}
+
+float ShadowMap::FindReceiverDistance(ECSWorld* world, const Camera& camera) {
+    const Frustum frustum = camera.GetFrustum();
+    const glm::vec3 forward = glm::normalize(camera.Target - camera.Position);
+
+    float distance = 0.0f;
+    auto view = world->GetRegistry().view<Transform, Renderable, BoundingBox>();
+    for (auto entity : view) {
+        if (!view.get<Renderable>(entity).Visible) {
+            continue;
+        }
+
+        // Same conservative world bounds as the culling system
+        const auto& boundingBox = view.get<BoundingBox>(entity);
+        glm::mat4 worldMatrix = view.get<Transform>(entity).GetWorldMatrix();
+        glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(boundingBox.GetCenter(), 1.0f));
+        float maxScale = std::max({ glm::length(glm::vec3(worldMatrix[0])), glm::length(glm::vec3(worldMatrix[1])),
+                                    glm::length(glm::vec3(worldMatrix[2])) });
+        glm::vec3 extents = boundingBox.GetExtents() * maxScale;
+        if (!frustum.TestBox(center, extents)) {
+            continue;
+        }
+
+        float farDepth = glm::dot(center - camera.Position, forward) + glm::dot(extents, glm::abs(forward));
+        distance = std::max(distance, farDepth);
+    }
+    return distance;
+}
+
+void ShadowMap::GetLightBounds(const ShadowCascade& cascade, const glm::vec3& center, const glm::vec3& extents,
+                               glm::vec3& outMin, glm::vec3& outMax) {
+    // The light projection is orthographic, so boxes stay boxes: project the center and
+    // accumulate the extents through the absolute rotation part
+    const glm::mat4& m = cascade.ViewProjection;
+    glm::vec3 clipCenter = glm::vec3(m * glm::vec4(center, 1.0f));
+    glm::vec3 clipExtents = glm::abs(glm::vec3(m[0])) * extents.x + glm::abs(glm::vec3(m[1])) * extents.y +
+                            glm::abs(glm::vec3(m[2])) * extents.z;
+    outMin = clipCenter - clipExtents;
+    outMax = clipCenter + clipExtents;
+}
+
+bool ShadowMap::TestCaster(const ShadowCascade& cascade, const glm::vec3& center, const glm::vec3& extents,
+                           const glm::vec3& receiverMin, const glm::vec3& receiverMax) {
+    if (!TestCaster(cascade, center, extents)) {
+        return false;
+    }
+
+    // Overlap in x/y, and the caster starts in front of the farthest receiver
+    glm::vec3 casterMin, casterMax;
+    GetLightBounds(cascade, center, extents, casterMin, casterMax);
+    return casterMin.x <= receiverMax.x && casterMax.x >= receiverMin.x &&
+           casterMin.y <= receiverMax.y && casterMax.y >= receiverMin.y &&
+           casterMin.z <= receiverMax.z;
+}
+
+void ShadowMap::SetStaticCasterSignature(uint64_t signature) {
+    if (signature != m_StaticSignature) {
+        m_StaticSignature = signature;
+        for (bool& valid : m_CacheValid) {
+            valid = false;
+        }
+    }
+}
+
+void ShadowMap::SetCacheStaticCasters(bool enabled) {
+    m_Settings.CacheStaticCasters = enabled;
+    for (uint32_t i = 0; i < MaxShadowCascades; i++) {
+        m_CacheValid[i] = false;
+        m_LayerMatchesCache[i] = false;
+    }
+}
+
+bool ShadowMap::IsStaticCacheValid(uint32_t cascade) const {
+    return m_Settings.CacheStaticCasters && m_CacheValid[cascade] &&
+           m_CachedViewProjection[cascade] == m_Cascades[cascade].ViewProjection;
+}
+
 void ShadowMap::BeginShadowPass() {
+    // Collect timings issued QueryLatency frames ago; skip any the GPU has not finished
+    m_QueryFrame = (m_QueryFrame + 1) % QueryLatency;
+    for (uint32_t i = 0; i < MaxShadowCascades; i++) {
+        if (!m_QueryPending[m_QueryFrame][i]) {
+            continue;
+        }
+        GLuint available = 0;
+        glGetQueryObjectuiv(m_TimerQueries[m_QueryFrame][i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(m_TimerQueries[m_QueryFrame][i], GL_QUERY_RESULT, &elapsed);
+            m_Stats.Cascades[i].GpuTimeMs = static_cast<float>(elapsed) / 1.0e6f;
+        }
+        m_QueryPending[m_QueryFrame][i] = false;
+    }
+    m_Stats.CascadeCount = m_Settings.CascadeCount;
+
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_PreviousFramebuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, m_Framebuffer);
     glViewport(0, 0, m_Resolution, m_Resolution);
+    
+    // Pancake casters in front of the near plane onto it instead of clipping them
+    glEnable(GL_DEPTH_CLAMP);
+}
+
+void ShadowMap::BeginCascade(uint32_t cascade) {
+    glBeginQuery(GL_TIME_ELAPSED, m_TimerQueries[m_QueryFrame][cascade]);
+    m_Stats.Cascades[cascade].Cached = IsStaticCacheValid(cascade);
+}
+
+void ShadowMap::BeginStaticCache(uint32_t cascade) {
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_StaticTexture, 0, static_cast<GLint>(cascade));
     glClear(GL_DEPTH_BUFFER_BIT);
 }
 
-void ShadowMap::EndShadowPass() {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void ShadowMap::EndStaticCache(uint32_t cascade) {
+    m_CachedViewProjection[cascade] = m_Cascades[cascade].ViewProjection;
+    m_CacheValid[cascade] = true;
+    m_LayerMatchesCache[cascade] = false;
+    m_Stats.CacheRebuilds++;
 }
 
-glm::mat4 ShadowMap::ComputeLightViewProjection(const glm::vec3& lightDirection,
-                                                 const glm::vec3& sceneBoundsMin,
-                                                 const glm::vec3& sceneBoundsMax) {
-    // Compute scene center and size
-    glm::vec3 sceneCenter = (sceneBoundsMin + sceneBoundsMax) * 0.5f;
-    glm::vec3 sceneExtents = sceneBoundsMax - sceneBoundsMin;
-    float sceneRadius = glm::length(sceneExtents) * 0.5f;
-    
-    // Normalize light direction
-    glm::vec3 lightDir = glm::normalize(lightDirection);
-    
-    // Position light to look at scene center
-    glm::vec3 lightPos = sceneCenter - lightDir * sceneRadius * 2.0f;
-    
-    // Compute light view matrix
-    glm::mat4 lightView = glm::lookAt(lightPos, sceneCenter, glm::vec3(0.0f, 1.0f, 0.0f));
+void ShadowMap::BeginDynamicCasters(uint32_t cascade) {
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_DepthTexture, 0, static_cast<GLint>(cascade));
     
-    // Compute orthographic projection that encompasses the scene
-    float orthoSize = sceneRadius * 2.0f;
-    glm::mat4 lightProjection = glm::ortho(
-        -orthoSize, orthoSize,
-        -orthoSize, orthoSize,
-        0.1f, sceneRadius * 4.0f
-    );
+    if (!IsStaticCacheValid(cascade)) {
+        glClear(GL_DEPTH_BUFFER_BIT);
+        m_LayerMatchesCache[cascade] = false;
+        return;
+    }
     
-    return lightProjection * lightView;
+    // The live layer already holds exactly the cache when no dynamic caster touched it last frame
+    if (!m_LayerMatchesCache[cascade]) {
+        glCopyImageSubData(m_StaticTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(cascade),
+                           m_DepthTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, static_cast<GLint>(cascade),
+                           m_Resolution, m_Resolution, 1);
+        m_LayerMatchesCache[cascade] = true;
+    }
+}
+
+void ShadowMap::EndCascade(uint32_t cascade, uint32_t casters, uint32_t triangles, bool dynamicDrawn) {
+    glEndQuery(GL_TIME_ELAPSED);
+    m_QueryPending[m_QueryFrame][cascade] = true;
+    if (dynamicDrawn) {
+        m_LayerMatchesCache[cascade] = false;
+    }
+    m_Stats.Cascades[cascade].Casters = casters;
+    m_Stats.Cascades[cascade].Triangles = triangles;
+}
+
+void ShadowMap::EndShadowPass() {
+    glDisable(GL_DEPTH_CLAMP);
+    glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(m_PreviousFramebuffer));
 }
 
 } // namespace Henky3D
@@ -1,37 +1,137 @@
 #pragma once
 #include "GraphicsDevice.h"
+#include "ConstantBuffers.h"
+#include "../ecs/Components.h"
 #include <glad/gl.h>
 #include <glm/glm.hpp>
+#include <cfloat>
 
 namespace Henky3D {
 
+class ECSWorld;
+
+struct ShadowSettings {
+    uint32_t CascadeCount = 4;    // 1..MaxShadowCascades
+    float MaxDistance = 100.0f;   // Shadows end here or at the camera far plane, whichever is closer
+    float SplitLambda = 0.75f;    // 0 = uniform splits, 1 = logarithmic splits
+    bool CacheStaticCasters = true; // Keep static casters in a cached depth array between frames
+};
+
+// One slice of the view frustum and the light projection that covers it
+struct ShadowCascade {
+    glm::mat4 ViewProjection = glm::mat4(1.0f);
+    Frustum Bounds;               // Planes of the light projection, for caster culling
+    float SplitNear = 0.0f;       // View-space distances covered by the slice
+    float SplitFar = 0.0f;
+    float Radius = 0.0f;          // Bounding sphere of the slice; the projection is 2 * Radius wide
+};
+
+struct ShadowCascadeStats {
+    uint32_t Casters = 0;         // Drawn this frame, static cache rebuild included
+    uint32_t Triangles = 0;
+    bool Cached = false;          // Static casters came from the cache
+    float GpuTimeMs = 0.0f;       // Lags a few frames behind
+};
+
+struct ShadowStats {
+    uint32_t CascadeCount = 0;
+    ShadowCascadeStats Cascades[MaxShadowCascades];
+    uint64_t CacheRebuilds = 0;
+};
+
+// Cascaded shadow map for the directional light: one depth texture array layer
+// per cascade. Cascade projections are fitted to bounding spheres of the view
+// frustum slices and snapped to whole texels, so they do not shimmer as the
+// camera moves or turns. Casters in front of a cascade's near plane are
+// clamped onto it (depth clamp), which lets the projection stay tight.
+//
+// Static casters are rendered into a second array that persists across frames.
+// Each frame the cached layer is copied into the live one and only dynamic
+// casters are drawn on top. A cascade's cache is rebuilt when its projection
+// changes (light direction, or the camera crossing a shadow texel) or when the
+// static caster signature does.
 class ShadowMap {
 public:
-    ShadowMap(GraphicsDevice* device, uint32_t resolution = 2048);
+    ShadowMap(GraphicsDevice* device, uint32_t resolution = 2048, const ShadowSettings& settings = {});
     ~ShadowMap();
 
     void Resize(uint32_t resolution);
+    void SetCascadeCount(uint32_t count);
+    void SetMaxDistance(float distance) { m_Settings.MaxDistance = distance; }
+    const ShadowSettings& GetSettings() const { return m_Settings; }
+
+    // Fit the cascades to the camera for this frame; receiverDistance (see FindReceiverDistance)
+    // pulls the far end of the last cascade in to the farthest visible receiver
+    void UpdateCascades(const Camera& camera, const glm::vec3& lightDirection, float receiverDistance = FLT_MAX);
+
+    // Cascade matrices, split distances and texel size for the shaders
+    void WriteConstants(PerFrameConstants& constants) const;
+
+    // Hash of every static caster's transform; a change invalidates all cached cascades
+    void SetStaticCasterSignature(uint64_t signature);
+    void SetCacheStaticCasters(bool enabled);
+    bool IsStaticCacheValid(uint32_t cascade) const;
+
+    // Per cascade: BeginCascade, then optionally BeginStaticCache/EndStaticCache around
+    // the static casters, then BeginDynamicCasters before drawing the rest
     void BeginShadowPass();
+    void BeginCascade(uint32_t cascade);
+    void BeginStaticCache(uint32_t cascade);
+    void EndStaticCache(uint32_t cascade);
+    void BeginDynamicCasters(uint32_t cascade);
+    void EndCascade(uint32_t cascade, uint32_t casters, uint32_t triangles, bool dynamicDrawn);
     void EndShadowPass();
     
-    GLuint GetDepthTexture() const { return m_DepthTexture; }
+    GLuint GetDepthTexture() const { return m_DepthTexture; } // GL_TEXTURE_2D_ARRAY
     GLuint GetFramebuffer() const { return m_Framebuffer; }
     uint32_t GetResolution() const { return m_Resolution; }
-    
-    // Compute light view-projection matrix for directional light
-    static glm::mat4 ComputeLightViewProjection(const glm::vec3& lightDirection, 
-                                                const glm::vec3& sceneBoundsMin,
-                                                const glm::vec3& sceneBoundsMax);
+    uint32_t GetCascadeCount() const { return m_Settings.CascadeCount; }
+    const ShadowCascade& GetCascade(uint32_t index) const { return m_Cascades[index]; }
+    const ShadowStats& GetStats() const { return m_Stats; }
+
+    // View depth of the farthest renderable inside the camera frustum, 0 when nothing is visible
+    static float FindReceiverDistance(ECSWorld* world, const Camera& camera);
+
+    // Side planes and far plane only: casters nearer the light than the cascade still cast into it
+    static bool TestCaster(const ShadowCascade& cascade, const glm::vec3& center, const glm::vec3& extents);
+
+    // Box in the cascade's light clip space (x, y in [-1, 1], z grows away from the light)
+    static void GetLightBounds(const ShadowCascade& cascade, const glm::vec3& center, const glm::vec3& extents,
+                               glm::vec3& outMin, glm::vec3& outMax);
+
+    // The caster overlaps the receivers' light-space box extended toward the light,
+    // i.e. it can shadow at least one visible receiver
+    static bool TestCaster(const ShadowCascade& cascade, const glm::vec3& center, const glm::vec3& extents,
+                           const glm::vec3& receiverMin, const glm::vec3& receiverMax);
 
 private:
+    static constexpr uint32_t QueryLatency = 3; // Frames before a timer query is read back
+    static constexpr uint32_t ReceiverDistanceSteps = 16; // Receiver distance granularity per MaxDistance
+
     void CreateResources();
     void DestroyResources();
     
     GraphicsDevice* m_Device;
     uint32_t m_Resolution;
+    ShadowSettings m_Settings;
+    ShadowCascade m_Cascades[MaxShadowCascades];
+    ShadowStats m_Stats;
     
     GLuint m_Framebuffer;
+    GLint m_PreviousFramebuffer = 0;  // Restored by EndShadowPass
     GLuint m_DepthTexture;
+    GLuint m_StaticTexture;       // Static casters only, same layout as m_DepthTexture
+
+    // Static cache state per cascade
+    glm::mat4 m_CachedViewProjection[MaxShadowCascades];
+    bool m_CacheValid[MaxShadowCascades] = {};
+    bool m_LayerMatchesCache[MaxShadowCascades] = {}; // Live layer holds the cache and nothing else
+    uint64_t m_StaticSignature = 0;
+
+    // GPU timing per cascade, QueryLatency frames deep
+    GLuint m_TimerQueries[QueryLatency][MaxShadowCascades] = {};
+    bool m_QueryPending[QueryLatency][MaxShadowCascades] = {};
+    uint32_t m_QueryFrame = 0;
 };
 
 } // namespace Henky3D
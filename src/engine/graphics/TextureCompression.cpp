@@ -0,0 +1,404 @@
+#include "TextureCompression.h"
+#include "../core/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define HENKY_BC_SSE2 1
+#endif
+
+namespace Henky3D {
+
+namespace {
+
+// Texel block layout: 16 texels split into per-channel float lanes
+struct BlockChannels {
+    alignas(16) float R[16];
+    alignas(16) float G[16];
+    alignas(16) float B[16];
+    alignas(16) float A[16];
+};
+
+void LoadBlockChannels(const uint8_t* pixels, BlockChannels& channels) {
+    for (int i = 0; i < 16; i++) {
+        channels.R[i] = pixels[i * 4 + 0];
+        channels.G[i] = pixels[i * 4 + 1];
+        channels.B[i] = pixels[i * 4 + 2];
+        channels.A[i] = pixels[i * 4 + 3];
+    }
+}
+
+// Per-channel min/max over the 16 RGBA texels of a block
+void ComputeBlockBounds(const uint8_t* pixels, uint8_t minColor[4], uint8_t maxColor[4]) {
+#ifdef HENKY_BC_SSE2
+    __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 0));
+    __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 16));
+    __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 32));
+    __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + 48));
+
+    __m128i minVec = _mm_min_epu8(_mm_min_epu8(p0, p1), _mm_min_epu8(p2, p3));
+    __m128i maxVec = _mm_max_epu8(_mm_max_epu8(p0, p1), _mm_max_epu8(p2, p3));
+    minVec = _mm_min_epu8(minVec, _mm_srli_si128(minVec, 8));
+    maxVec = _mm_max_epu8(maxVec, _mm_srli_si128(maxVec, 8));
+    minVec = _mm_min_epu8(minVec, _mm_srli_si128(minVec, 4));
+    maxVec = _mm_max_epu8(maxVec, _mm_srli_si128(maxVec, 4));
+
+    uint32_t minPacked = static_cast<uint32_t>(_mm_cvtsi128_si32(minVec));
+    uint32_t maxPacked = static_cast<uint32_t>(_mm_cvtsi128_si32(maxVec));
+    std::memcpy(minColor, &minPacked, 4);
+    std::memcpy(maxColor, &maxPacked, 4);
+#else
+    for (int c = 0; c < 4; c++) {
+        minColor[c] = 255;
+        maxColor[c] = 0;
+    }
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 4; c++) {
+            minColor[c] = std::min(minColor[c], pixels[i * 4 + c]);
+            maxColor[c] = std::max(maxColor[c], pixels[i * 4 + c]);
+        }
+    }
+#endif
+}
+
+// Shrink the bounding box slightly to reduce the error of the interpolated colors
+void InsetBounds(uint8_t minColor[4], uint8_t maxColor[4], int shift) {
+    for (int c = 0; c < 4; c++) {
+        int inset = (maxColor[c] - minColor[c]) >> shift;
+        minColor[c] = static_cast<uint8_t>(std::min(255, minColor[c] + inset));
+        maxColor[c] = static_cast<uint8_t>(std::max(0, maxColor[c] - inset));
+    }
+}
+
+// Project every texel onto the segment base -> base + axis and quantize to [0, levels]
+void ProjectToLevels(const BlockChannels& channels, const float base[4], const float axis[4],
+                     int levels, int indices[16]) {
+    float lengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] + axis[3] * axis[3];
+    if (lengthSq <= 0.0f) {
+        std::fill(indices, indices + 16, 0);
+        return;
+    }
+    float scale = static_cast<float>(levels) / lengthSq;
+
+#ifdef HENKY_BC_SSE2
+    const __m128 baseR = _mm_set1_ps(base[0]), baseG = _mm_set1_ps(base[1]);
+    const __m128 baseB = _mm_set1_ps(base[2]), baseA = _mm_set1_ps(base[3]);
+    const __m128 axisR = _mm_set1_ps(axis[0] * scale), axisG = _mm_set1_ps(axis[1] * scale);
+    const __m128 axisB = _mm_set1_ps(axis[2] * scale), axisA = _mm_set1_ps(axis[3] * scale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxLevel = _mm_set1_ps(static_cast<float>(levels));
+
+    for (int i = 0; i < 16; i += 4) {
+        __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(channels.R + i), baseR), axisR);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(channels.G + i), baseG), axisG));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(channels.B + i), baseB), axisB));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(channels.A + i), baseA), axisA));
+        t = _mm_min_ps(_mm_max_ps(t, zero), maxLevel);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), _mm_cvtps_epi32(t));
+    }
+#else
+    for (int i = 0; i < 16; i++) {
+        float t = (channels.R[i] - base[0]) * axis[0] + (channels.G[i] - base[1]) * axis[1] +
+                  (channels.B[i] - base[2]) * axis[2] + (channels.A[i] - base[3]) * axis[3];
+        t = std::clamp(t * scale, 0.0f, static_cast<float>(levels));
+        indices[i] = static_cast<int>(std::lround(t));
+    }
+#endif
+}
+
+uint16_t PackRGB565(const uint8_t color[4]) {
+    return static_cast<uint16_t>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+}
+
+void UnpackRGB565(uint16_t packed, float color[4]) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = static_cast<float>((r << 3) | (r >> 2));
+    color[1] = static_cast<float>((g << 2) | (g >> 4));
+    color[2] = static_cast<float>((b << 3) | (b >> 2));
+    color[3] = 0.0f;
+}
+
+void EncodeColorBlock(const uint8_t* pixels, uint8_t* output) {
+    uint8_t minColor[4], maxColor[4];
+    ComputeBlockBounds(pixels, minColor, maxColor);
+    InsetBounds(minColor, maxColor, 4);
+
+    uint16_t color0 = PackRGB565(maxColor);
+    uint16_t color1 = PackRGB565(minColor);
+    if (color0 < color1) {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indexBits = 0;
+    if (color0 != color1) {
+        BlockChannels channels;
+        LoadBlockChannels(pixels, channels);
+
+        float endpoint0[4], endpoint1[4];
+        UnpackRGB565(color0, endpoint0);
+        UnpackRGB565(color1, endpoint1);
+        float axis[4] = { endpoint0[0] - endpoint1[0], endpoint0[1] - endpoint1[1], endpoint0[2] - endpoint1[2], 0.0f };
+
+        int steps[16];
+        ProjectToLevels(channels, endpoint1, axis, 3, steps);
+
+        // Step 3 is color0, step 0 is color1; codes 2/3 are the 1/3 and 2/3 interpolants
+        static constexpr uint32_t StepToCode[4] = { 1, 3, 2, 0 };
+        for (int i = 0; i < 16; i++) {
+            indexBits |= StepToCode[steps[i]] << (i * 2);
+        }
+    }
+
+    output[0] = static_cast<uint8_t>(color0 & 0xFF);
+    output[1] = static_cast<uint8_t>(color0 >> 8);
+    output[2] = static_cast<uint8_t>(color1 & 0xFF);
+    output[3] = static_cast<uint8_t>(color1 >> 8);
+    std::memcpy(output + 4, &indexBits, 4);
+}
+
+// BC4 single-channel block (8 interpolated values)
+void EncodeChannelBlock(const uint8_t* pixels, int channel, uint8_t* output) {
+    uint8_t minValue = 255, maxValue = 0;
+    for (int i = 0; i < 16; i++) {
+        minValue = std::min(minValue, pixels[i * 4 + channel]);
+        maxValue = std::max(maxValue, pixels[i * 4 + channel]);
+    }
+
+    output[0] = maxValue;
+    output[1] = minValue;
+
+    uint64_t indexBits = 0;
+    if (maxValue != minValue) {
+        float range = static_cast<float>(maxValue - minValue);
+        for (int i = 0; i < 16; i++) {
+            // Step 0 is endpoint 0 (max), step 7 is endpoint 1 (min)
+            float t = (maxValue - pixels[i * 4 + channel]) / range;
+            int step = static_cast<int>(t * 7.0f + 0.5f);
+            uint64_t code = step == 0 ? 0 : (step == 7 ? 1 : static_cast<uint64_t>(step + 1));
+            indexBits |= code << (i * 3);
+        }
+    }
+
+    for (int i = 0; i < 6; i++) {
+        output[2 + i] = static_cast<uint8_t>(indexBits >> (i * 8));
+    }
+}
+
+// LSB-first bit packer for 128-bit BC7 blocks
+class BlockBitWriter {
+public:
+    explicit BlockBitWriter(uint8_t* output) : m_Output(output) {
+        std::memset(m_Output, 0, 16);
+    }
+
+    void Write(uint32_t value, int bitCount) {
+        for (int i = 0; i < bitCount; i++, m_Bit++) {
+            if (value & (1u << i)) {
+                m_Output[m_Bit >> 3] |= static_cast<uint8_t>(1u << (m_Bit & 7));
+            }
+        }
+    }
+
+private:
+    uint8_t* m_Output;
+    int m_Bit = 0;
+};
+
+// Quantize an 8-bit endpoint to 7 bits plus a shared p-bit, picking the p-bit with lower error
+void QuantizeEndpointWithPBit(const uint8_t endpoint[4], uint8_t quantized[4], uint32_t& pBit, float reconstructed[4]) {
+    int bestError = -1;
+    for (uint32_t p = 0; p < 2; p++) {
+        uint8_t candidate[4];
+        int error = 0;
+        for (int c = 0; c < 4; c++) {
+            int q = std::clamp((endpoint[c] - static_cast<int>(p) + 1) >> 1, 0, 127);
+            int value = (q << 1) | static_cast<int>(p);
+            candidate[c] = static_cast<uint8_t>(q);
+            error += (value - endpoint[c]) * (value - endpoint[c]);
+        }
+        if (bestError < 0 || error < bestError) {
+            bestError = error;
+            pBit = p;
+            std::memcpy(quantized, candidate, 4);
+        }
+    }
+    for (int c = 0; c < 4; c++) {
+        reconstructed[c] = static_cast<float>((quantized[c] << 1) | pBit);
+    }
+}
+
+void EncodeBC7Mode6(const uint8_t* pixels, uint8_t* output) {
+    uint8_t minColor[4], maxColor[4];
+    ComputeBlockBounds(pixels, minColor, maxColor);
+    InsetBounds(minColor, maxColor, 5);
+
+    uint8_t endpoint0[4], endpoint1[4];
+    uint32_t pBit0 = 0, pBit1 = 0;
+    float reconstructed0[4], reconstructed1[4];
+    QuantizeEndpointWithPBit(minColor, endpoint0, pBit0, reconstructed0);
+    QuantizeEndpointWithPBit(maxColor, endpoint1, pBit1, reconstructed1);
+
+    BlockChannels channels;
+    LoadBlockChannels(pixels, channels);
+
+    float axis[4];
+    for (int c = 0; c < 4; c++) {
+        axis[c] = reconstructed1[c] - reconstructed0[c];
+    }
+
+    int indices[16];
+    ProjectToLevels(channels, reconstructed0, axis, 15, indices);
+
+    // The anchor texel's index has an implicit zero MSB
+    if (indices[0] >= 8) {
+        std::swap(endpoint0, endpoint1);
+        std::swap(pBit0, pBit1);
+        for (int& index : indices) {
+            index = 15 - index;
+        }
+    }
+
+    BlockBitWriter writer(output);
+    writer.Write(1u << 6, 7); // Mode 6
+    for (int c = 0; c < 4; c++) {
+        writer.Write(endpoint0[c], 7);
+        writer.Write(endpoint1[c], 7);
+    }
+    writer.Write(pBit0, 1);
+    writer.Write(pBit1, 1);
+    writer.Write(static_cast<uint32_t>(indices[0]), 3);
+    for (int i = 1; i < 16; i++) {
+        writer.Write(static_cast<uint32_t>(indices[i]), 4);
+    }
+}
+
+using BlockEncoder = void (*)(const uint8_t*, uint8_t*);
+
+BlockEncoder GetBlockEncoder(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return &TextureCompression::EncodeBlockBC1;
+        case BlockFormat::BC3: return &TextureCompression::EncodeBlockBC3;
+        case BlockFormat::BC5: return &TextureCompression::EncodeBlockBC5;
+        case BlockFormat::BC7: return &TextureCompression::EncodeBlockBC7;
+    }
+    return &TextureCompression::EncodeBlockBC1;
+}
+
+} // namespace
+
+void TextureCompression::EncodeBlockBC1(const uint8_t* pixels, uint8_t* output) {
+    EncodeColorBlock(pixels, output);
+}
+
+void TextureCompression::EncodeBlockBC3(const uint8_t* pixels, uint8_t* output) {
+    EncodeChannelBlock(pixels, 3, output);
+    EncodeColorBlock(pixels, output + 8);
+}
+
+void TextureCompression::EncodeBlockBC5(const uint8_t* pixels, uint8_t* output) {
+    EncodeChannelBlock(pixels, 0, output);
+    EncodeChannelBlock(pixels, 1, output + 8);
+}
+
+void TextureCompression::EncodeBlockBC7(const uint8_t* pixels, uint8_t* output) {
+    EncodeBC7Mode6(pixels, output);
+}
+
+uint32_t TextureCompression::GetBlockBytes(BlockFormat format) {
+    return format == BlockFormat::BC1 ? 8u : 16u;
+}
+
+size_t TextureCompression::GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height) {
+    size_t blocksX = (width + 3) / 4;
+    size_t blocksY = (height + 3) / 4;
+    return blocksX * blocksY * GetBlockBytes(format);
+}
+
+GLenum TextureCompression::GetGLInternalFormat(BlockFormat format) {
+    switch (format) {
+        case BlockFormat::BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        case BlockFormat::BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+        case BlockFormat::BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+}
+
+std::vector<MipImage> TextureCompression::GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height,
+                                                           uint32_t maxLevels) {
+    std::vector<MipImage> chain;
+
+    MipImage base;
+    base.Width = width;
+    base.Height = height;
+    base.Pixels.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+    chain.push_back(std::move(base));
+
+    while ((chain.back().Width > 1 || chain.back().Height > 1) && chain.size() < maxLevels) {
+        const MipImage& source = chain.back();
+        MipImage level;
+        level.Width = std::max(1u, source.Width / 2);
+        level.Height = std::max(1u, source.Height / 2);
+        level.Pixels.resize(static_cast<size_t>(level.Width) * level.Height * 4);
+
+        for (uint32_t y = 0; y < level.Height; y++) {
+            uint32_t y0 = std::min(y * 2, source.Height - 1);
+            uint32_t y1 = std::min(y * 2 + 1, source.Height - 1);
+            for (uint32_t x = 0; x < level.Width; x++) {
+                uint32_t x0 = std::min(x * 2, source.Width - 1);
+                uint32_t x1 = std::min(x * 2 + 1, source.Width - 1);
+                for (uint32_t c = 0; c < 4; c++) {
+                    uint32_t sum = source.Pixels[(y0 * source.Width + x0) * 4 + c] +
+                                   source.Pixels[(y0 * source.Width + x1) * 4 + c] +
+                                   source.Pixels[(y1 * source.Width + x0) * 4 + c] +
+                                   source.Pixels[(y1 * source.Width + x1) * 4 + c];
+                    level.Pixels[(y * level.Width + x) * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+                }
+            }
+        }
+        chain.push_back(std::move(level));
+    }
+
+    return chain;
+}
+
+std::vector<uint8_t> TextureCompression::Compress(const uint8_t* rgba, uint32_t width, uint32_t height,
+                                                  BlockFormat format, JobSystem* jobSystem) {
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    const uint32_t blockBytes = GetBlockBytes(format);
+    const BlockEncoder encoder = GetBlockEncoder(format);
+
+    std::vector<uint8_t> output(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+    auto encodeRows = [&](uint32_t beginRow, uint32_t endRow) {
+        alignas(16) uint8_t block[64];
+        for (uint32_t by = beginRow; by < endRow; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                // Gather the 4x4 block, clamping at the image edge
+                for (uint32_t py = 0; py < 4; py++) {
+                    uint32_t y = std::min(by * 4 + py, height - 1);
+                    for (uint32_t px = 0; px < 4; px++) {
+                        uint32_t x = std::min(bx * 4 + px, width - 1);
+                        std::memcpy(block + (py * 4 + px) * 4, rgba + (static_cast<size_t>(y) * width + x) * 4, 4);
+                    }
+                }
+                encoder(block, output.data() + (static_cast<size_t>(by) * blocksX + bx) * blockBytes);
+            }
+        }
+    };
+
+    if (jobSystem) {
+        jobSystem->ParallelFor(blocksY, 4, encodeRows);
+    } else {
+        encodeRows(0, blocksY);
+    }
+
+    return output;
+}
+
+} // namespace Henky3D
@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/gl.h>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace Henky3D {
+
+class JobSystem;
+
+// GPU block-compressed formats produced by the texture cook step
+enum class BlockFormat {
+    BC1, // RGB, 4 bpp
+    BC3, // RGBA, 8 bpp (BC1 color + BC4 alpha)
+    BC5, // Two-channel (normal maps), 8 bpp
+    BC7  // High-quality RGBA, 8 bpp (mode 6 encoder)
+};
+
+// One level of an uncompressed RGBA8 mip chain
+struct MipImage {
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<uint8_t> Pixels;
+};
+
+class TextureCompression {
+public:
+    // Box-filter a full mip chain down to 1x1; level 0 is a copy of the source
+    static std::vector<MipImage> GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height,
+                                                  uint32_t maxLevels = UINT32_MAX);
+
+    // Encode an RGBA8 image; block rows are spread across the job system when one is given
+    static std::vector<uint8_t> Compress(const uint8_t* rgba, uint32_t width, uint32_t height,
+                                         BlockFormat format, JobSystem* jobSystem = nullptr);
+
+    static uint32_t GetBlockBytes(BlockFormat format);
+    static size_t GetCompressedSize(BlockFormat format, uint32_t width, uint32_t height);
+    static GLenum GetGLInternalFormat(BlockFormat format);
+
+    // Single-block encoders; pixels are 16 RGBA8 texels in row-major order
+    static void EncodeBlockBC1(const uint8_t* pixels, uint8_t* output);
+    static void EncodeBlockBC3(const uint8_t* pixels, uint8_t* output);
+    static void EncodeBlockBC5(const uint8_t* pixels, uint8_t* output);
+    static void EncodeBlockBC7(const uint8_t* pixels, uint8_t* output);
+};
+
+} // namespace Henky3D
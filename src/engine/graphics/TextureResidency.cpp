@@ -0,0 +1,187 @@
+#include "TextureResidency.h"
+#include "AssetRegistry.h"
+#include "TextureStreamer.h"
+#include "../ecs/ECSWorld.h"
+#include "../core/Profiler.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace Henky3D {
+
+TextureResidency::TextureResidency(AssetRegistry* registry, TextureStreamer* streamer,
+                                   const TextureResidencySettings& settings)
+    : m_Registry(registry), m_Streamer(streamer), m_Settings(settings) {
+}
+
+void TextureResidency::Update(ECSWorld* world, const Camera& camera, uint32_t viewportHeight) {
+    HENKY_PROFILE_ZONE("TextureResidency::Update");
+    m_FrameIndex++;
+    m_Stats.RequestsThisFrame = 0;
+    m_Stats.EvictionsThisFrame = 0;
+
+    // Streamed textures default to their coarsest level until an entity asks for more
+    m_Streamed.clear();
+    for (uint32_t i = 0; i < m_Registry->GetTextureSlotCount(); i++) {
+        TextureAsset* texture = m_Registry->GetTextureSlot(i);
+        if (!texture || texture->IsDefault || texture->State != TextureState::Resident) {
+            continue;
+        }
+        texture->DesiredMip = texture->MipLevels - 1;
+        texture->StreamingPriority = 0.0f;
+        m_Streamed.push_back(texture);
+    }
+
+    ComputeDesiredMips(world, camera, viewportHeight);
+
+    size_t usedBytes = 0;
+    size_t pendingBytes = 0;
+    for (const TextureAsset* texture : m_Streamed) {
+        usedBytes += texture->VramBytes;
+        if (texture->PendingMip != TextureAsset::NoPendingMip) {
+            pendingBytes += TextureStreamer::ComputeMipRangeBytes(*texture, texture->PendingMip, texture->ResidentMip);
+        }
+    }
+
+    // Shrink back under budget when it was lowered or views moved away
+    if (usedBytes + pendingBytes > m_Settings.BudgetBytes) {
+        usedBytes -= EvictUntil(usedBytes + pendingBytes - m_Settings.BudgetBytes, usedBytes);
+    }
+
+    // Request finer mips, most visible textures first
+    m_Candidates.clear();
+    for (TextureAsset* texture : m_Streamed) {
+        if (texture->PendingMip == TextureAsset::NoPendingMip && texture->DesiredMip < texture->ResidentMip) {
+            m_Candidates.push_back(texture);
+        }
+    }
+    std::sort(m_Candidates.begin(), m_Candidates.end(), [](const TextureAsset* a, const TextureAsset* b) {
+        return a->StreamingPriority > b->StreamingPriority;
+    });
+
+    for (TextureAsset* texture : m_Candidates) {
+        if (m_Stats.RequestsThisFrame >= m_Settings.MaxRequestsPerFrame) {
+            break;
+        }
+
+        uint32_t firstMip = texture->DesiredMip;
+        size_t required = TextureStreamer::ComputeMipRangeBytes(*texture, firstMip, texture->ResidentMip);
+        if (usedBytes + pendingBytes + required > m_Settings.BudgetBytes) {
+            usedBytes -= EvictUntil(usedBytes + pendingBytes + required - m_Settings.BudgetBytes, usedBytes);
+        }
+
+        // Settle for a coarser level when the full request still does not fit
+        while (firstMip < texture->ResidentMip && usedBytes + pendingBytes + required > m_Settings.BudgetBytes) {
+            firstMip++;
+            required = TextureStreamer::ComputeMipRangeBytes(*texture, firstMip, texture->ResidentMip);
+        }
+        if (firstMip >= texture->ResidentMip) {
+            break; // Budget exhausted
+        }
+
+        m_Streamer->RequestMips(texture, firstMip);
+        pendingBytes += required;
+        m_Stats.RequestsThisFrame++;
+        m_Stats.TotalRequests++;
+    }
+
+    m_Stats.ResidentBytes = usedBytes;
+    m_Stats.PendingBytes = pendingBytes;
+    m_Stats.BudgetBytes = m_Settings.BudgetBytes;
+    m_Stats.StreamedTextures = static_cast<uint32_t>(m_Streamed.size());
+    m_Stats.PendingRequests = 0;
+    m_Stats.WantedTextures = 0;
+    for (const TextureAsset* texture : m_Streamed) {
+        if (texture->PendingMip != TextureAsset::NoPendingMip) {
+            m_Stats.PendingRequests++;
+        }
+        if (texture->DesiredMip < texture->ResidentMip) {
+            m_Stats.WantedTextures++;
+        }
+    }
+}
+
+void TextureResidency::ComputeDesiredMips(ECSWorld* world, const Camera& camera, uint32_t viewportHeight) {
+    const Frustum frustum = camera.GetFrustum();
+    const float pixelsPerUnit = static_cast<float>(viewportHeight) / (2.0f * std::tan(camera.FOV * 0.5f));
+
+    auto view = world->GetRegistry().view<Transform, Renderable, BoundingBox, Material>();
+    for (auto entity : view) {
+        const auto& renderable = view.get<Renderable>(entity);
+        if (!renderable.Visible) {
+            continue;
+        }
+
+        const MaterialAsset* material = m_Registry->GetMaterial(view.get<Material>(entity).MaterialIndex);
+        if (!material) {
+            continue;
+        }
+
+        // World-space bounds, same conservative scale as the culling system
+        const auto& boundingBox = view.get<BoundingBox>(entity);
+        glm::mat4 worldMatrix = view.get<Transform>(entity).GetWorldMatrix();
+        glm::vec3 center = glm::vec3(worldMatrix * glm::vec4(boundingBox.GetCenter(), 1.0f));
+        float maxScale = std::max({ glm::length(glm::vec3(worldMatrix[0])), glm::length(glm::vec3(worldMatrix[1])),
+                                    glm::length(glm::vec3(worldMatrix[2])) });
+        glm::vec3 extents = boundingBox.GetExtents() * maxScale;
+        if (!frustum.TestBox(center, extents)) {
+            continue;
+        }
+
+        // Projected size of the object; UVs are assumed to span it once
+        float radius = glm::length(extents);
+        float distance = std::max(camera.NearPlane, glm::length(center - camera.Position) - radius);
+        float screenSize = 2.0f * radius * pixelsPerUnit / distance;
+
+        MarkTexture(material->BaseColorTexture, screenSize);
+        MarkTexture(material->NormalTexture, screenSize);
+        MarkTexture(material->RoughnessMetalnessTexture, screenSize);
+    }
+}
+
+void TextureResidency::MarkTexture(TextureHandle handle, float screenSize) {
+    TextureAsset* texture = m_Registry->GetTextureMutable(handle);
+    if (!texture || texture->IsDefault || texture->State != TextureState::Resident) {
+        return;
+    }
+
+    // One texel per pixel: every halving of the on-screen size drops a mip
+    float texels = static_cast<float>(std::max(texture->Width, texture->Height));
+    float mip = std::log2(texels / std::max(screenSize, 1.0f)) + m_Settings.MipBias;
+    uint32_t desired = static_cast<uint32_t>(std::clamp(mip, 0.0f, static_cast<float>(texture->MipLevels - 1)));
+
+    texture->DesiredMip = std::min(texture->DesiredMip, desired);
+    texture->StreamingPriority = std::max(texture->StreamingPriority, screenSize);
+    texture->LastUsedFrame = m_FrameIndex;
+}
+
+size_t TextureResidency::EvictUntil(size_t requiredBytes, size_t usedBytes) {
+    // Only levels finer than what views currently want are eligible, oldest use first
+    std::vector<TextureAsset*> evictable;
+    for (TextureAsset* texture : m_Streamed) {
+        if (texture->PendingMip == TextureAsset::NoPendingMip && texture->ResidentMip < texture->DesiredMip) {
+            evictable.push_back(texture);
+        }
+    }
+    std::sort(evictable.begin(), evictable.end(), [](const TextureAsset* a, const TextureAsset* b) {
+        if (a->LastUsedFrame != b->LastUsedFrame) {
+            return a->LastUsedFrame < b->LastUsedFrame;
+        }
+        return a->StreamingPriority < b->StreamingPriority;
+    });
+
+    size_t freed = 0;
+    for (TextureAsset* texture : evictable) {
+        if (freed >= requiredBytes || freed >= usedBytes) {
+            break;
+        }
+        size_t before = texture->VramBytes;
+        m_Streamer->EvictMips(texture, texture->DesiredMip);
+        freed += before - texture->VramBytes;
+        m_Stats.EvictionsThisFrame++;
+        m_Stats.TotalEvictions++;
+    }
+    return freed;
+}
+
+} // namespace Henky3D
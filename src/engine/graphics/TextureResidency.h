@@ -0,0 +1,62 @@
+#pragma once
+#include "Material.h"
+#include "../ecs/Components.h"
+#include <vector>
+
+namespace Henky3D {
+
+class ECSWorld;
+class AssetRegistry;
+class TextureStreamer;
+
+struct TextureResidencySettings {
+    size_t BudgetBytes = 256 * 1024 * 1024; // GPU memory allowed for streamed textures
+    uint32_t MaxRequestsPerFrame = 4;       // Mip requests issued per update
+    float MipBias = 0.0f;                   // Added to the computed mip; positive values stream less
+};
+
+struct TextureResidencyStats {
+    size_t ResidentBytes = 0;
+    size_t PendingBytes = 0;     // Bytes that in-flight requests will add
+    size_t BudgetBytes = 0;
+    uint32_t StreamedTextures = 0;
+    uint32_t PendingRequests = 0;
+    uint32_t WantedTextures = 0; // Textures whose desired mip is not resident yet
+    uint32_t RequestsThisFrame = 0;
+    uint32_t EvictionsThisFrame = 0;
+    uint64_t TotalRequests = 0;
+    uint64_t TotalEvictions = 0;
+};
+
+// Decides which mips of each streamed texture should be resident. The desired
+// mip comes from the screen-space texel density of the visible entities whose
+// material references the texture; finer mips are requested in priority order
+// and unused levels are evicted least-recently-used first once over budget.
+class TextureResidency {
+public:
+    TextureResidency(AssetRegistry* registry, TextureStreamer* streamer,
+                     const TextureResidencySettings& settings = {});
+
+    // Render thread, once per frame after the camera is final
+    void Update(ECSWorld* world, const Camera& camera, uint32_t viewportHeight);
+
+    void SetBudget(size_t bytes) { m_Settings.BudgetBytes = bytes; }
+    const TextureResidencySettings& GetSettings() const { return m_Settings; }
+    const TextureResidencyStats& GetStats() const { return m_Stats; }
+
+private:
+    void ComputeDesiredMips(ECSWorld* world, const Camera& camera, uint32_t viewportHeight);
+    void MarkTexture(TextureHandle handle, float screenSize);
+    size_t EvictUntil(size_t requiredBytes, size_t usedBytes);
+
+    AssetRegistry* m_Registry;
+    TextureStreamer* m_Streamer;
+    TextureResidencySettings m_Settings;
+    TextureResidencyStats m_Stats;
+    uint64_t m_FrameIndex = 0;
+
+    std::vector<TextureAsset*> m_Streamed; // Scratch lists reused across frames
+    std::vector<TextureAsset*> m_Candidates;
+};
+
+} // namespace Henky3D
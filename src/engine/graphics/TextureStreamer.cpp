@@ -0,0 +1,517 @@
+#include "TextureStreamer.h"
+#include "Ktx2.h"
+#include "TextureCompression.h"
+#include "../core/JobSystem.h"
+#include "../core/FileSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace Henky3D {
+
+namespace {
+
+// Texel or block layout of a storage format
+void GetFormatLayout(GLenum format, bool& compressed, uint32_t& blockBytes) {
+    compressed = format != GL_RGBA8;
+    blockBytes = 4;
+    if (compressed) {
+        blockBytes = format == TextureCompression::GetGLInternalFormat(BlockFormat::BC1) ? 8 : 16;
+    }
+}
+
+size_t GetLevelBytes(bool compressed, uint32_t blockBytes, uint32_t width, uint32_t height) {
+    return compressed ? static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * blockBytes
+                      : static_cast<size_t>(width) * height * blockBytes;
+}
+
+void ApplySamplerState(GLuint texture, uint32_t levelCount) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levelCount - 1));
+}
+
+} // namespace
+
+TextureStreamer::TextureStreamer(JobSystem* jobSystem, const TextureStreamingSettings& settings)
+    : m_JobSystem(jobSystem), m_Settings(settings), m_Shared(std::make_shared<SharedState>()) {
+    CreateStagingBuffers();
+}
+
+TextureStreamer::~TextureStreamer() {
+    // Decode jobs hold their own reference to the shared state and drop results once cancelled
+    m_Shared->Cancelled.store(true, std::memory_order_release);
+    for (auto& job : m_Uploads) {
+        if (job.Texture) {
+            glDeleteTextures(1, &job.Texture);
+        }
+    }
+    DestroyStagingBuffers();
+}
+
+void TextureStreamer::CreateStagingBuffers() {
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    m_StagingBuffers.resize(m_Settings.StagingBufferCount);
+    for (auto& staging : m_StagingBuffers) {
+        glGenBuffers(1, &staging.Buffer);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.Buffer);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_Settings.StagingBufferSize, nullptr, flags);
+        staging.Mapped = static_cast<uint8_t*>(
+            glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_Settings.StagingBufferSize, flags));
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureStreamer::DestroyStagingBuffers() {
+    for (auto& staging : m_StagingBuffers) {
+        if (staging.Fence) {
+            glDeleteSync(staging.Fence);
+        }
+        if (staging.Buffer) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.Buffer);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glDeleteBuffers(1, &staging.Buffer);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_StagingBuffers.clear();
+}
+
+void TextureStreamer::SetFrameBudget(float milliseconds, size_t bytes) {
+    m_Settings.FrameBudgetMs = milliseconds;
+    m_Settings.FrameBudgetBytes = bytes;
+}
+
+bool TextureStreamer::IsIdle() const {
+    return m_Shared->InFlight.load(std::memory_order_acquire) == 0 && m_Uploads.empty();
+}
+
+size_t TextureStreamer::ComputeMipRangeBytes(const TextureAsset& texture, uint32_t firstMip, uint32_t endMip) {
+    bool compressed = false;
+    uint32_t blockBytes = 4;
+    GetFormatLayout(texture.Format, compressed, blockBytes);
+
+    size_t bytes = 0;
+    for (uint32_t mip = firstMip; mip < std::min(endMip, texture.MipLevels); mip++) {
+        bytes += GetLevelBytes(compressed, blockBytes, std::max(1u, texture.Width >> mip),
+                               std::max(1u, texture.Height >> mip));
+    }
+    return bytes;
+}
+
+void TextureStreamer::Request(TextureAsset* texture) {
+    texture->State = TextureState::Loading;
+
+    LoadRequest request;
+    request.Target = texture;
+    request.Path = texture->Path;
+    request.Initial = true;
+    Submit(request);
+}
+
+void TextureStreamer::RequestMips(TextureAsset* texture, uint32_t firstMip) {
+    if (texture->State != TextureState::Resident || texture->IsDefault ||
+        texture->PendingMip != TextureAsset::NoPendingMip || firstMip >= texture->ResidentMip) {
+        return;
+    }
+
+    texture->PendingMip = firstMip;
+
+    LoadRequest request;
+    request.Target = texture;
+    request.Path = texture->Path;
+    request.FirstMip = firstMip;
+    request.EndMip = texture->ResidentMip;
+    Submit(request);
+}
+
+void TextureStreamer::Submit(const LoadRequest& request) {
+    m_Shared->InFlight.fetch_add(1, std::memory_order_relaxed);
+
+    std::shared_ptr<SharedState> shared = m_Shared;
+    const uint32_t initialMipSize = m_Settings.InitialMipSize;
+    m_JobSystem->Submit([shared, request, initialMipSize]() {
+        DecodedImage image;
+        image.Request = request;
+        if (!shared->Cancelled.load(std::memory_order_acquire)) {
+            image.Succeeded = LoadLevels(request, initialMipSize, image);
+            std::lock_guard<std::mutex> lock(shared->Mutex);
+            shared->Completed.push_back(std::move(image));
+        }
+        shared->InFlight.fetch_sub(1, std::memory_order_release);
+    });
+}
+
+bool TextureStreamer::LoadLevels(const LoadRequest& request, uint32_t initialMipSize, DecodedImage& image) {
+    // Mounted archives first, then the loose file
+    AssetFile file;
+    if (!file.Open(request.Path) || file.GetSize() == 0) {
+        return false;
+    }
+
+    uint8_t identifier[12] = {};
+    if (file.Read(0, identifier, sizeof(identifier)) && Ktx2::IsKtx2(identifier, sizeof(identifier))) {
+        return LoadKtx2Levels(file, request, initialMipSize, image);
+    }
+    return DecodeImageLevels(file, request, initialMipSize, image);
+}
+
+bool TextureStreamer::LoadKtx2Levels(AssetFile& file, const LoadRequest& request,
+                                     uint32_t initialMipSize, DecodedImage& image) {
+    // Read the fixed header first to learn the level count, then the level index
+    const size_t fileSize = file.GetSize();
+    std::vector<uint8_t> header(Ktx2::GetHeaderSize(0));
+    if (!file.Read(0, header.data(), header.size())) {
+        return false;
+    }
+
+    uint32_t levelCount = 0;
+    std::memcpy(&levelCount, header.data() + 40, sizeof(levelCount));
+    levelCount = std::max(1u, levelCount);
+    if (levelCount > 32 || fileSize < Ktx2::GetHeaderSize(levelCount)) {
+        return false;
+    }
+    header.resize(Ktx2::GetHeaderSize(levelCount));
+    if (!file.Read(Ktx2::GetHeaderSize(0), header.data() + Ktx2::GetHeaderSize(0),
+                   header.size() - Ktx2::GetHeaderSize(0))) {
+        return false;
+    }
+
+    Ktx2::Header parsed;
+    if (!Ktx2::ParseHeader(header.data(), header.size(), parsed, fileSize)) {
+        return false;
+    }
+    if (!Ktx2::GetGLFormat(parsed.VkFormat, image.InternalFormat, image.Compressed, image.BlockBytes)) {
+        return false;
+    }
+
+    image.Width = parsed.Width;
+    image.Height = parsed.Height;
+    image.MipLevels = static_cast<uint32_t>(parsed.Levels.size());
+    SelectMipRange(request, initialMipSize, image);
+    if (image.Levels.empty()) {
+        return false;
+    }
+
+    // Only the selected levels are read from disk
+    for (auto& span : image.Levels) {
+        const Ktx2::Level& level = parsed.Levels[image.FirstMip + static_cast<uint32_t>(&span - image.Levels.data())];
+        const size_t required = GetLevelBytes(image.Compressed, image.BlockBytes, span.Width, span.Height);
+        if (level.Length < required) {
+            return false;
+        }
+
+        span.Offset = image.Data.size();
+        span.Length = required;
+        image.Data.resize(span.Offset + required);
+        if (!file.Read(static_cast<size_t>(level.Offset), image.Data.data() + span.Offset, required)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TextureStreamer::DecodeImageLevels(AssetFile& file, const LoadRequest& request,
+                                        uint32_t initialMipSize, DecodedImage& image) {
+    // Archive entries decode straight from memory; loose files are read whole
+    std::vector<uint8_t> encoded;
+    const uint8_t* data = file.GetData();
+    if (!data) {
+        encoded.resize(file.GetSize());
+        if (!file.Read(0, encoded.data(), encoded.size())) {
+            return false;
+        }
+        data = encoded.data();
+    }
+
+    int width = 0, height = 0, channels = 0;
+    stbi_uc* pixels = stbi_load_from_memory(data, static_cast<int>(file.GetSize()),
+                                            &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        return false;
+    }
+
+    image.Width = static_cast<uint32_t>(width);
+    image.Height = static_cast<uint32_t>(height);
+    image.MipLevels = 1;
+    while (std::max(image.Width >> image.MipLevels, image.Height >> image.MipLevels) > 0) {
+        image.MipLevels++;
+    }
+    image.InternalFormat = GL_RGBA8;
+    image.BlockBytes = 4;
+    image.Compressed = false;
+    SelectMipRange(request, initialMipSize, image);
+    if (image.Levels.empty()) {
+        stbi_image_free(pixels);
+        return false;
+    }
+
+    // Source images carry a single level; the chain is only built down to the last requested level
+    const uint32_t endMip = image.FirstMip + static_cast<uint32_t>(image.Levels.size());
+    std::vector<MipImage> chain = TextureCompression::GenerateMipChain(pixels, width, height, endMip);
+    stbi_image_free(pixels);
+
+    for (size_t i = 0; i < image.Levels.size(); i++) {
+        const MipImage& mip = chain[image.FirstMip + i];
+        LevelSpan& span = image.Levels[i];
+        span.Offset = image.Data.size();
+        span.Length = mip.Pixels.size();
+        image.Data.insert(image.Data.end(), mip.Pixels.begin(), mip.Pixels.end());
+    }
+    return true;
+}
+
+void TextureStreamer::SelectMipRange(const LoadRequest& request, uint32_t initialMipSize, DecodedImage& image) {
+    uint32_t firstMip = request.FirstMip;
+    uint32_t endMip = std::min(request.EndMip, image.MipLevels);
+
+    if (request.Initial) {
+        // Start from the largest level that fits the initial size
+        firstMip = 0;
+        while (firstMip + 1 < image.MipLevels &&
+               std::max(image.Width >> firstMip, image.Height >> firstMip) > initialMipSize) {
+            firstMip++;
+        }
+        endMip = image.MipLevels;
+    }
+
+    image.FirstMip = firstMip;
+    image.Levels.clear();
+    for (uint32_t mip = firstMip; mip < endMip; mip++) {
+        LevelSpan span;
+        span.Width = std::max(1u, image.Width >> mip);
+        span.Height = std::max(1u, image.Height >> mip);
+        image.Levels.push_back(span);
+    }
+}
+
+void TextureStreamer::FailRequest(const LoadRequest& request) {
+    TextureAsset* texture = request.Target;
+    if (request.Initial) {
+        std::wcout << L"Warning: Failed to load texture, keeping placeholder: " << texture->Path << std::endl;
+        texture->State = TextureState::Failed;
+    } else {
+        texture->PendingMip = TextureAsset::NoPendingMip;
+    }
+    m_Stats.TotalFailed++;
+}
+
+void TextureStreamer::ReleaseTexture(GLuint texture) {
+    if (m_ReleaseCallback) {
+        m_ReleaseCallback(texture);
+    }
+    glDeleteTextures(1, &texture);
+}
+
+void TextureStreamer::Update() {
+    auto startTime = std::chrono::steady_clock::now();
+    auto elapsedMs = [&startTime]() {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    };
+
+    m_Stats.CompletedThisFrame = 0;
+    m_Stats.BytesUploadedThisFrame = 0;
+
+    // Collect finished loads
+    std::vector<DecodedImage> decoded;
+    {
+        std::lock_guard<std::mutex> lock(m_Shared->Mutex);
+        decoded.swap(m_Shared->Completed);
+    }
+
+    for (auto& image : decoded) {
+        if (!image.Succeeded) {
+            FailRequest(image.Request);
+            continue;
+        }
+
+        // Finer mips only make sense on top of the residency they were requested against
+        const TextureAsset* target = image.Request.Target;
+        if (!image.Request.Initial &&
+            (target->ResidentMip != image.Request.EndMip || target->MipLevels != image.MipLevels)) {
+            image.Request.Target->PendingMip = TextureAsset::NoPendingMip;
+            continue;
+        }
+
+        UploadJob job;
+        job.Image = std::move(image);
+        m_Uploads.push_back(std::move(job));
+    }
+
+    // Upload in row chunks until the frame budget runs out
+    size_t bytesThisFrame = 0;
+    while (!m_Uploads.empty()) {
+        if (elapsedMs() >= m_Settings.FrameBudgetMs || bytesThisFrame >= m_Settings.FrameBudgetBytes) {
+            break;
+        }
+
+        UploadJob& job = m_Uploads.front();
+        if (job.Texture == 0) {
+            const DecodedImage& image = job.Image;
+            job.Texture = AllocateStorage(image.InternalFormat, image.Width, image.Height, image.FirstMip, image.MipLevels);
+        }
+
+        if (!UploadChunk(job, bytesThisFrame)) {
+            break; // Staging ring still in use by the GPU
+        }
+
+        if (job.CurrentLevel >= job.Image.Levels.size()) {
+            FinalizeTexture(job);
+            m_Uploads.pop_front();
+        }
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_Stats.BytesUploadedThisFrame = bytesThisFrame;
+    m_Stats.UploadTimeMs = elapsedMs();
+    m_Stats.PendingDecodes = m_Shared->InFlight.load(std::memory_order_acquire);
+    m_Stats.PendingUploads = static_cast<uint32_t>(m_Uploads.size());
+}
+
+GLuint TextureStreamer::AllocateStorage(GLenum internalFormat, uint32_t width, uint32_t height,
+                                        uint32_t firstMip, uint32_t mipLevels) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, static_cast<GLsizei>(mipLevels - firstMip), internalFormat,
+                   std::max(1u, width >> firstMip), std::max(1u, height >> firstMip));
+    return texture;
+}
+
+void TextureStreamer::CopyResidentMips(const TextureAsset& texture, GLuint destination, uint32_t destinationFirstMip,
+                                       uint32_t firstMip, uint32_t endMip) {
+    for (uint32_t mip = firstMip; mip < endMip; mip++) {
+        glCopyImageSubData(texture.Texture, GL_TEXTURE_2D, static_cast<GLint>(mip - texture.ResidentMip), 0, 0, 0,
+                           destination, GL_TEXTURE_2D, static_cast<GLint>(mip - destinationFirstMip), 0, 0, 0,
+                           std::max(1u, texture.Width >> mip), std::max(1u, texture.Height >> mip), 1);
+    }
+}
+
+bool TextureStreamer::UploadChunk(UploadJob& job, size_t& bytesThisFrame) {
+    const DecodedImage& image = job.Image;
+    const LevelSpan& level = image.Levels[job.CurrentLevel];
+
+    // Compressed levels are copied in rows of 4x4 blocks
+    const size_t rowPitch = image.Compressed ? ((level.Width + 3) / 4) * image.BlockBytes
+                                             : static_cast<size_t>(level.Width) * image.BlockBytes;
+    const uint32_t rowCount = image.Compressed ? (level.Height + 3) / 4 : level.Height;
+    const size_t remainingBudget = m_Settings.FrameBudgetBytes - bytesThisFrame;
+    uint32_t rows = rowCount - job.NextRow;
+    rows = static_cast<uint32_t>(std::min<size_t>(rows, std::max<size_t>(1, remainingBudget / rowPitch)));
+
+    const uint8_t* source = image.Data.data() + level.Offset + job.NextRow * rowPitch;
+    const size_t rowsPerStaging = m_Settings.StagingBufferSize / rowPitch;
+    const void* uploadSource = source;
+
+    if (rowsPerStaging == 0 || m_StagingBuffers.empty()) {
+        // Row wider than a staging buffer: upload straight from client memory
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    } else {
+        StagingBuffer& staging = m_StagingBuffers[m_NextStagingBuffer];
+        if (staging.Fence) {
+            GLenum status = glClientWaitSync(staging.Fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                return false;
+            }
+            glDeleteSync(staging.Fence);
+            staging.Fence = nullptr;
+        }
+
+        rows = std::min<uint32_t>(rows, static_cast<uint32_t>(rowsPerStaging));
+        std::memcpy(staging.Mapped, source, rows * rowPitch);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.Buffer);
+        uploadSource = nullptr;
+    }
+
+    // Storage level 0 holds the first streamed mip
+    glBindTexture(GL_TEXTURE_2D, job.Texture);
+    const GLint mipLevel = static_cast<GLint>(job.CurrentLevel);
+    if (image.Compressed) {
+        uint32_t y = job.NextRow * 4;
+        uint32_t height = std::min(rows * 4, level.Height - y);
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, mipLevel, 0, y, level.Width, height, image.InternalFormat,
+                                  static_cast<GLsizei>(rows * rowPitch), uploadSource);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, mipLevel, 0, job.NextRow, level.Width, rows, GL_RGBA, GL_UNSIGNED_BYTE, uploadSource);
+    }
+
+    if (!uploadSource) {
+        StagingBuffer& staging = m_StagingBuffers[m_NextStagingBuffer];
+        staging.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        m_NextStagingBuffer = (m_NextStagingBuffer + 1) % static_cast<uint32_t>(m_StagingBuffers.size());
+    }
+
+    job.NextRow += rows;
+    bytesThisFrame += rows * rowPitch;
+    if (job.NextRow >= rowCount) {
+        job.CurrentLevel++;
+        job.NextRow = 0;
+    }
+    return true;
+}
+
+void TextureStreamer::FinalizeTexture(UploadJob& job) {
+    const DecodedImage& image = job.Image;
+    TextureAsset* texture = image.Request.Target;
+    const uint32_t endMip = image.FirstMip + static_cast<uint32_t>(image.Levels.size());
+
+    // Residency changed while the upload was in flight (eviction): drop the new storage
+    if (!image.Request.Initial && texture->ResidentMip != endMip) {
+        glDeleteTextures(1, &job.Texture);
+        job.Texture = 0;
+        texture->PendingMip = TextureAsset::NoPendingMip;
+        return;
+    }
+
+    if (image.Request.Initial) {
+        texture->Width = image.Width;
+        texture->Height = image.Height;
+        texture->MipLevels = image.MipLevels;
+        texture->Format = image.InternalFormat;
+    } else {
+        CopyResidentMips(*texture, job.Texture, image.FirstMip, endMip, texture->MipLevels);
+        ReleaseTexture(texture->Texture);
+    }
+
+    ApplySamplerState(job.Texture, texture->MipLevels - image.FirstMip);
+    texture->Texture = job.Texture;
+    texture->ResidentMip = image.FirstMip;
+    texture->PendingMip = TextureAsset::NoPendingMip;
+    texture->VramBytes = ComputeMipRangeBytes(*texture, texture->ResidentMip, texture->MipLevels);
+    texture->State = TextureState::Resident;
+    job.Texture = 0;
+
+    m_Stats.CompletedThisFrame++;
+    m_Stats.TotalCompleted++;
+}
+
+void TextureStreamer::EvictMips(TextureAsset* texture, uint32_t firstMip) {
+    if (texture->State != TextureState::Resident || texture->IsDefault ||
+        firstMip <= texture->ResidentMip || firstMip >= texture->MipLevels) {
+        return;
+    }
+
+    // In-flight requests for finer mips are discarded when they land, since ResidentMip moves
+    GLuint storage = AllocateStorage(texture->Format, texture->Width, texture->Height, firstMip, texture->MipLevels);
+    CopyResidentMips(*texture, storage, firstMip, firstMip, texture->MipLevels);
+    ApplySamplerState(storage, texture->MipLevels - firstMip);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    ReleaseTexture(texture->Texture);
+    texture->Texture = storage;
+    texture->ResidentMip = firstMip;
+    texture->VramBytes = ComputeMipRangeBytes(*texture, firstMip, texture->MipLevels);
+    m_Stats.TotalEvictions++;
+}
+
+} // namespace Henky3D
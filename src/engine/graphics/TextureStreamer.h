@@ -0,0 +1,159 @@
+#pragma once
+#include "Material.h"
+#include <glad/gl.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+namespace Henky3D {
+
+class AssetFile;
+
+class JobSystem;
+
+// Per-frame limits for texture uploads on the render thread
+struct TextureStreamingSettings {
+    float FrameBudgetMs = 2.0f;                        // Upload time allowed per frame
+    size_t FrameBudgetBytes = 16 * 1024 * 1024;        // Bytes copied into staging per frame
+    size_t StagingBufferSize = 4 * 1024 * 1024;        // Size of each pixel buffer object
+    uint32_t StagingBufferCount = 3;                   // PBO ring depth
+    uint32_t InitialMipSize = 128;                     // First load only brings in mips up to this size
+};
+
+struct TextureStreamingStats {
+    uint32_t PendingDecodes = 0;
+    uint32_t PendingUploads = 0;
+    uint32_t CompletedThisFrame = 0;
+    size_t BytesUploadedThisFrame = 0;
+    float UploadTimeMs = 0.0f;
+    uint64_t TotalCompleted = 0;
+    uint64_t TotalFailed = 0;
+    uint64_t TotalEvictions = 0;
+};
+
+// Streams textures from disk: file reads and decoding run on the job system,
+// uploads go through a ring of persistently mapped PBOs in row chunks bounded
+// by a per-frame time and byte budget. KTX2 files carrying block-compressed mip
+// chains are uploaded level by level without a decode step.
+//
+// Residency is tracked per mip: the GL texture only holds levels
+// [ResidentMip, MipLevels). Streaming in finer levels or evicting them
+// reallocates the storage and copies the coarser levels across on the GPU.
+class TextureStreamer {
+public:
+    TextureStreamer(JobSystem* jobSystem, const TextureStreamingSettings& settings = {});
+    ~TextureStreamer();
+
+    // Queue the initial load (mip tail up to InitialMipSize); the asset must stay alive
+    // until it leaves the Loading state
+    void Request(TextureAsset* texture);
+
+    // Stream in levels [firstMip, ResidentMip) of a resident texture
+    void RequestMips(TextureAsset* texture, uint32_t firstMip);
+
+    // Release every level finer than firstMip (render thread only)
+    void EvictMips(TextureAsset* texture, uint32_t firstMip);
+
+    // Upload decoded data within the frame budget (render thread only)
+    void Update();
+
+    bool IsIdle() const;
+
+    // GPU bytes held by levels [firstMip, endMip) of a texture
+    static size_t ComputeMipRangeBytes(const TextureAsset& texture, uint32_t firstMip, uint32_t endMip);
+
+    // Invoked with a texture's old GL name just before the streamer deletes it
+    void SetReleaseCallback(std::function<void(GLuint)> callback) { m_ReleaseCallback = std::move(callback); }
+
+    // Run the release callback and delete a GL texture
+    void ReleaseTexture(GLuint texture);
+
+    const TextureStreamingSettings& GetSettings() const { return m_Settings; }
+    void SetFrameBudget(float milliseconds, size_t bytes);
+    const TextureStreamingStats& GetStats() const { return m_Stats; }
+
+private:
+    struct LoadRequest {
+        TextureAsset* Target = nullptr;
+        std::wstring Path;
+        uint32_t FirstMip = 0;
+        uint32_t EndMip = 0;            // Exclusive; the residency the load was issued against
+        bool Initial = false;
+    };
+
+    // Span of one mip level inside a decoded image's data
+    struct LevelSpan {
+        size_t Offset = 0;
+        size_t Length = 0;
+        uint32_t Width = 0;
+        uint32_t Height = 0;
+    };
+
+    struct DecodedImage {
+        LoadRequest Request;
+        std::vector<uint8_t> Data;      // RGBA8 pixels or KTX2 level payloads
+        std::vector<LevelSpan> Levels;  // Levels [FirstMip, FirstMip + Levels.size())
+        uint32_t Width = 0;             // Full-resolution size
+        uint32_t Height = 0;
+        uint32_t MipLevels = 0;
+        uint32_t FirstMip = 0;
+        GLenum InternalFormat = GL_RGBA8;
+        uint32_t BlockBytes = 4;        // Bytes per texel, or per 4x4 block when compressed
+        bool Compressed = false;
+        bool Succeeded = false;
+    };
+
+    struct UploadJob {
+        DecodedImage Image;
+        GLuint Texture = 0;             // New storage, swapped in once every level is uploaded
+        uint32_t CurrentLevel = 0;
+        uint32_t NextRow = 0;           // Texel rows, or block rows when compressed
+    };
+
+    struct StagingBuffer {
+        GLuint Buffer = 0;
+        uint8_t* Mapped = nullptr;
+        GLsync Fence = nullptr;
+    };
+
+    // Shared with in-flight decode jobs so they can outlive the streamer
+    struct SharedState {
+        std::mutex Mutex;
+        std::vector<DecodedImage> Completed;
+        std::atomic<uint32_t> InFlight{0};
+        std::atomic<bool> Cancelled{false};
+    };
+
+    void Submit(const LoadRequest& request);
+    static bool LoadLevels(const LoadRequest& request, uint32_t initialMipSize, DecodedImage& image);
+    static bool LoadKtx2Levels(AssetFile& file, const LoadRequest& request,
+                               uint32_t initialMipSize, DecodedImage& image);
+    static bool DecodeImageLevels(AssetFile& file, const LoadRequest& request,
+                                  uint32_t initialMipSize, DecodedImage& image);
+    static void SelectMipRange(const LoadRequest& request, uint32_t initialMipSize, DecodedImage& image);
+
+    void CreateStagingBuffers();
+    void DestroyStagingBuffers();
+    GLuint AllocateStorage(GLenum internalFormat, uint32_t width, uint32_t height, uint32_t firstMip, uint32_t mipLevels);
+    void CopyResidentMips(const TextureAsset& texture, GLuint destination, uint32_t destinationFirstMip,
+                          uint32_t firstMip, uint32_t endMip);
+    bool UploadChunk(UploadJob& job, size_t& bytesThisFrame);
+    void FinalizeTexture(UploadJob& job);
+    void FailRequest(const LoadRequest& request);
+
+    JobSystem* m_JobSystem;
+    TextureStreamingSettings m_Settings;
+    TextureStreamingStats m_Stats;
+    std::function<void(GLuint)> m_ReleaseCallback;
+
+    std::shared_ptr<SharedState> m_Shared;
+    std::deque<UploadJob> m_Uploads;
+    std::vector<StagingBuffer> m_StagingBuffers;
+    uint32_t m_NextStagingBuffer = 0;
+};
+
+} // namespace Henky3D
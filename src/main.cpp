@@ -1,19 +1,31 @@
 #include "engine/core/Window.h"
 #include "engine/core/Timer.h"
+#include "engine/core/Profiler.h"
+#include "engine/core/FrameStats.h"
+#include "engine/core/FramePacer.h"
+#include "engine/core/FrameAllocator.h"
 #include "engine/input/Input.h"
 #include "engine/graphics/GraphicsDevice.h"
 #include "engine/graphics/Renderer.h"
 #include "engine/graphics/ConstantBuffers.h"
 #include "engine/graphics/ShadowMap.h"
+#include "engine/graphics/FrameGraph.h"
 #include "engine/ecs/ECSWorld.h"
 #include "engine/ecs/Components.h"
 #include "engine/ecs/TransformSystem.h"
 #include "engine/ecs/CullingSystem.h"
+#include "engine/ecs/WorldSnapshot.h"
+#include "engine/ecs/WorldPartition.h"
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <memory>
 #include <iostream>
 
@@ -22,13 +34,24 @@ using namespace Henky3D;
 class Application {
 public:
     Application() {
+        Profiler::SetThreadName("Main");
         m_Window = std::make_unique<Window>("Henky3D Engine", 1280, 720);
         m_Device = std::make_unique<GraphicsDevice>(m_Window.get());
         m_Renderer = std::make_unique<Renderer>(m_Device.get());
+        // Shadow caster lists come from the application's arena, flipped at the top of each frame
+        m_Renderer->SetFrameArena(&m_FrameArena);
         m_ECS = std::make_unique<ECSWorld>();
         
         InitializeImGui();
-        InitializeScene();
+        InitializeMaterials();
+        const char* scenePath = std::getenv("HENKY_SCENE");
+        if (!scenePath || !LoadScene(scenePath)) {
+            InitializeScene();
+        }
+        if (const char* worldPath = std::getenv("HENKY_WORLD")) {
+            OpenWorldPartition(worldPath);
+        }
+        InitializeFrameGraph();
         
         Input::Initialize(m_Window->GetHandle());
         
@@ -38,6 +61,9 @@ public:
     }
 
     ~Application() {
+        if (const char* summaryPath = std::getenv("HENKY_FRAME_SUMMARY")) {
+            m_FrameStats.WriteSummary(summaryPath);
+        }
         m_Device->WaitForGPU();
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
@@ -50,18 +76,41 @@ public:
         m_TotalTime = 0.0f;
 
         while (m_Running) {
+            Profiler::BeginFrame();
+            m_FrameArena.BeginFrame();
+            HENKY_PROFILE_ZONE("Frame");
+            // Limit the frame rate before polling, so input is sampled as late as possible
+            m_FramePacer.WaitForNextFrame();
             if (!m_Window->ProcessMessages()) {
                 m_Running = false;
                 break;
             }
+            m_FramePacer.MarkInputSampled();
 
             m_DeltaTime = timer.GetDeltaTime();
             fpsCounter.Update(m_DeltaTime);
+            m_FrameStats.Record(m_DeltaTime * 1000.0f);
             m_TotalTime += m_DeltaTime;
             
             Input::Update();
-            Update(m_DeltaTime);
+            // The free camera follows input every rendered frame so it stays responsive
+            UpdateCamera(m_DeltaTime);
+            // Streaming spends its instantiation budget once per rendered frame, not per step
+            if (m_WorldPartition && m_ECS->HasComponent<Camera>(m_CameraEntity)) {
+                m_WorldPartition->Update(m_ECS->GetComponent<Camera>(m_CameraEntity).Position);
+            }
+            if (m_FixedStepEnabled) {
+                const uint32_t steps = m_FixedTimestep.Advance(m_DeltaTime);
+                for (uint32_t step = 0; step < steps; step++) {
+                    Update(m_FixedTimestep.GetStep(), true);
+                }
+                TransformSystem::Interpolate(m_ECS.get(), m_FixedTimestep.GetAlpha());
+            }
+            else {
+                Update(m_DeltaTime, false);
+            }
             Render(fpsCounter);
+            m_FramePacer.MarkPresented(m_Device->GetLastPresentTime());
         }
     }
 
@@ -75,7 +124,70 @@ private:
         ImGui::StyleColorsDark();
 
         ImGui_ImplGlfw_InitForOpenGL(m_Window->GetHandle(), true);
-        ImGui_ImplOpenGL3_Init("#version 460 core");
+        ImGui_ImplOpenGL3_Init("#version 450 core");
+    }
+
+    void InitializeMaterials() {
+        // Registered before any scene so snapshot material indices resolve to the same materials
+        AssetRegistry* assets = m_Renderer->GetAssetRegistry();
+        MaterialAsset glossy;
+        glossy.Name = "Glossy";
+        glossy.BaseColorFactor = { 0.3f, 1.0f, 0.3f, 1.0f };
+        glossy.RoughnessFactor = 0.2f;
+        m_GlossyMaterial = assets->CreateMaterial(glossy);
+
+        MaterialAsset metal;
+        metal.Name = "Metal";
+        metal.BaseColorFactor = { 0.3f, 0.3f, 1.0f, 1.0f };
+        metal.RoughnessFactor = 0.35f;
+        metal.MetalnessFactor = 1.0f;
+        m_MetalMaterial = assets->CreateMaterial(metal);
+    }
+
+    bool LoadScene(const std::string& path) {
+        WorldSnapshot snapshot;
+        if (!snapshot.Open(path)) {
+            std::cout << "Warning: cannot load scene " << path << std::endl;
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto world = std::make_unique<ECSWorld>();
+        std::vector<entt::entity> entities;
+        snapshot.Instantiate(world.get(), entities);
+        m_SceneLoadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        m_SceneEntityCount = snapshot.GetEntityCount();
+
+        // The first camera in the snapshot drives the view
+        auto cameras = world->GetRegistry().view<Camera>();
+        if (cameras.begin() != cameras.end()) {
+            m_CameraEntity = *cameras.begin();
+        }
+        else {
+            m_CameraEntity = world->CreateEntity();
+            world->AddComponent<Camera>(m_CameraEntity);
+        }
+        world->GetComponent<Camera>(m_CameraEntity).AspectRatio =
+            static_cast<float>(m_Window->GetWidth()) / static_cast<float>(m_Window->GetHeight());
+
+        // The partition streams into the old world, so it goes first and reopens on the new one
+        m_WorldPartition.reset();
+        m_ECS = std::move(world);
+        if (!m_WorldDirectory.empty()) {
+            OpenWorldPartition(m_WorldDirectory);
+        }
+        return true;
+    }
+
+    bool OpenWorldPartition(const std::string& directory) {
+        WorldPartitionSettings settings = m_WorldPartition ? m_WorldPartition->GetSettings() : WorldPartitionSettings{};
+        m_WorldPartition.reset();
+        auto partition = std::make_unique<WorldPartition>(m_ECS.get(), m_Renderer->GetJobSystem(), settings);
+        if (!partition->Open(directory)) {
+            return false;
+        }
+        m_WorldPartition = std::move(partition);
+        m_WorldDirectory = directory;
+        return true;
     }
 
     void InitializeScene() {
@@ -92,6 +204,38 @@ private:
         light.Direction = { 0.0f, -1.0f, 0.5f };
         light.Color = { 1.0f, 1.0f, 1.0f, 1.0f };
 
+        // Local lights with shadows in the shadow atlas
+        auto pointLightEntity = m_ECS->CreateEntity();
+        auto& pointLight = m_ECS->AddComponent<Light>(pointLightEntity);
+        pointLight.LightType = Light::Type::Point;
+        pointLight.Position = { 0.0f, 2.0f, -1.5f };
+        pointLight.Color = { 1.0f, 0.7f, 0.4f, 1.0f };
+        pointLight.Intensity = 4.0f;
+        pointLight.Range = 8.0f;
+
+        auto spotLightEntity = m_ECS->CreateEntity();
+        auto& spotLight = m_ECS->AddComponent<Light>(spotLightEntity);
+        spotLight.LightType = Light::Type::Spot;
+        spotLight.Position = { -3.0f, 3.0f, -3.0f };
+        spotLight.Direction = { 0.6f, -0.6f, 0.6f };
+        spotLight.Color = { 0.4f, 0.6f, 1.0f, 1.0f };
+        spotLight.Intensity = 6.0f;
+        spotLight.Range = 12.0f;
+
+        // A grid of small unshadowed lights, shaded through the light clusters
+        for (int z = 0; z < 16; z++) {
+            for (int x = 0; x < 16; x++) {
+                auto fillLightEntity = m_ECS->CreateEntity();
+                auto& fillLight = m_ECS->AddComponent<Light>(fillLightEntity);
+                fillLight.LightType = Light::Type::Point;
+                fillLight.Position = { -15.0f + x * 2.0f, 0.3f, -15.0f + z * 2.0f };
+                fillLight.Color = { 0.5f + 0.5f * (x % 2), 0.5f + 0.5f * (z % 2), (x + z) % 3 == 0 ? 1.0f : 0.5f, 1.0f };
+                fillLight.Intensity = 0.6f;
+                fillLight.Range = 1.5f;
+                fillLight.CastShadows = false;
+            }
+        }
+
         // Create a spinning cube at the center
         auto cubeEntity = m_ECS->CreateEntity();
         auto& transform = m_ECS->AddComponent<Transform>(cubeEntity);
@@ -105,7 +249,9 @@ private:
         transform2.Position = { 2.0f, 0.0f, 0.0f };
         auto& renderable2 = m_ECS->AddComponent<Renderable>(cube2Entity);
         renderable2.Color = { 0.3f, 1.0f, 0.3f, 1.0f };
+        renderable2.Static = true;
         m_ECS->AddComponent<BoundingBox>(cube2Entity);
+        m_ECS->AddComponent<Material>(cube2Entity).MaterialIndex = m_GlossyMaterial;
 
         // Create a third cube to the left
         auto cube3Entity = m_ECS->CreateEntity();
@@ -113,16 +259,66 @@ private:
         transform3.Position = { -2.0f, 0.0f, 0.0f };
         auto& renderable3 = m_ECS->AddComponent<Renderable>(cube3Entity);
         renderable3.Color = { 0.3f, 0.3f, 1.0f, 1.0f };
+        renderable3.Static = true;
         m_ECS->AddComponent<BoundingBox>(cube3Entity);
+        m_ECS->AddComponent<Material>(cube3Entity).MaterialIndex = m_MetalMaterial;
     }
 
-    void Update(float deltaTime) {
+    void InitializeFrameGraph() {
+        m_FrameGraph = std::make_unique<FrameGraph>(m_Device.get());
+        m_FrameGraph->SetGpuProfiler(m_Renderer->GetGpuProfiler());
+        FrameGraphResource backBuffer = m_FrameGraph->ImportTexture("BackBuffer", m_Device->GetBackBuffer());
+        FrameGraphResource shadowMap = m_FrameGraph->ImportTexture("ShadowMap", m_Renderer->GetShadowMap()->GetDepthTexture());
+        FrameGraphResource shadowAtlas = m_FrameGraph->ImportTexture("ShadowAtlas", m_Renderer->GetShadowAtlas()->GetDepthTexture());
+        // Scaled scene target of the dynamic resolution; its handle is refreshed every frame
+        m_SceneColor = m_FrameGraph->ImportTexture("SceneColor", 0);
+        FrameGraphResource sceneColor = m_SceneColor;
+
+        m_FrameGraph->AddPass("Shadows",
+            [&](FrameGraphBuilder& builder) {
+                shadowMap = builder.Write(shadowMap);
+                shadowAtlas = builder.Write(shadowAtlas);
+            },
+            [this](const FrameGraph&) {
+                m_Renderer->RenderShadowPass(m_ECS.get());
+                
+                // Reset viewport after shadow pass
+                glViewport(0, 0, m_Window->GetWidth(), m_Window->GetHeight());
+            });
+
+        m_FrameGraph->AddPass("Scene",
+            [&](FrameGraphBuilder& builder) {
+                builder.Read(shadowMap);
+                builder.Read(shadowAtlas);
+                sceneColor = builder.Write(sceneColor);
+                backBuffer = builder.Write(backBuffer);
+            },
+            [this](const FrameGraph&) {
+                m_Renderer->GetDynamicResolution()->BeginScene();
+                m_Renderer->RenderScene(m_ECS.get(), m_DepthPrepassEnabled, m_ShadowsEnabled);
+            });
+
+        // Fixed output resolution: scale the scene up into the back buffer before the overlay
+        m_FrameGraph->AddPass("Upscale",
+            [&](FrameGraphBuilder& builder) {
+                builder.Read(sceneColor);
+                builder.Write(backBuffer);
+                builder.SideEffect();
+            },
+            [this](const FrameGraph&) {
+                m_Renderer->GetDynamicResolution()->Resolve();
+            });
+    }
+
+    // One simulation step; interpolate tracks moving transforms for TransformSystem::Interpolate
+    void Update(float deltaTime, bool interpolate) {
+        HENKY_PROFILE_ZONE("Update");
+        TransformSystem::BeginStep(m_ECS.get());
         m_ECS->Update(deltaTime);
-        UpdateCamera(deltaTime);
         UpdateScene(deltaTime);
         
         // Update transform hierarchy
-        TransformSystem::UpdateTransforms(m_ECS.get());
+        TransformSystem::UpdateTransforms(m_ECS.get(), interpolate);
     }
 
     void UpdateScene(float deltaTime) {
@@ -184,6 +380,7 @@ private:
     }
 
     void Render(const FPSCounter& fpsCounter) {
+        HENKY_PROFILE_ZONE("Render");
         m_Device->BeginFrame();
         m_Renderer->BeginFrame();
         
@@ -211,11 +408,9 @@ private:
                 }
             }
             
-            // Compute light view-projection for shadows
-            glm::vec3 sceneBoundsMin = glm::vec3(-5.0f, -5.0f, -5.0f);
-            glm::vec3 sceneBoundsMax = glm::vec3(5.0f, 5.0f, 5.0f);
-            glm::mat4 lightViewProj = ShadowMap::ComputeLightViewProjection(
-                lightDirection, sceneBoundsMin, sceneBoundsMax);
+            // Fit the shadow cascades to this frame's view
+            ShadowMap* shadowMap = m_Renderer->GetShadowMap();
+            shadowMap->UpdateCascades(camera, lightDirection, ShadowMap::FindReceiverDistance(m_ECS.get(), camera));
 
             PerFrameConstants perFrameConstants;
             glm::mat4 view = camera.GetViewMatrix();
@@ -224,7 +419,6 @@ private:
             perFrameConstants.ViewMatrix = view;
             perFrameConstants.ProjectionMatrix = projection;
             perFrameConstants.ViewProjectionMatrix = projection * view;
-            perFrameConstants.LightViewProjectionMatrix = lightViewProj;
             perFrameConstants.CameraPosition = glm::vec4(camera.Position, 1.0f);
             perFrameConstants.LightDirection = glm::vec4(lightDirection, 0.0f);
             perFrameConstants.LightColor = lightColor;
@@ -233,28 +427,32 @@ private:
             perFrameConstants.DeltaTime = m_DeltaTime;
             perFrameConstants.ShadowBias = m_ShadowBias;
             perFrameConstants.ShadowsEnabled = m_ShadowsEnabled ? 1.0f : 0.0f;
+            shadowMap->WriteConstants(perFrameConstants);
 
             m_Renderer->SetPerFrameConstants(perFrameConstants);
 
-            // Render shadow pass if enabled
-            if (m_ShadowsEnabled) {
-                m_Renderer->RenderShadowPass(m_ECS.get());
-                
-                // Reset viewport after shadow pass
-                glViewport(0, 0, m_Window->GetWidth(), m_Window->GetHeight());
-            }
+            // Pick the scene resolution from the GPU time of recent frames
+            DynamicResolution* dynamicResolution = m_Renderer->GetDynamicResolution();
+            dynamicResolution->Update(*m_Renderer->GetGpuProfiler(), "Scene");
+            m_FrameGraph->SetImportedHandle(m_SceneColor, dynamicResolution->GetSceneTexture());
 
-            // Render scene
-            m_Renderer->RenderScene(m_ECS.get(), m_DepthPrepassEnabled, m_ShadowsEnabled);
+            // Pick texture mips from this frame's view before drawing
+            m_Renderer->GetAssetRegistry()->GetTextureResidency()->Update(m_ECS.get(), camera, dynamicResolution->GetRenderHeight());
+
+            // Shadow and scene passes; the graph only recompiles when a pass is toggled or the window resizes
+            m_FrameGraph->SetPassEnabled("Shadows", m_ShadowsEnabled);
+            m_FrameGraph->Execute();
         }
 
         // Render ImGui
         RenderImGui(fpsCounter);
 
+        HENKY_PROFILE_ZONE("Present");
         m_Device->EndFrame();
     }
 
     void RenderImGui(const FPSCounter& fpsCounter) {
+        HENKY_PROFILE_ZONE("RenderImGui");
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
@@ -266,7 +464,97 @@ private:
         if (ImGui::Begin("Henky3D Engine")) {
             ImGui::Text("FPS: %.1f", fpsCounter.GetFPS());
             ImGui::Text("Frame Time: %.2f ms", fpsCounter.GetFrameTime());
+            FramePercentiles frameTimes = m_FrameStats.GetWindowPercentiles();
+            ImGui::Text("p50 %.2f  p95 %.2f  p99 %.2f  p99.9 %.2f  max %.2f ms",
+                        frameTimes.P50Ms, frameTimes.P95Ms, frameTimes.P99Ms, frameTimes.P999Ms, frameTimes.MaxMs);
+            FrameStatsSettings frameSettings = m_FrameStats.GetSettings();
+            char graphLabel[32];
+            std::snprintf(graphLabel, sizeof(graphLabel), "last %u frames", FrameStats::GraphFrames);
+            ImGui::PlotLines("##FrameTimes", m_FrameStats.GetGraph(), static_cast<int>(FrameStats::GraphFrames),
+                             static_cast<int>(m_FrameStats.GetGraphOffset()), graphLabel, 0.0f,
+                             std::max(frameTimes.MaxMs, frameSettings.HitchThresholdMs) * 1.1f, ImVec2(0, 60));
+            ImGui::Text("Hitches: %llu", static_cast<unsigned long long>(m_FrameStats.GetHitchCount()));
+            if (!m_FrameStats.GetHitches().empty()) {
+                const FrameHitch& hitch = m_FrameStats.GetHitches().back();
+                ImGui::Text("Last: frame %llu, %.1f ms (> %.1f ms)", static_cast<unsigned long long>(hitch.Frame),
+                            hitch.FrameMs, hitch.ThresholdMs);
+                for (const FrameHitchZone& zone : hitch.Zones) {
+                    ImGui::Text("  %s: %.2f ms", zone.Name.c_str(), zone.SelfMs);
+                }
+            }
+            bool frameSettingsChanged = ImGui::SliderFloat("Hitch Threshold (ms)", &frameSettings.HitchThresholdMs, 0.0f, 100.0f, "%.1f");
+            frameSettingsChanged |= ImGui::SliderFloat("Hitch x Median", &frameSettings.HitchMedianFactor, 0.0f, 5.0f, "%.1f");
+            if (frameSettingsChanged) {
+                m_FrameStats.SetSettings(frameSettings);
+            }
+            if (ImGui::Button("Write Frame Summary")) {
+                if (m_FrameStats.WriteSummary("frame_summary.json")) {
+                    std::cout << "Frame summary written to frame_summary.json" << std::endl;
+                }
+            }
             
+            ImGui::Separator();
+            ImGui::Text("Frame Pacing:");
+            FramePacingSettings pacingSettings = m_FramePacer.GetSettings();
+            bool vsync = m_Window->IsVSync();
+            if (ImGui::Checkbox("VSync", &vsync)) {
+                m_Window->SetVSync(vsync);
+            }
+            bool pacingChanged = ImGui::Checkbox("Low Latency", &pacingSettings.LowLatency);
+            if (pacingSettings.LowLatency) {
+                int queuedFrames = static_cast<int>(pacingSettings.MaxQueuedFrames);
+                if (ImGui::SliderInt("Max Queued Frames", &queuedFrames, 1, static_cast<int>(GraphicsDevice::MaxQueuedFramesLimit))) {
+                    pacingSettings.MaxQueuedFrames = static_cast<uint32_t>(queuedFrames);
+                    pacingChanged = true;
+                }
+            }
+            pacingChanged |= ImGui::SliderFloat("Frame Limit (fps)", &pacingSettings.TargetFps, 0.0f, 360.0f, "%.0f");
+            if (pacingChanged) {
+                m_FramePacer.SetSettings(pacingSettings);
+                m_Device->SetMaxQueuedFrames(pacingSettings.LowLatency ? pacingSettings.MaxQueuedFrames : 0);
+            }
+            const FramePacingStats& pacingStats = m_FramePacer.GetStats();
+            const FramePercentiles latency = m_FramePacer.GetLatencyPercentiles();
+            ImGui::Text("Input to swap: %.2f ms (p50 %.2f  p99 %.2f  max %.2f)",
+                        pacingStats.LatencyMs, latency.P50Ms, latency.P99Ms, latency.MaxMs);
+            ImGui::Text("Limiter wait %.2f ms (spin %.2f, oversleep %.2f), GPU queue wait %.2f ms",
+                        pacingStats.WaitMs, pacingStats.SpinMs, pacingStats.OversleepMs, m_Device->GetLastQueueWaitMs());
+            ImGui::Text("Missed deadlines: %llu", static_cast<unsigned long long>(pacingStats.MissedFrames));
+            if (ImGui::Button("Reset Latency")) {
+                m_FramePacer.ResetLatency();
+            }
+
+            ImGui::Separator();
+            ImGui::Text("Frame Memory:");
+            const FrameArenaStats& arenaStats = m_FrameArena.GetStats();
+            if (arenaStats.HeapAllocationsCounted) {
+                ImGui::Text("Heap allocations: %llu last frame", static_cast<unsigned long long>(arenaStats.HeapAllocations));
+            }
+            else {
+                ImGui::Text("Heap allocations: unavailable (HENKY_COUNT_HEAP_ALLOCATIONS is off)");
+            }
+            ImGui::Text("Frame arena: %.1f KB used, %.1f KB peak, %.1f KB reserved",
+                        arenaStats.UsedBytes / 1024.0f, arenaStats.PeakBytes / 1024.0f, arenaStats.CapacityBytes / 1024.0f);
+            ImGui::Text("Arena overflows: %llu", static_cast<unsigned long long>(arenaStats.Overflows));
+
+            ImGui::Separator();
+            ImGui::Text("Simulation:");
+            if (ImGui::Checkbox("Fixed Timestep", &m_FixedStepEnabled)) {
+                m_FixedTimestep.Reset();
+            }
+            if (m_FixedStepEnabled) {
+                int simulationHz = static_cast<int>(std::lround(1.0f / m_FixedTimestep.GetStep()));
+                if (ImGui::SliderInt("Simulation Hz", &simulationHz, 10, 240)) {
+                    m_FixedTimestep.SetStep(1.0f / static_cast<float>(simulationHz));
+                }
+                int maxSteps = static_cast<int>(m_FixedTimestep.GetMaxSteps());
+                if (ImGui::SliderInt("Max Steps per Frame", &maxSteps, 1, 16)) {
+                    m_FixedTimestep.SetMaxSteps(static_cast<uint32_t>(maxSteps));
+                }
+                ImGui::Text("Steps: %u  Alpha: %.2f  Dropped: %.1f ms", m_FixedTimestep.GetLastSteps(),
+                            m_FixedTimestep.GetAlpha(), m_FixedTimestep.GetDroppedTime() * 1000.0f);
+            }
+
             ImGui::Separator();
             ImGui::Text("Rendering:");
             ImGui::Checkbox("Enable Depth Prepass", &m_DepthPrepassEnabled);
@@ -275,14 +563,169 @@ private:
             m_Renderer->SetShadowsEnabled(m_ShadowsEnabled);
             if (m_ShadowsEnabled) {
                 ImGui::SliderFloat("Shadow Bias", &m_ShadowBias, 0.0f, 0.01f, "%.4f");
+                ShadowMap* shadowMap = m_Renderer->GetShadowMap();
+                int cascadeCount = static_cast<int>(shadowMap->GetCascadeCount());
+                if (ImGui::SliderInt("Cascades", &cascadeCount, 1, static_cast<int>(MaxShadowCascades))) {
+                    shadowMap->SetCascadeCount(static_cast<uint32_t>(cascadeCount));
+                }
+                float shadowDistance = shadowMap->GetSettings().MaxDistance;
+                if (ImGui::SliderFloat("Shadow Distance", &shadowDistance, 10.0f, 500.0f, "%.0f")) {
+                    shadowMap->SetMaxDistance(shadowDistance);
+                }
+                bool cacheStatic = shadowMap->GetSettings().CacheStaticCasters;
+                if (ImGui::Checkbox("Cache Static Shadows", &cacheStatic)) {
+                    shadowMap->SetCacheStaticCasters(cacheStatic);
+                }
+                bool recordCommands = m_Renderer->GetRecordCommands();
+                if (ImGui::Checkbox("Record Atlas Commands on Workers", &recordCommands)) {
+                    m_Renderer->SetRecordCommands(recordCommands);
+                }
             }
             
             ImGui::Separator();
             ImGui::Text("Stats:");
             auto& stats = m_Renderer->GetStats();
-            ImGui::Text("Draw Calls: %u", stats.DrawCount);
+            ImGui::Text("Draw Calls: %u (%u instances)", stats.DrawCount, stats.InstanceCount);
             ImGui::Text("Culled: %u", stats.CulledCount);
             ImGui::Text("Triangles: %u", stats.TriangleCount);
+            if (m_ShadowsEnabled) {
+                ImGui::Text("Shadow Draw Calls: %u (%u instances, %u culled)", stats.ShadowDrawCount,
+                            stats.ShadowInstanceCount, stats.ShadowCulledCount);
+                ImGui::Text("Shadow Triangles: %u", stats.ShadowTriangleCount);
+                auto& shadowStats = m_Renderer->GetShadowMap()->GetStats();
+                for (uint32_t i = 0; i < shadowStats.CascadeCount; i++) {
+                    const ShadowCascadeStats& cascade = shadowStats.Cascades[i];
+                    ImGui::Text("Cascade %u: %.1f m, %u casters, %u tris, %.3f ms%s", i,
+                                m_Renderer->GetShadowMap()->GetCascade(i).SplitFar, cascade.Casters,
+                                cascade.Triangles, cascade.GpuTimeMs, cascade.Cached ? " (cached)" : "");
+                }
+                ImGui::Text("Shadow Cache Rebuilds: %llu", static_cast<unsigned long long>(shadowStats.CacheRebuilds));
+                
+                auto& atlasStats = m_Renderer->GetShadowAtlas()->GetStats();
+                ImGui::Text("Local Lights: %u (%u shadowed, %u without tile)", m_Renderer->GetLocalLightCount(),
+                            atlasStats.ShadowedLights, atlasStats.LightsWithoutTile);
+                if (stats.SkippedLocalLights > 0) {
+                    ImGui::Text("Skipped Local Lights: %u over the limit of %u", stats.SkippedLocalLights, MaxLocalLights);
+                }
+                ImGui::Text("Atlas Tiles: %u rendered, %u cached, %u deferred, %.0f%% used", atlasStats.TilesRendered,
+                            atlasStats.TilesCached, atlasStats.TilesDeferred, atlasStats.Occupancy * 100.0f);
+            }
+            
+            if (m_ShadowsEnabled && stats.AtlasCommandCount > 0) {
+                ImGui::Text("Atlas Submit: %u commands, %.3f ms (%.0f ns/command, %s)", stats.AtlasCommandCount,
+                            stats.AtlasSubmitMs, stats.AtlasSubmitMs * 1.0e6f / stats.AtlasCommandCount,
+                            stats.AtlasRecorded ? "replay" : "direct");
+                if (stats.AtlasRecorded) {
+                    ImGui::Text("Atlas Recording: %.3f ms", stats.AtlasRecordMs);
+                }
+            }
+            
+            auto& clusterStats = m_Renderer->GetLightClusters()->GetStats();
+            ImGui::Text("Light Clusters: %u, %.2f avg / %u max lights, binning %.3f ms", clusterStats.ClusterCount,
+                        clusterStats.AverageLightsPerCluster, clusterStats.MaxLightsPerCluster, clusterStats.BinningTimeMs);
+            
+            auto& graphStats = m_FrameGraph->GetStats();
+            ImGui::Text("Frame Graph: %u passes (%u culled), %u transients in %u targets, %llu compiles",
+                        graphStats.PassCount, graphStats.CulledPassCount, graphStats.TransientResources,
+                        graphStats.PhysicalResources, static_cast<unsigned long long>(graphStats.CompileCount));
+            
+            auto& materialStats = m_Renderer->GetMaterialTable()->GetStats();
+            ImGui::Text("Materials: %u (%u uploaded), %s: %u", materialStats.MaterialCount,
+                        materialStats.MaterialsUploadedThisFrame,
+                        materialStats.Bindless ? "Bindless Handles" : "Array Layers", materialStats.ResidentHandles);
+            
+            auto& streamStats = m_Renderer->GetAssetRegistry()->GetTextureStreamer()->GetStats();
+            ImGui::Text("Textures Decoding: %u, Uploading: %u", streamStats.PendingDecodes, streamStats.PendingUploads);
+            ImGui::Text("Texture Upload: %.2f ms, %.1f KB", streamStats.UploadTimeMs,
+                        streamStats.BytesUploadedThisFrame / 1024.0f);
+            auto& residencyStats = m_Renderer->GetAssetRegistry()->GetTextureResidency()->GetStats();
+            ImGui::Text("Texture VRAM: %.2f / %.0f MB (%.2f MB pending)", residencyStats.ResidentBytes / (1024.0f * 1024.0f),
+                        residencyStats.BudgetBytes / (1024.0f * 1024.0f), residencyStats.PendingBytes / (1024.0f * 1024.0f));
+            ImGui::Text("Mip Requests: %u in flight, %u wanted, %llu total", residencyStats.PendingRequests,
+                        residencyStats.WantedTextures, static_cast<unsigned long long>(residencyStats.TotalRequests));
+            ImGui::Text("Mip Evictions: %llu", static_cast<unsigned long long>(residencyStats.TotalEvictions));
+            auto& assetStats = m_Renderer->GetAssetRegistry()->GetStats();
+            ImGui::Text("Textures: %u live, %u unreferenced, %llu evicted", assetStats.LiveTextures,
+                        assetStats.UnreferencedTextures, static_cast<unsigned long long>(assetStats.TotalEvictions));
+            auto& loaderStats = m_Renderer->GetAssetRegistry()->GetAssetLoader()->GetStats();
+            ImGui::Text("Async Loads: %u parsing, %u textures, %u materials pending", loaderStats.PendingParses,
+                        loaderStats.PendingTextures, loaderStats.PendingMaterials);
+            
+            ImGui::Separator();
+            GpuProfiler* gpuProfiler = m_Renderer->GetGpuProfiler();
+            const GpuFrameTimings& gpuFrame = gpuProfiler->GetLatestFrame();
+            ImGui::Text("GPU: %.3f ms (frame %llu)", gpuFrame.TotalMs, static_cast<unsigned long long>(gpuFrame.FrameIndex));
+            for (const GpuPassTiming& pass : gpuFrame.Passes) {
+                ImGui::Text("%*s%s: %.3f ms", static_cast<int>(pass.Depth * 2), "", pass.Name.c_str(), pass.GpuMs);
+                if (pass.HasStatistics) {
+                    ImGui::Text("%*s  %llu verts, %llu prims, %llu VS, %llu FS, %llu/%llu clipped",
+                                static_cast<int>(pass.Depth * 2), "",
+                                static_cast<unsigned long long>(pass.Statistics[GpuStatisticVertices]),
+                                static_cast<unsigned long long>(pass.Statistics[GpuStatisticPrimitives]),
+                                static_cast<unsigned long long>(pass.Statistics[GpuStatisticVertexInvocations]),
+                                static_cast<unsigned long long>(pass.Statistics[GpuStatisticFragmentInvocations]),
+                                static_cast<unsigned long long>(pass.Statistics[GpuStatisticClippingOutput]),
+                                static_cast<unsigned long long>(pass.Statistics[GpuStatisticClippingInput]));
+                }
+            }
+
+            DynamicResolution* dynamicResolution = m_Renderer->GetDynamicResolution();
+            DynamicResolutionSettings resolutionSettings = dynamicResolution->GetSettings();
+            bool resolutionChanged = ImGui::Checkbox("Dynamic Resolution", &resolutionSettings.Enabled);
+            if (resolutionSettings.Enabled) {
+                const DynamicResolutionStats& resolutionStats = dynamicResolution->GetStats();
+                ImGui::Text("Scale %.2f (%ux%u), GPU %.2f ms, scene %.2f ms, %llu changes",
+                            resolutionStats.Scale, resolutionStats.RenderWidth, resolutionStats.RenderHeight,
+                            resolutionStats.FrameGpuMs, resolutionStats.ScaledGpuMs,
+                            static_cast<unsigned long long>(resolutionStats.Adjustments));
+                resolutionChanged |= ImGui::SliderFloat("Target GPU (ms)", &resolutionSettings.TargetGpuMs, 2.0f, 33.0f, "%.1f");
+                resolutionChanged |= ImGui::SliderFloat("Min Scale", &resolutionSettings.MinScale, 0.25f, 1.0f, "%.2f");
+                resolutionChanged |= ImGui::SliderFloat("Max Scale", &resolutionSettings.MaxScale, 0.25f, 1.0f, "%.2f");
+                int filter = static_cast<int>(resolutionSettings.Filter);
+                if (ImGui::Combo("Upscale", &filter, "Bilinear blit\0Sharpen\0")) {
+                    resolutionSettings.Filter = static_cast<UpscaleFilter>(filter);
+                    resolutionChanged = true;
+                }
+                if (resolutionSettings.Filter == UpscaleFilter::Sharpen) {
+                    resolutionChanged |= ImGui::SliderFloat("Sharpness", &resolutionSettings.Sharpness, 0.0f, 1.0f, "%.2f");
+                }
+                if (!gpuProfiler->IsEnabled()) {
+                    ImGui::Text("Scale is held while GPU profiling is off");
+                }
+            }
+            if (resolutionChanged) {
+                dynamicResolution->SetSettings(resolutionSettings);
+            }
+            bool gpuProfiling = gpuProfiler->IsEnabled();
+            if (ImGui::Checkbox("GPU Profiling", &gpuProfiling)) {
+                gpuProfiler->SetEnabled(gpuProfiling);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Export GPU CSV")) {
+                if (gpuProfiler->ExportCsv("gpu_profile.csv")) {
+                    std::cout << "GPU profile written to gpu_profile.csv" << std::endl;
+                }
+            }
+            
+            ImGui::Separator();
+            bool cpuProfiling = Profiler::IsEnabled();
+            if (ImGui::Checkbox("CPU Profiling", &cpuProfiling)) {
+                Profiler::SetEnabled(cpuProfiling);
+            }
+            ImGui::SliderInt("Capture Frames", &m_CaptureFrames, 1, 600);
+            if (Profiler::IsCapturing()) {
+                ImGui::Text("Capturing frame %u/%u...", Profiler::GetCapturedFrames() + 1, Profiler::GetCaptureLength());
+            }
+            else if (ImGui::Button("Capture CPU Trace")) {
+                Profiler::SetEnabled(true);
+                Profiler::RequestCapture(static_cast<uint32_t>(m_CaptureFrames), "profile_capture.json");
+            }
+            ProfilerStats profilerStats = Profiler::GetStats();
+            if (profilerStats.CapturesWritten > 0) {
+                ImGui::Text("Last Trace: %s (%llu zones%s)", profilerStats.LastCapturePath.c_str(),
+                            static_cast<unsigned long long>(profilerStats.LastCaptureEvents),
+                            profilerStats.LastCaptureTruncated ? ", truncated" : "");
+            }
             
             ImGui::Separator();
             ImGui::Text("Controls:");
@@ -293,6 +736,45 @@ private:
                 ImGui::Text("Mouse: Look");
             }
 
+            ImGui::Separator();
+            ImGui::Text("Scene Snapshot:");
+            if (ImGui::Button("Save Scene")) {
+                WorldSnapshot::Save(m_ECS.get(), "scene.hsnap");
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Load Scene")) {
+                LoadScene("scene.hsnap");
+            }
+            if (m_SceneEntityCount > 0) {
+                ImGui::Text("Loaded %u entities in %.2f ms", m_SceneEntityCount, m_SceneLoadMs);
+            }
+
+            ImGui::Separator();
+            ImGui::Text("World Partition:");
+            if (ImGui::Button("Write World Cells")) {
+                WorldPartition::Build(m_ECS.get(), 64.0f, "world");
+            }
+            if (m_WorldPartition) {
+                const WorldPartitionStats& partitionStats = m_WorldPartition->GetStats();
+                ImGui::Text("Cells: %u resident, %u loading, %u pending of %u",
+                    partitionStats.ResidentCells, partitionStats.LoadingCells, partitionStats.PendingCells,
+                    m_WorldPartition->GetCellCount());
+                ImGui::Text("Entities: %u (%.1f MB mapped)", partitionStats.ResidentEntities,
+                    partitionStats.ResidentBytes / (1024.0f * 1024.0f));
+                ImGui::Text("Loaded %llu, unloaded %llu, failed %llu, update %.2f ms",
+                    static_cast<unsigned long long>(partitionStats.TotalLoaded),
+                    static_cast<unsigned long long>(partitionStats.TotalUnloaded),
+                    static_cast<unsigned long long>(partitionStats.TotalFailed), partitionStats.UpdateMs);
+
+                WorldPartitionSettings partitionSettings = m_WorldPartition->GetSettings();
+                bool changed = ImGui::SliderFloat("Load Radius", &partitionSettings.LoadRadius, 16.0f, 1024.0f);
+                changed |= ImGui::SliderFloat("Unload Radius", &partitionSettings.UnloadRadius, 16.0f, 1024.0f);
+                changed |= ImGui::SliderFloat("Stream Budget (ms)", &partitionSettings.InstantiateBudgetMs, 0.1f, 8.0f);
+                if (changed) {
+                    m_WorldPartition->SetSettings(partitionSettings);
+                }
+            }
+
             if (m_ECS->HasComponent<Camera>(m_CameraEntity)) {
                 ImGui::Separator();
                 auto& camera = m_ECS->GetComponent<Camera>(m_CameraEntity);
@@ -305,7 +787,10 @@ private:
         ImGui::End();
 
         ImGui::Render();
+        GpuProfiler* gpuProfiler = m_Renderer->GetGpuProfiler();
+        gpuProfiler->BeginPass("ImGui");
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        gpuProfiler->EndPass();
     }
 
     void OnResize() {
@@ -315,10 +800,14 @@ private:
         }
     }
 
+    FrameArena m_FrameArena;    // Shared with the renderer, so declared first and destroyed last
     std::unique_ptr<Window> m_Window;
     std::unique_ptr<GraphicsDevice> m_Device;
     std::unique_ptr<Renderer> m_Renderer;
     std::unique_ptr<ECSWorld> m_ECS;
+    std::unique_ptr<WorldPartition> m_WorldPartition;   // Declared after m_ECS so it is destroyed first
+    std::unique_ptr<FrameGraph> m_FrameGraph;
+    FrameGraphResource m_SceneColor = InvalidFrameGraphResource;
     entt::entity m_CameraEntity;
     bool m_Running = true;
     bool m_CameraControlEnabled = false;
@@ -327,6 +816,16 @@ private:
     float m_ShadowBias = 0.005f;
     float m_TotalTime = 0.0f;
     float m_DeltaTime = 0.0f;
+    FixedTimestep m_FixedTimestep;
+    bool m_FixedStepEnabled = true;
+    int m_CaptureFrames = 120;
+    uint32_t m_GlossyMaterial = 0;
+    uint32_t m_MetalMaterial = 0;
+    uint32_t m_SceneEntityCount = 0;
+    float m_SceneLoadMs = 0.0f;
+    std::string m_WorldDirectory;
+    FrameStats m_FrameStats;
+    FramePacer m_FramePacer;
 };
 
 int main(int argc, char** argv) {
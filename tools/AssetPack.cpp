@@ -0,0 +1,215 @@
+// Offline packing step: walks one or more asset directories and writes every
+// file into a single .hpak archive with a hashed, sorted table of contents. Each
+// directory keeps its own name in the stored paths, so packing "shaders" yields
+// "shaders/Forward.vs.glsl", matching the runtime FileSystem lookups. Paths are
+// stored as UTF-8. Entries that shrink enough are LZ4 compressed;
+// already-compressed formats (KTX2 with BCn data, PNG, ...) usually stay raw
+// and are then served zero-copy from the mapping.
+//
+// Usage: HenkyAssetPack <output.hpak> <dir> [<dir> ...] [--no-compress] [--min-savings 0.1]
+//        HenkyAssetPack --list <archive.hpak>
+
+#include "core/AssetArchive.h"
+#include "core/AssetId.h"
+#include "core/Lz4.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace Henky3D;
+namespace fs = std::filesystem;
+
+struct PackInput {
+    std::string Path;       // Relative archive path, UTF-8 with '/' separators
+    fs::path SourcePath;
+};
+
+static void PrintUsage() {
+    std::cerr << "Usage: HenkyAssetPack <output.hpak> <dir> [<dir> ...] [--no-compress] [--min-savings 0.1]" << std::endl;
+    std::cerr << "       HenkyAssetPack --list <archive.hpak>" << std::endl;
+}
+
+static bool ReadWholeFile(const fs::path& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::streamsize size = file.tellg();
+    data.resize(static_cast<size_t>(size));
+    file.seekg(0, std::ios::beg);
+    return size == 0 || static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), size));
+}
+
+static int ListArchive(const std::string& path) {
+    AssetArchive archive;
+    if (!archive.Open(path)) {
+        std::cerr << "Error: Failed to open " << path << std::endl;
+        return 1;
+    }
+    for (uint32_t i = 0; i < archive.GetEntryCount(); i++) {
+        const ArchiveEntry& entry = archive.GetEntries()[i];
+        std::cout << archive.GetEntryPath(entry) << "  " << entry.Size << " bytes";
+        if (entry.Compression == static_cast<uint32_t>(ArchiveCompression::Lz4)) {
+            std::cout << " (lz4 " << entry.StoredSize << ")";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << archive.GetEntryCount() << " entries, " << archive.GetSize() / 1024 << " KB" << std::endl;
+    return 0;
+}
+
+static void AlignTo(std::vector<uint8_t>& data, size_t alignment) {
+    data.resize((data.size() + alignment - 1) / alignment * alignment, 0);
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::strcmp(argv[1], "--list") == 0) {
+        return ListArchive(argv[2]);
+    }
+    if (argc < 3) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::string outputPath = argv[1];
+    std::vector<fs::path> roots;
+    bool compress = true;
+    float minSavings = 0.1f;
+
+    for (int i = 2; i < argc; i++) {
+        if (std::strcmp(argv[i], "--no-compress") == 0) {
+            compress = false;
+        } else if (std::strcmp(argv[i], "--min-savings") == 0 && i + 1 < argc) {
+            minSavings = std::stof(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            PrintUsage();
+            return 1;
+        } else {
+            roots.push_back(argv[i]);
+        }
+    }
+    if (roots.empty()) {
+        PrintUsage();
+        return 1;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    // Gather inputs; the archive is keyed by the path below each directory's parent
+    std::vector<PackInput> inputs;
+    for (const fs::path& root : roots) {
+        std::error_code error;
+        if (!fs::is_directory(root, error)) {
+            std::cerr << "Error: Not a directory: " << root.string() << std::endl;
+            return 1;
+        }
+        const fs::path base = fs::weakly_canonical(root).parent_path();
+        for (const auto& item : fs::recursive_directory_iterator(root)) {
+            if (!item.is_regular_file() || fs::equivalent(item.path(), outputPath, error)) {
+                continue;
+            }
+            PackInput input;
+            // UTF-8 regardless of the locale, the encoding HashAssetPath expects
+            const std::u8string path = fs::relative(fs::weakly_canonical(item.path()), base).generic_u8string();
+            input.Path.assign(path.begin(), path.end());
+            input.SourcePath = item.path();
+            inputs.push_back(std::move(input));
+        }
+    }
+
+    std::vector<ArchiveEntry> entries(inputs.size());
+    std::unordered_map<AssetId, size_t> owners;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        entries[i].PathHash = HashAssetPath(inputs[i].Path);
+        auto [it, inserted] = owners.emplace(entries[i].PathHash, i);
+        if (!inserted) {
+            std::cerr << "Error: " << inputs[i].Path << " collides with " << inputs[it->second].Path << std::endl;
+            return 1;
+        }
+    }
+
+    // Sort inputs by hash so the table can be binary searched at runtime
+    std::vector<size_t> order(inputs.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&entries](size_t a, size_t b) {
+        return entries[a].PathHash < entries[b].PathHash;
+    });
+
+    std::vector<uint8_t> paths;
+    std::vector<ArchiveEntry> toc;
+    toc.reserve(order.size());
+    for (size_t index : order) {
+        ArchiveEntry entry = entries[index];
+        entry.PathOffset = static_cast<uint32_t>(paths.size());
+        paths.insert(paths.end(), inputs[index].Path.begin(), inputs[index].Path.end());
+        paths.push_back(0);
+        toc.push_back(entry);
+    }
+
+    ArchiveHeader header = {};
+    header.Magic = ArchiveHeader::MagicValue;
+    header.Version = ArchiveHeader::CurrentVersion;
+    header.EntryCount = static_cast<uint32_t>(toc.size());
+    header.TocOffset = sizeof(ArchiveHeader);
+    header.PathsOffset = header.TocOffset + toc.size() * sizeof(ArchiveEntry);
+
+    std::vector<uint8_t> archive(header.PathsOffset);
+    archive.insert(archive.end(), paths.begin(), paths.end());
+
+    size_t sourceBytes = 0;
+    uint32_t compressedCount = 0;
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> packed;
+    for (size_t i = 0; i < toc.size(); i++) {
+        const PackInput& input = inputs[order[i]];
+        if (!ReadWholeFile(input.SourcePath, data)) {
+            std::cerr << "Error: Failed to read " << input.SourcePath.string() << std::endl;
+            return 1;
+        }
+        sourceBytes += data.size();
+
+        ArchiveEntry& entry = toc[i];
+        entry.Size = data.size();
+        entry.Compression = static_cast<uint32_t>(ArchiveCompression::None);
+
+        packed.clear();
+        if (compress && !data.empty()) {
+            Lz4::Compress(data.data(), data.size(), packed);
+        }
+        const bool useLz4 = !packed.empty() &&
+            static_cast<float>(packed.size()) <= static_cast<float>(data.size()) * (1.0f - minSavings);
+        const std::vector<uint8_t>& stored = useLz4 ? packed : data;
+        if (useLz4) {
+            entry.Compression = static_cast<uint32_t>(ArchiveCompression::Lz4);
+            compressedCount++;
+        }
+
+        AlignTo(archive, AssetArchive::PayloadAlignment);
+        entry.Offset = archive.size();
+        entry.StoredSize = stored.size();
+        archive.insert(archive.end(), stored.begin(), stored.end());
+    }
+
+    std::memcpy(archive.data(), &header, sizeof(header));
+    std::memcpy(archive.data() + header.TocOffset, toc.data(), toc.size() * sizeof(ArchiveEntry));
+
+    std::ofstream output(outputPath, std::ios::binary);
+    if (!output.is_open() || !output.write(reinterpret_cast<const char*>(archive.data()), archive.size())) {
+        std::cerr << "Error: Failed to write " << outputPath << std::endl;
+        return 1;
+    }
+
+    float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Packed " << toc.size() << " files -> " << outputPath << ": " << archive.size() / 1024 << " KB ("
+              << sourceBytes / 1024 << " KB source, " << compressedCount << " LZ4 compressed), "
+              << elapsedMs << " ms" << std::endl;
+    return 0;
+}
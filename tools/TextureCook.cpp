@@ -0,0 +1,101 @@
+// Offline texture cook step: decodes a source image, builds its mip chain,
+// block-compresses every level and writes the result as a KTX2 file.
+//
+// Usage: HenkyTextureCook <input> <output.ktx2> [--format bc1|bc3|bc5|bc7] [--no-mips] [--threads N]
+
+#include "core/JobSystem.h"
+#include "graphics/TextureCompression.h"
+#include "graphics/Ktx2.h"
+#include <stb_image.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace Henky3D;
+
+static bool ParseFormat(const std::string& name, BlockFormat& format) {
+    if (name == "bc1") { format = BlockFormat::BC1; return true; }
+    if (name == "bc3") { format = BlockFormat::BC3; return true; }
+    if (name == "bc5") { format = BlockFormat::BC5; return true; }
+    if (name == "bc7") { format = BlockFormat::BC7; return true; }
+    return false;
+}
+
+static void PrintUsage() {
+    std::cerr << "Usage: HenkyTextureCook <input> <output.ktx2> [--format bc1|bc3|bc5|bc7] [--no-mips] [--threads N]" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        PrintUsage();
+        return 1;
+    }
+
+    std::string inputPath = argv[1];
+    std::string outputPath = argv[2];
+    BlockFormat format = BlockFormat::BC7;
+    bool generateMips = true;
+    uint32_t threadCount = 0;
+
+    for (int i = 3; i < argc; i++) {
+        if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            if (!ParseFormat(argv[++i], format)) {
+                std::cerr << "Error: Unknown format: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--no-mips") == 0) {
+            generateMips = false;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    int width = 0, height = 0, channels = 0;
+    stbi_uc* pixels = stbi_load(inputPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        std::cerr << "Error: Failed to load " << inputPath << ": " << stbi_failure_reason() << std::endl;
+        return 1;
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+
+    std::vector<MipImage> chain;
+    if (generateMips) {
+        chain = TextureCompression::GenerateMipChain(pixels, width, height);
+    } else {
+        MipImage base;
+        base.Width = static_cast<uint32_t>(width);
+        base.Height = static_cast<uint32_t>(height);
+        base.Pixels.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        chain.push_back(std::move(base));
+    }
+    stbi_image_free(pixels);
+
+    JobSystem jobSystem(threadCount);
+    std::vector<std::vector<uint8_t>> levels;
+    size_t totalBytes = 0;
+    for (const auto& mip : chain) {
+        levels.push_back(TextureCompression::Compress(mip.Pixels.data(), mip.Width, mip.Height, format, &jobSystem));
+        totalBytes += levels.back().size();
+    }
+
+    std::vector<uint8_t> file = Ktx2::Write(Ktx2::GetVkFormat(format), width, height, levels);
+    std::ofstream output(outputPath, std::ios::binary);
+    if (!output.is_open() || !output.write(reinterpret_cast<const char*>(file.data()), file.size())) {
+        std::cerr << "Error: Failed to write " << outputPath << std::endl;
+        return 1;
+    }
+
+    float elapsedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Cooked " << inputPath << " -> " << outputPath << ": " << width << "x" << height
+              << ", " << levels.size() << " mips, " << totalBytes / 1024 << " KB ("
+              << (static_cast<size_t>(width) * height * 4) / 1024 << " KB uncompressed base), "
+              << elapsedMs << " ms on " << jobSystem.GetWorkerCount() + 1 << " threads" << std::endl;
+    return 0;
+}